@@ -18,6 +18,8 @@ public class OSMDataAssets : ModuleRules
 		PrivateIncludePaths.AddRange(
 			new string[] {
 				// ... add other private include paths required here ...
+				"OSMDataAssets/Private",
+				"OSMDataAssets/Private/Helpers"
 			}
 			);
 
@@ -40,6 +42,7 @@ public class OSMDataAssets : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"XmlParser",
 				// ... add private dependencies that you statically link with here ...
 			}
 			);
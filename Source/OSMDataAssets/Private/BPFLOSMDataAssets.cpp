@@ -4,6 +4,39 @@
 #include "BPFLOSMDataAssets.h"
 #include "PolygonHelper.h"
 #include "Algo/Reverse.h"
+#include "OSMBatchProjection.h"
+#include "OSMBuildingBlob.h"
+#include "OSMFlatGeobuf.h"
+#include "OSMGeometryKernels.h"
+#include "OSMPolygonValidity.h"
+#include "OSMRasterizer.h"
+#include "Async/ParallelFor.h"
+#include "Engine/Texture2D.h"
+#include "Runtime/Launch/Resources/Version.h"
+
+namespace
+{
+    /** Coordinates of a footprint that does not reference a vertex pool */
+    void GetCoordinates(const FOSMFootprint& Footprint, TArray<FOSMGeoPoint>& OutCoordinates)
+    {
+        if(Footprint.PolygonCoordinates.Num() > 0) {
+            OutCoordinates = Footprint.PolygonCoordinates;
+            return;
+        }
+        OutCoordinates.Reset(Footprint.PolygonPoints.Num());
+        for(const FVector& Point : Footprint.PolygonPoints) {
+            OutCoordinates.Add(FOSMGeoPoint::FromVector(Point));
+        }
+    }
+
+    void MarkInvalid(TArray<int32>& InvalidBuildings, int32 BuildingIndex)
+    {
+        // rings of one building are visited next to each other
+        if(InvalidBuildings.Num() == 0 || InvalidBuildings.Last() != BuildingIndex) {
+            InvalidBuildings.Add(BuildingIndex);
+        }
+    }
+}
 
 bool UBPFLOSMDataAssets::CheckAndRepairBuildingData(AGeoReferenceActor * GeoReference, FBuildingData &Building, float MinVertexDistance)
 {
@@ -23,17 +56,278 @@ bool UBPFLOSMDataAssets::CheckAndRepairMPBuildingData(AGeoReferenceActor * GeoRe
     return ret;
 }
 
+bool UBPFLOSMDataAssets::ExportBuildingBlob(UOSMDataAsset * Asset, const FString &Filename)
+{
+    return FOSMBuildingBlob::WriteToFile(Asset, Filename);
+}
+
+bool UBPFLOSMDataAssets::ExportFlatGeobuf(UOSMDataAsset * Asset, const FString &Filename)
+{
+    return FOSMFlatGeobuf::WriteToFile(Asset, Filename);
+}
+
+bool UBPFLOSMDataAssets::ImportFlatGeobuf(UOSMDataAsset * Asset, const FString &Filename)
+{
+    return FOSMFlatGeobuf::ReadFromFile(Filename, Asset);
+}
+
+bool UBPFLOSMDataAssets::ImportFlatGeobufInBounds(UOSMDataAsset * Asset, const FString &Filename, const FOSMGeoPoint &Min, const FOSMGeoPoint &Max)
+{
+    return FOSMFlatGeobuf::ReadFromFileInBounds(Filename, Min, Max, Asset);
+}
+
+FOSMValidationReport UBPFLOSMDataAssets::ValidateAsset(UOSMDataAsset * Asset)
+{
+    FOSMValidationReport Report;
+    if(!Asset) {
+        return Report;
+    }
+
+    FOSMPackedRings Rings;
+    TArray<FOSMRingSource> Sources;
+    FOSMGeometryKernels::PackAsset(Asset, Rings, Sources);
+    TArray<FOSMRingAnalysis> Results;
+    FOSMGeometryKernels::AnalyzeRingsParallel(Rings, Results);
+
+    // exact test for rings the precheck could not prove simple
+    TArray<bool> SelfIntersecting;
+    SelfIntersecting.SetNumZeroed(Results.Num());
+    ParallelFor(Results.Num(), [&](int32 i)
+    {
+        if(EnumHasAnyFlags(Results[i].Flags, EOSMRingFlags::SelfIntersectionCandidate)
+            && !EnumHasAnyFlags(Results[i].Flags, EOSMRingFlags::Degenerate))
+        {
+            TArray<FOSMGeoPoint> Points;
+            if(Sources[i].PartIndex == INDEX_NONE) {
+                Asset->GetBuildingCoordinates(Sources[i].BuildingIndex, Points);
+            } else {
+                Asset->GetMPBuildingPartCoordinates(Sources[i].BuildingIndex, Sources[i].PartIndex, Points);
+            }
+            SelfIntersecting[i] = FOSMPolygonValidity::HasSelfIntersection(Points);
+        }
+    });
+
+    TArray<int32> HolesOutsideOuter;
+    HolesOutsideOuter.SetNumZeroed(Asset->MultiPolygonBuildings.Num());
+    ParallelFor(HolesOutsideOuter.Num(), [&](int32 i)
+    {
+        HolesOutsideOuter[i] = CountHolesOutsideOuter(Asset->MultiPolygonBuildings[i], [Asset](const FMPBuildingPart& Part, TArray<FOSMGeoPoint>& OutPoints)
+        {
+            Asset->ResolveCoordinates(Part, OutPoints);
+        });
+    });
+
+    Report.NumRings = Results.Num();
+    for(int32 i = 0; i < Results.Num(); i++) {
+        const FOSMRingAnalysis& Result = Results[i];
+        const FOSMRingSource& Source = Sources[i];
+        TArray<int32>& Invalid = Source.PartIndex == INDEX_NONE ? Report.InvalidBuildings : Report.InvalidMPBuildings;
+        if(EnumHasAnyFlags(Result.Flags, EOSMRingFlags::Degenerate)) {
+            Report.NumDegenerate++;
+            MarkInvalid(Invalid, Source.BuildingIndex);
+            continue;
+        }
+        if(EnumHasAnyFlags(Result.Flags, EOSMRingFlags::Clockwise) != Source.bIsInner) {
+            Report.NumWrongWinding++;
+        }
+        if(EnumHasAnyFlags(Result.Flags, EOSMRingFlags::SelfIntersectionCandidate)) {
+            Report.NumSelfIntersectionCandidates++;
+        }
+        if(SelfIntersecting[i]) {
+            Report.NumSelfIntersecting++;
+            MarkInvalid(Invalid, Source.BuildingIndex);
+        }
+    }
+    for(int32 i = 0; i < HolesOutsideOuter.Num(); i++) {
+        if(HolesOutsideOuter[i] > 0) {
+            Report.NumHolesOutsideOuter += HolesOutsideOuter[i];
+            Report.InvalidMPBuildings.AddUnique(i);
+        }
+    }
+    Report.InvalidMPBuildings.Sort();
+    return Report;
+}
+
+FOSMValidationReport UBPFLOSMDataAssets::RepairAsset(UOSMDataAsset * Asset)
+{
+    if(!Asset) {
+        return FOSMValidationReport();
+    }
+
+    TArray<int32> Repaired;
+    Repaired.SetNumZeroed(Asset->Buildings.Num() + Asset->MultiPolygonBuildings.Num());
+    ParallelFor(Asset->Buildings.Num(), [&](int32 i)
+    {
+        FBuildingData& Building = Asset->Buildings[i];
+        TArray<FOSMGeoPoint> Resolved;
+        Asset->ResolveCoordinates(Building, Resolved);
+        Repaired[i] = RepairRing(Building, Resolved) ? 1 : 0;
+    });
+    ParallelFor(Asset->MultiPolygonBuildings.Num(), [&](int32 i)
+    {
+        Repaired[Asset->Buildings.Num() + i] = RepairMPBuilding(Asset->MultiPolygonBuildings[i], [Asset](const FMPBuildingPart& Part, TArray<FOSMGeoPoint>& OutPoints)
+        {
+            Asset->ResolveCoordinates(Part, OutPoints);
+        });
+    });
+
+    FOSMValidationReport Report = ValidateAsset(Asset);
+    for(const int32 Count : Repaired) {
+        Report.NumRepairedRings += Count;
+    }
+    return Report;
+}
+
+bool UBPFLOSMDataAssets::CheckBuildingPolygon(FBuildingData &Building, bool bRepair)
+{
+    if(Building.PolygonIndices.Num() > 0) {
+        UE_LOG(LogTemp, Warning, TEXT("UBPFLOSMDataAssets: Building %lld uses a shared vertex pool, check its asset instead"), Building.ID)
+        return false;
+    }
+    TArray<FOSMGeoPoint> Coordinates;
+    GetCoordinates(Building, Coordinates);
+    if(bRepair && RepairRing(Building, Coordinates)) {
+        GetCoordinates(Building, Coordinates);
+    }
+    return Coordinates.Num() >= 3
+        && FOSMPolygonValidity::SignedArea(Coordinates) != 0.0
+        && !FOSMPolygonValidity::HasSelfIntersection(Coordinates);
+}
+
+bool UBPFLOSMDataAssets::CheckMPBuildingPolygons(FMPBuildingData &Building, bool bRepair)
+{
+    for(const auto &Part : Building.Parts) {
+        if(Part.PolygonIndices.Num() > 0) {
+            UE_LOG(LogTemp, Warning, TEXT("UBPFLOSMDataAssets: Building %lld uses a shared vertex pool, check its asset instead"), Building.ID)
+            return false;
+        }
+    }
+    auto Resolve = [](const FMPBuildingPart& Part, TArray<FOSMGeoPoint>& OutPoints)
+    {
+        GetCoordinates(Part, OutPoints);
+    };
+    if(bRepair) {
+        RepairMPBuilding(Building, Resolve);
+    }
+    TArray<FOSMGeoPoint> Coordinates;
+    for(const auto &Part : Building.Parts) {
+        GetCoordinates(Part, Coordinates);
+        if(Coordinates.Num() < 3
+            || FOSMPolygonValidity::SignedArea(Coordinates) == 0.0
+            || FOSMPolygonValidity::HasSelfIntersection(Coordinates))
+        {
+            return false;
+        }
+    }
+    return CountHolesOutsideOuter(Building, Resolve) == 0;
+}
+
+bool UBPFLOSMDataAssets::RasterizeFootprints(UOSMDataAsset * Asset, const FOSMGeoPoint &Min, const FOSMGeoPoint &Max, int32 Width, int32 Height, FOSMFootprintRaster &OutRaster)
+{
+    OutRaster = FOSMFootprintRaster();
+    if(!Asset || Width <= 0 || Height <= 0 || Min.LongitudeE7 >= Max.LongitudeE7 || Min.LatitudeE7 >= Max.LatitudeE7) {
+        UE_LOG(LogTemp, Error, TEXT("UBPFLOSMDataAssets: Invalid asset, raster size %dx%d or bounds"), Width, Height)
+        return false;
+    }
+    OutRaster.Width = Width;
+    OutRaster.Height = Height;
+    OutRaster.Min = Min;
+    OutRaster.Max = Max;
+    OutRaster.Coverage.SetNumZeroed(Width * Height);
+    OutRaster.BuildingIndices.Init(INDEX_NONE, Width * Height);
+    OutRaster.Heights.SetNumZeroed(Width * Height);
+
+    // polygon p of the rasterizer is building PolygonBuildings[p]
+    FOSMScanlineRasterizer Rasterizer(Min, Max, Width, Height);
+    TArray<int32> PolygonBuildings;
+    TArray<float> PolygonHeights;
+    PolygonBuildings.Reserve(Asset->Buildings.Num() + Asset->MultiPolygonBuildings.Num());
+    PolygonHeights.Reserve(PolygonBuildings.Max());
+    TArray<FOSMGeoPoint> Coordinates;
+    for(int32 b = 0; b < Asset->Buildings.Num(); b++) {
+        const FBuildingData& Building = Asset->Buildings[b];
+        Rasterizer.BeginPolygon();
+        Asset->ResolveCoordinates(Building, Coordinates);
+        Rasterizer.AddRing(Coordinates);
+        PolygonBuildings.Add(b);
+        PolygonHeights.Add(Building.Height);
+    }
+    for(int32 b = 0; b < Asset->MultiPolygonBuildings.Num(); b++) {
+        const FMPBuildingData& Building = Asset->MultiPolygonBuildings[b];
+        Rasterizer.BeginPolygon();
+        for(const FMPBuildingPart& Part : Building.Parts) {
+            Asset->ResolveCoordinates(Part, Coordinates);
+            Rasterizer.AddRing(Coordinates);
+        }
+        PolygonBuildings.Add(Asset->Buildings.Num() + b);
+        PolygonHeights.Add(Building.Height);
+    }
+
+    Rasterizer.Rasterize([&](int32 Polygon, int32 Row, int32 FirstColumn, int32 EndColumn)
+    {
+        const float BuildingHeight = PolygonHeights[Polygon];
+        for(int32 i = Row * Width + FirstColumn; i < Row * Width + EndColumn; i++) {
+            OutRaster.Coverage[i] = 0xFF;
+            if(OutRaster.BuildingIndices[i] == INDEX_NONE || BuildingHeight > OutRaster.Heights[i]) {
+                OutRaster.BuildingIndices[i] = PolygonBuildings[Polygon];
+                OutRaster.Heights[i] = BuildingHeight;
+            }
+        }
+    });
+    return true;
+}
+
+UTexture2D * UBPFLOSMDataAssets::CreateFootprintHeightTexture(const FOSMFootprintRaster &Raster)
+{
+    if(Raster.Width <= 0 || Raster.Height <= 0 || Raster.Heights.Num() != Raster.Width * Raster.Height) {
+        return nullptr;
+    }
+    UTexture2D * Texture = UTexture2D::CreateTransient(Raster.Width, Raster.Height, PF_R32_FLOAT);
+    if(!Texture) {
+        return nullptr;
+    }
+#if ENGINE_MAJOR_VERSION >= 5
+    FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+#else
+    FTexture2DMipMap& Mip = Texture->PlatformData->Mips[0];
+#endif
+    void * Data = Mip.BulkData.Lock(LOCK_READ_WRITE);
+    FMemory::Memcpy(Data, Raster.Heights.GetData(), Raster.Heights.Num() * sizeof(float));
+    Mip.BulkData.Unlock();
+
+    Texture->SRGB = false;
+    Texture->Filter = TF_Nearest;
+    Texture->UpdateResource();
+    return Texture;
+}
+
+bool UBPFLOSMDataAssets::ProjectToGameCoordinates(AGeoReferenceActor * GeoReference, const TArray<FVector> &GeoPoints, TArray<FVector> &OutGamePoints)
+{
+    OutGamePoints.Reset();
+    if(!GeoReference) {
+        UE_LOG(LogTemp, Error, TEXT("UBPFLOSMDataAssets: ProjectToGameCoordinates needs a GeoReference"))
+        return false;
+    }
+    FOSMBatchProjection::ProjectPoints(GeoReference, GeoPoints, OutGamePoints);
+    return true;
+}
+
 bool UBPFLOSMDataAssets::CheckFloorPlanVertexDistance(AGeoReferenceActor * GeoReference, TArray<FVector> &FloorPlan, float MinVertexDistance)
 {
     TSet<int> RemovalCandidates;
 
+    // every vertex is projected once instead of twice
+    TArray<FVector> GamePoints;
+    FOSMBatchProjection::ProjectPoints(GeoReference, FloorPlan, GamePoints);
+    if(GamePoints.Num() != FloorPlan.Num()) {
+        // ProjectPoints logged the missing GeoReference
+        return false;
+    }
+
     // find consecutive vertices with game distance smaller MinVertexDistance
     for(int i = 0; i < FloorPlan.Num(); i++){
-        auto ThisGeo     = FloorPlan[i];
-        auto NextGeo     = FloorPlan[(i+1)%(FloorPlan.Num()-1)];
-
-        auto ThisOne = GeoReference->ToGameCoordinate(ThisGeo);
-        auto NextOne = GeoReference->ToGameCoordinate(NextGeo);
+        auto ThisOne = GamePoints[i];
+        auto NextOne = GamePoints[(i+1)%(FloorPlan.Num()-1)];
 
         if(FVector::Distance(ThisOne, NextOne) < MinVertexDistance) {
             RemovalCandidates.Add(i+1);
@@ -60,3 +354,72 @@ bool UBPFLOSMDataAssets::CheckFloorPlanWindingOrder(TArray<FVector> &FloorPlan,
     }
     return true;
 }
+
+bool UBPFLOSMDataAssets::RepairRing(FOSMFootprint &Footprint, const TArray<FOSMGeoPoint> &Resolved)
+{
+    TArray<int32> Keep;
+    if(!FOSMPolygonValidity::FindRedundantVertices(Resolved, Keep)) {
+        return false;
+    }
+    Footprint.KeepVertices(Keep);
+    return true;
+}
+
+int32 UBPFLOSMDataAssets::RepairMPBuilding(FMPBuildingData &Building, TFunctionRef<void(const FMPBuildingPart&, TArray<FOSMGeoPoint>&)> Resolve)
+{
+    int32 NumRepaired = 0;
+    TArray<FOSMGeoPoint> Resolved;
+    for(int32 i = Building.Parts.Num() - 1; i >= 0; i--) {
+        FMPBuildingPart& Part = Building.Parts[i];
+        Resolve(Part, Resolved);
+        if(RepairRing(Part, Resolved)) {
+            NumRepaired++;
+            Resolve(Part, Resolved);
+        }
+        if(Resolved.Num() < 3 || FOSMPolygonValidity::SignedArea(Resolved) == 0.0) {
+            Building.Parts.RemoveAt(i);
+            NumRepaired++;
+        }
+    }
+
+    TArray<TArray<FOSMGeoPoint>> Outers;
+    for(const auto &Part : Building.Parts) {
+        if(!Part.bIsInner) {
+            Resolve(Part, Outers.AddDefaulted_GetRef());
+        }
+    }
+    for(int32 i = Building.Parts.Num() - 1; i >= 0; i--) {
+        if(!Building.Parts[i].bIsInner) {
+            continue;
+        }
+        Resolve(Building.Parts[i], Resolved);
+        if(!Outers.ContainsByPredicate([&Resolved](const TArray<FOSMGeoPoint>& Outer) { return FOSMPolygonValidity::IsInside(Resolved[0], Outer); })) {
+            Building.Parts.RemoveAt(i);
+            NumRepaired++;
+        }
+    }
+    return NumRepaired;
+}
+
+int32 UBPFLOSMDataAssets::CountHolesOutsideOuter(const FMPBuildingData &Building, TFunctionRef<void(const FMPBuildingPart&, TArray<FOSMGeoPoint>&)> Resolve)
+{
+    TArray<TArray<FOSMGeoPoint>> Outers;
+    for(const auto &Part : Building.Parts) {
+        if(!Part.bIsInner) {
+            Resolve(Part, Outers.AddDefaulted_GetRef());
+        }
+    }
+
+    int32 NumOutside = 0;
+    TArray<FOSMGeoPoint> Hole;
+    for(const auto &Part : Building.Parts) {
+        if(!Part.bIsInner) {
+            continue;
+        }
+        Resolve(Part, Hole);
+        if(Hole.Num() > 0 && !Outers.ContainsByPredicate([&Hole](const TArray<FOSMGeoPoint>& Outer) { return FOSMPolygonValidity::IsInside(Hole[0], Outer); })) {
+            NumOutside++;
+        }
+    }
+    return NumOutside;
+}
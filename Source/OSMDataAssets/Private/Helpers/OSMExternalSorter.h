@@ -0,0 +1,181 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Algo/IsSorted.h"
+#include "Algo/Sort.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+/**
+ * Sorts more records than fit into memory. Records are collected in a buffer, every full buffer is sorted and
+ * written to a run file, and the runs are merged while reading them back. If all records fit into the read
+ * budget nothing is written to disk.
+ *
+ * T has to be trivially copyable, run files are raw memory dumps that are only valid for this process.
+ */
+template<typename T, typename TLess>
+class TOSMExternalSorter
+{
+public:
+    /** Run files are named after Name and created in Directory, BufferBytes bounds the memory while adding */
+    TOSMExternalSorter(const FString& InDirectory, const FString& InName, int64 BufferBytes, TLess InLess = TLess())
+        : Directory(InDirectory)
+        , Name(InName)
+        , Capacity(static_cast<int32>(FMath::Clamp<int64>(BufferBytes / sizeof(T), 1024, MAX_int32 / 2)))
+        , Less(InLess)
+    {
+    }
+
+    ~TOSMExternalSorter()
+    {
+        for(FRun& Run : Runs) {
+            Run.Reader.Reset();
+            IFileManager::Get().Delete(*Run.Filename, false, false, true);
+        }
+    }
+
+    bool Add(const T& Record)
+    {
+        Buffer.Add(Record);
+        return Buffer.Num() < Capacity || WriteRun();
+    }
+
+    /**
+     * Ends adding, afterwards Next returns all records in order. ReadBytes is shared by the read buffers of all
+     * runs, the records stay in memory without any run if they fit into it.
+     */
+    bool Finish(int64 ReadBytes)
+    {
+        if(Runs.Num() == 0 && static_cast<int64>(Buffer.Num()) * sizeof(T) <= ReadBytes) {
+            SortBuffer();
+            return true;
+        }
+        if(Buffer.Num() > 0 && !WriteRun()) {
+            return false;
+        }
+        Buffer.Empty();
+
+        const int64 BlockRecords = FMath::Clamp<int64>(ReadBytes / Runs.Num() / sizeof(T), 256, Capacity);
+        auto HeapLess = [this](int32 A, int32 B)
+        {
+            return Less(Runs[A].Block[Runs[A].Position], Runs[B].Block[Runs[B].Position]);
+        };
+        for(int32 r = 0; r < Runs.Num(); r++) {
+            FRun& Run = Runs[r];
+            Run.BlockRecords = static_cast<int32>(BlockRecords);
+            Run.Reader.Reset(IFileManager::Get().CreateFileReader(*Run.Filename));
+            if(!Run.Reader || !ReadBlock(Run)) {
+                UE_LOG(LogTemp, Error, TEXT("TOSMExternalSorter: Failed to read %s"), *Run.Filename)
+                return false;
+            }
+            Heap.HeapPush(r, HeapLess);
+        }
+        return true;
+    }
+
+    /** Next record in order, false after the last one or on a read error */
+    bool Next(T& OutRecord)
+    {
+        if(Runs.Num() == 0) {
+            if(BufferPosition >= Buffer.Num()) {
+                return false;
+            }
+            OutRecord = Buffer[BufferPosition++];
+            return true;
+        }
+        if(Heap.Num() == 0 || bIsError) {
+            return false;
+        }
+        auto HeapLess = [this](int32 A, int32 B)
+        {
+            return Less(Runs[A].Block[Runs[A].Position], Runs[B].Block[Runs[B].Position]);
+        };
+        int32 r;
+        Heap.HeapPop(r, HeapLess);
+        FRun& Run = Runs[r];
+        OutRecord = Run.Block[Run.Position++];
+        if(Run.Position == Run.Block.Num()) {
+            if(Run.Remaining == 0) {
+                return true;
+            }
+            if(!ReadBlock(Run)) {
+                UE_LOG(LogTemp, Error, TEXT("TOSMExternalSorter: Failed to read %s"), *Run.Filename)
+                bIsError = true;
+                return true;
+            }
+        }
+        Heap.HeapPush(r, HeapLess);
+        return true;
+    }
+
+    bool IsError() const { return bIsError; }
+
+    int64 Num() const { return NumRecords + Buffer.Num(); }
+
+private:
+    struct FRun
+    {
+        FString Filename;
+        TUniquePtr<FArchive> Reader;
+        TArray<T> Block;
+        int32 Position = 0;
+        int32 BlockRecords = 0;
+        int64 Remaining = 0;
+    };
+
+    void SortBuffer()
+    {
+        // OSM files list their elements by ID, so node runs usually are sorted already
+        if(!Algo::IsSorted(Buffer, Less)) {
+            Algo::Sort(Buffer, Less);
+        }
+    }
+
+    bool WriteRun()
+    {
+        SortBuffer();
+        FRun& Run = Runs.AddDefaulted_GetRef();
+        Run.Filename = FPaths::Combine(Directory, FString::Printf(TEXT("%s_%d.run"), *Name, Runs.Num() - 1));
+        Run.Remaining = Buffer.Num();
+        TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Run.Filename));
+        if(!Writer) {
+            UE_LOG(LogTemp, Error, TEXT("TOSMExternalSorter: Failed to create %s"), *Run.Filename)
+            bIsError = true;
+            return false;
+        }
+        Writer->Serialize(Buffer.GetData(), static_cast<int64>(Buffer.Num()) * sizeof(T));
+        const bool bWritten = Writer->Close();
+        if(!bWritten) {
+            UE_LOG(LogTemp, Error, TEXT("TOSMExternalSorter: Failed to write %s, disk full?"), *Run.Filename)
+            bIsError = true;
+            return false;
+        }
+        NumRecords += Buffer.Num();
+        Buffer.Reset();
+        return true;
+    }
+
+    bool ReadBlock(FRun& Run)
+    {
+        const int32 Count = static_cast<int32>(FMath::Min<int64>(Run.Remaining, Run.BlockRecords));
+        Run.Block.SetNumUninitialized(Count);
+        Run.Reader->Serialize(Run.Block.GetData(), static_cast<int64>(Count) * sizeof(T));
+        Run.Remaining -= Count;
+        Run.Position = 0;
+        return !Run.Reader->IsError();
+    }
+
+    FString Directory;
+    FString Name;
+    int32 Capacity;
+    TLess Less;
+
+    TArray<T> Buffer;
+    int32 BufferPosition = 0;
+    TArray<FRun> Runs;
+    /** Indices into Runs, ordered by the current record of each run */
+    TArray<int32> Heap;
+    int64 NumRecords = 0;
+    bool bIsError = false;
+};
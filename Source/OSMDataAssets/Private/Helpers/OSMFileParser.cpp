@@ -2,6 +2,7 @@
 // Copyright 2020 Iwer Petersen. All rights reserved.
 
 #include "OSMFileParser.h"
+#include "OSMTagParsing.h"
 
 
 FOSMFile::FOSMFile()
@@ -22,14 +23,32 @@ FOSMFile::~FOSMFile() {
             delete NodeInfo;
         }
         NodeMap.Empty();
+
+        for (auto * Relation : Relations) {
+            for (auto * Member : Relation->Members) {
+                delete Member;
+            }
+            delete Relation;
+        }
+        Relations.Empty();
     }
 }
 
 
 bool FOSMFile::LoadOpenStreetMapFile(FString &OSMFilePath, const bool bIsFilePathActuallyTextBuffer,
                                      FFeedbackContext * FeedbackContext) {
-    constexpr bool bShowSlowTaskDialog = true;
-    constexpr bool bShowCancelButton = true;
+    // slow task dialogs are only possible on the game thread, runtime loads parse on a worker
+    const bool bShowSlowTaskDialog = IsInGameThread() && FeedbackContext != nullptr;
+    const bool bShowCancelButton = bShowSlowTaskDialog;
+
+    // a byte level pass is much cheaper than growing the maps element by element
+    FOSMFileSummary Summary;
+    if (bIsFilePathActuallyTextBuffer) {
+        FOSMFileSummary::ScanText(*OSMFilePath, Summary);
+        Reserve(Summary);
+    } else if (FOSMFileSummary::ScanFile(OSMFilePath, Summary)) {
+        Reserve(Summary);
+    }
 
     FText ErrorMessage;
     int32 ErrorLineNumber;
@@ -63,6 +82,118 @@ bool FOSMFile::LoadOpenStreetMapFile(FString &OSMFilePath, const bool bIsFilePat
 }
 
 
+void FOSMFile::Reserve(const FOSMFileSummary& Summary) {
+    NodeMap.Reserve(Summary.NumNodes);
+    Ways.Reserve(Summary.NumWays);
+    WayMap.Reserve(Summary.NumWays);
+    Relations.Reserve(Summary.NumRelations);
+
+    bHasFileBounds = Summary.bHasBounds;
+    if (bHasFileBounds) {
+        MinLatitude = Summary.MinLatitude;
+        MinLongitude = Summary.MinLongitude;
+        MaxLatitude = Summary.MaxLatitude;
+        MaxLongitude = Summary.MaxLongitude;
+    }
+}
+
+
+void FOSMFile::MergeFrom(FOSMFile& Other) {
+    check(bKeepNodeRefs && Other.bKeepNodeRefs);
+
+    // nodes are identical in all extracts that contain them, ways of Other are reconnected by FinishMerge
+    NodeMap.Reserve(NodeMap.Num() + Other.NodeMap.Num());
+    for (const auto &HashPair : Other.NodeMap) {
+        FOSMNodeInfo *& Existing = NodeMap.FindOrAdd(HashPair.Key);
+        if (!Existing) {
+            Existing = HashPair.Value;
+        } else {
+            delete HashPair.Value;
+        }
+    }
+    Other.NodeMap.Empty();
+
+    Ways.Reserve(Ways.Num() + Other.Ways.Num());
+    WayMap.Reserve(WayMap.Num() + Other.Ways.Num());
+    for (auto * Way : Other.Ways) {
+        FOSMWayInfo ** Existing = WayMap.Find(Way->WayID);
+        if (!Existing) {
+            Ways.Add(Way);
+            WayMap.Add(Way->WayID, Way);
+            continue;
+        }
+        if (Way->NodeRefs.Num() > (*Existing)->NodeRefs.Num()) {
+            **Existing = MoveTemp(*Way);
+        }
+        delete Way;
+    }
+    Other.Ways.Empty();
+    Other.WayMap.Empty();
+
+    TMap<FString, int32> RelationIndices;
+    RelationIndices.Reserve(Relations.Num());
+    for (int32 i = 0; i < Relations.Num(); i++) {
+        RelationIndices.Add(Relations[i]->RelationID, i);
+    }
+    for (auto * Relation : Other.Relations) {
+        const int32 * Index = RelationIndices.Find(Relation->RelationID);
+        if (!Index) {
+            RelationIndices.Add(Relation->RelationID, Relations.Add(Relation));
+            continue;
+        }
+        // the loser is deleted together with its members
+        if (Relation->Members.Num() > Relations[*Index]->Members.Num()) {
+            Swap(Relations[*Index], Relation);
+        }
+        for (auto * Member : Relation->Members) {
+            delete Member;
+        }
+        delete Relation;
+    }
+    Other.Relations.Empty();
+
+    bHasFileBounds = bHasFileBounds && Other.bHasFileBounds;
+    MinLatitude = FMath::Min(MinLatitude, Other.MinLatitude);
+    MinLongitude = FMath::Min(MinLongitude, Other.MinLongitude);
+    MaxLatitude = FMath::Max(MaxLatitude, Other.MaxLatitude);
+    MaxLongitude = FMath::Max(MaxLongitude, Other.MaxLongitude);
+}
+
+
+void FOSMFile::FinishMerge() {
+    check(bKeepNodeRefs);
+
+    AverageLatitude = 0.0;
+    AverageLongitude = 0.0;
+    for (const auto &HashPair : NodeMap) {
+        HashPair.Value->WayRefs.Reset();
+        AverageLatitude += HashPair.Value->Latitude;
+        AverageLongitude += HashPair.Value->Longitude;
+    }
+    if (NodeMap.Num() > 0) {
+        AverageLatitude /= NodeMap.Num();
+        AverageLongitude /= NodeMap.Num();
+    }
+
+    for (auto * Way : Ways) {
+        Way->Nodes.Reset(Way->NodeRefs.Num());
+        Way->bHasMissingNodes = false;
+        for (const FString& Ref : Way->NodeRefs) {
+            FOSMNodeInfo * Node = NodeMap.FindRef(Ref);
+            if (!Node) {
+                Way->bHasMissingNodes = true;
+                continue;
+            }
+            FOSMWayRef NewWayRef;
+            NewWayRef.Way = Way;
+            NewWayRef.NodeIndex = Way->Nodes.Num();
+            Node->WayRefs.Add(NewWayRef);
+            Way->Nodes.Add(Node);
+        }
+    }
+}
+
+
 bool FOSMFile::ProcessXmlDeclaration(const TCHAR * ElementData, int32 XmlFileLineNumber) {
     // Don't care about XML declaration
     return true;
@@ -76,7 +207,6 @@ bool FOSMFile::ProcessComment(const TCHAR * Comment) {
 
 
 bool FOSMFile::ProcessElement(const TCHAR * ElementName, const TCHAR * ElementData, int32 XmlFileLineNumber) {
-    UE_LOG(LogTemp, Warning, TEXT("FOSMFile: ProcessElement: %d"), XmlFileLineNumber);
     if (ParsingState == ParsingState::Root) {
         if (!FCString::Stricmp(ElementName, TEXT("node"))) {
             ParsingState = ParsingState::Node;
@@ -86,24 +216,17 @@ bool FOSMFile::ProcessElement(const TCHAR * ElementName, const TCHAR * ElementDa
         } else if (!FCString::Stricmp(ElementName, TEXT("way"))) {
             ParsingState = ParsingState::Way;
             CurrentWayInfo = new FOSMWayInfo();
-            CurrentWayInfo->Name.Empty();
-            CurrentWayInfo->Ref.Empty();
-            CurrentWayInfo->WayType = EOSMWayType::OtherRoad;
-            CurrentWayInfo->BuildingType = EOSMBuildingType::OtherBuilding;
-            CurrentWayInfo->Height = 0.0;
-            CurrentWayInfo->bIsOneWay = false;
-            CurrentWayInfo->bIsBridge = false;
-            CurrentWayInfo->Layer = 0;
-            CurrentWayInfo->Lanes = 1;
-            CurrentWayInfo->Levels = 0;
+            InitWayInfo(*CurrentWayInfo);
             // @todo: We're currently ignoring the "visible" tag on ways, which means that roads will always
             //        be included in our data set.  It might be nice to make this an import option.
         } else if (!FCString::Stricmp(ElementName, TEXT("relation"))) {
             ParsingState = ParsingState::Relation;
             CurrentRelationInfo = new FOSMRelationInfo();
-            CurrentRelationInfo->Members.Empty();
-            CurrentRelationInfo->BuildingType = EOSMBuildingType::OtherBuilding;
-            CurrentRelationInfo->BuildingLevels = 0;
+            InitRelationInfo(*CurrentRelationInfo);
+        }
+    } else if (ParsingState == ParsingState::Node) {
+        if (!FCString::Stricmp(ElementName, TEXT("tag"))) {
+            ParsingState = ParsingState::Node_Tag;
         }
     } else if (ParsingState == ParsingState::Way) {
         if (!FCString::Stricmp(ElementName, TEXT("nd"))) {
@@ -118,6 +241,7 @@ bool FOSMFile::ProcessElement(const TCHAR * ElementName, const TCHAR * ElementDa
             CurrentRelMember->Type.Empty();
             CurrentRelMember->Ref.Empty();
             CurrentRelMember->bIsInner = 0;
+            CurrentRelMember->bHasRole = 0;
         } else if (!FCString::Stricmp(ElementName, TEXT("tag"))) {
             ParsingState = ParsingState::Rel_Tag;
         }
@@ -139,14 +263,10 @@ bool FOSMFile::ProcessAttribute(const TCHAR * AttributeName, const TCHAR * Attri
 
             AverageLatitude += CurrentNodeInfo->Latitude;
 
-            // Update minimum and maximum latitude
-            // @todo: Performance: Instead of computing our own bounding box, we could parse the "minlat" and
-            //        "minlon" tags from the OSM file
-            if (CurrentNodeInfo->Latitude < MinLatitude) {
-                MinLatitude = CurrentNodeInfo->Latitude;
-            }
-            if (CurrentNodeInfo->Latitude > MaxLatitude) {
-                MaxLatitude = CurrentNodeInfo->Latitude;
+            // Update minimum and maximum latitude, unless the file provided its bounds
+            if (!bHasFileBounds) {
+                MinLatitude = FMath::Min(MinLatitude, CurrentNodeInfo->Latitude);
+                MaxLatitude = FMath::Max(MaxLatitude, CurrentNodeInfo->Latitude);
             }
         } else if (!FCString::Stricmp(AttributeName, TEXT("lon"))) {
             CurrentNodeInfo->Longitude = FPlatformString::Atod(AttributeValue);
@@ -154,20 +274,32 @@ bool FOSMFile::ProcessAttribute(const TCHAR * AttributeName, const TCHAR * Attri
             AverageLongitude += CurrentNodeInfo->Longitude;
 
             // Update minimum and maximum longitude
-            if (CurrentNodeInfo->Longitude < MinLongitude) {
-                MinLongitude = CurrentNodeInfo->Longitude;
-            }
-            if (CurrentNodeInfo->Longitude > MaxLongitude) {
-                MaxLongitude = CurrentNodeInfo->Longitude;
+            if (!bHasFileBounds) {
+                MinLongitude = FMath::Min(MinLongitude, CurrentNodeInfo->Longitude);
+                MaxLongitude = FMath::Max(MaxLongitude, CurrentNodeInfo->Longitude);
             }
         }
+    } else if (ParsingState == ParsingState::Node_Tag) {
+        if (!FCString::Stricmp(AttributeName, TEXT("k"))) {
+            CurrentNodeTagKey = AttributeValue;
+        } else if (!FCString::Stricmp(AttributeName, TEXT("v")) && bCollectNodeTags) {
+            CurrentNodeInfo->Tags.Emplace(CurrentNodeTagKey, AttributeValue);
+        }
     } else if (ParsingState == ParsingState::Way) {
         if (!FCString::Stricmp(AttributeName, TEXT("id"))) {
             CurrentWayInfo->WayID = FString(AttributeValue);
         }
     } else if (ParsingState == ParsingState::Way_NodeRef) {
         if (!FCString::Stricmp(AttributeName, TEXT("ref"))) {
+            if (bKeepNodeRefs) {
+                CurrentWayInfo->NodeRefs.Emplace(AttributeValue);
+            }
             FOSMNodeInfo * ReferencedNode = NodeMap.FindRef(FString(AttributeValue));
+            if (!ReferencedNode) {
+                // extracts cut at the bounding box reference nodes that are not part of the file
+                CurrentWayInfo->bHasMissingNodes = true;
+                return true;
+            }
             const int NewNodeIndex = CurrentWayInfo->Nodes.Num();
             CurrentWayInfo->Nodes.Add(ReferencedNode);
 
@@ -183,61 +315,7 @@ bool FOSMFile::ProcessAttribute(const TCHAR * AttributeName, const TCHAR * Attri
         if (!FCString::Stricmp(AttributeName, TEXT("k"))) {
             CurrentWayTagKey = AttributeValue;
         } else if (!FCString::Stricmp(AttributeName, TEXT("v"))) {
-            if (!FCString::Stricmp(CurrentWayTagKey, TEXT("name"))) {
-                CurrentWayInfo->Name = AttributeValue;
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("ref"))) {
-                CurrentWayInfo->Ref = AttributeValue;
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("highway"))) {
-                EOSMWayType WayType;
-                DecodeWayType(AttributeValue, WayType);
-                CurrentWayInfo->WayType = WayType;
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("building"))) {
-                CurrentWayInfo->WayType = EOSMWayType::Building;
-                EOSMBuildingType BuildingType;
-                DecodeBuildingType(AttributeValue, BuildingType);
-                CurrentWayInfo->BuildingType = BuildingType;
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("height"))) {
-                // Check to see if there is a space character in the height value.  For now, we're looking
-                // for straight-up floating point values.
-                if (!FString(AttributeValue).Contains(TEXT(" "))) {
-                    // Okay, no space character.  So this has got to be a floating point number.  The OSM
-                    // spec says that the height values are in meters.
-                    CurrentWayInfo->Height = FPlatformString::Atod(AttributeValue);
-                } else {
-                    // Looks like the height value contains units of some sort.
-                    // @todo: Add support for interpreting unit strings and converting the values
-                }
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("building:levels"))) {
-                CurrentWayInfo->BuildingLevels = FPlatformString::Atoi(AttributeValue);
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("oneway"))) {
-                if (!FCString::Stricmp(AttributeValue, TEXT("yes"))) {
-                    CurrentWayInfo->bIsOneWay = true;
-                } else {
-                    CurrentWayInfo->bIsOneWay = false;
-                }
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("bridge"))) {
-                if (!FCString::Stricmp(AttributeValue, TEXT("yes"))) {
-                    CurrentWayInfo->bIsBridge = true;
-                } else {
-                    CurrentWayInfo->bIsBridge = false;
-                }
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("layer"))) {
-                CurrentWayInfo->Layer = FPlatformString::Atoi(AttributeValue);
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("lanes"))) {
-                CurrentWayInfo->Lanes = FMath::Max(1, FPlatformString::Atoi(AttributeValue));
-            }
-            else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("levels"))) {
-                CurrentWayInfo->Levels = FMath::Max(1, FPlatformString::Atoi(AttributeValue));
-            }
+            DecodeWayTag(CurrentWayTagKey, AttributeValue, *CurrentWayInfo);
         }
     } else if (ParsingState == ParsingState::Relation) {
         if (!FCString::Stricmp(AttributeName, TEXT("id"))) {
@@ -248,30 +326,14 @@ bool FOSMFile::ProcessAttribute(const TCHAR * AttributeName, const TCHAR * Attri
             CurrentRelMember->Type = AttributeValue;
         } else if (!FCString::Stricmp(AttributeName, TEXT("ref"))) {
             CurrentRelMember->Ref = AttributeValue;
-        } if (!FCString::Stricmp(AttributeName, TEXT("role"))) {
-            UE_LOG(LogTemp,Warning,TEXT("OSMFileParser: Relation Member Role: %s"), AttributeValue)
-            CurrentRelMember->bIsInner = FCString::Stricmp(AttributeValue, TEXT("inner")) == 0 ? 1 : 0;
+        } else if (!FCString::Stricmp(AttributeName, TEXT("role"))) {
+            DecodeMemberRole(AttributeValue, *CurrentRelMember);
         }
     } else if (ParsingState == ParsingState::Rel_Tag) {
         if (!FCString::Stricmp(AttributeName, TEXT("k"))) {
             CurrentRelTagKey = AttributeValue;
         } else if (!FCString::Stricmp(AttributeName, TEXT("v"))) {
-            if (!FCString::Stricmp(CurrentRelTagKey, TEXT("building"))) {
-                EOSMBuildingType BuildingType;
-                DecodeBuildingType(AttributeValue, BuildingType);
-                CurrentRelationInfo->BuildingType = BuildingType;
-            } else if (!FCString::Stricmp(CurrentRelTagKey, TEXT("building:levels"))) {
-                CurrentRelationInfo->BuildingLevels = FPlatformString::Atoi(AttributeValue);
-            } else if (!FCString::Stricmp(CurrentRelTagKey, TEXT("height"))) {
-                if (!FString(AttributeValue).Contains(TEXT(" "))) {
-                    // Okay, no space character.  So this has got to be a floating point number.  The OSM
-                    // spec says that the height values are in meters.
-                    CurrentRelationInfo->Height = FPlatformString::Atod(AttributeValue);
-                } else {
-                    // Looks like the height value contains units of some sort.
-                    // @todo: Add support for interpreting unit strings and converting the values
-                }
-            }
+            DecodeRelationTag(CurrentRelTagKey, AttributeValue, *CurrentRelationInfo);
         }
     }
 
@@ -284,6 +346,9 @@ bool FOSMFile::ProcessClose(const TCHAR * Element) {
         NodeMap.Add(CurrentNodeInfo->NodeID, CurrentNodeInfo);
         CurrentNodeInfo = nullptr;
         ParsingState = ParsingState::Root;
+    } else if (ParsingState == ParsingState::Node_Tag) {
+        CurrentNodeTagKey = TEXT("");
+        ParsingState = ParsingState::Node;
     } else if (ParsingState == ParsingState::Way) {
         Ways.Add(CurrentWayInfo);
         WayMap.Add(CurrentWayInfo->WayID, CurrentWayInfo);
@@ -302,6 +367,8 @@ bool FOSMFile::ProcessClose(const TCHAR * Element) {
         // only interested in relations of type way for now
         if(CurrentRelMember->Type.Equals(TEXT("way"))){
             CurrentRelationInfo->Members.Add(CurrentRelMember);
+        } else {
+            delete CurrentRelMember;
         }
         CurrentRelMember = nullptr;
         ParsingState = ParsingState::Relation;
@@ -313,6 +380,128 @@ bool FOSMFile::ProcessClose(const TCHAR * Element) {
     return true;
 }
 
+void FOSMFile::InitWayInfo(FOSMWayInfo& Way)
+{
+    Way.Name.Empty();
+    Way.Ref.Empty();
+    Way.WayType = EOSMWayType::OtherRoad;
+    Way.BuildingType = EOSMBuildingType::OtherBuilding;
+    Way.Height = 0.0;
+    Way.bIsOneWay = false;
+    Way.bIsBridge = false;
+    Way.Layer = 0;
+    Way.Lanes = 1;
+    Way.Levels = 0;
+    Way.BuildingLevels = 0;
+    Way.bHasMissingNodes = false;
+    Way.AreaType = EOSMAreaType::OtherArea;
+    Way.bIsArea = false;
+}
+
+void FOSMFile::InitRelationInfo(FOSMRelationInfo& Relation)
+{
+    Relation.Members.Empty();
+    Relation.BuildingType = EOSMBuildingType::OtherBuilding;
+    Relation.BuildingLevels = 0;
+    Relation.Height = 0.0;
+    Relation.AreaType = EOSMAreaType::OtherArea;
+    Relation.bIsArea = false;
+    Relation.bIsBuilding = false;
+}
+
+void FOSMFile::DecodeWayTag(const TCHAR* Key, const TCHAR* Value, FOSMWayInfo& Way)
+{
+    if (!FCString::Stricmp(Key, TEXT("name"))) {
+        Way.Name = Value;
+    }
+    else if (!FCString::Stricmp(Key, TEXT("ref"))) {
+        Way.Ref = Value;
+    }
+    else if (!FCString::Stricmp(Key, TEXT("highway"))) {
+        EOSMWayType WayType;
+        DecodeWayType(Value, WayType);
+        Way.WayType = WayType;
+    }
+    else if (!FCString::Stricmp(Key, TEXT("building"))) {
+        Way.WayType = EOSMWayType::Building;
+        EOSMBuildingType BuildingType;
+        DecodeBuildingType(Value, BuildingType);
+        Way.BuildingType = BuildingType;
+    }
+    else if (!FCString::Stricmp(Key, TEXT("height"))) {
+        // The OSM spec says that height values are in meters unless a unit is given
+        float Height;
+        if (OSMTagParsing::ParseLength(Value, Height)) {
+            Way.Height = Height;
+        }
+    }
+    else if (!FCString::Stricmp(Key, TEXT("building:levels"))) {
+        Way.BuildingLevels = FPlatformString::Atoi(Value);
+    }
+    else if (!FCString::Stricmp(Key, TEXT("oneway"))) {
+        if (!FCString::Stricmp(Value, TEXT("yes"))) {
+            Way.bIsOneWay = true;
+        } else {
+            Way.bIsOneWay = false;
+        }
+    }
+    else if (!FCString::Stricmp(Key, TEXT("bridge"))) {
+        if (!FCString::Stricmp(Value, TEXT("yes"))) {
+            Way.bIsBridge = true;
+        } else {
+            Way.bIsBridge = false;
+        }
+    }
+    else if (!FCString::Stricmp(Key, TEXT("layer"))) {
+        Way.Layer = FPlatformString::Atoi(Value);
+    }
+    else if (!FCString::Stricmp(Key, TEXT("lanes"))) {
+        Way.Lanes = FMath::Max(1, FPlatformString::Atoi(Value));
+    }
+    else if (!FCString::Stricmp(Key, TEXT("levels"))) {
+        Way.Levels = FMath::Max(1, FPlatformString::Atoi(Value));
+    }
+    else {
+        EOSMAreaType AreaType;
+        if (!Way.bIsArea && OSMTagParsing::ClassifyArea(Key, Value, AreaType)) {
+            Way.AreaType = AreaType;
+            Way.bIsArea = true;
+        }
+        DecodeBuildingTag(Key, Value, Way.BuildingTags);
+    }
+}
+
+void FOSMFile::DecodeRelationTag(const TCHAR* Key, const TCHAR* Value, FOSMRelationInfo& Relation)
+{
+    if (!FCString::Stricmp(Key, TEXT("building"))) {
+        EOSMBuildingType BuildingType;
+        DecodeBuildingType(Value, BuildingType);
+        Relation.BuildingType = BuildingType;
+        Relation.bIsBuilding = true;
+    } else if (!FCString::Stricmp(Key, TEXT("building:levels"))) {
+        Relation.BuildingLevels = FPlatformString::Atoi(Value);
+    } else if (!FCString::Stricmp(Key, TEXT("height"))) {
+        float Height;
+        if (OSMTagParsing::ParseLength(Value, Height)) {
+            Relation.Height = Height;
+        }
+    } else {
+        EOSMAreaType AreaType;
+        if (!Relation.bIsArea && OSMTagParsing::ClassifyArea(Key, Value, AreaType)) {
+            Relation.AreaType = AreaType;
+            Relation.bIsArea = true;
+        }
+        DecodeBuildingTag(Key, Value, Relation.BuildingTags);
+    }
+}
+
+void FOSMFile::DecodeMemberRole(const TCHAR* Role, FOSMRelMember& Member)
+{
+    Member.bIsInner = FCString::Stricmp(Role, TEXT("inner")) == 0 ? 1 : 0;
+    Member.bHasRole = Member.bIsInner
+        || FCString::Stricmp(Role, TEXT("outer")) == 0 ? 1 : 0;
+}
+
 void FOSMFile::DecodeWayType(const TCHAR* AttributeValue, EOSMWayType& WayType)
 {
     WayType = EOSMWayType::OtherRoad;
@@ -374,6 +563,32 @@ void FOSMFile::DecodeWayType(const TCHAR* AttributeValue, EOSMWayType& WayType)
     }
 }
 
+bool FOSMFile::DecodeBuildingTag(const TCHAR* TagKey, const TCHAR* AttributeValue, FOSMBuildingTags& Tags)
+{
+    if (!FCString::Stricmp(TagKey, TEXT("min_height"))) {
+        return OSMTagParsing::ParseLength(AttributeValue, Tags.MinHeight);
+    } else if (!FCString::Stricmp(TagKey, TEXT("building:min_level"))) {
+        Tags.MinLevel = FPlatformString::Atoi(AttributeValue);
+    } else if (!FCString::Stricmp(TagKey, TEXT("roof:height"))) {
+        return OSMTagParsing::ParseLength(AttributeValue, Tags.RoofHeight);
+    } else if (!FCString::Stricmp(TagKey, TEXT("roof:shape"))) {
+        Tags.RoofShape = AttributeValue;
+    } else if (!FCString::Stricmp(TagKey, TEXT("building:part"))) {
+        Tags.BuildingPart = AttributeValue;
+    } else if (!FCString::Stricmp(TagKey, TEXT("building:colour"))) {
+        Tags.BuildingColour = AttributeValue;
+    } else if (!FCString::Stricmp(TagKey, TEXT("building:material"))) {
+        Tags.BuildingMaterial = AttributeValue;
+    } else if (!FCString::Stricmp(TagKey, TEXT("roof:colour"))) {
+        Tags.RoofColour = AttributeValue;
+    } else if (!FCString::Stricmp(TagKey, TEXT("roof:material"))) {
+        Tags.RoofMaterial = AttributeValue;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 void FOSMFile::DecodeBuildingType(const TCHAR* AttributeValue, EOSMBuildingType& BuildingType)
 {
     BuildingType = EOSMBuildingType::OtherBuilding;
@@ -6,6 +6,7 @@
 #include "FastXml.h"
 #include "Misc/FeedbackContext.h"
 #include "Enums.h"
+#include "OSMFileSummary.h"
 
 /** OpenStreetMap file loader */
 class FOSMFile : public IFastXmlCallback
@@ -22,9 +23,39 @@ public:
     /** Loads the map from an OpenStreetMap XML file.  Note that in the case of the file path containing the XML data, the string must be mutable for us to parse it quickly. */
     bool LoadOpenStreetMapFile( FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, class FFeedbackContext* FeedbackContext );
 
+    /** Reserves the containers for the element counts of Summary and takes over its bounds */
+    void Reserve( const FOSMFileSummary& Summary );
+
+    /**
+     * Moves all elements of Other into this file, Other is empty afterwards. Elements contained in both are
+     * merged by OSM ID: the way with more node references and the relation with more members win, since
+     * extracts cut those at their border. Both files need bKeepNodeRefs. Call FinishMerge after the last file.
+     */
+    void MergeFrom( FOSMFile& Other );
+
+    /**
+     * Reconnects all ways to the merged nodes by their node IDs, so ways cut in one file are completed with the
+     * nodes of another, and recomputes the average location
+     */
+    void FinishMerge();
+
 
     struct FOSMWayInfo;
 
+    /** Additional building tags, kept until the asset attribute table is assembled */
+    struct FOSMBuildingTags
+    {
+        float MinHeight = 0.f;
+        int32 MinLevel = 0;
+        float RoofHeight = 0.f;
+        FString RoofShape;
+        FString BuildingPart;
+        FString BuildingColour;
+        FString BuildingMaterial;
+        FString RoofColour;
+        FString RoofMaterial;
+    };
+
 //////
 
 
@@ -44,6 +75,8 @@ public:
         double Latitude;
         double Longitude;
         TArray<FOSMWayRef> WayRefs;
+        // Key/value pairs of the node, only collected with bCollectNodeTags
+        TArray<TPair<FString, FString>> Tags;
     };
 
     USTRUCT()
@@ -58,6 +91,8 @@ public:
         FString Ref;
         UPROPERTY()
         TArray<FOSMNodeInfo*> Nodes;
+        // IDs of all referenced nodes including the ones missing from the file, only kept with bKeepNodeRefs
+        TArray<FString> NodeRefs;
         UPROPERTY()
         TEnumAsByte<EOSMWayType> WayType;
         UPROPERTY()
@@ -66,6 +101,7 @@ public:
         double Height;
         UPROPERTY()
         int32 BuildingLevels;
+        FOSMBuildingTags BuildingTags;
 
         // If true, way is only traversable in the order the nodes are listed in the Nodes list
         UPROPERTY()
@@ -78,12 +114,21 @@ public:
         int32 Lanes;
         UPROPERTY()
         int32 Levels;
+
+        // Area type from landuse, natural, leisure and the like, only valid with bIsArea
+        TEnumAsByte<EOSMAreaType> AreaType;
+        uint8 bIsArea : 1;
+
+        // If true, at least one referenced node was not part of the file and is missing from Nodes
+        uint8 bHasMissingNodes : 1;
     };
 
     struct FOSMRelMember {
         FString Type;
         FString Ref;
         uint8 bIsInner : 1;
+        // If false, the member had no or an unknown role and inner/outer has to be derived from the geometry
+        uint8 bHasRole : 1;
     };
 
     struct FOSMRelationInfo {
@@ -92,9 +137,14 @@ public:
         TEnumAsByte<EOSMBuildingType> BuildingType;
         int32 BuildingLevels;
         double Height;
+        FOSMBuildingTags BuildingTags;
+        // Area type from landuse, natural, leisure and the like, only valid with bIsArea
+        TEnumAsByte<EOSMAreaType> AreaType;
+        uint8 bIsArea : 1;
+        uint8 bIsBuilding : 1;
     };
 
-    // Minimum latitude/longitude bounds
+    // Minimum latitude/longitude bounds, from the <bounds> element if the file has one, else from the nodes
     double MinLatitude = MAX_dbl;
     double MinLongitude = MAX_dbl;
     double MaxLatitude = -MAX_dbl;
@@ -113,6 +163,24 @@ public:
 
     TArray<FOSMRelationInfo*> Relations;
 
+    // Keep the tags of nodes, e.g. for point of interest extraction. Off by default, most nodes only carry geometry.
+    bool bCollectNodeTags = false;
+
+    // Keep the node IDs of every way, needed to merge files with MergeFrom
+    bool bKeepNodeRefs = false;
+
+    // Maps the value of a building tag to a building type, OtherBuilding for unknown values
+    static void DecodeBuildingType(const TCHAR* AttributeValue, EOSMBuildingType& BuildingType);
+
+    // Defaults of a way or relation before its tags are applied
+    static void InitWayInfo(FOSMWayInfo& Way);
+    static void InitRelationInfo(FOSMRelationInfo& Relation);
+
+    // Applies a single tag or member role, shared with readers that do not go through the XML callbacks
+    static void DecodeWayTag(const TCHAR* Key, const TCHAR* Value, FOSMWayInfo& Way);
+    static void DecodeRelationTag(const TCHAR* Key, const TCHAR* Value, FOSMRelationInfo& Relation);
+    static void DecodeMemberRole(const TCHAR* Role, FOSMRelMember& Member);
+
 protected:
 
     // IFastXmlCallback overrides
@@ -120,7 +188,7 @@ protected:
     virtual bool ProcessComment( const TCHAR* Comment ) override;
     virtual bool ProcessElement( const TCHAR* ElementName, const TCHAR* ElementData, int32 XmlFileLineNumber ) override;
     static void DecodeWayType(const TCHAR* AttributeValue, EOSMWayType& WayType);
-    static void DecodeBuildingType(const TCHAR* AttributeValue, EOSMBuildingType& BuildingType);
+    static bool DecodeBuildingTag(const TCHAR* TagKey, const TCHAR* AttributeValue, FOSMBuildingTags& Tags);
     virtual bool ProcessAttribute( const TCHAR* AttributeName, const TCHAR* AttributeValue ) override;
     virtual bool ProcessClose( const TCHAR* Element ) override;
 
@@ -131,6 +199,7 @@ protected:
     {
         Root,
         Node,
+        Node_Tag,
         Way,
         Way_NodeRef,
         Way_Tag,
@@ -142,6 +211,9 @@ protected:
     // Current state of parser
     ParsingState ParsingState;
 
+    // If true, the bounds were read up front and are not extended by every node
+    bool bHasFileBounds = false;
+
     // Node that is currently being parsed
     FOSMNodeInfo* CurrentNodeInfo;
 
@@ -153,6 +225,9 @@ protected:
 
     FOSMRelMember * CurrentRelMember;
 
+    // Current node's current tag key string
+    const TCHAR* CurrentNodeTagKey;
+
     // Current way's current tag key string
     const TCHAR* CurrentWayTagKey;
 
@@ -0,0 +1,314 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMPayloadChunks.h"
+
+#include "Async/ParallelFor.h"
+#include "Misc/Compression.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "OSMDataAsset.h"
+
+namespace
+{
+    // elements per chunk, about a megabyte of uncompressed data for typical buildings
+    constexpr int32 BuildingsPerChunk = 4096;
+    constexpr int32 MPBuildingsPerChunk = 512;
+    constexpr int32 NodesPerChunk = 64 * 1024;
+
+    /** Bulk arrays in the order of their chunks */
+    enum class EPayloadArray : uint8
+    {
+        Buildings,
+        MPBuildings,
+        NodePositions,
+        NodeCoordinates
+    };
+
+    /** Stored compression format, names are not stable across engine versions */
+    enum class EPayloadFormat : uint8
+    {
+        Zlib,
+        Oodle
+    };
+
+    struct FChunk
+    {
+        EPayloadArray Array;
+        int32 First;
+        int32 Num;
+        int32 UncompressedSize;
+        /** Equal to UncompressedSize if the chunk is stored uncompressed */
+        int32 CompressedSize;
+
+        friend FArchive& operator<<(FArchive& Ar, FChunk& Chunk)
+        {
+            return Ar << Chunk.Array << Chunk.First << Chunk.Num << Chunk.UncompressedSize << Chunk.CompressedSize;
+        }
+    };
+
+    FName GetFormatName(EPayloadFormat Format)
+    {
+#if ENGINE_MAJOR_VERSION >= 5
+        if(Format == EPayloadFormat::Oodle) {
+            return NAME_Oodle;
+        }
+#endif
+        return Format == EPayloadFormat::Zlib ? NAME_Zlib : NAME_None;
+    }
+
+    EPayloadFormat GetSaveFormat()
+    {
+#if ENGINE_MAJOR_VERSION >= 5
+        return EPayloadFormat::Oodle;
+#else
+        return EPayloadFormat::Zlib;
+#endif
+    }
+
+    // explicit layouts instead of the struct serializers, so the data does not depend on the engine version
+    // of FVector and chunks can be read without the package version
+    void SerializeElement(FArchive& Ar, FVector& Point);
+    void SerializeElement(FArchive& Ar, FOSMGeoPoint& Point);
+    void SerializeElement(FArchive& Ar, FBuildingData& Building);
+    void SerializeElement(FArchive& Ar, FMPBuildingPart& Part);
+    void SerializeElement(FArchive& Ar, FMPBuildingData& Building);
+
+    void SerializeElement(FArchive& Ar, FVector& Point)
+    {
+        using FReal = decltype(FVector::X);
+        double X = Point.X;
+        double Y = Point.Y;
+        double Z = Point.Z;
+        Ar << X << Y << Z;
+        Point.X = static_cast<FReal>(X);
+        Point.Y = static_cast<FReal>(Y);
+        Point.Z = static_cast<FReal>(Z);
+    }
+
+    void SerializeElement(FArchive& Ar, FOSMGeoPoint& Point)
+    {
+        Ar << Point.LongitudeE7 << Point.LatitudeE7;
+    }
+
+    template<typename T>
+    void SerializeArray(FArchive& Ar, TArray<T>& Array)
+    {
+        int32 Num = Array.Num();
+        Ar << Num;
+        if(Ar.IsLoading()) {
+            if(Num < 0) {
+                Ar.SetError();
+                return;
+            }
+            Array.SetNum(Num);
+        }
+        for(T& Element : Array) {
+            SerializeElement(Ar, Element);
+        }
+    }
+
+    void SerializeFootprint(FArchive& Ar, FOSMFootprint& Footprint)
+    {
+        SerializeArray(Ar, Footprint.PolygonPoints);
+        SerializeArray(Ar, Footprint.PolygonCoordinates);
+        Ar << Footprint.PolygonIndices;
+    }
+
+    void SerializeElement(FArchive& Ar, FBuildingData& Building)
+    {
+        SerializeFootprint(Ar, Building);
+        Ar << Building.ID << Building.ElementType << Building.BuildingType << Building.Height << Building.Levels
+            << Building.HeightSource;
+    }
+
+    void SerializeElement(FArchive& Ar, FMPBuildingPart& Part)
+    {
+        SerializeFootprint(Ar, Part);
+        uint8 bIsInner = Part.bIsInner;
+        Ar << bIsInner;
+        Part.bIsInner = bIsInner;
+    }
+
+    void SerializeElement(FArchive& Ar, FMPBuildingData& Building)
+    {
+        SerializeArray(Ar, Building.Parts);
+        uint8 bHasHole = Building.bHasHole;
+        Ar << Building.ID << Building.ElementType << bHasHole << Building.BuildingType << Building.Height
+            << Building.Levels << Building.HeightSource;
+        Building.bHasHole = bHasHole;
+    }
+
+    template<typename T>
+    void AddChunks(EPayloadArray Array, const TArray<T>& Elements, int32 ElementsPerChunk, TArray<FChunk>& OutChunks)
+    {
+        for(int32 First = 0; First < Elements.Num(); First += ElementsPerChunk) {
+            FChunk& Chunk = OutChunks.AddZeroed_GetRef();
+            Chunk.Array = Array;
+            Chunk.First = First;
+            Chunk.Num = FMath::Min(ElementsPerChunk, Elements.Num() - First);
+        }
+    }
+
+    template<typename T>
+    void SerializeRange(FArchive& Ar, TArray<T>& Elements, const FChunk& Chunk)
+    {
+        for(int32 i = Chunk.First; i < Chunk.First + Chunk.Num; i++) {
+            SerializeElement(Ar, Elements[i]);
+        }
+    }
+
+    void SerializeChunk(FArchive& Ar, UOSMDataAsset& Asset, const FChunk& Chunk)
+    {
+        switch(Chunk.Array) {
+        case EPayloadArray::Buildings:
+            SerializeRange(Ar, Asset.Buildings, Chunk);
+            break;
+        case EPayloadArray::MPBuildings:
+            SerializeRange(Ar, Asset.MultiPolygonBuildings, Chunk);
+            break;
+        case EPayloadArray::NodePositions:
+            SerializeRange(Ar, Asset.NodePositions, Chunk);
+            break;
+        case EPayloadArray::NodeCoordinates:
+            SerializeRange(Ar, Asset.NodeCoordinates, Chunk);
+            break;
+        }
+    }
+
+    int32 GetArrayNum(const UOSMDataAsset& Asset, EPayloadArray Array)
+    {
+        switch(Array) {
+        case EPayloadArray::Buildings:
+            return Asset.Buildings.Num();
+        case EPayloadArray::MPBuildings:
+            return Asset.MultiPolygonBuildings.Num();
+        case EPayloadArray::NodePositions:
+            return Asset.NodePositions.Num();
+        case EPayloadArray::NodeCoordinates:
+            return Asset.NodeCoordinates.Num();
+        }
+        return 0;
+    }
+}
+
+void OSMPayloadChunks::Save(FArchive& Ar, UOSMDataAsset& Asset)
+{
+    TArray<FChunk> Chunks;
+    AddChunks(EPayloadArray::Buildings, Asset.Buildings, BuildingsPerChunk, Chunks);
+    AddChunks(EPayloadArray::MPBuildings, Asset.MultiPolygonBuildings, MPBuildingsPerChunk, Chunks);
+    AddChunks(EPayloadArray::NodePositions, Asset.NodePositions, NodesPerChunk, Chunks);
+    AddChunks(EPayloadArray::NodeCoordinates, Asset.NodeCoordinates, NodesPerChunk, Chunks);
+
+    EPayloadFormat Format = GetSaveFormat();
+    const FName FormatName = GetFormatName(Format);
+    TArray<TArray<uint8>> Data;
+    Data.SetNum(Chunks.Num());
+    ParallelFor(Chunks.Num(), [&](int32 c)
+    {
+        TArray<uint8> Uncompressed;
+        FMemoryWriter Writer(Uncompressed);
+        SerializeChunk(Writer, Asset, Chunks[c]);
+        const int32 UncompressedSize = Uncompressed.Num();
+
+        // chunks that do not shrink are stored as they are
+        int32 CompressedSize = FCompression::CompressMemoryBound(FormatName, UncompressedSize);
+        Data[c].SetNumUninitialized(CompressedSize);
+        if(!FCompression::CompressMemory(FormatName, Data[c].GetData(), CompressedSize, Uncompressed.GetData(), UncompressedSize)
+            || CompressedSize >= UncompressedSize)
+        {
+            Data[c] = MoveTemp(Uncompressed);
+            CompressedSize = UncompressedSize;
+        } else {
+            Data[c].SetNum(CompressedSize);
+        }
+        Chunks[c].UncompressedSize = UncompressedSize;
+        Chunks[c].CompressedSize = CompressedSize;
+    });
+
+    int32 NumBuildings = Asset.Buildings.Num();
+    int32 NumMPBuildings = Asset.MultiPolygonBuildings.Num();
+    int32 NumNodePositions = Asset.NodePositions.Num();
+    int32 NumNodeCoordinates = Asset.NodeCoordinates.Num();
+    Ar << Format << NumBuildings << NumMPBuildings << NumNodePositions << NumNodeCoordinates;
+    Ar << Chunks;
+    for(TArray<uint8>& ChunkData : Data) {
+        Ar.Serialize(ChunkData.GetData(), ChunkData.Num());
+    }
+}
+
+bool OSMPayloadChunks::Load(FArchive& Ar, UOSMDataAsset& Asset)
+{
+    EPayloadFormat Format;
+    int32 NumBuildings;
+    int32 NumMPBuildings;
+    int32 NumNodePositions;
+    int32 NumNodeCoordinates;
+    TArray<FChunk> Chunks;
+    Ar << Format << NumBuildings << NumMPBuildings << NumNodePositions << NumNodeCoordinates;
+    Ar << Chunks;
+    const FName FormatName = GetFormatName(Format);
+    if(Ar.IsError() || FormatName.IsNone() || NumBuildings < 0 || NumMPBuildings < 0 || NumNodePositions < 0 || NumNodeCoordinates < 0) {
+        UE_LOG(LogTemp, Error, TEXT("OSMPayloadChunks: Unsupported or corrupt building data in %s"), *Asset.GetPathName())
+        Ar.SetError();
+        return false;
+    }
+
+    Asset.Buildings.SetNum(NumBuildings);
+    Asset.MultiPolygonBuildings.SetNum(NumMPBuildings);
+    Asset.NodePositions.SetNum(NumNodePositions);
+    Asset.NodeCoordinates.SetNum(NumNodeCoordinates);
+
+    // a single read of all compressed chunks, they are inflated into the presized arrays in parallel
+    TArray<int64> Offsets;
+    Offsets.SetNumUninitialized(Chunks.Num() + 1);
+    Offsets[0] = 0;
+    for(int32 c = 0; c < Chunks.Num(); c++) {
+        const FChunk& Chunk = Chunks[c];
+        if(Chunk.First < 0 || Chunk.Num < 0 || Chunk.First + Chunk.Num > GetArrayNum(Asset, Chunk.Array)
+            || Chunk.CompressedSize < 0 || Chunk.CompressedSize > Chunk.UncompressedSize)
+        {
+            UE_LOG(LogTemp, Error, TEXT("OSMPayloadChunks: Corrupt chunk table in %s"), *Asset.GetPathName())
+            Ar.SetError();
+            return false;
+        }
+        Offsets[c + 1] = Offsets[c] + Chunk.CompressedSize;
+    }
+    TArray64<uint8> Data;
+    Data.SetNumUninitialized(Offsets.Last());
+    Ar.Serialize(Data.GetData(), Data.Num());
+    if(Ar.IsError()) {
+        return false;
+    }
+
+    TAtomic<bool> bFailed(false);
+    ParallelFor(Chunks.Num(), [&](int32 c)
+    {
+        const FChunk& Chunk = Chunks[c];
+        const uint8 * Compressed = Data.GetData() + Offsets[c];
+        TArray<uint8> Uncompressed;
+        if(Chunk.CompressedSize == Chunk.UncompressedSize) {
+            Uncompressed.Append(Compressed, Chunk.CompressedSize);
+        } else {
+            Uncompressed.SetNumUninitialized(Chunk.UncompressedSize);
+            if(!FCompression::UncompressMemory(FormatName, Uncompressed.GetData(), Chunk.UncompressedSize, Compressed, Chunk.CompressedSize)) {
+                bFailed = true;
+                return;
+            }
+        }
+        FMemoryReader Reader(Uncompressed);
+        SerializeChunk(Reader, Asset, Chunk);
+        if(Reader.IsError() || Reader.Tell() != Uncompressed.Num()) {
+            bFailed = true;
+        }
+    });
+    if(bFailed) {
+        UE_LOG(LogTemp, Error, TEXT("OSMPayloadChunks: Failed to decompress the building data of %s"), *Asset.GetPathName())
+        Asset.Buildings.Empty();
+        Asset.MultiPolygonBuildings.Empty();
+        Asset.NodePositions.Empty();
+        Asset.NodeCoordinates.Empty();
+        Ar.SetError();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,21 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UOSMDataAsset;
+
+/**
+ * Package layout of the bulk arrays of UOSMDataAsset, the buildings, multipolygon buildings and node pools.
+ * Each array is split into independently compressed chunks of contiguous elements, listed in a chunk table
+ * in front of the compressed data. With buildings sorted along a Hilbert curve a building chunk covers a compact
+ * area. Chunks are compressed on all cores at save and decompressed on all cores at load.
+ */
+namespace OSMPayloadChunks
+{
+    /** Writes the bulk arrays of Asset */
+    void Save(FArchive& Ar, UOSMDataAsset& Asset);
+
+    /** Reads what Save wrote into the bulk arrays of Asset. Returns false and flags Ar if the data is corrupt. */
+    bool Load(FArchive& Ar, UOSMDataAsset& Asset);
+}
@@ -0,0 +1,401 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMPolygonValidity.h"
+#include "Containers/HashTable.h"
+
+namespace
+{
+    struct FPoint
+    {
+        int64 X;
+        int64 Y;
+
+        bool operator==(const FPoint& Other) const { return X == Other.X && Y == Other.Y; }
+    };
+
+    /** Fixed point offset of Vertex to Origin */
+    FORCEINLINE FPoint ToPoint(const FOSMGeoPoint& Vertex, const FOSMGeoPoint& Origin)
+    {
+        return FPoint{(int64)Vertex.LongitudeE7 - Origin.LongitudeE7, (int64)Vertex.LatitudeE7 - Origin.LatitudeE7};
+    }
+
+    /** Converts a ring to offsets relative to its first vertex, consecutive duplicates are skipped */
+    void ToPoints(TArrayView<const FOSMGeoPoint> Ring, TArray<FPoint>& OutPoints)
+    {
+        OutPoints.Reset(Ring.Num());
+        for(const FOSMGeoPoint& Vertex : Ring) {
+            const FPoint Point = ToPoint(Vertex, Ring[0]);
+            if(OutPoints.Num() == 0 || !(OutPoints.Last() == Point)) {
+                OutPoints.Add(Point);
+            }
+        }
+        while(OutPoints.Num() > 1 && OutPoints.Last() == OutPoints[0]) {
+            OutPoints.Pop(false);
+        }
+    }
+
+    /** Unsigned 128 bit product of A and B as high and low word */
+    FORCEINLINE void MultiplyWide(uint64 A, uint64 B, uint64& OutHigh, uint64& OutLow)
+    {
+        const uint64 A0 = A & 0xFFFFFFFF;
+        const uint64 A1 = A >> 32;
+        const uint64 B0 = B & 0xFFFFFFFF;
+        const uint64 B1 = B >> 32;
+        const uint64 P00 = A0 * B0;
+        const uint64 P01 = A0 * B1;
+        const uint64 P10 = A1 * B0;
+        const uint64 Middle = (P00 >> 32) + (P01 & 0xFFFFFFFF) + (P10 & 0xFFFFFFFF);
+        OutLow = (Middle << 32) | (P00 & 0xFFFFFFFF);
+        OutHigh = A1 * B1 + (P01 >> 32) + (P10 >> 32) + (Middle >> 32);
+    }
+
+    /**
+     * Sign of A * B - C * D without rounding. The factors are differences of offsets of up to 34 bits, their
+     * products exceed both the 53 bit mantissa of double and int64.
+     */
+    int32 SignOfDifference(int64 A, int64 B, int64 C, int64 D)
+    {
+        const int32 SignAB = static_cast<int32>(FMath::Sign(A) * FMath::Sign(B));
+        const int32 SignCD = static_cast<int32>(FMath::Sign(C) * FMath::Sign(D));
+        if(SignAB != SignCD) {
+            return SignAB > SignCD ? 1 : -1;
+        }
+        if(SignAB == 0) {
+            return 0;
+        }
+        uint64 HighAB, LowAB, HighCD, LowCD;
+        MultiplyWide(static_cast<uint64>(FMath::Abs(A)), static_cast<uint64>(FMath::Abs(B)), HighAB, LowAB);
+        MultiplyWide(static_cast<uint64>(FMath::Abs(C)), static_cast<uint64>(FMath::Abs(D)), HighCD, LowCD);
+        if(HighAB == HighCD && LowAB == LowCD) {
+            return 0;
+        }
+        const bool bABIsLarger = HighAB != HighCD ? HighAB > HighCD : LowAB > LowCD;
+        return bABIsLarger ? SignAB : -SignAB;
+    }
+
+    /** Sign of the cross product of OA and OB, positive if B is left of OA */
+    FORCEINLINE int32 Orientation(const FPoint& O, const FPoint& A, const FPoint& B)
+    {
+        return SignOfDifference(A.X - O.X, B.Y - O.Y, A.Y - O.Y, B.X - O.X);
+    }
+
+    /** Sign of the dot product of OA and OB */
+    FORCEINLINE int32 DotSign(const FPoint& O, const FPoint& A, const FPoint& B)
+    {
+        return SignOfDifference(A.X - O.X, B.X - O.X, O.Y - A.Y, B.Y - O.Y);
+    }
+
+    FORCEINLINE bool IsLess(const FPoint& A, const FPoint& B)
+    {
+        return A.X < B.X || (A.X == B.X && A.Y < B.Y);
+    }
+
+    /** True if A and C lie on the same ray from V, i.e. the ring turns back at V */
+    FORCEINLINE bool IsSpike(const FPoint& A, const FPoint& V, const FPoint& C)
+    {
+        return Orientation(V, A, C) == 0 && DotSign(V, A, C) > 0;
+    }
+
+    /** R is collinear with segment PQ, checks whether it is within the segment */
+    FORCEINLINE bool IsOnSegment(const FPoint& P, const FPoint& Q, const FPoint& R)
+    {
+        return R.X >= FMath::Min(P.X, Q.X) && R.X <= FMath::Max(P.X, Q.X)
+            && R.Y >= FMath::Min(P.Y, Q.Y) && R.Y <= FMath::Max(P.Y, Q.Y);
+    }
+
+    bool SegmentsIntersect(const FPoint& P1, const FPoint& P2, const FPoint& Q1, const FPoint& Q2)
+    {
+        const int32 D1 = Orientation(Q1, Q2, P1);
+        const int32 D2 = Orientation(Q1, Q2, P2);
+        const int32 D3 = Orientation(P1, P2, Q1);
+        const int32 D4 = Orientation(P1, P2, Q2);
+        if(D1 * D2 < 0 && D3 * D4 < 0) {
+            return true;
+        }
+        return (D1 == 0 && IsOnSegment(Q1, Q2, P1))
+            || (D2 == 0 && IsOnSegment(Q1, Q2, P2))
+            || (D3 == 0 && IsOnSegment(P1, P2, Q1))
+            || (D4 == 0 && IsOnSegment(P1, P2, Q2));
+    }
+
+    /**
+     * Segments crossing the sweep line, ordered bottom to top. A treap with parent links, so a segment is
+     * removed and its neighbours are found through its own node without comparing at the removal point, where
+     * segments ending in the same vertex can't be ordered anymore. All operations are O(log n) expected.
+     */
+    class FSweepStatus
+    {
+    public:
+        explicit FSweepStatus(int32 NumSegments)
+        {
+            Nodes.SetNumUninitialized(NumSegments);
+        }
+
+        /** Inserts Segment below the first segment it is not above, IsBelow(A, B) compares two segments */
+        template<typename TIsBelow>
+        void Insert(int32 Segment, TIsBelow IsBelow)
+        {
+            FNode& Node = Nodes[Segment];
+            Node.Children[0] = INDEX_NONE;
+            Node.Children[1] = INDEX_NONE;
+            Node.Priority = MurmurFinalize32(static_cast<uint32>(Segment));
+            int32 Parent = INDEX_NONE;
+            int32 Side = 0;
+            for(int32 Current = Root; Current != INDEX_NONE; Current = Nodes[Current].Children[Side]) {
+                Parent = Current;
+                Side = IsBelow(Current, Segment) ? 1 : 0;
+            }
+            SetChild(Parent, Side, Segment);
+            // restore the heap order of the priorities
+            while(Node.Parent != INDEX_NONE && Nodes[Node.Parent].Priority > Node.Priority) {
+                RotateUp(Segment);
+            }
+        }
+
+        void Remove(int32 Segment)
+        {
+            const FNode& Node = Nodes[Segment];
+            // rotate the child with the lower priority up until the segment is a leaf
+            while(Node.Children[0] != INDEX_NONE || Node.Children[1] != INDEX_NONE) {
+                const int32 Lower = Node.Children[0];
+                const int32 Upper = Node.Children[1];
+                const bool bLowerUp = Upper == INDEX_NONE || (Lower != INDEX_NONE && Nodes[Lower].Priority < Nodes[Upper].Priority);
+                RotateUp(bLowerUp ? Lower : Upper);
+            }
+            if(Node.Parent == INDEX_NONE) {
+                Root = INDEX_NONE;
+            } else {
+                Nodes[Node.Parent].Children[GetSide(Segment)] = INDEX_NONE;
+            }
+        }
+
+        /** Segment directly below (Direction 0) or above (1) Segment, INDEX_NONE if there is none */
+        int32 GetNeighbour(int32 Segment, int32 Direction) const
+        {
+            int32 Current = Nodes[Segment].Children[Direction];
+            if(Current != INDEX_NONE) {
+                while(Nodes[Current].Children[1 - Direction] != INDEX_NONE) {
+                    Current = Nodes[Current].Children[1 - Direction];
+                }
+                return Current;
+            }
+            Current = Segment;
+            while(Nodes[Current].Parent != INDEX_NONE && GetSide(Current) == Direction) {
+                Current = Nodes[Current].Parent;
+            }
+            return Nodes[Current].Parent;
+        }
+
+    private:
+        struct FNode
+        {
+            int32 Parent;
+            int32 Children[2];
+            uint32 Priority;
+        };
+
+        /** 1 if Node is the upper child of its parent */
+        int32 GetSide(int32 Node) const
+        {
+            return Nodes[Nodes[Node].Parent].Children[1] == Node ? 1 : 0;
+        }
+
+        void SetChild(int32 Parent, int32 Side, int32 Child)
+        {
+            if(Parent == INDEX_NONE) {
+                Root = Child;
+            } else {
+                Nodes[Parent].Children[Side] = Child;
+            }
+            if(Child != INDEX_NONE) {
+                Nodes[Child].Parent = Parent;
+            }
+        }
+
+        /** Rotates Node above its parent, the order of the segments stays the same */
+        void RotateUp(int32 Node)
+        {
+            const int32 Parent = Nodes[Node].Parent;
+            const int32 GrandParent = Nodes[Parent].Parent;
+            const int32 Side = GetSide(Node);
+            const int32 ParentSide = GrandParent != INDEX_NONE ? GetSide(Parent) : 0;
+            SetChild(Parent, Side, Nodes[Node].Children[1 - Side]);
+            SetChild(Node, 1 - Side, Parent);
+            SetChild(GrandParent, ParentSide, Node);
+        }
+
+        TArray<FNode> Nodes;
+        int32 Root = INDEX_NONE;
+    };
+}
+
+bool FOSMPolygonValidity::HasSelfIntersection(TArrayView<const FOSMGeoPoint> Ring)
+{
+    TArray<FPoint> Points;
+    ToPoints(Ring, Points);
+    const int32 Num = Points.Num();
+    if(Num < 3) {
+        return false;
+    }
+
+    // edge i runs from vertex i to vertex i+1, stored with the lexicographically smaller endpoint first
+    struct FSegment
+    {
+        FPoint Left;
+        FPoint Right;
+    };
+    struct FEvent
+    {
+        FPoint Point;
+        int32 Segment;
+        bool bIsLeft;
+    };
+    TArray<FSegment> Segments;
+    TArray<FEvent> Events;
+    Segments.Reserve(Num);
+    Events.Reserve(Num * 2);
+    for(int32 i = 0; i < Num; i++) {
+        const FPoint& A = Points[i];
+        const FPoint& B = Points[(i + 1) % Num];
+        const bool bAFirst = IsLess(A, B);
+        Segments.Add({bAFirst ? A : B, bAFirst ? B : A});
+        Events.Add({Segments[i].Left, i, true});
+        Events.Add({Segments[i].Right, i, false});
+    }
+    // insertions before removals at the same point, so touching segments meet in the status
+    Events.Sort([](const FEvent& A, const FEvent& B)
+    {
+        if(!(A.Point == B.Point)) {
+            return IsLess(A.Point, B.Point);
+        }
+        return A.bIsLeft && !B.bIsLeft;
+    });
+
+    int64 SweepX = 0;
+    auto YAt = [&Segments, &SweepX](int32 Segment)
+    {
+        const FSegment& Seg = Segments[Segment];
+        if(Seg.Right.X == Seg.Left.X) {
+            return (double)Seg.Left.Y;
+        }
+        return Seg.Left.Y + (double)(SweepX - Seg.Left.X) / (Seg.Right.X - Seg.Left.X) * (Seg.Right.Y - Seg.Left.Y);
+    };
+    auto IsBelow = [&Segments, &YAt](int32 A, int32 B)
+    {
+        const double YA = YAt(A);
+        const double YB = YAt(B);
+        if(YA != YB) {
+            return YA < YB;
+        }
+        // same height at the sweep position, the flatter segment stays below, vertical ones are the steepest
+        const FSegment& SegA = Segments[A];
+        const FSegment& SegB = Segments[B];
+        const int64 DXA = SegA.Right.X - SegA.Left.X;
+        const int64 DXB = SegB.Right.X - SegB.Left.X;
+        if(DXA == 0 || DXB == 0) {
+            return DXA != 0 || (DXB == 0 && A < B);
+        }
+        // both run to the right, so the slopes compare like the cross multiplied rises
+        const int32 Slope = SignOfDifference(SegA.Right.Y - SegA.Left.Y, DXB, SegB.Right.Y - SegB.Left.Y, DXA);
+        return Slope != 0 ? Slope < 0 : A < B;
+    };
+    auto Intersect = [&Points, Num](int32 A, int32 B)
+    {
+        // neighbouring edges share a vertex, they are only invalid if they overlap
+        if((A + 1) % Num == B) {
+            return IsSpike(Points[A], Points[B], Points[(B + 1) % Num]);
+        }
+        if((B + 1) % Num == A) {
+            return IsSpike(Points[B], Points[A], Points[(A + 1) % Num]);
+        }
+        return SegmentsIntersect(Points[A], Points[(A + 1) % Num], Points[B], Points[(B + 1) % Num]);
+    };
+
+    // the order of the status is only consistent as long as there are no intersections, which is fine as the
+    // sweep stops at the first one
+    FSweepStatus Status(Num);
+    for(const FEvent& Event : Events) {
+        SweepX = Event.Point.X;
+        if(Event.bIsLeft) {
+            Status.Insert(Event.Segment, IsBelow);
+            const int32 Below = Status.GetNeighbour(Event.Segment, 0);
+            const int32 Above = Status.GetNeighbour(Event.Segment, 1);
+            if((Below != INDEX_NONE && Intersect(Below, Event.Segment)) || (Above != INDEX_NONE && Intersect(Event.Segment, Above))) {
+                return true;
+            }
+        } else {
+            const int32 Below = Status.GetNeighbour(Event.Segment, 0);
+            const int32 Above = Status.GetNeighbour(Event.Segment, 1);
+            if(Below != INDEX_NONE && Above != INDEX_NONE && Intersect(Below, Above)) {
+                return true;
+            }
+            Status.Remove(Event.Segment);
+        }
+    }
+    return false;
+}
+
+bool FOSMPolygonValidity::IsInside(const FOSMGeoPoint& Point, TArrayView<const FOSMGeoPoint> Ring)
+{
+    if(Ring.Num() < 3) {
+        return false;
+    }
+    const FPoint P = ToPoint(Point, Ring[0]);
+    bool bInside = false;
+    for(int32 i = 0, j = Ring.Num() - 1; i < Ring.Num(); j = i++) {
+        const FPoint A = ToPoint(Ring[i], Ring[0]);
+        const FPoint B = ToPoint(Ring[j], Ring[0]);
+        // P is left of the crossing if it is left of the edge directed upwards
+        if((A.Y > P.Y) != (B.Y > P.Y) && Orientation(A, B, P) == (B.Y > A.Y ? 1 : -1)) {
+            bInside = !bInside;
+        }
+    }
+    return bInside;
+}
+
+double FOSMPolygonValidity::SignedArea(TArrayView<const FOSMGeoPoint> Ring)
+{
+    double Area = 0.0;
+    for(int32 i = 1; i + 1 < Ring.Num(); i++) {
+        const FPoint A = ToPoint(Ring[i], Ring[0]);
+        const FPoint B = ToPoint(Ring[i + 1], Ring[0]);
+        Area += (double)A.X * B.Y - (double)B.X * A.Y;
+    }
+    // offsets are in 1e-7 degrees
+    return 0.5 * Area / (FOSMGeoPoint::Scale * FOSMGeoPoint::Scale);
+}
+
+bool FOSMPolygonValidity::FindRedundantVertices(TArrayView<const FOSMGeoPoint> Ring, TArray<int32>& OutKeep)
+{
+    OutKeep.Reset(Ring.Num());
+    auto PointAt = [&Ring](int32 i) { return ToPoint(Ring[i], Ring[0]); };
+
+    for(int32 i = 0; i < Ring.Num(); i++) {
+        const FPoint Point = PointAt(i);
+        if(OutKeep.Num() > 0 && PointAt(OutKeep.Last()) == Point) {
+            continue;
+        }
+        // removing a spike may expose the next one, e.g. when a way runs back over several nodes
+        while(OutKeep.Num() >= 2 && IsSpike(PointAt(OutKeep[OutKeep.Num() - 2]), PointAt(OutKeep.Last()), Point)) {
+            OutKeep.Pop(false);
+        }
+        OutKeep.Add(i);
+    }
+
+    // the seam between the last and the first vertex
+    while(OutKeep.Num() > 1 && PointAt(OutKeep.Last()) == PointAt(OutKeep[0])) {
+        OutKeep.Pop(false);
+    }
+    bool bChanged = true;
+    while(bChanged && OutKeep.Num() >= 3) {
+        bChanged = false;
+        const int32 Last = OutKeep.Num() - 1;
+        if(IsSpike(PointAt(OutKeep[Last - 1]), PointAt(OutKeep[Last]), PointAt(OutKeep[0]))) {
+            OutKeep.Pop(false);
+            bChanged = true;
+        } else if(IsSpike(PointAt(OutKeep[Last]), PointAt(OutKeep[0]), PointAt(OutKeep[1]))) {
+            OutKeep.RemoveAt(0, 1, false);
+            bChanged = true;
+        }
+    }
+    return OutKeep.Num() != Ring.Num();
+}
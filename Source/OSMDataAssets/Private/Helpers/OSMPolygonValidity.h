@@ -0,0 +1,33 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OSMDataAsset.h"
+
+/**
+ * Validity tests for footprint rings in longitude/latitude space.
+ * Rings are closed implicitly, the closing vertex is not repeated. Coordinates are fixed point offsets to the first
+ * vertex of a ring, the orientation predicates are exact in 128 bit integer arithmetic. Only the height of
+ * segments at the sweep position and the area are computed in double precision.
+ */
+class FOSMPolygonValidity
+{
+public:
+    /**
+     * Shamos-Hoey sweep line test in O(n log n) expected. Returns true if two edges that are not neighbours cross or
+     * touch, or if two neighbouring edges overlap, i.e. the ring has a spike.
+     */
+    static bool HasSelfIntersection(TArrayView<const FOSMGeoPoint> Ring);
+
+    /** Even-odd point in polygon test */
+    static bool IsInside(const FOSMGeoPoint& Point, TArrayView<const FOSMGeoPoint> Ring);
+
+    /** Shoelace area, positive for counter clockwise rings */
+    static double SignedArea(TArrayView<const FOSMGeoPoint> Ring);
+
+    /**
+     * Finds the vertices that remain after removing consecutive duplicates and spikes, where the ring runs
+     * back along the edge it came from. Returns false if nothing needs to be removed.
+     */
+    static bool FindRedundantVertices(TArrayView<const FOSMGeoPoint> Ring, TArray<int32>& OutKeep);
+};
@@ -0,0 +1,149 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMRingAssembler.h"
+
+bool FOSMRingAssembler::Assemble(const FOSMFile& Parser, const FOSMFile::FOSMRelationInfo& Relation, TArray<FRing>& OutRings)
+{
+    TArray<FMemberWay> Members;
+    Members.Reserve(Relation.Members.Num());
+    for(const auto * Member : Relation.Members) {
+        const FOSMFile::FOSMWayInfo * Way = Parser.WayMap.FindRef(Member->Ref);
+        if(!Way || Way->bHasMissingNodes || Way->Nodes.Num() < 2) {
+            UE_LOG(LogTemp, Warning, TEXT("FOSMRingAssembler: Relation %s references way %s which is missing or incomplete"), *Relation.RelationID, *Member->Ref)
+            return false;
+        }
+        FMemberWay& MemberWay = Members.AddDefaulted_GetRef();
+        MemberWay.Way = Way;
+        MemberWay.bIsInner = Member->bIsInner;
+        MemberWay.bHasRole = Member->bHasRole;
+        MemberWay.bUsed = false;
+    }
+
+    // endpoint node -> open member ways ending there, this makes joining linear in the number of members
+    TMap<const FOSMFile::FOSMNodeInfo*, TArray<int32, TInlineAllocator<2>>> Endpoints;
+    Endpoints.Reserve(Members.Num() * 2);
+    for(int32 i = 0; i < Members.Num(); i++) {
+        const auto& Nodes = Members[i].Way->Nodes;
+        if(Nodes[0] != Nodes.Last()) {
+            Endpoints.FindOrAdd(Nodes[0]).Add(i);
+            Endpoints.FindOrAdd(Nodes.Last()).Add(i);
+        }
+    }
+
+    TArray<bool> RingHasRole;
+    for(int32 i = 0; i < Members.Num(); i++) {
+        if(Members[i].bUsed) {
+            continue;
+        }
+        Members[i].bUsed = true;
+
+        FRing Ring;
+        Ring.Nodes = Members[i].Way->Nodes;
+        Ring.bIsInner = Members[i].bIsInner;
+        bool bHasRole = Members[i].bHasRole;
+        bool bRoleConflict = false;
+
+        // append connecting ways until we are back at the start node
+        while(Ring.Nodes.Last() != Ring.Nodes[0]) {
+            const auto * Candidates = Endpoints.Find(Ring.Nodes.Last());
+            int32 Next = INDEX_NONE;
+            if(Candidates) {
+                for(const int32 Candidate : *Candidates) {
+                    if(!Members[Candidate].bUsed) {
+                        Next = Candidate;
+                        break;
+                    }
+                }
+            }
+            if(Next == INDEX_NONE) {
+                UE_LOG(LogTemp, Warning, TEXT("FOSMRingAssembler: Relation %s has a ring that can not be closed"), *Relation.RelationID)
+                return false;
+            }
+
+            FMemberWay& NextMember = Members[Next];
+            NextMember.bUsed = true;
+            const auto& NextNodes = NextMember.Way->Nodes;
+            if(NextNodes[0] == Ring.Nodes.Last()) {
+                for(int32 n = 1; n < NextNodes.Num(); n++) {
+                    Ring.Nodes.Add(NextNodes[n]);
+                }
+            } else {
+                for(int32 n = NextNodes.Num() - 2; n >= 0; n--) {
+                    Ring.Nodes.Add(NextNodes[n]);
+                }
+            }
+
+            if(NextMember.bHasRole) {
+                if(!bHasRole) {
+                    Ring.bIsInner = NextMember.bIsInner;
+                    bHasRole = true;
+                } else if(Ring.bIsInner != NextMember.bIsInner) {
+                    bRoleConflict = true;
+                }
+            }
+        }
+
+        // closing node is implicit
+        Ring.Nodes.Pop();
+        if(Ring.Nodes.Num() < 3) {
+            UE_LOG(LogTemp, Warning, TEXT("FOSMRingAssembler: Relation %s contains a degenerated ring, skipping it"), *Relation.RelationID)
+            continue;
+        }
+        OutRings.Add(MoveTemp(Ring));
+        RingHasRole.Add(bHasRole && !bRoleConflict);
+    }
+
+    ClassifyByContainment(OutRings, RingHasRole);
+
+    // a relation without outer ring has nothing to extrude
+    return OutRings.ContainsByPredicate([](const FRing& Ring) { return !Ring.bIsInner; });
+}
+
+bool FOSMRingAssembler::IsInsideRing(const FOSMFile::FOSMNodeInfo* Point, const TArray<FOSMFile::FOSMNodeInfo*>& Ring)
+{
+    // even-odd rule, ray cast in positive longitude direction
+    bool bInside = false;
+    for(int32 i = 0, j = Ring.Num() - 1; i < Ring.Num(); j = i++) {
+        const FOSMFile::FOSMNodeInfo * A = Ring[i];
+        const FOSMFile::FOSMNodeInfo * B = Ring[j];
+        if((A->Latitude > Point->Latitude) != (B->Latitude > Point->Latitude)) {
+            const double CrossLon = A->Longitude + (Point->Latitude - A->Latitude) * (B->Longitude - A->Longitude) / (B->Latitude - A->Latitude);
+            if(Point->Longitude < CrossLon) {
+                bInside = !bInside;
+            }
+        }
+    }
+    return bInside;
+}
+
+void FOSMRingAssembler::ClassifyByContainment(TArray<FRing>& Rings, const TArray<bool>& HasRole)
+{
+    if(!HasRole.Contains(false)) {
+        return;
+    }
+
+    TArray<FBox2D> Bounds;
+    Bounds.Reserve(Rings.Num());
+    for(const auto& Ring : Rings) {
+        FBox2D Box(ForceInit);
+        for(const auto * Node : Ring.Nodes) {
+            Box += FVector2D(Node->Longitude, Node->Latitude);
+        }
+        Bounds.Add(Box);
+    }
+
+    // rings nested an odd number of times are holes
+    for(int32 i = 0; i < Rings.Num(); i++) {
+        if(HasRole[i]) {
+            continue;
+        }
+        const FOSMFile::FOSMNodeInfo * Probe = Rings[i].Nodes[0];
+        const FVector2D ProbePoint(Probe->Longitude, Probe->Latitude);
+        int32 Depth = 0;
+        for(int32 j = 0; j < Rings.Num(); j++) {
+            if(i != j && Bounds[j].IsInside(ProbePoint) && IsInsideRing(Probe, Rings[j].Nodes)) {
+                Depth++;
+            }
+        }
+        Rings[i].bIsInner = (Depth % 2) == 1;
+    }
+}
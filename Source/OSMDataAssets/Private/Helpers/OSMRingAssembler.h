@@ -0,0 +1,38 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OSMFileParser.h"
+
+/**
+ * Builds closed rings from the member ways of a multipolygon relation.
+ * Member ways may be split anywhere along a ring, they are joined end to end by their endpoint nodes.
+ */
+class FOSMRingAssembler
+{
+public:
+    struct FRing
+    {
+        // Nodes of the closed ring, the closing node is not repeated
+        TArray<FOSMFile::FOSMNodeInfo*> Nodes;
+        uint8 bIsInner : 1;
+    };
+
+    /**
+     * Assembles all rings of Relation. Returns false if the relation is broken, i.e. a member way is missing
+     * from the file or a ring can not be closed. Rings without explicit roles are classified by containment.
+     */
+    static bool Assemble(const FOSMFile& Parser, const FOSMFile::FOSMRelationInfo& Relation, TArray<FRing>& OutRings);
+
+private:
+    struct FMemberWay
+    {
+        const FOSMFile::FOSMWayInfo* Way;
+        uint8 bIsInner : 1;
+        uint8 bHasRole : 1;
+        uint8 bUsed : 1;
+    };
+
+    static bool IsInsideRing(const FOSMFile::FOSMNodeInfo* Point, const TArray<FOSMFile::FOSMNodeInfo*>& Ring);
+    static void ClassifyByContainment(TArray<FRing>& Rings, const TArray<bool>& HasRole);
+};
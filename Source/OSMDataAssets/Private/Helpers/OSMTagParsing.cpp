@@ -0,0 +1,266 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMTagParsing.h"
+
+namespace
+{
+    constexpr double MetersPerFoot = 0.3048;
+    constexpr double MetersPerInch = 0.0254;
+
+    void SkipSpaces(const TCHAR*& Cursor)
+    {
+        while(*Cursor == TEXT(' ')) {
+            Cursor++;
+        }
+    }
+
+    /** Reads an unsigned decimal number, returns false if there are no digits at Cursor */
+    bool ReadNumber(const TCHAR*& Cursor, double& OutValue)
+    {
+        double Value = 0.0;
+        bool bHasDigits = false;
+        while(*Cursor >= TEXT('0') && *Cursor <= TEXT('9')) {
+            Value = Value * 10.0 + (*Cursor - TEXT('0'));
+            bHasDigits = true;
+            Cursor++;
+        }
+        if(*Cursor == TEXT('.')) {
+            Cursor++;
+            double Scale = 0.1;
+            while(*Cursor >= TEXT('0') && *Cursor <= TEXT('9')) {
+                Value += (*Cursor - TEXT('0')) * Scale;
+                Scale *= 0.1;
+                bHasDigits = true;
+                Cursor++;
+            }
+        }
+        OutValue = Value;
+        return bHasDigits;
+    }
+
+    bool MatchUnit(const TCHAR*& Cursor, const TCHAR* Unit)
+    {
+        const int32 Len = FCString::Strlen(Unit);
+        if(FCString::Strnicmp(Cursor, Unit, Len) == 0) {
+            Cursor += Len;
+            return true;
+        }
+        return false;
+    }
+}
+
+bool OSMTagParsing::ParseLength(const TCHAR* Value, float& OutMeters)
+{
+    if(!Value) {
+        return false;
+    }
+
+    const TCHAR * Cursor = Value;
+    SkipSpaces(Cursor);
+    double Number;
+    if(!ReadNumber(Cursor, Number)) {
+        return false;
+    }
+    SkipSpaces(Cursor);
+
+    double Meters;
+    if(*Cursor == TEXT('\0')) {
+        Meters = Number;
+    } else if(*Cursor == TEXT('\'')) {
+        // feet and inches notation: 12'6"
+        Cursor++;
+        Meters = Number * MetersPerFoot;
+        SkipSpaces(Cursor);
+        double Inches;
+        if(ReadNumber(Cursor, Inches)) {
+            Meters += Inches * MetersPerInch;
+            if(*Cursor == TEXT('"')) {
+                Cursor++;
+            }
+        }
+    } else if(MatchUnit(Cursor, TEXT("km"))) {
+        Meters = Number * 1000.0;
+    } else if(MatchUnit(Cursor, TEXT("cm"))) {
+        Meters = Number * 0.01;
+    } else if(MatchUnit(Cursor, TEXT("mm"))) {
+        Meters = Number * 0.001;
+    } else if(MatchUnit(Cursor, TEXT("mi"))) {
+        Meters = Number * 1609.344;
+    } else if(MatchUnit(Cursor, TEXT("feet")) || MatchUnit(Cursor, TEXT("ft"))) {
+        Meters = Number * MetersPerFoot;
+    } else if(MatchUnit(Cursor, TEXT("in"))) {
+        Meters = Number * MetersPerInch;
+    } else if(MatchUnit(Cursor, TEXT("m"))) {
+        Meters = Number;
+    } else {
+        return false;
+    }
+
+    SkipSpaces(Cursor);
+    if(*Cursor != TEXT('\0')) {
+        return false;
+    }
+    OutMeters = static_cast<float>(Meters);
+    return true;
+}
+
+bool OSMTagParsing::ClassifyPOI(const TArray<TPair<FString, FString>>& Tags, EOSMPOICategory& OutCategory)
+{
+    auto Find = [&Tags](const TCHAR* Key) -> const FString*
+    {
+        for(const TPair<FString, FString>& Tag : Tags) {
+            if(Tag.Key == Key) {
+                return &Tag.Value;
+            }
+        }
+        return nullptr;
+    };
+    auto IsOneOf = [](const FString& Value, std::initializer_list<const TCHAR*> Values)
+    {
+        for(const TCHAR* Candidate : Values) {
+            if(Value == Candidate) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // in order of priority, a shop with amenity=atm is still a shop
+    if(Find(TEXT("shop"))) {
+        OutCategory = EOSMPOICategory::ShopPOI;
+        return true;
+    }
+    if(const FString * Amenity = Find(TEXT("amenity"))) {
+        if(IsOneOf(*Amenity, {TEXT("restaurant"), TEXT("cafe"), TEXT("fast_food"), TEXT("bar"), TEXT("pub"), TEXT("biergarten"), TEXT("food_court"), TEXT("ice_cream")})) {
+            OutCategory = EOSMPOICategory::FoodPOI;
+        } else if(IsOneOf(*Amenity, {TEXT("school"), TEXT("kindergarten"), TEXT("university"), TEXT("college"), TEXT("library")})) {
+            OutCategory = EOSMPOICategory::EducationPOI;
+        } else if(IsOneOf(*Amenity, {TEXT("hospital"), TEXT("clinic"), TEXT("doctors"), TEXT("dentist"), TEXT("pharmacy")})) {
+            OutCategory = EOSMPOICategory::HealthPOI;
+        } else if(IsOneOf(*Amenity, {TEXT("bank"), TEXT("atm"), TEXT("bureau_de_change")})) {
+            OutCategory = EOSMPOICategory::FinancePOI;
+        } else if(IsOneOf(*Amenity, {TEXT("parking"), TEXT("fuel"), TEXT("charging_station"), TEXT("bicycle_parking"), TEXT("car_rental")})) {
+            OutCategory = EOSMPOICategory::VehiclePOI;
+        } else if(IsOneOf(*Amenity, {TEXT("bus_station"), TEXT("ferry_terminal"), TEXT("taxi")})) {
+            OutCategory = EOSMPOICategory::TransportPOI;
+        } else if(*Amenity == TEXT("place_of_worship")) {
+            OutCategory = EOSMPOICategory::WorshipPOI;
+        } else if(IsOneOf(*Amenity, {TEXT("police"), TEXT("fire_station"), TEXT("townhall"), TEXT("post_office"), TEXT("courthouse")})) {
+            OutCategory = EOSMPOICategory::PublicServicePOI;
+        } else {
+            OutCategory = EOSMPOICategory::AmenityPOI;
+        }
+        return true;
+    }
+
+    const FString * Highway = Find(TEXT("highway"));
+    const FString * Railway = Find(TEXT("railway"));
+    if(Find(TEXT("public_transport")) || (Highway && *Highway == TEXT("bus_stop"))
+        || (Railway && IsOneOf(*Railway, {TEXT("station"), TEXT("halt"), TEXT("tram_stop"), TEXT("subway_entrance")})))
+    {
+        OutCategory = EOSMPOICategory::TransportPOI;
+        return true;
+    }
+    if(Find(TEXT("tourism"))) {
+        OutCategory = EOSMPOICategory::TourismPOI;
+        return true;
+    }
+    if(Find(TEXT("leisure"))) {
+        OutCategory = EOSMPOICategory::LeisurePOI;
+        return true;
+    }
+    if(Find(TEXT("historic"))) {
+        OutCategory = EOSMPOICategory::HistoricPOI;
+        return true;
+    }
+    if(Find(TEXT("office")) || Find(TEXT("craft"))) {
+        OutCategory = EOSMPOICategory::OfficePOI;
+        return true;
+    }
+    if(Find(TEXT("healthcare"))) {
+        OutCategory = EOSMPOICategory::HealthPOI;
+        return true;
+    }
+    if(Find(TEXT("emergency"))) {
+        OutCategory = EOSMPOICategory::AmenityPOI;
+        return true;
+    }
+    return false;
+}
+
+bool OSMTagParsing::ClassifyArea(const TCHAR* Key, const TCHAR* Value, EOSMAreaType& OutType)
+{
+    struct FAreaTag
+    {
+        const TCHAR* Value;
+        EOSMAreaType Type;
+    };
+    auto Match = [Value, &OutType](std::initializer_list<FAreaTag> Tags)
+    {
+        for(const FAreaTag& Tag : Tags) {
+            if(!FCString::Stricmp(Value, Tag.Value)) {
+                OutType = Tag.Type;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if(!FCString::Stricmp(Key, TEXT("landuse"))) {
+        if(!Match({
+            {TEXT("residential"), EOSMAreaType::ResidentialArea},
+            {TEXT("commercial"), EOSMAreaType::CommercialArea},
+            {TEXT("industrial"), EOSMAreaType::IndustrialArea},
+            {TEXT("retail"), EOSMAreaType::RetailArea},
+            {TEXT("farmland"), EOSMAreaType::FarmlandArea},
+            {TEXT("farmyard"), EOSMAreaType::FarmlandArea},
+            {TEXT("orchard"), EOSMAreaType::OrchardArea},
+            {TEXT("vineyard"), EOSMAreaType::OrchardArea},
+            {TEXT("cemetery"), EOSMAreaType::CemeteryArea},
+            {TEXT("construction"), EOSMAreaType::ConstructionArea},
+            {TEXT("brownfield"), EOSMAreaType::ConstructionArea},
+            {TEXT("greenfield"), EOSMAreaType::ConstructionArea},
+            {TEXT("forest"), EOSMAreaType::ForestArea},
+            {TEXT("grass"), EOSMAreaType::GrassArea},
+            {TEXT("village_green"), EOSMAreaType::GrassArea},
+            {TEXT("recreation_ground"), EOSMAreaType::GrassArea},
+            {TEXT("meadow"), EOSMAreaType::MeadowArea},
+            {TEXT("reservoir"), EOSMAreaType::WaterArea},
+            {TEXT("basin"), EOSMAreaType::WaterArea}
+        })) {
+            // landuse is always an area
+            OutType = EOSMAreaType::OtherArea;
+        }
+        return true;
+    }
+    if(!FCString::Stricmp(Key, TEXT("natural"))) {
+        return Match({
+            {TEXT("water"), EOSMAreaType::WaterArea},
+            {TEXT("wood"), EOSMAreaType::ForestArea},
+            {TEXT("grassland"), EOSMAreaType::GrassArea},
+            {TEXT("scrub"), EOSMAreaType::ScrubArea},
+            {TEXT("heath"), EOSMAreaType::HeathArea},
+            {TEXT("wetland"), EOSMAreaType::WetlandArea},
+            {TEXT("beach"), EOSMAreaType::BeachArea},
+            {TEXT("sand"), EOSMAreaType::BeachArea},
+            {TEXT("bare_rock"), EOSMAreaType::BareRockArea},
+            {TEXT("scree"), EOSMAreaType::BareRockArea}
+        });
+    }
+    if(!FCString::Stricmp(Key, TEXT("leisure"))) {
+        return Match({
+            {TEXT("park"), EOSMAreaType::ParkArea},
+            {TEXT("garden"), EOSMAreaType::GardenArea},
+            {TEXT("pitch"), EOSMAreaType::PitchArea},
+            {TEXT("sports_centre"), EOSMAreaType::PitchArea},
+            {TEXT("playground"), EOSMAreaType::PlaygroundArea},
+            {TEXT("golf_course"), EOSMAreaType::GolfArea}
+        });
+    }
+    if(!FCString::Stricmp(Key, TEXT("waterway"))) {
+        return Match({{TEXT("riverbank"), EOSMAreaType::WaterArea}});
+    }
+    if(!FCString::Stricmp(Key, TEXT("amenity"))) {
+        return Match({{TEXT("grave_yard"), EOSMAreaType::CemeteryArea}});
+    }
+    return false;
+}
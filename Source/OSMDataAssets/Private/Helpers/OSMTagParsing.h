@@ -0,0 +1,27 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Enums.h"
+
+/** Helpers for decoding OSM tag values */
+namespace OSMTagParsing
+{
+    /**
+     * Parses a length value like "12", "12.5 m", "40ft", "40 feet" or "12'6\"" and converts it to meters.
+     * OSM defaults to meters when no unit is given. Returns false if the value is not a length.
+     */
+    bool ParseLength(const TCHAR* Value, float& OutMeters);
+
+    /**
+     * Derives the point of interest category from the tags of a node. Returns false if none of the tags
+     * makes the node a point of interest, e.g. for nodes that only carry a name or a created_by tag.
+     */
+    bool ClassifyPOI(const TArray<TPair<FString, FString>>& Tags, EOSMPOICategory& OutCategory);
+
+    /**
+     * Derives the area type from a single tag of a way or relation. Returns false if the tag does not describe
+     * an area, e.g. natural=coastline or leisure=track, which are lines.
+     */
+    bool ClassifyArea(const TCHAR* Key, const TCHAR* Value, EOSMAreaType& OutType);
+}
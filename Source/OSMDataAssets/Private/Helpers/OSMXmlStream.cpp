@@ -0,0 +1,311 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMXmlStream.h"
+
+#include "HAL/FileManager.h"
+
+namespace
+{
+    constexpr int64 ChunkSize = 4 * 1024 * 1024;
+
+    FORCEINLINE bool IsSpace(uint8 Char)
+    {
+        return Char == ' ' || Char == '\t' || Char == '\r' || Char == '\n';
+    }
+
+    void AppendUTF8(uint32 CodePoint, TArray<ANSICHAR, TInlineAllocator<256>>& Out)
+    {
+        if(CodePoint < 0x80) {
+            Out.Add(static_cast<ANSICHAR>(CodePoint));
+        } else if(CodePoint < 0x800) {
+            Out.Add(static_cast<ANSICHAR>(0xC0 | (CodePoint >> 6)));
+            Out.Add(static_cast<ANSICHAR>(0x80 | (CodePoint & 0x3F)));
+        } else if(CodePoint < 0x10000) {
+            Out.Add(static_cast<ANSICHAR>(0xE0 | (CodePoint >> 12)));
+            Out.Add(static_cast<ANSICHAR>(0x80 | ((CodePoint >> 6) & 0x3F)));
+            Out.Add(static_cast<ANSICHAR>(0x80 | (CodePoint & 0x3F)));
+        } else {
+            Out.Add(static_cast<ANSICHAR>(0xF0 | (CodePoint >> 18)));
+            Out.Add(static_cast<ANSICHAR>(0x80 | ((CodePoint >> 12) & 0x3F)));
+            Out.Add(static_cast<ANSICHAR>(0x80 | ((CodePoint >> 6) & 0x3F)));
+            Out.Add(static_cast<ANSICHAR>(0x80 | (CodePoint & 0x3F)));
+        }
+    }
+
+    /** Decodes the entity between '&' and ';', returns false for unknown entities which are kept as they are */
+    bool DecodeEntity(const uint8* Begin, const uint8* End, TArray<ANSICHAR, TInlineAllocator<256>>& Out)
+    {
+        const int64 EntityLength = End - Begin;
+        auto Is = [&](const ANSICHAR* Name)
+        {
+            return FCStringAnsi::Strlen(Name) == EntityLength
+                && FCStringAnsi::Strncmp(reinterpret_cast<const ANSICHAR*>(Begin), Name, EntityLength) == 0;
+        };
+        if(Is("amp")) {
+            Out.Add('&');
+        } else if(Is("lt")) {
+            Out.Add('<');
+        } else if(Is("gt")) {
+            Out.Add('>');
+        } else if(Is("quot")) {
+            Out.Add('"');
+        } else if(Is("apos")) {
+            Out.Add('\'');
+        } else if(EntityLength > 1 && Begin[0] == '#') {
+            const bool bIsHex = Begin[1] == 'x' || Begin[1] == 'X';
+            uint32 CodePoint = 0;
+            for(const uint8* At = Begin + (bIsHex ? 2 : 1); At < End; At++) {
+                if(*At >= '0' && *At <= '9') {
+                    CodePoint = CodePoint * (bIsHex ? 16 : 10) + (*At - '0');
+                } else if(bIsHex && FChar::ToLower(*At) >= 'a' && FChar::ToLower(*At) <= 'f') {
+                    CodePoint = CodePoint * 16 + (FChar::ToLower(*At) - 'a' + 10);
+                } else {
+                    return false;
+                }
+            }
+            AppendUTF8(FMath::Min<uint32>(CodePoint, 0x10FFFF), Out);
+        } else {
+            return false;
+        }
+        return true;
+    }
+}
+
+bool FOSMXmlStream::Open(const FString& Filename)
+{
+    Reader.Reset(IFileManager::Get().CreateFileReader(*Filename));
+    if(!Reader) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMXmlStream: Failed to open %s"), *Filename)
+        return false;
+    }
+    FileSize = Reader->TotalSize();
+    Remaining = FileSize;
+    Buffer.SetNumUninitialized(FMath::Min(FileSize, ChunkSize));
+    return true;
+}
+
+bool FOSMXmlStream::Next()
+{
+    if(bPendingEnd) {
+        bPendingEnd = false;
+        bIsEnd = true;
+        return true;
+    }
+
+    int64 Cursor = TagEnd;
+    while(true) {
+        while(Cursor < Length && Buffer[Cursor] != '<') {
+            Cursor++;
+        }
+        if(Cursor >= Length) {
+            if(!Refill(Length)) {
+                return false;
+            }
+            Cursor = 0;
+            continue;
+        }
+
+        // the closing '>' is searched outside of quoted values, comments may contain anything up to "-->"
+        const int64 Begin = Cursor;
+        if(Begin + 4 > Length && Remaining > 0) {
+            if(!Refill(Begin)) {
+                return false;
+            }
+            Cursor = 0;
+            continue;
+        }
+        const bool bIsComment = Begin + 4 <= Length && FMemory::Memcmp(&Buffer[Begin], "<!--", 4) == 0;
+        int64 Close = INDEX_NONE;
+        uint8 Quote = 0;
+        for(int64 i = Begin + 1; i < Length; i++) {
+            const uint8 Char = Buffer[i];
+            if(bIsComment) {
+                if(Char == '>' && i - Begin >= 6 && Buffer[i - 1] == '-' && Buffer[i - 2] == '-') {
+                    Close = i;
+                    break;
+                }
+            } else if(Quote) {
+                Quote = Char == Quote ? 0 : Quote;
+            } else if(Char == '"' || Char == '\'') {
+                Quote = Char;
+            } else if(Char == '>') {
+                Close = i;
+                break;
+            }
+        }
+        if(Close == INDEX_NONE) {
+            // the tag continues in the next chunk
+            if(!Refill(Begin)) {
+                if(!bIsError) {
+                    UE_LOG(LogTemp, Error, TEXT("FOSMXmlStream: File ends inside a tag"))
+                    bIsError = true;
+                }
+                return false;
+            }
+            Cursor = 0;
+            continue;
+        }
+        Cursor = Close + 1;
+        if(Buffer[Begin + 1] == '?' || Buffer[Begin + 1] == '!') {
+            continue;
+        }
+
+        TagBegin = Begin;
+        TagEnd = Close + 1;
+        bIsEnd = Buffer[Begin + 1] == '/';
+        NameBegin = Begin + (bIsEnd ? 2 : 1);
+        NameEnd = NameBegin;
+        while(NameEnd < Close && !IsSpace(Buffer[NameEnd]) && Buffer[NameEnd] != '/') {
+            NameEnd++;
+        }
+        bPendingEnd = !bIsEnd && Buffer[Close - 1] == '/';
+        return true;
+    }
+}
+
+bool FOSMXmlStream::Refill(int64 Keep)
+{
+    if(Remaining <= 0 || !Reader) {
+        return false;
+    }
+    const int64 Kept = Length - Keep;
+    FMemory::Memmove(Buffer.GetData(), Buffer.GetData() + Keep, Kept);
+    FileOffset += Keep;
+    TagBegin = 0;
+    TagEnd = 0;
+
+    // a tag longer than a chunk grows the buffer
+    const int64 Read = FMath::Min(Remaining, ChunkSize);
+    if(Kept + Read > Buffer.Num()) {
+        Buffer.SetNumUninitialized(Kept + Read);
+    }
+    Reader->Serialize(Buffer.GetData() + Kept, Read);
+    if(Reader->IsError()) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMXmlStream: Failed to read at offset %lld"), FileOffset + Kept)
+        bIsError = true;
+        return false;
+    }
+    Remaining -= Read;
+    Length = Kept + Read;
+    return true;
+}
+
+bool FOSMXmlStream::IsElement(const ANSICHAR* Name) const
+{
+    const int64 NameLength = FCStringAnsi::Strlen(Name);
+    return NameEnd - NameBegin == NameLength
+        && FMemory::Memcmp(&Buffer[NameBegin], Name, NameLength) == 0;
+}
+
+bool FOSMXmlStream::FindAttribute(const ANSICHAR* Name, const uint8*& OutBegin, const uint8*& OutEnd) const
+{
+    if(bIsEnd) {
+        return false;
+    }
+    const int64 NameLength = FCStringAnsi::Strlen(Name);
+    const int64 Close = TagEnd - 1;
+    int64 i = NameEnd;
+    while(true) {
+        while(i < Close && IsSpace(Buffer[i])) {
+            i++;
+        }
+        if(i >= Close || Buffer[i] == '/') {
+            return false;
+        }
+        const int64 AttributeBegin = i;
+        while(i < Close && Buffer[i] != '=' && !IsSpace(Buffer[i])) {
+            i++;
+        }
+        const int64 AttributeEnd = i;
+        while(i < Close && IsSpace(Buffer[i])) {
+            i++;
+        }
+        if(i >= Close || Buffer[i] != '=') {
+            return false;
+        }
+        i++;
+        while(i < Close && IsSpace(Buffer[i])) {
+            i++;
+        }
+        if(i >= Close || (Buffer[i] != '"' && Buffer[i] != '\'')) {
+            return false;
+        }
+        const uint8 Quote = Buffer[i++];
+        const int64 ValueBegin = i;
+        while(i < Close && Buffer[i] != Quote) {
+            i++;
+        }
+        const int64 ValueEnd = i++;
+        if(AttributeEnd - AttributeBegin == NameLength
+            && FMemory::Memcmp(&Buffer[AttributeBegin], Name, NameLength) == 0)
+        {
+            OutBegin = Buffer.GetData() + ValueBegin;
+            OutEnd = Buffer.GetData() + ValueEnd;
+            return true;
+        }
+    }
+}
+
+bool FOSMXmlStream::GetAttribute(const ANSICHAR* Name, FString& OutValue) const
+{
+    const uint8 * Begin;
+    const uint8 * End;
+    if(!FindAttribute(Name, Begin, End)) {
+        return false;
+    }
+    TArray<ANSICHAR, TInlineAllocator<256>> Decoded;
+    Decoded.Reserve(End - Begin);
+    for(const uint8* At = Begin; At < End; At++) {
+        if(*At == '&') {
+            const uint8 * Semicolon = At + 1;
+            while(Semicolon < End && *Semicolon != ';' && Semicolon - At < 12) {
+                Semicolon++;
+            }
+            if(Semicolon < End && *Semicolon == ';' && DecodeEntity(At + 1, Semicolon, Decoded)) {
+                At = Semicolon;
+                continue;
+            }
+        }
+        Decoded.Add(static_cast<ANSICHAR>(*At));
+    }
+    const FUTF8ToTCHAR Converted(Decoded.GetData(), Decoded.Num());
+    OutValue = FString(Converted.Length(), Converted.Get());
+    return true;
+}
+
+bool FOSMXmlStream::GetAttribute(const ANSICHAR* Name, int64& OutValue) const
+{
+    const uint8 * Begin;
+    const uint8 * End;
+    if(!FindAttribute(Name, Begin, End) || Begin == End) {
+        return false;
+    }
+    const bool bIsNegative = *Begin == '-';
+    int64 Value = 0;
+    for(const uint8* At = Begin + (bIsNegative ? 1 : 0); At < End; At++) {
+        if(*At < '0' || *At > '9') {
+            return false;
+        }
+        Value = Value * 10 + (*At - '0');
+    }
+    OutValue = bIsNegative ? -Value : Value;
+    return true;
+}
+
+bool FOSMXmlStream::GetAttribute(const ANSICHAR* Name, double& OutValue) const
+{
+    const uint8 * Begin;
+    const uint8 * End;
+    if(!FindAttribute(Name, Begin, End)) {
+        return false;
+    }
+    // Atod needs a terminated string
+    constexpr int32 MaxValueLength = 31;
+    ANSICHAR Value[MaxValueLength + 1];
+    int32 n = 0;
+    for(const uint8* At = Begin; At < End && n < MaxValueLength; At++) {
+        Value[n++] = static_cast<ANSICHAR>(*At);
+    }
+    Value[n] = 0;
+    OutValue = FCStringAnsi::Atod(Value);
+    return true;
+}
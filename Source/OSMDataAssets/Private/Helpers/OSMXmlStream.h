@@ -0,0 +1,62 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Pull reader for OSM XML that reads the file in chunks, so files of any size are read with a small buffer.
+ * Only covers what OSM files use: elements with quoted attributes and no text content. Declarations and
+ * comments are skipped. A self-closing element is reported as a start followed by an end.
+ */
+class FOSMXmlStream
+{
+public:
+    /** Opens Filename for reading, returns false if it can not be opened */
+    bool Open(const FString& Filename);
+
+    /** Advances to the next start or end tag. Returns false at the end of the file or on a read error. */
+    bool Next();
+
+    bool IsError() const { return bIsError; }
+
+    /** True if the current tag closes an element */
+    bool IsEnd() const { return bIsEnd; }
+
+    /** True if the current tag opens or closes the element Name */
+    bool IsElement(const ANSICHAR* Name) const;
+
+    /** Reads attribute Name of the current start tag, entities are decoded */
+    bool GetAttribute(const ANSICHAR* Name, FString& OutValue) const;
+    bool GetAttribute(const ANSICHAR* Name, int64& OutValue) const;
+    bool GetAttribute(const ANSICHAR* Name, double& OutValue) const;
+
+    int64 GetFileSize() const { return FileSize; }
+
+    /** Bytes consumed so far, for progress reporting */
+    int64 GetPosition() const { return FileOffset + TagEnd; }
+
+private:
+    /** Moves the bytes from Keep on to the front and appends the next chunk, false at the end of the file */
+    bool Refill(int64 Keep);
+
+    /** Finds the raw value of attribute Name in the current tag */
+    bool FindAttribute(const ANSICHAR* Name, const uint8*& OutBegin, const uint8*& OutEnd) const;
+
+    TUniquePtr<FArchive> Reader;
+    TArray64<uint8> Buffer;
+    int64 FileSize = 0;
+    int64 Remaining = 0;
+    /** File offset of Buffer[0] */
+    int64 FileOffset = 0;
+    int64 Length = 0;
+
+    /** Current tag, from its '<' to one past its '>' */
+    int64 TagBegin = 0;
+    int64 TagEnd = 0;
+    int64 NameBegin = 0;
+    int64 NameEnd = 0;
+    bool bIsEnd = false;
+    /** The current start tag was self-closing, the next call reports its end without reading */
+    bool bPendingEnd = false;
+    bool bIsError = false;
+};
@@ -0,0 +1,110 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMAreaDataAsset.h"
+
+#include "Misc/FileHelper.h"
+#include "OSMRasterizer.h"
+
+namespace
+{
+    constexpr int32 NumAreaTypes = EOSMAreaType::OtherArea + 1;
+}
+
+void UOSMAreaDataAsset::BucketByAreaType()
+{
+    TArray<int32> Offsets;
+    Offsets.SetNumZeroed(NumAreaTypes + 1);
+    for(const FOSMAreaData& Area : Areas) {
+        Offsets[Area.AreaType + 1]++;
+    }
+    for(int32 Type = 0; Type < NumAreaTypes; Type++) {
+        Offsets[Type + 1] += Offsets[Type];
+    }
+    AreaTypeOffsets = Offsets;
+
+    TArray<FOSMAreaData> Sorted;
+    Sorted.SetNum(Areas.Num());
+    for(FOSMAreaData& Area : Areas) {
+        Sorted[Offsets[Area.AreaType]++] = MoveTemp(Area);
+    }
+    Areas = MoveTemp(Sorted);
+}
+
+TArrayView<const FOSMAreaData> UOSMAreaDataAsset::GetAreasOfType(EOSMAreaType Type) const
+{
+    int32 First;
+    int32 Num;
+    if(!GetAreaTypeRange(Type, First, Num)) {
+        return TArrayView<const FOSMAreaData>();
+    }
+    return TArrayView<const FOSMAreaData>(Areas.GetData() + First, Num);
+}
+
+bool UOSMAreaDataAsset::GetAreaTypeRange(TEnumAsByte<EOSMAreaType> Type, int32& OutFirst, int32& OutNum) const
+{
+    OutFirst = 0;
+    OutNum = 0;
+    if(AreaTypeOffsets.Num() != NumAreaTypes + 1 || Type >= NumAreaTypes) {
+        return false;
+    }
+    OutFirst = AreaTypeOffsets[Type];
+    OutNum = AreaTypeOffsets[Type + 1] - AreaTypeOffsets[Type];
+    return true;
+}
+
+bool UOSMAreaDataAsset::GetBounds(FOSMGeoPoint& OutMin, FOSMGeoPoint& OutMax) const
+{
+    OutMin = FOSMGeoPoint(MAX_int32, MAX_int32);
+    OutMax = FOSMGeoPoint(MIN_int32, MIN_int32);
+    bool bHasVertices = false;
+    for(const FOSMAreaData& Area : Areas) {
+        for(const FMPBuildingPart& Ring : Area.Rings) {
+            for(const FOSMGeoPoint& Point : Ring.PolygonCoordinates) {
+                OutMin.LongitudeE7 = FMath::Min(OutMin.LongitudeE7, Point.LongitudeE7);
+                OutMin.LatitudeE7 = FMath::Min(OutMin.LatitudeE7, Point.LatitudeE7);
+                OutMax.LongitudeE7 = FMath::Max(OutMax.LongitudeE7, Point.LongitudeE7);
+                OutMax.LatitudeE7 = FMath::Max(OutMax.LatitudeE7, Point.LatitudeE7);
+                bHasVertices = true;
+            }
+        }
+    }
+    return bHasVertices;
+}
+
+bool UOSMAreaDataAsset::RasterizeLayerMask(const TArray<TEnumAsByte<EOSMAreaType>>& Types, const FOSMGeoPoint& Min, const FOSMGeoPoint& Max, int32 Width, int32 Height, TArray<uint8>& OutMask) const
+{
+    OutMask.Reset();
+    if(Width <= 0 || Height <= 0 || Min.LongitudeE7 >= Max.LongitudeE7 || Min.LatitudeE7 >= Max.LatitudeE7) {
+        UE_LOG(LogTemp, Error, TEXT("UOSMAreaDataAsset: Invalid layer mask size %dx%d or bounds"), Width, Height)
+        return false;
+    }
+    OutMask.SetNumZeroed(Width * Height);
+
+    // every area is its own polygon, so holes only cut out of the area they belong to
+    FOSMScanlineRasterizer Rasterizer(Min, Max, Width, Height);
+    for(const TEnumAsByte<EOSMAreaType> Type : Types) {
+        for(const FOSMAreaData& Area : GetAreasOfType(Type)) {
+            Rasterizer.BeginPolygon();
+            for(const FMPBuildingPart& Ring : Area.Rings) {
+                Rasterizer.AddRing(Ring.PolygonCoordinates);
+            }
+        }
+    }
+    Rasterizer.Rasterize([&OutMask, Width](int32 Polygon, int32 Row, int32 FirstColumn, int32 EndColumn)
+    {
+        FMemory::Memset(OutMask.GetData() + Row * Width + FirstColumn, 0xFF, EndColumn - FirstColumn);
+    });
+    return true;
+}
+
+bool UOSMAreaDataAsset::ExportLayerMask(const FString& Filename, const TArray<TEnumAsByte<EOSMAreaType>>& Types, const FOSMGeoPoint& Min, const FOSMGeoPoint& Max, int32 Width, int32 Height) const
+{
+    TArray<uint8> Mask;
+    if(!RasterizeLayerMask(Types, Min, Max, Width, Height, Mask)) {
+        return false;
+    }
+    if(!FFileHelper::SaveArrayToFile(Mask, *Filename)) {
+        UE_LOG(LogTemp, Error, TEXT("UOSMAreaDataAsset: Failed to write layer mask %s"), *Filename)
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,381 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMBatchProjection.h"
+
+#include "GeoReferenceActor.h"
+#include "OSMDataAsset.h"
+#include "Async/ParallelFor.h"
+#include "Runtime/Launch/Resources/Version.h"
+
+namespace
+{
+#if ENGINE_MAJOR_VERSION >= 5
+    using FOSMVector4 = VectorRegister4Float;
+#else
+    using FOSMVector4 = VectorRegister;
+#endif
+
+    /** Samples per axis of the grid the polynomial is fitted to, the checks lie between them */
+    constexpr int32 NumSamples = 5;
+
+    /** Below this many points fitting needs more calls to the actor than it saves */
+    constexpr int32 MinFitPoints = 256;
+
+    /** Vertices per ParallelFor task */
+    constexpr int32 PointsPerTask = 4096;
+
+    /** Half extent of the box for a single point, about a centimeter */
+    constexpr double MinHalfExtent = 1e-7;
+
+    /** Offsets are checked in double, so points on the box edge stay inside after rounding */
+    constexpr double BoxMargin = 1e-6;
+
+    FORCEINLINE void GetTerms(double U, double V, double OutTerms[6])
+    {
+        OutTerms[0] = 1;
+        OutTerms[1] = U;
+        OutTerms[2] = V;
+        OutTerms[3] = U * U;
+        OutTerms[4] = U * V;
+        OutTerms[5] = V * V;
+    }
+
+    FORCEINLINE bool IsInBox(double U, double V)
+    {
+        return FMath::Abs(U) <= 1 + BoxMargin && FMath::Abs(V) <= 1 + BoxMargin;
+    }
+
+    /** Solves Matrix * X = Rhs for three right hand sides by Gaussian elimination, X replaces Rhs */
+    bool Solve(double Matrix[6][6], double Rhs[6][3])
+    {
+        for(int32 Column = 0; Column < 6; Column++) {
+            int32 Pivot = Column;
+            for(int32 Row = Column + 1; Row < 6; Row++) {
+                if(FMath::Abs(Matrix[Row][Column]) > FMath::Abs(Matrix[Pivot][Column])) {
+                    Pivot = Row;
+                }
+            }
+            if(FMath::Abs(Matrix[Pivot][Column]) < 1e-12) {
+                return false;
+            }
+            for(int32 i = 0; i < 6; i++) {
+                Swap(Matrix[Column][i], Matrix[Pivot][i]);
+            }
+            for(int32 a = 0; a < 3; a++) {
+                Swap(Rhs[Column][a], Rhs[Pivot][a]);
+            }
+            for(int32 Row = Column + 1; Row < 6; Row++) {
+                const double Factor = Matrix[Row][Column] / Matrix[Column][Column];
+                for(int32 i = Column; i < 6; i++) {
+                    Matrix[Row][i] -= Factor * Matrix[Column][i];
+                }
+                for(int32 a = 0; a < 3; a++) {
+                    Rhs[Row][a] -= Factor * Rhs[Column][a];
+                }
+            }
+        }
+        for(int32 Row = 5; Row >= 0; Row--) {
+            for(int32 a = 0; a < 3; a++) {
+                double Value = Rhs[Row][a];
+                for(int32 i = Row + 1; i < 6; i++) {
+                    Value -= Matrix[Row][i] * Rhs[i][a];
+                }
+                Rhs[Row][a] = Value / Matrix[Row][Row];
+            }
+        }
+        return true;
+    }
+}
+
+FOSMBatchProjection::FOSMBatchProjection(AGeoReferenceActor* InGeoReference, const FVector2D& Min, const FVector2D& Max, float Tolerance)
+    : GeoReference(InGeoReference)
+{
+    FMemory::Memzero(Coefficients);
+    if(!GeoReference) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMBatchProjection: No GeoReference"))
+        return;
+    }
+    CenterLongitude = 0.5 * (static_cast<double>(Min.X) + Max.X);
+    CenterLatitude = 0.5 * (static_cast<double>(Min.Y) + Max.Y);
+    const double HalfWidth = FMath::Max(0.5 * (static_cast<double>(Max.X) - Min.X), MinHalfExtent);
+    const double HalfHeight = FMath::Max(0.5 * (static_cast<double>(Max.Y) - Min.Y), MinHalfExtent);
+    InvHalfWidth = 1 / HalfWidth;
+    InvHalfHeight = 1 / HalfHeight;
+
+    // least squares through the normal equations, the terms are well conditioned on [-1, 1]
+    double Matrix[6][6] = {};
+    double Rhs[6][3] = {};
+    for(int32 j = 0; j < NumSamples; j++) {
+        for(int32 i = 0; i < NumSamples; i++) {
+            const double U = -1 + 2.0 * i / (NumSamples - 1);
+            const double V = -1 + 2.0 * j / (NumSamples - 1);
+            const FVector Game = GeoReference->ToGameCoordinate(FVector(CenterLongitude + U * HalfWidth, CenterLatitude + V * HalfHeight, 0));
+            double Terms[6];
+            GetTerms(U, V, Terms);
+            for(int32 Row = 0; Row < 6; Row++) {
+                for(int32 Column = 0; Column < 6; Column++) {
+                    Matrix[Row][Column] += Terms[Row] * Terms[Column];
+                }
+                Rhs[Row][0] += Terms[Row] * Game.X;
+                Rhs[Row][1] += Terms[Row] * Game.Y;
+                Rhs[Row][2] += Terms[Row] * Game.Z;
+            }
+        }
+    }
+    if(!Solve(Matrix, Rhs)) {
+        UE_LOG(LogTemp, Warning, TEXT("FOSMBatchProjection: Projection can not be fitted, projecting every vertex"))
+        return;
+    }
+    for(int32 a = 0; a < 3; a++) {
+        for(int32 Term = 0; Term < 6; Term++) {
+            Coefficients[a][Term] = Rhs[Term][a];
+        }
+    }
+
+    // checked in the middle of the sample cells with the same float evaluation Project uses
+    constexpr int32 NumChecks = NumSamples - 1;
+    alignas(16) float U[4];
+    alignas(16) float V[4];
+    FVector Fitted[4];
+    for(int32 j = 0; j < NumChecks; j++) {
+        for(int32 i = 0; i < NumChecks; i += 4) {
+            const int32 Count = FMath::Min(4, NumChecks - i);
+            for(int32 Lane = 0; Lane < 4; Lane++) {
+                U[Lane] = Lane < Count ? -1 + 2.0 * (i + Lane + 0.5) / NumChecks : 0;
+                V[Lane] = -1 + 2.0 * (j + 0.5) / NumChecks;
+            }
+            EvaluateBlock(U, V, Count, Fitted);
+            for(int32 Lane = 0; Lane < Count; Lane++) {
+                const FVector Geo(CenterLongitude + U[Lane] * HalfWidth, CenterLatitude + V[Lane] * HalfHeight, 0);
+                FitError = FMath::Max<double>(FitError, FVector::Dist(Fitted[Lane], GeoReference->ToGameCoordinate(Geo)));
+            }
+        }
+    }
+    bIsFitted = FitError <= Tolerance;
+    if(!bIsFitted) {
+        UE_LOG(LogTemp, Log, TEXT("FOSMBatchProjection: Fit error %f exceeds %f, projecting every vertex"), FitError, Tolerance)
+    }
+}
+
+FOSMBatchProjection FOSMBatchProjection::ForAsset(AGeoReferenceActor* GeoReference, const UOSMDataAsset* Asset, float Tolerance)
+{
+    // bounds in fixed point per building, reduced afterwards
+    const int32 NumBuildings = Asset ? Asset->Buildings.Num() : 0;
+    const int32 NumAll = Asset ? NumBuildings + Asset->MultiPolygonBuildings.Num() : 0;
+    TArray<FIntRect> Bounds;
+    Bounds.SetNumUninitialized(NumAll);
+    ParallelFor(NumAll, [&](int32 i)
+    {
+        FIntRect& Box = Bounds[i];
+        Box = FIntRect(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+        TArray<FOSMGeoPoint> Points;
+        auto Add = [&](const FOSMFootprint& Footprint)
+        {
+            Asset->ResolveCoordinates(Footprint, Points);
+            for(const FOSMGeoPoint& Point : Points) {
+                Box.Min.X = FMath::Min(Box.Min.X, Point.LongitudeE7);
+                Box.Min.Y = FMath::Min(Box.Min.Y, Point.LatitudeE7);
+                Box.Max.X = FMath::Max(Box.Max.X, Point.LongitudeE7);
+                Box.Max.Y = FMath::Max(Box.Max.Y, Point.LatitudeE7);
+            }
+        };
+        if(i < NumBuildings) {
+            Add(Asset->Buildings[i]);
+        } else {
+            for(const FMPBuildingPart& Part : Asset->MultiPolygonBuildings[i - NumBuildings].Parts) {
+                Add(Part);
+            }
+        }
+    });
+
+    FIntRect Box(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+    for(const FIntRect& Building : Bounds) {
+        Box.Min = Box.Min.ComponentMin(Building.Min);
+        Box.Max = Box.Max.ComponentMax(Building.Max);
+    }
+    if(Box.Min.X > Box.Max.X) {
+        Box = FIntRect();
+    }
+    return FOSMBatchProjection(GeoReference,
+        FVector2D(Box.Min.X / FOSMGeoPoint::Scale, Box.Min.Y / FOSMGeoPoint::Scale),
+        FVector2D(Box.Max.X / FOSMGeoPoint::Scale, Box.Max.Y / FOSMGeoPoint::Scale), Tolerance);
+}
+
+void FOSMBatchProjection::EvaluateBlock(const float* U, const float* V, int32 Count, FVector* OutGamePoints) const
+{
+    const FOSMVector4 U4 = VectorLoadAligned(U);
+    const FOSMVector4 V4 = VectorLoadAligned(V);
+    const FOSMVector4 UU = VectorMultiply(U4, U4);
+    const FOSMVector4 UV = VectorMultiply(U4, V4);
+    const FOSMVector4 VV = VectorMultiply(V4, V4);
+
+    // only the offsets from the center are evaluated in float, the constant term is added in double
+    alignas(16) float Offsets[3][4];
+    for(int32 a = 0; a < 3; a++) {
+        const double * C = Coefficients[a];
+        FOSMVector4 Result = VectorMultiply(VV, VectorSetFloat1(static_cast<float>(C[5])));
+        Result = VectorMultiplyAdd(UV, VectorSetFloat1(static_cast<float>(C[4])), Result);
+        Result = VectorMultiplyAdd(UU, VectorSetFloat1(static_cast<float>(C[3])), Result);
+        Result = VectorMultiplyAdd(V4, VectorSetFloat1(static_cast<float>(C[2])), Result);
+        Result = VectorMultiplyAdd(U4, VectorSetFloat1(static_cast<float>(C[1])), Result);
+        VectorStoreAligned(Result, Offsets[a]);
+    }
+    for(int32 Lane = 0; Lane < Count; Lane++) {
+        OutGamePoints[Lane] = FVector(Coefficients[0][0] + Offsets[0][Lane],
+                                      Coefficients[1][0] + Offsets[1][Lane],
+                                      Coefficients[2][0] + Offsets[2][Lane]);
+    }
+}
+
+void FOSMBatchProjection::Evaluate(TArrayView<const FVector> GeoPoints, TArrayView<FVector> OutGamePoints, TArray<int32>& OutActorIndices) const
+{
+    check(GeoPoints.Num() == OutGamePoints.Num());
+    const int32 Num = GeoPoints.Num();
+    if(!bIsFitted) {
+        for(int32 i = 0; i < Num; i++) {
+            OutActorIndices.Add(i);
+        }
+        return;
+    }
+
+    alignas(16) float U[4];
+    alignas(16) float V[4];
+    for(int32 First = 0; First < Num; First += 4) {
+        const int32 Count = FMath::Min(4, Num - First);
+        for(int32 Lane = 0; Lane < 4; Lane++) {
+            U[Lane] = 0;
+            V[Lane] = 0;
+            if(Lane < Count) {
+                const FVector& Point = GeoPoints[First + Lane];
+                const double PointU = (Point.X - CenterLongitude) * InvHalfWidth;
+                const double PointV = (Point.Y - CenterLatitude) * InvHalfHeight;
+                if(Point.Z != 0 || !IsInBox(PointU, PointV)) {
+                    OutActorIndices.Add(First + Lane);
+                } else {
+                    U[Lane] = static_cast<float>(PointU);
+                    V[Lane] = static_cast<float>(PointV);
+                }
+            }
+        }
+        EvaluateBlock(U, V, Count, &OutGamePoints[First]);
+    }
+}
+
+void FOSMBatchProjection::Evaluate(TArrayView<const FOSMGeoPoint> Coordinates, TArrayView<FVector> OutGamePoints, TArray<int32>& OutActorIndices) const
+{
+    check(Coordinates.Num() == OutGamePoints.Num());
+    const int32 Num = Coordinates.Num();
+    if(!bIsFitted) {
+        for(int32 i = 0; i < Num; i++) {
+            OutActorIndices.Add(i);
+        }
+        return;
+    }
+
+    const int64 CenterLongitudeE7 = static_cast<int64>(FMath::RoundToDouble(CenterLongitude * FOSMGeoPoint::Scale));
+    const int64 CenterLatitudeE7 = static_cast<int64>(FMath::RoundToDouble(CenterLatitude * FOSMGeoPoint::Scale));
+    // the center is rounded to fixed point, its remainder is added back in double
+    const double CenterU = (CenterLongitudeE7 / FOSMGeoPoint::Scale - CenterLongitude) * InvHalfWidth;
+    const double CenterV = (CenterLatitudeE7 / FOSMGeoPoint::Scale - CenterLatitude) * InvHalfHeight;
+    const double ScaleU = InvHalfWidth / FOSMGeoPoint::Scale;
+    const double ScaleV = InvHalfHeight / FOSMGeoPoint::Scale;
+
+    alignas(16) float U[4];
+    alignas(16) float V[4];
+    for(int32 First = 0; First < Num; First += 4) {
+        const int32 Count = FMath::Min(4, Num - First);
+        for(int32 Lane = 0; Lane < 4; Lane++) {
+            U[Lane] = 0;
+            V[Lane] = 0;
+            if(Lane < Count) {
+                const FOSMGeoPoint& Point = Coordinates[First + Lane];
+                const double PointU = CenterU + (Point.LongitudeE7 - CenterLongitudeE7) * ScaleU;
+                const double PointV = CenterV + (Point.LatitudeE7 - CenterLatitudeE7) * ScaleV;
+                if(!IsInBox(PointU, PointV)) {
+                    OutActorIndices.Add(First + Lane);
+                } else {
+                    U[Lane] = static_cast<float>(PointU);
+                    V[Lane] = static_cast<float>(PointV);
+                }
+            }
+        }
+        EvaluateBlock(U, V, Count, &OutGamePoints[First]);
+    }
+}
+
+void FOSMBatchProjection::ProjectWithActor(TArrayView<const FVector> GeoPoints, const TArray<int32>& Indices, TArrayView<FVector> OutGamePoints) const
+{
+    if(!GeoReference) {
+        return;
+    }
+    for(const int32 i : Indices) {
+        OutGamePoints[i] = GeoReference->ToGameCoordinate(GeoPoints[i]);
+    }
+}
+
+void FOSMBatchProjection::ProjectWithActor(TArrayView<const FOSMGeoPoint> Coordinates, const TArray<int32>& Indices, TArrayView<FVector> OutGamePoints) const
+{
+    if(!GeoReference) {
+        return;
+    }
+    for(const int32 i : Indices) {
+        OutGamePoints[i] = GeoReference->ToGameCoordinate(Coordinates[i].ToVector());
+    }
+}
+
+void FOSMBatchProjection::Project(TArrayView<const FVector> GeoPoints, TArrayView<FVector> OutGamePoints) const
+{
+    TArray<int32> ActorIndices;
+    Evaluate(GeoPoints, OutGamePoints, ActorIndices);
+    ProjectWithActor(GeoPoints, ActorIndices, OutGamePoints);
+}
+
+void FOSMBatchProjection::Project(TArrayView<const FOSMGeoPoint> Coordinates, TArrayView<FVector> OutGamePoints) const
+{
+    TArray<int32> ActorIndices;
+    Evaluate(Coordinates, OutGamePoints, ActorIndices);
+    ProjectWithActor(Coordinates, ActorIndices, OutGamePoints);
+}
+
+void FOSMBatchProjection::ProjectParallel(TArrayView<const FVector> GeoPoints, TArrayView<FVector> OutGamePoints) const
+{
+    check(GeoPoints.Num() == OutGamePoints.Num());
+    const int32 Num = GeoPoints.Num();
+    const int32 NumTasks = FMath::DivideAndRoundUp(Num, PointsPerTask);
+    // only the polynomial runs on the workers, the actor is not thread safe
+    TArray<TArray<int32>> TaskActorIndices;
+    TaskActorIndices.SetNum(NumTasks);
+    ParallelFor(NumTasks, [&](int32 Task)
+    {
+        const int32 First = Task * PointsPerTask;
+        const int32 Count = FMath::Min(PointsPerTask, Num - First);
+        Evaluate(TArrayView<const FVector>(GeoPoints.GetData() + First, Count), TArrayView<FVector>(OutGamePoints.GetData() + First, Count), TaskActorIndices[Task]);
+    });
+    TArray<int32> ActorIndices;
+    for(int32 Task = 0; Task < NumTasks; Task++) {
+        for(const int32 Index : TaskActorIndices[Task]) {
+            ActorIndices.Add(Task * PointsPerTask + Index);
+        }
+    }
+    ProjectWithActor(GeoPoints, ActorIndices, OutGamePoints);
+}
+
+void FOSMBatchProjection::ProjectPoints(AGeoReferenceActor* GeoReference, const TArray<FVector>& GeoPoints, TArray<FVector>& OutGamePoints)
+{
+    OutGamePoints.Reset();
+    if(!GeoReference) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMBatchProjection: No GeoReference"))
+        return;
+    }
+    OutGamePoints.SetNumUninitialized(GeoPoints.Num());
+    if(GeoPoints.Num() < MinFitPoints) {
+        for(int32 i = 0; i < GeoPoints.Num(); i++) {
+            OutGamePoints[i] = GeoReference->ToGameCoordinate(GeoPoints[i]);
+        }
+        return;
+    }
+    FBox2D Box(ForceInit);
+    for(const FVector& Point : GeoPoints) {
+        Box += FVector2D(Point.X, Point.Y);
+    }
+    FOSMBatchProjection(GeoReference, Box.Min, Box.Max).ProjectParallel(GeoPoints, OutGamePoints);
+}
@@ -0,0 +1,354 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMBuildingBlob.h"
+
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "OSMDataAsset.h"
+
+namespace
+{
+    uint64 AlignBlobOffset(uint64 Offset)
+    {
+        return Align(Offset, 8);
+    }
+
+    FOSMBlobVertex ToBlobVertex(const FOSMGeoPoint& Point)
+    {
+        FOSMBlobVertex Vertex;
+        Vertex.Longitude = Point.GetLongitude();
+        Vertex.Latitude = Point.GetLatitude();
+        return Vertex;
+    }
+
+    /** Fills a footprint from blob vertices in the storage mode of the target asset */
+    void CopyVertices(TArrayView<const FOSMBlobVertex> Vertices, bool bFixedPoint, FOSMFootprint& OutFootprint)
+    {
+        OutFootprint.PolygonIndices.Reset();
+        OutFootprint.PolygonPoints.Reset();
+        OutFootprint.PolygonCoordinates.Reset();
+        if(bFixedPoint) {
+            OutFootprint.PolygonCoordinates.Reserve(Vertices.Num());
+            for(const auto& Vertex : Vertices) {
+                OutFootprint.PolygonCoordinates.Add(FOSMGeoPoint::FromDegrees(Vertex.Longitude, Vertex.Latitude));
+            }
+        } else {
+            OutFootprint.PolygonPoints.Reserve(Vertices.Num());
+            for(const auto& Vertex : Vertices) {
+                OutFootprint.PolygonPoints.Add(FVector(Vertex.Longitude, Vertex.Latitude, 0));
+            }
+        }
+    }
+
+    template<typename T>
+    T* BlobPtr(TArray64<uint8>& Data, uint64 Offset)
+    {
+        return reinterpret_cast<T*>(Data.GetData() + Offset);
+    }
+}
+
+FOSMBuildingBlob::FOSMBuildingBlob()
+    : Header(nullptr)
+    , BuildingRecords(nullptr)
+    , MPBuildingRecords(nullptr)
+    , PartRecords(nullptr)
+    , Vertices(nullptr)
+{
+}
+
+FOSMBuildingBlob::~FOSMBuildingBlob()
+{
+    Close();
+}
+
+bool FOSMBuildingBlob::Write(const UOSMDataAsset* Asset, TArray64<uint8>& OutData)
+{
+    if(!Asset) {
+        return false;
+    }
+
+    // count everything first so the blob is allocated exactly once
+    uint64 VertexCount = 0;
+    uint32 PartCount = 0;
+    for(const auto& Building : Asset->Buildings) {
+        VertexCount += Building.NumVertices();
+    }
+    for(const auto& Building : Asset->MultiPolygonBuildings) {
+        PartCount += Building.Parts.Num();
+        for(const auto& Part : Building.Parts) {
+            VertexCount += Part.NumVertices();
+        }
+    }
+    if(VertexCount > MAX_uint32) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMBuildingBlob: Too many vertices for blob version %d"), OSMBuildingBlob::Version)
+        return false;
+    }
+
+    FOSMBlobHeader BlobHeader;
+    FMemory::Memzero(BlobHeader);
+    BlobHeader.Magic = OSMBuildingBlob::Magic;
+    BlobHeader.Version = OSMBuildingBlob::Version;
+    BlobHeader.BuildingCount = Asset->Buildings.Num();
+    BlobHeader.MPBuildingCount = Asset->MultiPolygonBuildings.Num();
+    BlobHeader.PartCount = PartCount;
+    BlobHeader.VertexCount = VertexCount;
+    BlobHeader.BuildingTableOffset = AlignBlobOffset(sizeof(FOSMBlobHeader));
+    BlobHeader.MPBuildingTableOffset = AlignBlobOffset(BlobHeader.BuildingTableOffset + sizeof(FOSMBlobBuildingRecord) * BlobHeader.BuildingCount);
+    BlobHeader.PartTableOffset = AlignBlobOffset(BlobHeader.MPBuildingTableOffset + sizeof(FOSMBlobMPBuildingRecord) * BlobHeader.MPBuildingCount);
+    BlobHeader.VertexOffset = AlignBlobOffset(BlobHeader.PartTableOffset + sizeof(FOSMBlobPartRecord) * BlobHeader.PartCount);
+    BlobHeader.TotalSize = BlobHeader.VertexOffset + sizeof(FOSMBlobVertex) * BlobHeader.VertexCount;
+
+    OutData.SetNumZeroed(BlobHeader.TotalSize);
+    FMemory::Memcpy(OutData.GetData(), &BlobHeader, sizeof(FOSMBlobHeader));
+
+    FOSMBlobBuildingRecord* OutBuildings = BlobPtr<FOSMBlobBuildingRecord>(OutData, BlobHeader.BuildingTableOffset);
+    FOSMBlobMPBuildingRecord* OutMPBuildings = BlobPtr<FOSMBlobMPBuildingRecord>(OutData, BlobHeader.MPBuildingTableOffset);
+    FOSMBlobPartRecord* OutParts = BlobPtr<FOSMBlobPartRecord>(OutData, BlobHeader.PartTableOffset);
+    FOSMBlobVertex* OutVertices = BlobPtr<FOSMBlobVertex>(OutData, BlobHeader.VertexOffset);
+
+    // footprints may be stored as shared pool indices, the blob always stores resolved vertices
+    TArray<FOSMGeoPoint> Points;
+    uint32 NextVertex = 0;
+    for(int32 i = 0; i < Asset->Buildings.Num(); i++) {
+        const auto& Building = Asset->Buildings[i];
+        FOSMBlobBuildingRecord& Record = OutBuildings[i];
+        Record.ID = Building.ID;
+        Record.FirstVertex = NextVertex;
+        Asset->ResolveCoordinates(Building, Points);
+        Record.VertexCount = Points.Num();
+        Record.Height = Building.Height;
+        Record.Levels = Building.Levels;
+        Record.BuildingType = Building.BuildingType;
+        Record.HeightSource = Building.HeightSource;
+        for(const auto& Point : Points) {
+            OutVertices[NextVertex++] = ToBlobVertex(Point);
+        }
+    }
+
+    uint32 NextPart = 0;
+    for(int32 i = 0; i < Asset->MultiPolygonBuildings.Num(); i++) {
+        const auto& Building = Asset->MultiPolygonBuildings[i];
+        FOSMBlobMPBuildingRecord& Record = OutMPBuildings[i];
+        Record.ID = Building.ID;
+        Record.FirstPart = NextPart;
+        Record.PartCount = Building.Parts.Num();
+        Record.Height = Building.Height;
+        Record.Levels = Building.Levels;
+        Record.BuildingType = Building.BuildingType;
+        Record.bHasHole = Building.bHasHole;
+        Record.HeightSource = Building.HeightSource;
+        for(const auto& Part : Building.Parts) {
+            FOSMBlobPartRecord& PartRecord = OutParts[NextPart++];
+            PartRecord.FirstVertex = NextVertex;
+            Asset->ResolveCoordinates(Part, Points);
+            PartRecord.VertexCount = Points.Num();
+            PartRecord.bIsInner = Part.bIsInner;
+            for(const auto& Point : Points) {
+                OutVertices[NextVertex++] = ToBlobVertex(Point);
+            }
+        }
+    }
+    return true;
+}
+
+bool FOSMBuildingBlob::WriteToFile(const UOSMDataAsset* Asset, const FString& Filename)
+{
+    TArray64<uint8> Data;
+    return Write(Asset, Data) && FFileHelper::SaveArrayToFile(Data, *Filename);
+}
+
+bool FOSMBuildingBlob::Open(const FString& Filename)
+{
+    Close();
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    MappedHandle.Reset(PlatformFile.OpenMapped(*Filename));
+    if(MappedHandle) {
+        MappedRegion.Reset(MappedHandle->MapRegion(0, MappedHandle->GetFileSize()));
+        if(MappedRegion && ValidateAndBind(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize())) {
+            return true;
+        }
+        Close();
+    }
+
+    // platform does not support mapping, read the whole blob in one go instead
+    if(!FFileHelper::LoadFileToArray(FallbackData, *Filename)) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMBuildingBlob: Could not open %s"), *Filename)
+        return false;
+    }
+    if(!ValidateAndBind(FallbackData.GetData(), FallbackData.Num())) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMBuildingBlob: %s is not a valid building blob"), *Filename)
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool FOSMBuildingBlob::OpenFromMemory(TArrayView<const uint8> Data)
+{
+    Close();
+
+    // records are read in place, so misaligned memory has to be copied once
+    if(!IsAligned(Data.GetData(), 8)) {
+        FallbackData.Append(Data.GetData(), Data.Num());
+        if(ValidateAndBind(FallbackData.GetData(), FallbackData.Num())) {
+            return true;
+        }
+        Close();
+        return false;
+    }
+    return ValidateAndBind(Data.GetData(), Data.Num());
+}
+
+void FOSMBuildingBlob::Close()
+{
+    MappedRegion.Reset();
+    MappedHandle.Reset();
+    FallbackData.Empty();
+    Header = nullptr;
+    BuildingRecords = nullptr;
+    MPBuildingRecords = nullptr;
+    PartRecords = nullptr;
+    Vertices = nullptr;
+}
+
+bool FOSMBuildingBlob::ValidateAndBind(const uint8* InData, int64 InSize)
+{
+    if(!InData || InSize < (int64)sizeof(FOSMBlobHeader)) {
+        return false;
+    }
+
+    const FOSMBlobHeader* InHeader = reinterpret_cast<const FOSMBlobHeader*>(InData);
+    if(InHeader->Magic != OSMBuildingBlob::Magic) {
+        return false;
+    }
+    if(InHeader->Version != OSMBuildingBlob::Version) {
+        UE_LOG(LogTemp, Warning, TEXT("FOSMBuildingBlob: Blob version %d is not supported (expected %d)"), InHeader->Version, OSMBuildingBlob::Version)
+        return false;
+    }
+
+    const uint64 Size = InSize;
+    auto SectionFits = [Size](uint64 Offset, uint64 Count, uint64 Stride)
+    {
+        return Offset % 8 == 0 && Offset <= Size && Count <= (Size - Offset) / Stride;
+    };
+    if(InHeader->TotalSize > Size
+        || !SectionFits(InHeader->BuildingTableOffset, InHeader->BuildingCount, sizeof(FOSMBlobBuildingRecord))
+        || !SectionFits(InHeader->MPBuildingTableOffset, InHeader->MPBuildingCount, sizeof(FOSMBlobMPBuildingRecord))
+        || !SectionFits(InHeader->PartTableOffset, InHeader->PartCount, sizeof(FOSMBlobPartRecord))
+        || !SectionFits(InHeader->VertexOffset, InHeader->VertexCount, sizeof(FOSMBlobVertex)))
+    {
+        return false;
+    }
+
+    const FOSMBlobBuildingRecord* InBuildings = reinterpret_cast<const FOSMBlobBuildingRecord*>(InData + InHeader->BuildingTableOffset);
+    const FOSMBlobMPBuildingRecord* InMPBuildings = reinterpret_cast<const FOSMBlobMPBuildingRecord*>(InData + InHeader->MPBuildingTableOffset);
+    const FOSMBlobPartRecord* InParts = reinterpret_cast<const FOSMBlobPartRecord*>(InData + InHeader->PartTableOffset);
+
+    // a single linear pass over the records makes every later view access safe without further checks
+    for(uint32 i = 0; i < InHeader->BuildingCount; i++) {
+        if((uint64)InBuildings[i].FirstVertex + InBuildings[i].VertexCount > InHeader->VertexCount) {
+            return false;
+        }
+    }
+    for(uint32 i = 0; i < InHeader->MPBuildingCount; i++) {
+        if((uint64)InMPBuildings[i].FirstPart + InMPBuildings[i].PartCount > InHeader->PartCount) {
+            return false;
+        }
+    }
+    for(uint32 i = 0; i < InHeader->PartCount; i++) {
+        if((uint64)InParts[i].FirstVertex + InParts[i].VertexCount > InHeader->VertexCount) {
+            return false;
+        }
+    }
+
+    Header = InHeader;
+    BuildingRecords = InBuildings;
+    MPBuildingRecords = InMPBuildings;
+    PartRecords = InParts;
+    Vertices = reinterpret_cast<const FOSMBlobVertex*>(InData + InHeader->VertexOffset);
+    return true;
+}
+
+FOSMBuildingView FOSMBuildingBlob::GetBuilding(int32 Index) const
+{
+    check(Header && Index >= 0 && Index < NumBuildings());
+    const FOSMBlobBuildingRecord& Record = BuildingRecords[Index];
+
+    FOSMBuildingView View;
+    View.Record = &Record;
+    View.Vertices = MakeArrayView(Vertices + Record.FirstVertex, Record.VertexCount);
+    return View;
+}
+
+const FOSMBlobMPBuildingRecord& FOSMBuildingBlob::GetMPBuilding(int32 Index) const
+{
+    check(Header && Index >= 0 && Index < NumMPBuildings());
+    return MPBuildingRecords[Index];
+}
+
+FOSMBuildingPartView FOSMBuildingBlob::GetMPBuildingPart(int32 BuildingIndex, int32 PartIndex) const
+{
+    const FOSMBlobMPBuildingRecord& Building = GetMPBuilding(BuildingIndex);
+    check(PartIndex >= 0 && (uint32)PartIndex < Building.PartCount);
+    const FOSMBlobPartRecord& Record = PartRecords[Building.FirstPart + PartIndex];
+
+    FOSMBuildingPartView View;
+    View.Record = &Record;
+    View.Vertices = MakeArrayView(Vertices + Record.FirstVertex, Record.VertexCount);
+    return View;
+}
+
+void FOSMBuildingBlob::CopyToAsset(UOSMDataAsset* Asset) const
+{
+    if(!Asset || !Header) {
+        return;
+    }
+
+    // the blob stores resolved vertices, so a shared pool is never needed
+    const bool bFixedPoint = Asset->ImportSettings.bUseFixedPointCoordinates;
+    Asset->ImportSettings.bUseSharedVertexPool = false;
+    Asset->NodePositions.Empty();
+    Asset->NodeCoordinates.Empty();
+    // the blob has no attribute tables, rows of the previous buildings must not survive
+    Asset->BuildingAttributes.Empty();
+    Asset->MultiPolygonBuildingAttributes.Empty();
+
+    Asset->Buildings.SetNum(NumBuildings());
+    for(int32 i = 0; i < NumBuildings(); i++) {
+        const FOSMBuildingView View = GetBuilding(i);
+        FBuildingData& Building = Asset->Buildings[i];
+        Building.ID = View.GetID();
+        Building.BuildingType = View.GetBuildingType();
+        Building.Height = View.GetHeight();
+        Building.Levels = View.GetLevels();
+        Building.HeightSource = View.GetHeightSource();
+        CopyVertices(View.Vertices, bFixedPoint, Building);
+    }
+
+    Asset->MultiPolygonBuildings.SetNum(NumMPBuildings());
+    for(int32 i = 0; i < NumMPBuildings(); i++) {
+        const FOSMBlobMPBuildingRecord& Record = GetMPBuilding(i);
+        FMPBuildingData& Building = Asset->MultiPolygonBuildings[i];
+        Building.ID = Record.ID;
+        Building.BuildingType = static_cast<EOSMBuildingType>(Record.BuildingType);
+        Building.Height = Record.Height;
+        Building.Levels = Record.Levels;
+        Building.HeightSource = static_cast<EOSMHeightSource>(Record.HeightSource);
+        Building.bHasHole = Record.bHasHole;
+        Building.Parts.SetNum(Record.PartCount);
+        for(uint32 p = 0; p < Record.PartCount; p++) {
+            const FOSMBuildingPartView PartView = GetMPBuildingPart(i, p);
+            FMPBuildingPart& Part = Building.Parts[p];
+            Part.bIsInner = PartView.IsInner();
+            CopyVertices(PartView.Vertices, bFixedPoint, Part);
+        }
+    }
+    Asset->UpdateBuildingLookups();
+    // the graph of the previous buildings does not apply, the blob has no node IDs to compute it from
+    if(Asset->ImportSettings.bComputeAdjacency) {
+        Asset->UpdateBuildingAdjacency();
+    } else {
+        Asset->BuildingAdjacency.Empty();
+    }
+}
@@ -0,0 +1,424 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMBuildingSpawnSubsystem.h"
+
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Containers/Queue.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "UObject/UObjectGlobals.h"
+#include "OSMBatchProjection.h"
+
+/** Buildings are prepared in batches, the worker checks for cancellation between them */
+static constexpr int32 SpawnBatchSize = 64;
+
+/** A building from the worker, with the vertices the polynomial did not cover still to be projected by the actor */
+struct FOSMPendingBuilding
+{
+    FOSMPreparedBuilding Building;
+    /** Coordinates and indices to project per ring, empty if the polynomial covered every vertex */
+    TArray<TArray<FOSMGeoPoint>> RingCoordinates;
+    TArray<TArray<int32>> RingActorIndices;
+
+    bool NeedsActor() const
+    {
+        return RingActorIndices.Num() > 0;
+    }
+};
+
+struct FOSMSpawnWork
+{
+    TArray<int32> BuildingIndices;
+    TArray<int32> MPBuildingIndices;
+    /** Native spawn callback, the request delegate is used if it is not set */
+    TFunction<void(const FOSMPreparedBuilding&)> OnSpawn;
+    /** Fitted on the game thread before the worker starts, the worker only evaluates it */
+    TUniquePtr<const FOSMBatchProjection> Projection;
+
+    /** Filled by the worker, drained on the game thread */
+    TQueue<TArray<FOSMPendingBuilding>, EQueueMode::Spsc> Batches;
+    FThreadSafeBool bCanceled;
+    TFuture<void> Task;
+
+    // game thread only
+    TArray<FOSMPreparedBuilding> Prepared;
+    /** Buildings waiting for the actor to project some of their vertices */
+    TArray<FOSMPendingBuilding> Unprojected;
+    int32 NumSpawned = 0;
+
+    int32 Num() const
+    {
+        return BuildingIndices.Num() + MPBuildingIndices.Num();
+    }
+};
+
+namespace
+{
+    /** Projects a ring with the polynomial, the vertices it does not cover are kept for the game thread */
+    void AddPreparedRing(const UOSMDataAsset* Asset, const FOSMBatchProjection& Projection, const FOSMFootprint& Footprint, bool bIsInner, FOSMPendingBuilding& OutPending, TArray<FOSMGeoPoint>& Scratch, TArray<int32>& ActorIndices)
+    {
+        Asset->ResolveCoordinates(Footprint, Scratch);
+        FOSMPreparedRing& Ring = OutPending.Building.Rings.AddDefaulted_GetRef();
+        Ring.bIsInner = bIsInner;
+        Ring.Vertices.SetNumUninitialized(Scratch.Num());
+        ActorIndices.Reset();
+        Projection.Evaluate(Scratch, Ring.Vertices, ActorIndices);
+        if(ActorIndices.Num() > 0) {
+            const int32 RingIndex = OutPending.Building.Rings.Num() - 1;
+            OutPending.RingCoordinates.SetNum(RingIndex + 1);
+            OutPending.RingActorIndices.SetNum(RingIndex + 1);
+            OutPending.RingCoordinates[RingIndex] = Scratch;
+            OutPending.RingActorIndices[RingIndex] = ActorIndices;
+        }
+    }
+
+    void ComputeCenter(FOSMPreparedBuilding& Building)
+    {
+        FVector Sum = FVector::ZeroVector;
+        int32 Count = 0;
+        for(const FOSMPreparedRing& Ring : Building.Rings) {
+            if(!Ring.bIsInner) {
+                for(const FVector& Vertex : Ring.Vertices) {
+                    Sum += Vertex;
+                }
+                Count += Ring.Vertices.Num();
+            }
+        }
+        Building.Center = Count > 0 ? Sum / Count : FVector::ZeroVector;
+    }
+
+    /**
+     * Runs on a worker thread, Asset is kept alive by the owning request. The geo reference is never called
+     * here, it is not thread safe.
+     */
+    void PrepareBuildings(FOSMSpawnWork& Work, const UOSMDataAsset* Asset)
+    {
+        const FOSMBatchProjection& Projection = *Work.Projection;
+        const int32 Num = Work.Num();
+        for(int32 First = 0; First < Num && !Work.bCanceled; First += SpawnBatchSize) {
+            TArray<FOSMPendingBuilding> Batch;
+            Batch.SetNum(FMath::Min(SpawnBatchSize, Num - First));
+            ParallelFor(Batch.Num(), [&](int32 i)
+            {
+                TArray<FOSMGeoPoint> Scratch;
+                TArray<int32> ActorIndices;
+                FOSMPendingBuilding& Pending = Batch[i];
+                FOSMPreparedBuilding& Prepared = Pending.Building;
+                const int32 Item = First + i;
+                if(Item < Work.BuildingIndices.Num()) {
+                    const FBuildingData& Building = Asset->Buildings[Work.BuildingIndices[Item]];
+                    Prepared.BuildingIndex = Work.BuildingIndices[Item];
+                    Prepared.ID = Building.ID;
+                    Prepared.BuildingType = Building.BuildingType;
+                    Prepared.Height = Building.Height;
+                    AddPreparedRing(Asset, Projection, Building, false, Pending, Scratch, ActorIndices);
+                } else {
+                    const int32 Index = Work.MPBuildingIndices[Item - Work.BuildingIndices.Num()];
+                    const FMPBuildingData& Building = Asset->MultiPolygonBuildings[Index];
+                    Prepared.BuildingIndex = Index;
+                    Prepared.bIsMultiPolygon = true;
+                    Prepared.ID = Building.ID;
+                    Prepared.BuildingType = Building.BuildingType;
+                    Prepared.Height = Building.Height;
+                    for(const FMPBuildingPart& Part : Building.Parts) {
+                        AddPreparedRing(Asset, Projection, Part, Part.bIsInner, Pending, Scratch, ActorIndices);
+                    }
+                }
+                // buildings waiting for the actor get their center once they are complete
+                if(!Pending.NeedsActor()) {
+                    ComputeCenter(Prepared);
+                }
+            });
+            Work.Batches.Enqueue(MoveTemp(Batch));
+        }
+    }
+
+    void AllIndices(int32 Num, TArray<int32>& OutIndices)
+    {
+        OutIndices.SetNumUninitialized(Num);
+        for(int32 i = 0; i < Num; i++) {
+            OutIndices[i] = i;
+        }
+    }
+}
+
+void UOSMBuildingSpawnSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+    PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &UOSMBuildingSpawnSubsystem::HandlePreGarbageCollect);
+}
+
+void UOSMBuildingSpawnSubsystem::Deinitialize()
+{
+    FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+    CancelAll();
+    Super::Deinitialize();
+}
+
+FOSMSpawnHandle UOSMBuildingSpawnSubsystem::SpawnBuildings(UOSMDataAsset* Asset, AGeoReferenceActor* GeoReference, FOSMSpawnBuildingDelegate OnSpawn, FOSMSpawnFinishedDelegate OnFinished)
+{
+    TArray<int32> BuildingIndices;
+    TArray<int32> MPBuildingIndices;
+    if(Asset) {
+        AllIndices(Asset->Buildings.Num(), BuildingIndices);
+        AllIndices(Asset->MultiPolygonBuildings.Num(), MPBuildingIndices);
+    }
+    FOSMSpawnRequest Request;
+    Request.Asset = Asset;
+    Request.GeoReference = GeoReference;
+    Request.OnSpawn = OnSpawn;
+    Request.OnFinished = OnFinished;
+    return StartRequest(MoveTemp(Request), MoveTemp(BuildingIndices), MoveTemp(MPBuildingIndices));
+}
+
+FOSMSpawnHandle UOSMBuildingSpawnSubsystem::SpawnBuildingSubset(UOSMDataAsset* Asset, AGeoReferenceActor* GeoReference, const TArray<int32>& BuildingIndices, const TArray<int32>& MPBuildingIndices, FOSMSpawnBuildingDelegate OnSpawn, FOSMSpawnFinishedDelegate OnFinished)
+{
+    FOSMSpawnRequest Request;
+    Request.Asset = Asset;
+    Request.GeoReference = GeoReference;
+    Request.OnSpawn = OnSpawn;
+    Request.OnFinished = OnFinished;
+    return StartRequest(MoveTemp(Request), TArray<int32>(BuildingIndices), TArray<int32>(MPBuildingIndices));
+}
+
+FOSMSpawnHandle UOSMBuildingSpawnSubsystem::RequestSpawn(UOSMDataAsset* Asset, AGeoReferenceActor* GeoReference, TArray<int32> BuildingIndices, TArray<int32> MPBuildingIndices, bool bAllBuildings, TFunction<void(const FOSMPreparedBuilding&)> OnSpawn)
+{
+    if(bAllBuildings && Asset) {
+        AllIndices(Asset->Buildings.Num(), BuildingIndices);
+        AllIndices(Asset->MultiPolygonBuildings.Num(), MPBuildingIndices);
+    }
+    FOSMSpawnRequest Request;
+    Request.Asset = Asset;
+    Request.GeoReference = GeoReference;
+    FOSMSpawnHandle Handle = StartRequest(MoveTemp(Request), MoveTemp(BuildingIndices), MoveTemp(MPBuildingIndices));
+    if(Handle.IsValid()) {
+        Requests[Handle.ID].Work->OnSpawn = MoveTemp(OnSpawn);
+    }
+    return Handle;
+}
+
+FOSMSpawnHandle UOSMBuildingSpawnSubsystem::StartRequest(FOSMSpawnRequest&& Request, TArray<int32>&& BuildingIndices, TArray<int32>&& MPBuildingIndices)
+{
+    check(IsInGameThread());
+    if(!IsValid(Request.Asset) || !IsValid(Request.GeoReference)) {
+        UE_LOG(LogTemp, Error, TEXT("UOSMBuildingSpawnSubsystem: Spawning needs a data asset and a geo reference"))
+        return FOSMSpawnHandle();
+    }
+    // the worker must never see an index outside the arrays
+    BuildingIndices.RemoveAll([&Request](int32 Index) { return !Request.Asset->Buildings.IsValidIndex(Index); });
+    MPBuildingIndices.RemoveAll([&Request](int32 Index) { return !Request.Asset->MultiPolygonBuildings.IsValidIndex(Index); });
+
+    TSharedPtr<FOSMSpawnWork, ESPMode::ThreadSafe> Work = MakeShared<FOSMSpawnWork, ESPMode::ThreadSafe>();
+    Work->BuildingIndices = MoveTemp(BuildingIndices);
+    Work->MPBuildingIndices = MoveTemp(MPBuildingIndices);
+    Work->Prepared.Reserve(Work->Num());
+
+    // fitted here, the actor must only be called on the game thread
+    const UOSMDataAsset* Asset = Request.Asset;
+    Work->Projection = MakeUnique<FOSMBatchProjection>(FOSMBatchProjection::ForAsset(Request.GeoReference, Asset));
+    Work->Task = Async(EAsyncExecution::ThreadPool, [Work, Asset]()
+    {
+        PrepareBuildings(*Work, Asset);
+    });
+
+    FOSMSpawnHandle Handle;
+    Handle.ID = NextRequestID++;
+    Request.Work = MoveTemp(Work);
+    Requests.Add(Handle.ID, MoveTemp(Request));
+    return Handle;
+}
+
+void UOSMBuildingSpawnSubsystem::StopRequest(int32 RequestID)
+{
+    FOSMSpawnRequest* Request = Requests.Find(RequestID);
+    if(!Request) {
+        return;
+    }
+    // the worker reads the asset and the geo reference, they have to outlive its current batch
+    Request->Work->bCanceled = true;
+    Request->Work->Task.Wait();
+    Requests.Remove(RequestID);
+
+    const int32 NumRemoved = ReadyHeap.RemoveAll([RequestID](const FReadyBuilding& Ready) { return Ready.RequestID == RequestID; });
+    if(NumRemoved > 0) {
+        ReadyHeap.Heapify([](const FReadyBuilding& A, const FReadyBuilding& B) { return A.DistanceSquared < B.DistanceSquared; });
+    }
+}
+
+void UOSMBuildingSpawnSubsystem::CancelSpawn(FOSMSpawnHandle Handle)
+{
+    StopRequest(Handle.ID);
+}
+
+void UOSMBuildingSpawnSubsystem::CancelAll()
+{
+    TArray<int32> RequestIDs;
+    Requests.GetKeys(RequestIDs);
+    for(const int32 RequestID : RequestIDs) {
+        StopRequest(RequestID);
+    }
+}
+
+bool UOSMBuildingSpawnSubsystem::IsSpawning(FOSMSpawnHandle Handle) const
+{
+    return Requests.Contains(Handle.ID);
+}
+
+int32 UOSMBuildingSpawnSubsystem::GetNumPending() const
+{
+    int32 NumPending = ReadyHeap.Num();
+    for(const TPair<int32, FOSMSpawnRequest>& Pair : Requests) {
+        NumPending += Pair.Value.Work->Unprojected.Num();
+    }
+    return NumPending;
+}
+
+void UOSMBuildingSpawnSubsystem::SetViewerLocation(const FVector& Location)
+{
+    ViewerOverride = Location;
+    bHasViewerOverride = true;
+}
+
+void UOSMBuildingSpawnSubsystem::ClearViewerLocation()
+{
+    bHasViewerOverride = false;
+}
+
+void UOSMBuildingSpawnSubsystem::HandlePreGarbageCollect()
+{
+    TArray<int32> Stale;
+    for(const TPair<int32, FOSMSpawnRequest>& Pair : Requests) {
+        if(!IsValid(Pair.Value.Asset) || !IsValid(Pair.Value.GeoReference)) {
+            Stale.Add(Pair.Key);
+        }
+    }
+    for(const int32 RequestID : Stale) {
+        UE_LOG(LogTemp, Log, TEXT("UOSMBuildingSpawnSubsystem: Canceling spawn request %d, its asset or geo reference was destroyed"), RequestID)
+        StopRequest(RequestID);
+    }
+}
+
+bool UOSMBuildingSpawnSubsystem::GetViewerLocation(FVector& OutLocation) const
+{
+    if(bHasViewerOverride) {
+        OutLocation = ViewerOverride;
+        return true;
+    }
+    const UWorld* World = GetWorld();
+    const APlayerController* Controller = World ? World->GetFirstPlayerController() : nullptr;
+    if(Controller && Controller->PlayerCameraManager) {
+        OutLocation = Controller->PlayerCameraManager->GetCameraLocation();
+        return true;
+    }
+    return false;
+}
+
+void UOSMBuildingSpawnSubsystem::Reprioritize(const FVector& ViewerLocation)
+{
+    PriorityLocation = ViewerLocation;
+    for(FReadyBuilding& Ready : ReadyHeap) {
+        const FOSMSpawnRequest& Request = Requests.FindChecked(Ready.RequestID);
+        Ready.DistanceSquared = FVector::DistSquared(Request.Work->Prepared[Ready.Index].Center, PriorityLocation);
+    }
+    ReadyHeap.Heapify([](const FReadyBuilding& A, const FReadyBuilding& B) { return A.DistanceSquared < B.DistanceSquared; });
+}
+
+void UOSMBuildingSpawnSubsystem::AddReady(int32 RequestID, FOSMSpawnWork& Work, FOSMPreparedBuilding&& Prepared)
+{
+    const double DistanceSquared = FVector::DistSquared(Prepared.Center, PriorityLocation);
+    ReadyHeap.HeapPush(FReadyBuilding{RequestID, Work.Prepared.Add(MoveTemp(Prepared)), DistanceSquared},
+        [](const FReadyBuilding& A, const FReadyBuilding& B) { return A.DistanceSquared < B.DistanceSquared; });
+}
+
+void UOSMBuildingSpawnSubsystem::CollectPrepared()
+{
+    for(TPair<int32, FOSMSpawnRequest>& Pair : Requests) {
+        FOSMSpawnWork& Work = *Pair.Value.Work;
+        TArray<FOSMPendingBuilding> Batch;
+        while(Work.Batches.Dequeue(Batch)) {
+            for(FOSMPendingBuilding& Pending : Batch) {
+                if(Pending.NeedsActor()) {
+                    Work.Unprojected.Add(MoveTemp(Pending));
+                } else {
+                    AddReady(Pair.Key, Work, MoveTemp(Pending.Building));
+                }
+            }
+        }
+    }
+}
+
+void UOSMBuildingSpawnSubsystem::ProjectUnprojected(double EndTime)
+{
+    for(TPair<int32, FOSMSpawnRequest>& Pair : Requests) {
+        FOSMSpawnWork& Work = *Pair.Value.Work;
+        while(Work.Unprojected.Num() > 0 && FPlatformTime::Seconds() < EndTime) {
+            FOSMPendingBuilding Pending = Work.Unprojected.Pop();
+            for(int32 Ring = 0; Ring < Pending.RingActorIndices.Num(); Ring++) {
+                Work.Projection->ProjectWithActor(Pending.RingCoordinates[Ring], Pending.RingActorIndices[Ring], Pending.Building.Rings[Ring].Vertices);
+            }
+            ComputeCenter(Pending.Building);
+            AddReady(Pair.Key, Work, MoveTemp(Pending.Building));
+        }
+    }
+}
+
+void UOSMBuildingSpawnSubsystem::Tick(float DeltaTime)
+{
+    FVector ViewerLocation;
+    if(GetViewerLocation(ViewerLocation) && FVector::DistSquared(ViewerLocation, PriorityLocation) > FMath::Square(ReprioritizeDistance)) {
+        Reprioritize(ViewerLocation);
+    }
+    CollectPrepared();
+
+    const double EndTime = FPlatformTime::Seconds() + FrameBudgetMs / 1000.0;
+    // shares the budget with the spawn callbacks, the loop below still spawns at least one building
+    ProjectUnprojected(EndTime);
+    TArray<int32> Finished;
+    do {
+        if(ReadyHeap.Num() == 0) {
+            break;
+        }
+        FReadyBuilding Ready;
+        ReadyHeap.HeapPop(Ready, [](const FReadyBuilding& A, const FReadyBuilding& B) { return A.DistanceSquared < B.DistanceSquared; });
+        const FOSMSpawnRequest& Request = Requests.FindChecked(Ready.RequestID);
+        // the callback may start or cancel requests, so Request must not be used after it
+        const TSharedPtr<FOSMSpawnWork, ESPMode::ThreadSafe> Work = Request.Work;
+        const FOSMSpawnBuildingDelegate OnSpawn = Request.OnSpawn;
+        const FOSMPreparedBuilding Prepared = MoveTemp(Work->Prepared[Ready.Index]);
+        Work->NumSpawned++;
+        if(Work->OnSpawn) {
+            Work->OnSpawn(Prepared);
+        } else {
+            OnSpawn.ExecuteIfBound(Prepared);
+        }
+    } while(FPlatformTime::Seconds() < EndTime);
+
+    for(const TPair<int32, FOSMSpawnRequest>& Pair : Requests) {
+        if(Pair.Value.Work->NumSpawned == Pair.Value.Work->Num()) {
+            Finished.Add(Pair.Key);
+        }
+    }
+    for(const int32 RequestID : Finished) {
+        const FOSMSpawnFinishedDelegate OnFinished = Requests[RequestID].OnFinished;
+        StopRequest(RequestID);
+        FOSMSpawnHandle Handle;
+        Handle.ID = RequestID;
+        OnFinished.ExecuteIfBound(Handle);
+    }
+}
+
+bool UOSMBuildingSpawnSubsystem::IsTickable() const
+{
+    return Requests.Num() > 0;
+}
+
+TStatId UOSMBuildingSpawnSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UOSMBuildingSpawnSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UOSMBuildingSpawnSubsystem::GetTickableGameObjectWorld() const
+{
+    return GetWorld();
+}
@@ -0,0 +1,886 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMDataAsset.h"
+
+#include "Algo/Sort.h"
+#include "Algo/Unique.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/CustomVersion.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "OSMPayloadChunks.h"
+#if WITH_EDITORONLY_DATA
+#include "EditorFramework/AssetImportData.h"
+#endif
+
+namespace
+{
+    constexpr int32 NumBuildingTypes = EOSMBuildingType::OtherBuilding + 1;
+
+    struct FOSMDataAssetVersion
+    {
+        enum Type
+        {
+            BeforeCustomVersionWasAdded = 0,
+            // building arrays and node pools are stored as compressed chunks after the tagged properties
+            ChunkedPayload,
+            // OSM IDs are int64, tagged buildings of older packages have them as strings
+            NumericBuildingIDs,
+
+            VersionPlusOne,
+            LatestVersion = VersionPlusOne - 1
+        };
+        static const FGuid GUID;
+    };
+    const FGuid FOSMDataAssetVersion::GUID(0x6A0E3C1B, 0x4F2D4B87, 0x9C51E0A3, 0x2B7D84F6);
+    FCustomVersionRegistration GRegisterOSMDataAssetVersion(FOSMDataAssetVersion::GUID, FOSMDataAssetVersion::LatestVersion, TEXT("OSMDataAssetVersion"));
+
+    /**
+     * True if the buildings read from Ar have string IDs. Only packages saved before the custom version have
+     * tagged buildings with them, chunked packages keep the tagged arrays empty.
+     */
+    bool HasStringBuildingIDs(const FArchive& Ar)
+    {
+        return Ar.IsLoading() && Ar.IsPersistent() && !Ar.IsTransacting()
+            && Ar.CustomVer(FOSMDataAssetVersion::GUID) < FOSMDataAssetVersion::NumericBuildingIDs;
+    }
+
+    /** Reads the tagged properties of a legacy building struct from Ar */
+    template<typename TLegacy>
+    void SerializeLegacy(FArchive& Ar, TLegacy& Legacy)
+    {
+        UScriptStruct* LegacyStruct = TLegacy::StaticStruct();
+        LegacyStruct->SerializeTaggedProperties(Ar, reinterpret_cast<uint8*>(&Legacy), LegacyStruct, nullptr);
+    }
+
+    /** Prefix sums of the building counts per type, empty if Buildings is not sorted by type */
+    template<typename TBuilding>
+    void ComputeTypeOffsets(const TArray<TBuilding>& Buildings, TArray<int32>& OutOffsets)
+    {
+        OutOffsets.Reset();
+        for(int32 i = 1; i < Buildings.Num(); i++) {
+            if(Buildings[i].BuildingType < Buildings[i - 1].BuildingType) {
+                return;
+            }
+        }
+        OutOffsets.SetNumZeroed(NumBuildingTypes + 1);
+        for(const TBuilding& Building : Buildings) {
+            OutOffsets[Building.BuildingType + 1]++;
+        }
+        for(int32 Type = 0; Type < NumBuildingTypes; Type++) {
+            OutOffsets[Type + 1] += OutOffsets[Type];
+        }
+    }
+
+    template<typename TBuilding>
+    void ComputeIDIndex(const TArray<TBuilding>& Buildings, TMap<int64, int32>& OutIndex)
+    {
+        OutIndex.Reset();
+        OutIndex.Reserve(Buildings.Num());
+        for(int32 i = 0; i < Buildings.Num(); i++) {
+            OutIndex.Add(Buildings[i].ID, i);
+        }
+    }
+
+    bool GetTypeRange(const TArray<int32>& Offsets, int32 Type, int32& OutFirst, int32& OutNum)
+    {
+        OutFirst = 0;
+        OutNum = 0;
+        if(Offsets.Num() != NumBuildingTypes + 1 || Type < 0 || Type >= NumBuildingTypes) {
+            return false;
+        }
+        OutFirst = Offsets[Type];
+        OutNum = Offsets[Type + 1] - Offsets[Type];
+        return true;
+    }
+
+    /** Packs a vertex into one key, equal for all rings that reference the same OSM node */
+    FORCEINLINE uint64 GetVertexKey(const FOSMGeoPoint& Point)
+    {
+        return (static_cast<uint64>(static_cast<uint32>(Point.LongitudeE7)) << 32) | static_cast<uint32>(Point.LatitudeE7);
+    }
+
+    /** Ring segment independent of its direction */
+    struct FSegmentKey
+    {
+        uint64 A;
+        uint64 B;
+
+        FSegmentKey(uint64 V0, uint64 V1)
+            : A(FMath::Min(V0, V1))
+            , B(FMath::Max(V0, V1))
+        {
+        }
+        bool operator==(const FSegmentKey& Other) const { return A == Other.A && B == Other.B; }
+        bool operator<(const FSegmentKey& Other) const { return A != Other.A ? A < Other.A : B < Other.B; }
+        friend uint32 GetTypeHash(const FSegmentKey& Key) { return HashCombine(GetTypeHash(Key.A), GetTypeHash(Key.B)); }
+    };
+
+    /** Key of a vertex or segment and the adjacency node whose ring contains it */
+    template<typename TKey>
+    struct FKeyedNode
+    {
+        TKey Key;
+        int32 Node;
+
+        bool operator<(const FKeyedNode& Other) const { return Key == Other.Key ? Node < Other.Node : Key < Other.Key; }
+    };
+
+    /** Edge between two nodes packed into one key, so equal edges sort next to each other */
+    struct FEdgeEntry
+    {
+        uint64 Nodes;
+        int32 SharedWalls;
+    };
+
+    /** Adds an entry for every pair of nodes within each run of equal keys in Sorted */
+    template<typename TKey>
+    void AddTouchingPairs(const TArray<FKeyedNode<TKey>>& Sorted, int32 SharedWalls, TArray<FEdgeEntry>& OutEntries)
+    {
+        int32 Begin = 0;
+        while(Begin < Sorted.Num()) {
+            int32 End = Begin + 1;
+            while(End < Sorted.Num() && Sorted[End].Key == Sorted[Begin].Key) {
+                End++;
+            }
+            // nodes are ascending within a run and unique, because the keys of each node are
+            for(int32 i = Begin; i < End; i++) {
+                for(int32 j = i + 1; j < End; j++) {
+                    const uint64 Nodes = (static_cast<uint64>(Sorted[i].Node) << 32) | static_cast<uint32>(Sorted[j].Node);
+                    OutEntries.Add({Nodes, SharedWalls});
+                }
+            }
+            Begin = End;
+        }
+    }
+
+    /** Adds the vertex and segment keys of one ring, the ring may be closed or not */
+    template<typename TRingKey>
+    void AddRingKeys(TArrayView<const TRingKey> Ring, TArray<uint64>& OutVertices, TArray<FSegmentKey>& OutSegments)
+    {
+        const int32 Num = Ring.Num();
+        for(int32 i = 0; i < Num; i++) {
+            const uint64 V0 = static_cast<uint64>(Ring[i]);
+            const uint64 V1 = static_cast<uint64>(Ring[(i + 1) % Num]);
+            OutVertices.Add(V0);
+            if(V0 != V1) {
+                OutSegments.Add(FSegmentKey(V0, V1));
+            }
+        }
+    }
+
+    void MakeKeysUnique(TArray<uint64>& Vertices, TArray<FSegmentKey>& Segments)
+    {
+        Algo::Sort(Vertices);
+        Vertices.SetNum(Algo::Unique(Vertices));
+        Algo::Sort(Segments);
+        Segments.SetNum(Algo::Unique(Segments));
+    }
+
+    /**
+     * Vertex keys of one ring: the indices into the shared vertex pool if the asset has one, so shared OSM nodes
+     * are found exactly, the fixed point coordinates otherwise
+     */
+    void GetRingKeys(const UOSMDataAsset& Asset, const FOSMFootprint& Footprint, TArray<FOSMGeoPoint>& Ring, TArray<uint64>& OutKeys)
+    {
+        OutKeys.Reset(Footprint.NumVertices());
+        if(Footprint.PolygonIndices.Num() > 0) {
+            for(const int32 Index : Footprint.PolygonIndices) {
+                OutKeys.Add(static_cast<uint64>(Index));
+            }
+            return;
+        }
+        Asset.ResolveCoordinates(Footprint, Ring);
+        for(const FOSMGeoPoint& Point : Ring) {
+            OutKeys.Add(GetVertexKey(Point));
+        }
+    }
+
+    /** Unique vertex and segment keys of all rings of adjacency node Node, see GetRingKeys */
+    void CollectKeys(const UOSMDataAsset& Asset, int32 Node, TArray<FOSMGeoPoint>& Ring, TArray<uint64>& RingKeys, TArray<uint64>& OutVertices, TArray<FSegmentKey>& OutSegments)
+    {
+        OutVertices.Reset();
+        OutSegments.Reset();
+        if(Node < Asset.Buildings.Num()) {
+            GetRingKeys(Asset, Asset.Buildings[Node], Ring, RingKeys);
+            AddRingKeys<uint64>(RingKeys, OutVertices, OutSegments);
+        } else {
+            for(const FMPBuildingPart& Part : Asset.MultiPolygonBuildings[Node - Asset.Buildings.Num()].Parts) {
+                GetRingKeys(Asset, Part, Ring, RingKeys);
+                AddRingKeys<uint64>(RingKeys, OutVertices, OutSegments);
+            }
+        }
+        MakeKeysUnique(OutVertices, OutSegments);
+    }
+
+    /** Connects the nodes that share a vertex key, and counts the segment keys they share as walls */
+    void BuildAdjacency(int32 NumBuildings, TArray<TArray<uint64>>& NodeVertices, TArray<TArray<FSegmentKey>>& NodeSegments, FOSMBuildingAdjacency& OutAdjacency)
+    {
+        const int32 NumNodes = NodeVertices.Num();
+        // buildings touch where a vertex or a segment key occurs in more than one of them
+        TArray<FKeyedNode<uint64>> Vertices;
+        TArray<FKeyedNode<FSegmentKey>> Segments;
+        for(int32 Node = 0; Node < NumNodes; Node++) {
+            for(const uint64 Key : NodeVertices[Node]) {
+                Vertices.Add({Key, Node});
+            }
+            for(const FSegmentKey& Key : NodeSegments[Node]) {
+                Segments.Add({Key, Node});
+            }
+        }
+        NodeVertices.Empty();
+        NodeSegments.Empty();
+        Algo::Sort(Vertices);
+        Algo::Sort(Segments);
+
+        TArray<FEdgeEntry> Entries;
+        AddTouchingPairs(Vertices, 0, Entries);
+        AddTouchingPairs(Segments, 1, Entries);
+        Vertices.Empty();
+        Segments.Empty();
+        Algo::Sort(Entries, [](const FEdgeEntry& A, const FEdgeEntry& B)
+        {
+            return A.Nodes < B.Nodes;
+        });
+
+        // sorting by the packed nodes sorts by A and B, as SetEdges expects
+        TArray<FOSMBuildingAdjacency::FEdge> Edges;
+        for(int32 i = 0; i < Entries.Num(); i++) {
+            if(i > 0 && Entries[i].Nodes == Entries[i - 1].Nodes) {
+                Edges.Last().SharedWalls += Entries[i].SharedWalls;
+            } else {
+                Edges.Add({static_cast<int32>(Entries[i].Nodes >> 32), static_cast<int32>(Entries[i].Nodes & 0xFFFFFFFF), Entries[i].SharedWalls});
+            }
+        }
+        OutAdjacency.SetEdges(NumBuildings, NumNodes, Edges);
+    }
+}
+
+bool FBuildingData::Serialize(FArchive& Ar)
+{
+    // the int64 ID can't take the old string tag, the old layout is read instead
+    if(!HasStringBuildingIDs(Ar)) {
+        return false;
+    }
+    FOSMLegacyBuildingData Legacy;
+    SerializeLegacy(Ar, Legacy);
+    ID = FCString::Atoi64(*Legacy.ID);
+    ElementType = EOSMElementType::WayElement;
+    PolygonPoints = MoveTemp(Legacy.PolygonPoints);
+    BuildingType = Legacy.BuildingType;
+    Height = Legacy.Height;
+    Levels = Legacy.Levels;
+    return true;
+}
+
+bool FMPBuildingData::Serialize(FArchive& Ar)
+{
+    if(!HasStringBuildingIDs(Ar)) {
+        return false;
+    }
+    FOSMLegacyMPBuildingData Legacy;
+    SerializeLegacy(Ar, Legacy);
+    ID = FCString::Atoi64(*Legacy.ID);
+    ElementType = EOSMElementType::RelationElement;
+    Parts = MoveTemp(Legacy.Parts);
+    bHasHole = Legacy.bHasHole;
+    BuildingType = Legacy.BuildingType;
+    Height = Legacy.Height;
+    Levels = Legacy.Levels;
+    return true;
+}
+
+void FOSMFootprint::KeepVertices(const TArray<int32>& Keep)
+{
+    auto KeepElements = [&Keep](auto& Array)
+    {
+        typename TRemoveReference<decltype(Array)>::Type Kept;
+        Kept.Reserve(Keep.Num());
+        for(const int32 Index : Keep) {
+            Kept.Add(Array[Index]);
+        }
+        Array = MoveTemp(Kept);
+    };
+    if(PolygonIndices.Num() > 0) {
+        KeepElements(PolygonIndices);
+    } else if(PolygonCoordinates.Num() > 0) {
+        KeepElements(PolygonCoordinates);
+    } else {
+        KeepElements(PolygonPoints);
+    }
+}
+
+void FOSMBuildingAttributeTable::Reserve(int32 Rows)
+{
+    MinHeight.Reserve(Rows);
+    MinLevel.Reserve(Rows);
+    RoofHeight.Reserve(Rows);
+    RoofShape.Reserve(Rows);
+    BuildingPart.Reserve(Rows);
+    BuildingColour.Reserve(Rows);
+    BuildingMaterial.Reserve(Rows);
+    RoofColour.Reserve(Rows);
+    RoofMaterial.Reserve(Rows);
+}
+
+void FOSMBuildingAttributeTable::Empty()
+{
+    Strings.Empty();
+    StringLookup.Empty();
+    MinHeight.Empty();
+    MinLevel.Empty();
+    RoofHeight.Empty();
+    RoofShape.Empty();
+    BuildingPart.Empty();
+    BuildingColour.Empty();
+    BuildingMaterial.Empty();
+    RoofColour.Empty();
+    RoofMaterial.Empty();
+}
+
+int32 FOSMBuildingAttributeTable::AddRow(const FOSMBuildingAttributes& Attributes)
+{
+    MinLevel.Add(static_cast<int16>(FMath::Clamp(Attributes.MinLevel, (int32)MIN_int16, (int32)MAX_int16)));
+    RoofHeight.Add(Attributes.RoofHeight);
+    RoofShape.Add(Intern(Attributes.RoofShape));
+    BuildingPart.Add(Intern(Attributes.BuildingPart));
+    BuildingColour.Add(Intern(Attributes.BuildingColour));
+    BuildingMaterial.Add(Intern(Attributes.BuildingMaterial));
+    RoofColour.Add(Intern(Attributes.RoofColour));
+    RoofMaterial.Add(Intern(Attributes.RoofMaterial));
+    return MinHeight.Add(Attributes.MinHeight);
+}
+
+FOSMBuildingAttributes FOSMBuildingAttributeTable::GetRow(int32 Row) const
+{
+    FOSMBuildingAttributes Attributes;
+    if(!MinHeight.IsValidIndex(Row)) {
+        return Attributes;
+    }
+    Attributes.MinHeight = MinHeight[Row];
+    Attributes.MinLevel = MinLevel[Row];
+    Attributes.RoofHeight = RoofHeight[Row];
+    Attributes.RoofShape = GetString(RoofShape[Row]);
+    Attributes.BuildingPart = GetString(BuildingPart[Row]);
+    Attributes.BuildingColour = GetString(BuildingColour[Row]);
+    Attributes.BuildingMaterial = GetString(BuildingMaterial[Row]);
+    Attributes.RoofColour = GetString(RoofColour[Row]);
+    Attributes.RoofMaterial = GetString(RoofMaterial[Row]);
+    return Attributes;
+}
+
+void FOSMBuildingAttributeTable::SetRow(int32 Row, const FOSMBuildingAttributes& Attributes)
+{
+    if(!MinHeight.IsValidIndex(Row)) {
+        return;
+    }
+    MinHeight[Row] = Attributes.MinHeight;
+    MinLevel[Row] = static_cast<int16>(FMath::Clamp(Attributes.MinLevel, (int32)MIN_int16, (int32)MAX_int16));
+    RoofHeight[Row] = Attributes.RoofHeight;
+    RoofShape[Row] = Intern(Attributes.RoofShape);
+    BuildingPart[Row] = Intern(Attributes.BuildingPart);
+    BuildingColour[Row] = Intern(Attributes.BuildingColour);
+    BuildingMaterial[Row] = Intern(Attributes.BuildingMaterial);
+    RoofColour[Row] = Intern(Attributes.RoofColour);
+    RoofMaterial[Row] = Intern(Attributes.RoofMaterial);
+}
+
+void FOSMBuildingAttributeTable::SetNum(int32 Rows)
+{
+    const FOSMBuildingAttributes EmptyRow;
+    while(Num() < Rows) {
+        AddRow(EmptyRow);
+    }
+    MinHeight.SetNum(Rows);
+    MinLevel.SetNum(Rows);
+    RoofHeight.SetNum(Rows);
+    RoofShape.SetNum(Rows);
+    BuildingPart.SetNum(Rows);
+    BuildingColour.SetNum(Rows);
+    BuildingMaterial.SetNum(Rows);
+    RoofColour.SetNum(Rows);
+    RoofMaterial.SetNum(Rows);
+}
+
+void FOSMBuildingAttributeTable::Reorder(const TArray<int32>& Order)
+{
+    auto ReorderColumn = [&Order](auto& Column)
+    {
+        typename TRemoveReference<decltype(Column)>::Type Reordered;
+        Reordered.Reserve(Order.Num());
+        for(const int32 OldRow : Order) {
+            Reordered.Add(Column[OldRow]);
+        }
+        Column = MoveTemp(Reordered);
+    };
+    ReorderColumn(MinHeight);
+    ReorderColumn(MinLevel);
+    ReorderColumn(RoofHeight);
+    ReorderColumn(RoofShape);
+    ReorderColumn(BuildingPart);
+    ReorderColumn(BuildingColour);
+    ReorderColumn(BuildingMaterial);
+    ReorderColumn(RoofColour);
+    ReorderColumn(RoofMaterial);
+}
+
+void FOSMBuildingAdjacency::Empty()
+{
+    NumBuildings = 0;
+    Offsets.Empty();
+    Neighbours.Empty();
+    SharedWalls.Empty();
+}
+
+void FOSMBuildingAdjacency::SetEdges(int32 InNumBuildings, int32 InNumNodes, const TArray<FEdge>& Edges)
+{
+    NumBuildings = InNumBuildings;
+    Offsets.Reset();
+    Offsets.SetNumZeroed(InNumNodes + 1);
+    for(const FEdge& Edge : Edges) {
+        Offsets[Edge.A + 1]++;
+        Offsets[Edge.B + 1]++;
+    }
+    for(int32 i = 0; i < InNumNodes; i++) {
+        Offsets[i + 1] += Offsets[i];
+    }
+
+    // with Edges sorted by A and B every row is filled in ascending order: first the smaller neighbours from
+    // edges that end at the node, then the larger ones from edges that start there
+    TArray<int32> Cursors(Offsets.GetData(), InNumNodes);
+    Neighbours.SetNumUninitialized(Offsets[InNumNodes]);
+    SharedWalls.SetNumUninitialized(Offsets[InNumNodes]);
+    for(const FEdge& Edge : Edges) {
+        const int32 AtA = Cursors[Edge.A]++;
+        Neighbours[AtA] = Edge.B;
+        SharedWalls[AtA] = Edge.SharedWalls;
+        const int32 AtB = Cursors[Edge.B]++;
+        Neighbours[AtB] = Edge.A;
+        SharedWalls[AtB] = Edge.SharedWalls;
+    }
+}
+
+void FOSMBuildingAdjacency::GetEdges(TArray<FEdge>& OutEdges) const
+{
+    OutEdges.Reserve(OutEdges.Num() + Neighbours.Num() / 2);
+    for(int32 Node = 0; Node < NumNodes(); Node++) {
+        for(int32 i = Offsets[Node]; i < Offsets[Node + 1]; i++) {
+            if(Neighbours[i] > Node) {
+                OutEdges.Add({Node, Neighbours[i], SharedWalls[i]});
+            }
+        }
+    }
+}
+
+TArrayView<const int32> FOSMBuildingAdjacency::GetNeighbours(int32 Node) const
+{
+    if(Node < 0 || Node >= NumNodes()) {
+        return TArrayView<const int32>();
+    }
+    return TArrayView<const int32>(Neighbours.GetData() + Offsets[Node], Offsets[Node + 1] - Offsets[Node]);
+}
+
+TArrayView<const int32> FOSMBuildingAdjacency::GetSharedWalls(int32 Node) const
+{
+    if(Node < 0 || Node >= NumNodes()) {
+        return TArrayView<const int32>();
+    }
+    return TArrayView<const int32>(SharedWalls.GetData() + Offsets[Node], Offsets[Node + 1] - Offsets[Node]);
+}
+
+void FOSMBuildingAdjacency::Reorder(const TArray<int32>& BuildingOrder, const TArray<int32>& MPBuildingOrder)
+{
+    TArray<int32> NewNodes;
+    NewNodes.Init(INDEX_NONE, NumNodes());
+    for(int32 i = 0; i < BuildingOrder.Num(); i++) {
+        NewNodes[BuildingOrder[i]] = i;
+    }
+    for(int32 i = 0; i < MPBuildingOrder.Num(); i++) {
+        NewNodes[NumBuildings + MPBuildingOrder[i]] = BuildingOrder.Num() + i;
+    }
+
+    TArray<FEdge> Edges;
+    GetEdges(Edges);
+    TArray<FEdge> Remapped;
+    Remapped.Reserve(Edges.Num());
+    for(const FEdge& Edge : Edges) {
+        const int32 A = NewNodes[Edge.A];
+        const int32 B = NewNodes[Edge.B];
+        if(A != INDEX_NONE && B != INDEX_NONE) {
+            Remapped.Add({FMath::Min(A, B), FMath::Max(A, B), Edge.SharedWalls});
+        }
+    }
+    Algo::Sort(Remapped, [](const FEdge& X, const FEdge& Y)
+    {
+        return X.A != Y.A ? X.A < Y.A : X.B < Y.B;
+    });
+    SetEdges(BuildingOrder.Num(), BuildingOrder.Num() + MPBuildingOrder.Num(), Remapped);
+}
+
+int32 FOSMBuildingAttributeTable::Intern(const FString& Value)
+{
+    if(Value.IsEmpty()) {
+        return INDEX_NONE;
+    }
+    // the lookup is not serialized, rebuild it lazily when appending to a loaded table
+    if(StringLookup.Num() != Strings.Num()) {
+        StringLookup.Empty(Strings.Num());
+        for(int32 i = 0; i < Strings.Num(); i++) {
+            StringLookup.Add(Strings[i], i);
+        }
+    }
+    if(const int32 * Existing = StringLookup.Find(Value)) {
+        return *Existing;
+    }
+    const int32 Index = Strings.Add(Value);
+    StringLookup.Add(Value, Index);
+    return Index;
+}
+
+const FString& FOSMBuildingAttributeTable::GetString(int32 StringIndex) const
+{
+    static const FString EmptyString;
+    return Strings.IsValidIndex(StringIndex) ? Strings[StringIndex] : EmptyString;
+}
+
+void UOSMDataAsset::PostInitProperties()
+{
+#if WITH_EDITORONLY_DATA
+    if(!HasAnyFlags(RF_ClassDefaultObject)) {
+        AssetImportData = NewObject<UAssetImportData>(this, TEXT("AssetImportData"));
+    }
+#endif
+    Super::PostInitProperties();
+}
+
+void UOSMDataAsset::Serialize(FArchive& Ar)
+{
+    Ar.UsingCustomVersion(FOSMDataAssetVersion::GUID);
+    // only packages get the chunks, undo, duplication and the import cache see plain properties
+    const bool bIsChunked = Ar.IsPersistent() && !Ar.IsTransacting() && (Ar.IsSaving()
+        || (Ar.IsLoading() && Ar.CustomVer(FOSMDataAssetVersion::GUID) >= FOSMDataAssetVersion::ChunkedPayload));
+    if(!bIsChunked) {
+        Super::Serialize(Ar);
+        return;
+    }
+
+    if(Ar.IsSaving()) {
+        // the tagged properties get empty arrays, the data follows them
+        TArray<FBuildingData> SavedBuildings = MoveTemp(Buildings);
+        TArray<FMPBuildingData> SavedMPBuildings = MoveTemp(MultiPolygonBuildings);
+        TArray<FVector> SavedNodePositions = MoveTemp(NodePositions);
+        TArray<FOSMGeoPoint> SavedNodeCoordinates = MoveTemp(NodeCoordinates);
+        Super::Serialize(Ar);
+        Buildings = MoveTemp(SavedBuildings);
+        MultiPolygonBuildings = MoveTemp(SavedMPBuildings);
+        NodePositions = MoveTemp(SavedNodePositions);
+        NodeCoordinates = MoveTemp(SavedNodeCoordinates);
+        OSMPayloadChunks::Save(Ar, *this);
+    } else {
+        Super::Serialize(Ar);
+        OSMPayloadChunks::Load(Ar, *this);
+    }
+}
+
+void UOSMDataAsset::PostLoad()
+{
+    Super::PostLoad();
+    // assets saved before the index existed
+    if(BuildingIDIndex.Num() != Buildings.Num() || MPBuildingIDIndex.Num() != MultiPolygonBuildings.Num()) {
+        ComputeIDIndex(Buildings, BuildingIDIndex);
+        ComputeIDIndex(MultiPolygonBuildings, MPBuildingIDIndex);
+    }
+}
+
+#if WITH_EDITORONLY_DATA
+void UOSMDataAsset::GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const
+{
+    if(AssetImportData) {
+        OutTags.Add(FAssetRegistryTag(SourceFileTagName(), AssetImportData->GetSourceData().ToJson(), FAssetRegistryTag::TT_Hidden));
+    }
+    Super::GetAssetRegistryTags(OutTags);
+}
+#endif
+
+void UOSMDataAsset::SerializeBuildingSet(FArchive& Ar)
+{
+#if WITH_EDITORONLY_DATA
+    // the import data subobject belongs to this asset and must survive loading foreign data
+    UAssetImportData * ImportData = AssetImportData;
+#endif
+
+    // names and object references are written as strings so the data does not depend on a linker
+    FObjectAndNameAsStringProxyArchive ProxyAr(Ar, false);
+    GetClass()->SerializeTaggedProperties(ProxyAr, reinterpret_cast<uint8*>(this), GetClass(), nullptr);
+
+#if WITH_EDITORONLY_DATA
+    if(Ar.IsLoading()) {
+        AssetImportData = ImportData;
+    }
+#endif
+}
+
+void UOSMDataAsset::GetBuildingFootprint(int32 BuildingIndex, TArray<FVector>& OutPoints) const
+{
+    OutPoints.Reset();
+    if(Buildings.IsValidIndex(BuildingIndex)) {
+        ResolvePoints(Buildings[BuildingIndex], OutPoints);
+    }
+}
+
+void UOSMDataAsset::GetMPBuildingPartFootprint(int32 BuildingIndex, int32 PartIndex, TArray<FVector>& OutPoints) const
+{
+    OutPoints.Reset();
+    if(MultiPolygonBuildings.IsValidIndex(BuildingIndex)
+        && MultiPolygonBuildings[BuildingIndex].Parts.IsValidIndex(PartIndex))
+    {
+        ResolvePoints(MultiPolygonBuildings[BuildingIndex].Parts[PartIndex], OutPoints);
+    }
+}
+
+void UOSMDataAsset::GetBuildingCoordinates(int32 BuildingIndex, TArray<FOSMGeoPoint>& OutCoordinates) const
+{
+    OutCoordinates.Reset();
+    if(Buildings.IsValidIndex(BuildingIndex)) {
+        ResolveCoordinates(Buildings[BuildingIndex], OutCoordinates);
+    }
+}
+
+void UOSMDataAsset::GetMPBuildingPartCoordinates(int32 BuildingIndex, int32 PartIndex, TArray<FOSMGeoPoint>& OutCoordinates) const
+{
+    OutCoordinates.Reset();
+    if(MultiPolygonBuildings.IsValidIndex(BuildingIndex)
+        && MultiPolygonBuildings[BuildingIndex].Parts.IsValidIndex(PartIndex))
+    {
+        ResolveCoordinates(MultiPolygonBuildings[BuildingIndex].Parts[PartIndex], OutCoordinates);
+    }
+}
+
+void UOSMDataAsset::ResolvePoints(const FOSMFootprint& Footprint, TArray<FVector>& OutPoints) const
+{
+    OutPoints.Reset(Footprint.NumVertices());
+    if(Footprint.PolygonIndices.Num() > 0) {
+        for(const int32 Index : Footprint.PolygonIndices) {
+            OutPoints.Add(NodeCoordinates.Num() > 0 ? NodeCoordinates[Index].ToVector() : NodePositions[Index]);
+        }
+    } else if(Footprint.PolygonCoordinates.Num() > 0) {
+        for(const FOSMGeoPoint& Coordinate : Footprint.PolygonCoordinates) {
+            OutPoints.Add(Coordinate.ToVector());
+        }
+    } else {
+        OutPoints = Footprint.PolygonPoints;
+    }
+}
+
+void UOSMDataAsset::ResolveCoordinates(const FOSMFootprint& Footprint, TArray<FOSMGeoPoint>& OutCoordinates) const
+{
+    OutCoordinates.Reset(Footprint.NumVertices());
+    if(Footprint.PolygonIndices.Num() > 0) {
+        for(const int32 Index : Footprint.PolygonIndices) {
+            OutCoordinates.Add(NodeCoordinates.Num() > 0 ? NodeCoordinates[Index] : FOSMGeoPoint::FromVector(NodePositions[Index]));
+        }
+    } else if(Footprint.PolygonCoordinates.Num() > 0) {
+        OutCoordinates = Footprint.PolygonCoordinates;
+    } else {
+        for(const FVector& Point : Footprint.PolygonPoints) {
+            OutCoordinates.Add(FOSMGeoPoint::FromVector(Point));
+        }
+    }
+}
+
+void UOSMDataAsset::UpdateBuildingLookups()
+{
+    ComputeTypeOffsets(Buildings, BuildingTypeOffsets);
+    ComputeTypeOffsets(MultiPolygonBuildings, MPBuildingTypeOffsets);
+    ComputeIDIndex(Buildings, BuildingIDIndex);
+    ComputeIDIndex(MultiPolygonBuildings, MPBuildingIDIndex);
+}
+
+void UOSMDataAsset::UpdateBuildingAdjacency()
+{
+    const int32 NumNodes = Buildings.Num() + MultiPolygonBuildings.Num();
+    TArray<TArray<uint64>> NodeVertices;
+    TArray<TArray<FSegmentKey>> NodeSegments;
+    NodeVertices.SetNum(NumNodes);
+    NodeSegments.SetNum(NumNodes);
+    ParallelFor(NumNodes, [&](int32 Node)
+    {
+        TArray<FOSMGeoPoint> Ring;
+        TArray<uint64> RingKeys;
+        CollectKeys(*this, Node, Ring, RingKeys, NodeVertices[Node], NodeSegments[Node]);
+    });
+    BuildAdjacency(Buildings.Num(), NodeVertices, NodeSegments, BuildingAdjacency);
+}
+
+void UOSMDataAsset::UpdateBuildingAdjacency(const TArray<TArray<int64>>& RingNodeIDs)
+{
+    // ring of the first part of every node
+    const int32 NumNodes = Buildings.Num() + MultiPolygonBuildings.Num();
+    TArray<int32> FirstRings;
+    FirstRings.SetNumUninitialized(NumNodes + 1);
+    FirstRings[0] = 0;
+    for(int32 Node = 0; Node < NumNodes; Node++) {
+        FirstRings[Node + 1] = FirstRings[Node] + (Node < Buildings.Num() ? 1 : MultiPolygonBuildings[Node - Buildings.Num()].Parts.Num());
+    }
+    if(RingNodeIDs.Num() != FirstRings[NumNodes]) {
+        UE_LOG(LogTemp, Warning, TEXT("UOSMDataAsset: Got node IDs for %d rings instead of %d, comparing coordinates"), RingNodeIDs.Num(), FirstRings[NumNodes])
+        UpdateBuildingAdjacency();
+        return;
+    }
+
+    TArray<TArray<uint64>> NodeVertices;
+    TArray<TArray<FSegmentKey>> NodeSegments;
+    NodeVertices.SetNum(NumNodes);
+    NodeSegments.SetNum(NumNodes);
+    ParallelFor(NumNodes, [&](int32 Node)
+    {
+        for(int32 Ring = FirstRings[Node]; Ring < FirstRings[Node + 1]; Ring++) {
+            AddRingKeys<int64>(RingNodeIDs[Ring], NodeVertices[Node], NodeSegments[Node]);
+        }
+        MakeKeysUnique(NodeVertices[Node], NodeSegments[Node]);
+    });
+    BuildAdjacency(Buildings.Num(), NodeVertices, NodeSegments, BuildingAdjacency);
+}
+
+int32 UOSMDataAsset::FindBuildingIndex(int64 ID) const
+{
+    const int32 * Index = BuildingIDIndex.Find(ID);
+    return Index ? *Index : INDEX_NONE;
+}
+
+int32 UOSMDataAsset::FindMPBuildingIndex(int64 ID) const
+{
+    const int32 * Index = MPBuildingIDIndex.Find(ID);
+    return Index ? *Index : INDEX_NONE;
+}
+
+bool UOSMDataAsset::FindBuildingByID(int64 ID, TEnumAsByte<EOSMElementType> ElementType, int32& OutIndex, bool& bOutIsMultiPolygon) const
+{
+    bOutIsMultiPolygon = ElementType == EOSMElementType::RelationElement;
+    if(ElementType == EOSMElementType::WayElement) {
+        OutIndex = FindBuildingIndex(ID);
+    } else if(ElementType == EOSMElementType::RelationElement) {
+        OutIndex = FindMPBuildingIndex(ID);
+    } else {
+        OutIndex = INDEX_NONE;
+    }
+    return OutIndex != INDEX_NONE;
+}
+
+const FBuildingData* UOSMDataAsset::FindBuilding(int64 ID) const
+{
+    const int32 Index = FindBuildingIndex(ID);
+    return Index != INDEX_NONE ? &Buildings[Index] : nullptr;
+}
+
+const FMPBuildingData* UOSMDataAsset::FindMPBuilding(int64 ID) const
+{
+    const int32 Index = FindMPBuildingIndex(ID);
+    return Index != INDEX_NONE ? &MultiPolygonBuildings[Index] : nullptr;
+}
+
+bool UOSMDataAsset::GetBuildingTypeRange(TEnumAsByte<EOSMBuildingType> Type, int32& OutFirst, int32& OutNum) const
+{
+    return GetTypeRange(BuildingTypeOffsets, Type, OutFirst, OutNum);
+}
+
+bool UOSMDataAsset::GetMPBuildingTypeRange(TEnumAsByte<EOSMBuildingType> Type, int32& OutFirst, int32& OutNum) const
+{
+    return GetTypeRange(MPBuildingTypeOffsets, Type, OutFirst, OutNum);
+}
+
+TArrayView<const FBuildingData> UOSMDataAsset::GetBuildingsOfType(EOSMBuildingType Type) const
+{
+    int32 First, Num;
+    GetTypeRange(BuildingTypeOffsets, Type, First, Num);
+    return TArrayView<const FBuildingData>(Buildings.GetData() + First, Num);
+}
+
+TArrayView<const FMPBuildingData> UOSMDataAsset::GetMPBuildingsOfType(EOSMBuildingType Type) const
+{
+    int32 First, Num;
+    GetTypeRange(MPBuildingTypeOffsets, Type, First, Num);
+    return TArrayView<const FMPBuildingData>(MultiPolygonBuildings.GetData() + First, Num);
+}
+
+bool UOSMDataAsset::HasBuildingAdjacency() const
+{
+    return !BuildingAdjacency.IsEmpty() && BuildingAdjacency.NumBuildings == Buildings.Num()
+        && BuildingAdjacency.NumNodes() == Buildings.Num() + MultiPolygonBuildings.Num();
+}
+
+void UOSMDataAsset::GetBuildingNeighbours(int32 BuildingIndex, bool bIsMultiPolygon, bool bSharedWallsOnly, TArray<int32>& OutBuildingIndices, TArray<int32>& OutMPBuildingIndices) const
+{
+    OutBuildingIndices.Reset();
+    OutMPBuildingIndices.Reset();
+    if(!HasBuildingAdjacency()
+        || !(bIsMultiPolygon ? MultiPolygonBuildings.IsValidIndex(BuildingIndex) : Buildings.IsValidIndex(BuildingIndex)))
+    {
+        return;
+    }
+    const int32 Node = bIsMultiPolygon ? Buildings.Num() + BuildingIndex : BuildingIndex;
+    const TArrayView<const int32> Neighbours = BuildingAdjacency.GetNeighbours(Node);
+    const TArrayView<const int32> SharedWalls = BuildingAdjacency.GetSharedWalls(Node);
+    for(int32 i = 0; i < Neighbours.Num(); i++) {
+        if(bSharedWallsOnly && SharedWalls[i] == 0) {
+            continue;
+        }
+        if(Neighbours[i] < Buildings.Num()) {
+            OutBuildingIndices.Add(Neighbours[i]);
+        } else {
+            OutMPBuildingIndices.Add(Neighbours[i] - Buildings.Num());
+        }
+    }
+}
+
+void UOSMDataAsset::GetSharedWallSegments(int32 BuildingIndex, bool bIsMultiPolygon, int32 PartIndex, TArray<bool>& OutIsShared) const
+{
+    OutIsShared.Reset();
+    const FOSMFootprint* Footprint = nullptr;
+    if(bIsMultiPolygon) {
+        if(MultiPolygonBuildings.IsValidIndex(BuildingIndex) && MultiPolygonBuildings[BuildingIndex].Parts.IsValidIndex(PartIndex)) {
+            Footprint = &MultiPolygonBuildings[BuildingIndex].Parts[PartIndex];
+        }
+    } else if(Buildings.IsValidIndex(BuildingIndex)) {
+        Footprint = &Buildings[BuildingIndex];
+    }
+    if(!Footprint) {
+        return;
+    }
+    // keyed like the rings of the neighbours, by pool index or by coordinates
+    TArray<FOSMGeoPoint> Ring;
+    TArray<uint64> RingKeys;
+    GetRingKeys(*this, *Footprint, Ring, RingKeys);
+    OutIsShared.SetNumZeroed(RingKeys.Num());
+    if(RingKeys.Num() == 0 || !HasBuildingAdjacency()) {
+        return;
+    }
+
+    // only the few neighbours with shared walls are resolved, so this is cheap enough to run per building
+    const int32 Node = bIsMultiPolygon ? Buildings.Num() + BuildingIndex : BuildingIndex;
+    const TArrayView<const int32> Neighbours = BuildingAdjacency.GetNeighbours(Node);
+    const TArrayView<const int32> SharedWalls = BuildingAdjacency.GetSharedWalls(Node);
+    TSet<FSegmentKey> NeighbourSegments;
+    TArray<uint64> NeighbourKeys;
+    TArray<uint64> Vertices;
+    TArray<FSegmentKey> Segments;
+    for(int32 i = 0; i < Neighbours.Num(); i++) {
+        if(SharedWalls[i] > 0) {
+            CollectKeys(*this, Neighbours[i], Ring, NeighbourKeys, Vertices, Segments);
+            NeighbourSegments.Append(Segments);
+        }
+    }
+    for(int32 i = 0; i < RingKeys.Num(); i++) {
+        const uint64 V0 = RingKeys[i];
+        const uint64 V1 = RingKeys[(i + 1) % RingKeys.Num()];
+        OutIsShared[i] = V0 != V1 && NeighbourSegments.Contains(FSegmentKey(V0, V1));
+    }
+}
+
+FOSMBuildingAttributes UOSMDataAsset::GetBuildingAttributes(int32 BuildingIndex) const
+{
+    return BuildingAttributes.GetRow(BuildingIndex);
+}
+
+FOSMBuildingAttributes UOSMDataAsset::GetMPBuildingAttributes(int32 BuildingIndex) const
+{
+    return MultiPolygonBuildingAttributes.GetRow(BuildingIndex);
+}
@@ -0,0 +1,1383 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMDataAssetBuilder.h"
+
+#include "Algo/Sort.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+#include "OSMExternalSorter.h"
+#include "OSMFileParser.h"
+#include "OSMHilbert.h"
+#include "OSMRingAssembler.h"
+#include "OSMTagParsing.h"
+#include "OSMXmlStream.h"
+
+namespace
+{
+    FOSMBuildingAttributes ToAttributes(const FOSMFile::FOSMBuildingTags& Tags)
+    {
+        FOSMBuildingAttributes Attributes;
+        Attributes.MinHeight = Tags.MinHeight;
+        Attributes.MinLevel = Tags.MinLevel;
+        Attributes.RoofHeight = Tags.RoofHeight;
+        Attributes.RoofShape = Tags.RoofShape;
+        Attributes.BuildingPart = Tags.BuildingPart;
+        Attributes.BuildingColour = Tags.BuildingColour;
+        Attributes.BuildingMaterial = Tags.BuildingMaterial;
+        Attributes.RoofColour = Tags.RoofColour;
+        Attributes.RoofMaterial = Tags.RoofMaterial;
+        return Attributes;
+    }
+
+    /** Parses Filenames in parallel and merges them into one file, nullptr if any of them fails to parse */
+    TUniquePtr<FOSMFile> LoadMerged(const TArray<FString>& Filenames, bool bCollectNodeTags)
+    {
+        if(Filenames.Num() == 0) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: No osm files to merge"))
+            return nullptr;
+        }
+        TArray<TUniquePtr<FOSMFile>> Parsers;
+        Parsers.SetNum(Filenames.Num());
+        TArray<bool> Loaded;
+        Loaded.SetNumZeroed(Filenames.Num());
+        ParallelFor(Filenames.Num(), [&](int32 i)
+        {
+            Parsers[i] = MakeUnique<FOSMFile>();
+            Parsers[i]->bCollectNodeTags = bCollectNodeTags;
+            Parsers[i]->bKeepNodeRefs = true;
+            FString File = Filenames[i];
+            Loaded[i] = Parsers[i]->LoadOpenStreetMapFile(File, false, nullptr);
+        });
+        for(int32 i = 0; i < Filenames.Num(); i++) {
+            if(!Loaded[i]) {
+                UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to parse osm file %s"), *Filenames[i])
+                return nullptr;
+            }
+        }
+
+        for(int32 i = 1; i < Parsers.Num(); i++) {
+            Parsers[0]->MergeFrom(*Parsers[i]);
+            Parsers[i].Reset();
+        }
+        Parsers[0]->FinishMerge();
+        return MoveTemp(Parsers[0]);
+    }
+
+    /** Area relations and closed ways without a building tag go to the area asset instead */
+    bool IsAreaOnly(const FOSMFile::FOSMRelationInfo& Relation)
+    {
+        return Relation.bIsArea && !Relation.bIsBuilding;
+    }
+    bool IsAreaOnly(const FOSMFile::FOSMWayInfo& Way)
+    {
+        return Way.bIsArea && Way.WayType != EOSMWayType::Building;
+    }
+
+    template<typename TBuilding>
+    void ResolveHeight(TBuilding& Building, const FOSMImportSettings& Settings)
+    {
+        if(Building.HeightSource == EOSMHeightSource::HeightFromTag) {
+            return;
+        }
+        const float StoreyHeight = Settings.GetStoreyHeight(Building.BuildingType);
+        if(Building.Levels > 0) {
+            Building.Height = Building.Levels * StoreyHeight;
+            Building.HeightSource = EOSMHeightSource::HeightFromLevels;
+        } else if(Settings.DefaultLevels > 0) {
+            Building.Height = Settings.DefaultLevels * StoreyHeight;
+            Building.HeightSource = EOSMHeightSource::HeightFromTypeDefault;
+        } else {
+            Building.Height = 0.0f;
+            Building.HeightSource = EOSMHeightSource::HeightUnknown;
+        }
+    }
+
+    /** Vertex average of the outer rings of a building in degrees */
+    struct FCentroid
+    {
+        double X = 0.0;
+        double Y = 0.0;
+        bool bIsValid = false;
+    };
+
+    /** Sums fixed point vertices, exact where a float or double sum of degrees is not */
+    void AccumulateVertices(const TArray<FOSMGeoPoint>& Points, int64& SumX, int64& SumY, int32& Count)
+    {
+        for(const FOSMGeoPoint& Point : Points) {
+            SumX += Point.LongitudeE7;
+            SumY += Point.LatitudeE7;
+        }
+        Count += Points.Num();
+    }
+
+    /** New element i is old element Order[i]. Order must not contain duplicates. */
+    template<typename T>
+    void ReorderArray(TArray<T>& Array, const TArray<int32>& Order)
+    {
+        TArray<T> Reordered;
+        Reordered.Reserve(Order.Num());
+        for(const int32 OldIndex : Order) {
+            Reordered.Add(MoveTemp(Array[OldIndex]));
+        }
+        Array = MoveTemp(Reordered);
+    }
+
+    /** Order that stable sorts Buildings by type, a counting sort as there are only few types */
+    template<typename TBuilding>
+    TArray<int32> GetTypeOrder(const TArray<TBuilding>& Buildings)
+    {
+        TArray<int32> Offsets;
+        Offsets.SetNumZeroed(EOSMBuildingType::OtherBuilding + 2);
+        for(const TBuilding& Building : Buildings) {
+            Offsets[Building.BuildingType + 1]++;
+        }
+        for(int32 Type = 1; Type < Offsets.Num(); Type++) {
+            Offsets[Type] += Offsets[Type - 1];
+        }
+        TArray<int32> Order;
+        Order.SetNumUninitialized(Buildings.Num());
+        for(int32 i = 0; i < Buildings.Num(); i++) {
+            Order[Offsets[Buildings[i].BuildingType]++] = i;
+        }
+        return Order;
+    }
+
+    /**
+     * Matches Old and New by ID. OutNewIndices[i] is the index into New of Old[i] or INDEX_NONE if it was removed,
+     * OutModifiedSlots marks the matched buildings Equals(OldIndex, NewIndex) found changed. OutAddedIndices lists
+     * the buildings of New without a match.
+     */
+    template<typename TBuilding, typename TEquals>
+    void DiffBuildings(const TArray<TBuilding>& Old, const TArray<TBuilding>& New, TEquals Equals,
+        TArray<int32>& OutNewIndices, TBitArray<>& OutModifiedSlots, TArray<int32>& OutAddedIndices,
+        TArray<int64>& OutAdded, TArray<int64>& OutRemoved, TArray<int64>& OutModified)
+    {
+        TMap<int64, int32> NewIndices;
+        NewIndices.Reserve(New.Num());
+        for(int32 j = 0; j < New.Num(); j++) {
+            NewIndices.Add(New[j].ID, j);
+        }
+
+        TBitArray<> Matched(false, New.Num());
+        OutNewIndices.Init(INDEX_NONE, Old.Num());
+        OutModifiedSlots.Init(false, Old.Num());
+        for(int32 i = 0; i < Old.Num(); i++) {
+            const int32 * NewIndex = NewIndices.Find(Old[i].ID);
+            if(!NewIndex || Matched[*NewIndex]) {
+                OutRemoved.Add(Old[i].ID);
+                continue;
+            }
+            Matched[*NewIndex] = true;
+            OutNewIndices[i] = *NewIndex;
+            if(!Equals(i, *NewIndex)) {
+                OutModifiedSlots[i] = true;
+                OutModified.Add(Old[i].ID);
+            }
+        }
+        for(int32 j = 0; j < New.Num(); j++) {
+            if(!Matched[j]) {
+                OutAddedIndices.Add(j);
+                OutAdded.Add(New[j].ID);
+            }
+        }
+    }
+
+    /**
+     * Assigns the buildings of an update to slots, returns the index into New for every slot. Matched buildings
+     * keep their slot, added ones take the slots of removed ones first and are appended after that. Removed slots
+     * left over are filled with the last buildings of the array, so only those move.
+     */
+    TArray<int32> GetUpdatedSlots(const TArray<int32>& NewIndices, const TArray<int32>& AddedIndices)
+    {
+        TArray<int32> Slots = NewIndices;
+        TArray<int32> FreeSlots;
+        for(int32 i = 0; i < Slots.Num(); i++) {
+            if(Slots[i] == INDEX_NONE) {
+                FreeSlots.Add(i);
+            }
+        }
+        int32 NextFree = 0;
+        for(const int32 Added : AddedIndices) {
+            if(NextFree < FreeSlots.Num()) {
+                Slots[FreeSlots[NextFree++]] = Added;
+            } else {
+                Slots.Add(Added);
+            }
+        }
+        for(; NextFree < FreeSlots.Num(); NextFree++) {
+            while(Slots.Num() > 0 && Slots.Last() == INDEX_NONE) {
+                Slots.Pop();
+            }
+            if(FreeSlots[NextFree] >= Slots.Num()) {
+                break;
+            }
+            Slots[FreeSlots[NextFree]] = Slots.Pop();
+        }
+        return Slots;
+    }
+
+    /** Marks the slots that need the building of New written, those that hold another building or changed */
+    TBitArray<> GetChangedSlots(const TArray<int32>& Slots, const TArray<int32>& NewIndices, const TBitArray<>& ModifiedSlots, bool bCopyAll)
+    {
+        TBitArray<> Changed(false, Slots.Num());
+        for(int32 Slot = 0; Slot < Slots.Num(); Slot++) {
+            Changed[Slot] = bCopyAll || !NewIndices.IsValidIndex(Slot) || NewIndices[Slot] != Slots[Slot] || ModifiedSlots[Slot];
+        }
+        return Changed;
+    }
+
+    /** Copies the pool vertices Footprint refers to from Source into Target and points its indices at the copies */
+    void CopyPoolVertices(const UOSMDataAsset* Source, UOSMDataAsset* Target, FOSMFootprint& Footprint, TMap<int32, int32>& CopiedIndices)
+    {
+        for(int32& Index : Footprint.PolygonIndices) {
+            if(const int32 * Copied = CopiedIndices.Find(Index)) {
+                Index = *Copied;
+                continue;
+            }
+            const int32 Copy = Source->NodeCoordinates.IsValidIndex(Index)
+                ? Target->NodeCoordinates.Add(Source->NodeCoordinates[Index])
+                : Target->NodePositions.Add(Source->NodePositions[Index]);
+            CopiedIndices.Add(Index, Copy);
+            Index = Copy;
+        }
+    }
+
+    /** Drops the pool vertices no footprint of Asset refers to, the rest is renumbered in order of first use */
+    void CompactNodePool(UOSMDataAsset* Asset)
+    {
+        const int32 PoolSize = FMath::Max(Asset->NodeCoordinates.Num(), Asset->NodePositions.Num());
+        if(PoolSize == 0) {
+            return;
+        }
+        TArray<int32> Remap;
+        Remap.Init(INDEX_NONE, PoolSize);
+        int32 NumUsed = 0;
+        auto Renumber = [&Remap, &NumUsed](FOSMFootprint& Footprint)
+        {
+            for(int32& Index : Footprint.PolygonIndices) {
+                if(Remap[Index] == INDEX_NONE) {
+                    Remap[Index] = NumUsed++;
+                }
+                Index = Remap[Index];
+            }
+        };
+        for(FBuildingData& Building : Asset->Buildings) {
+            Renumber(Building);
+        }
+        for(FMPBuildingData& Building : Asset->MultiPolygonBuildings) {
+            for(FMPBuildingPart& Part : Building.Parts) {
+                Renumber(Part);
+            }
+        }
+        auto CompactPool = [&Remap, NumUsed](auto& Pool)
+        {
+            if(Pool.Num() == 0) {
+                return;
+            }
+            typename TRemoveReference<decltype(Pool)>::Type Compacted;
+            Compacted.SetNumUninitialized(NumUsed);
+            for(int32 i = 0; i < Pool.Num(); i++) {
+                if(Remap[i] != INDEX_NONE) {
+                    Compacted[Remap[i]] = Pool[i];
+                }
+            }
+            Pool = MoveTemp(Compacted);
+        };
+        CompactPool(Asset->NodeCoordinates);
+        CompactPool(Asset->NodePositions);
+    }
+
+    /**
+     * Writes the attribute rows of the slots that changed from Source to Target. If Target has no valid table,
+     * every row is written.
+     */
+    template<typename TGetAttributes>
+    void PatchAttributes(FOSMBuildingAttributeTable& Target, int32 OldNum, const FOSMBuildingAttributeTable& Source,
+        const TArray<int32>& Slots, const TBitArray<>& ChangedSlots, TGetAttributes GetAttributes)
+    {
+        if(Source.Num() == 0) {
+            Target.Empty();
+            return;
+        }
+        const bool bRewrite = Target.Num() != OldNum;
+        if(bRewrite) {
+            Target.Empty();
+        }
+        Target.SetNum(Slots.Num());
+        for(int32 Slot = 0; Slot < Slots.Num(); Slot++) {
+            if(bRewrite || ChangedSlots[Slot]) {
+                Target.SetRow(Slot, GetAttributes(Slots[Slot]));
+            }
+        }
+    }
+
+    /** Lists the buildings that ended up in another slot than before the update, added buildings excluded */
+    template<typename TBuilding>
+    void GetMovedBuildings(const TArray<TBuilding>& Buildings, const TMap<int64, int32>& OldSlots, TArray<int64>& OutMoved)
+    {
+        for(int32 Slot = 0; Slot < Buildings.Num(); Slot++) {
+            const int32 * OldSlot = OldSlots.Find(Buildings[Slot].ID);
+            if(OldSlot && *OldSlot != Slot) {
+                OutMoved.Add(Buildings[Slot].ID);
+            }
+        }
+    }
+
+    /** Maps the ID of every building to its slot, the first one wins for duplicate IDs */
+    template<typename TBuilding>
+    TMap<int64, int32> GetSlots(const TArray<TBuilding>& Buildings)
+    {
+        TMap<int64, int32> Slots;
+        Slots.Reserve(Buildings.Num());
+        for(int32 Slot = 0; Slot < Buildings.Num(); Slot++) {
+            if(!Slots.Contains(Buildings[Slot].ID)) {
+                Slots.Add(Buildings[Slot].ID, Slot);
+            }
+        }
+        return Slots;
+    }
+
+    // records of an out of core import, written to disk as they are
+
+    /** A node, sorted by ID to join it with the references to it */
+    struct FSpilledNode
+    {
+        int64 ID;
+        int32 LongitudeE7;
+        int32 LatitudeE7;
+    };
+    /** Reference number Sequence of way WayIndex, sorted by node ID to join it with the nodes */
+    struct FSpilledNodeRef
+    {
+        int64 NodeID;
+        int32 WayIndex;
+        int32 Sequence;
+    };
+    /** A reference with the coordinates of its node, sorted back into way order */
+    struct FResolvedNodeRef
+    {
+        int32 WayIndex;
+        int32 Sequence;
+        int64 NodeID;
+        int32 LongitudeE7;
+        int32 LatitudeE7;
+    };
+    struct FSpilledNodeLess
+    {
+        bool operator()(const FSpilledNode& A, const FSpilledNode& B) const
+        {
+            return A.ID < B.ID;
+        }
+    };
+    struct FSpilledNodeRefLess
+    {
+        bool operator()(const FSpilledNodeRef& A, const FSpilledNodeRef& B) const
+        {
+            if(A.NodeID != B.NodeID) {
+                return A.NodeID < B.NodeID;
+            }
+            return A.WayIndex != B.WayIndex ? A.WayIndex < B.WayIndex : A.Sequence < B.Sequence;
+        }
+    };
+    struct FResolvedNodeRefLess
+    {
+        bool operator()(const FResolvedNodeRef& A, const FResolvedNodeRef& B) const
+        {
+            return A.WayIndex != B.WayIndex ? A.WayIndex < B.WayIndex : A.Sequence < B.Sequence;
+        }
+    };
+
+    /** What is kept of a way until its nodes are resolved, written in the order of the way indices */
+    struct FSpilledWay
+    {
+        int64 ID = 0;
+        int32 NumRefs = 0;
+        /** Member of a multipolygon relation, only its geometry is needed */
+        bool bIsMember = false;
+        TEnumAsByte<EOSMBuildingType> BuildingType = EOSMBuildingType::OtherBuilding;
+        double Height = 0.0;
+        int32 Levels = 0;
+        FOSMFile::FOSMBuildingTags Tags;
+
+        friend FArchive& operator<<(FArchive& Ar, FSpilledWay& Way)
+        {
+            Ar << Way.ID << Way.NumRefs << Way.bIsMember;
+            if(!Way.bIsMember) {
+                Ar << Way.BuildingType << Way.Height << Way.Levels;
+                Ar << Way.Tags.MinHeight << Way.Tags.MinLevel << Way.Tags.RoofHeight << Way.Tags.RoofShape
+                    << Way.Tags.BuildingPart << Way.Tags.BuildingColour << Way.Tags.BuildingMaterial
+                    << Way.Tags.RoofColour << Way.Tags.RoofMaterial;
+            }
+            return Ar;
+        }
+    };
+
+    /**
+     * First pass of an out of core import. Relations come last in OSM files, so their member ways have to be
+     * known before the ways are read. Keeps the relations that become multipolygon buildings in Members.
+     */
+    bool ReadRelations(const FString& Filename, FOSMFile& Members, TSet<int64>& OutMemberWays, TSet<int64>& OutNeededWays)
+    {
+        FOSMXmlStream Stream;
+        if(!Stream.Open(Filename)) {
+            return false;
+        }
+        FOSMFile::FOSMRelationInfo * Relation = nullptr;
+        FString Key;
+        FString Value;
+        while(Stream.Next()) {
+            if(Stream.IsElement("relation")) {
+                if(!Stream.IsEnd()) {
+                    Relation = new FOSMFile::FOSMRelationInfo();
+                    FOSMFile::InitRelationInfo(*Relation);
+                    Stream.GetAttribute("id", Relation->RelationID);
+                    continue;
+                }
+                if(!Relation) {
+                    continue;
+                }
+                TArray<int64, TInlineAllocator<16>> WayIDs;
+                for(const auto * Member : Relation->Members) {
+                    WayIDs.Add(FCString::Atoi64(*Member->Ref));
+                }
+                OutMemberWays.Append(WayIDs);
+                if(IsAreaOnly(*Relation)) {
+                    for(const auto * Member : Relation->Members) {
+                        delete Member;
+                    }
+                    delete Relation;
+                } else {
+                    OutNeededWays.Append(WayIDs);
+                    Members.Relations.Add(Relation);
+                }
+                Relation = nullptr;
+            } else if(Relation && !Stream.IsEnd()) {
+                if(Stream.IsElement("member")) {
+                    // only interested in relations of type way for now
+                    if(!Stream.GetAttribute("type", Value) || !Value.Equals(TEXT("way"))) {
+                        continue;
+                    }
+                    auto * Member = new FOSMFile::FOSMRelMember();
+                    Member->Type = Value;
+                    Stream.GetAttribute("ref", Member->Ref);
+                    Member->bIsInner = 0;
+                    Member->bHasRole = 0;
+                    if(Stream.GetAttribute("role", Value)) {
+                        FOSMFile::DecodeMemberRole(*Value, *Member);
+                    }
+                    Relation->Members.Add(Member);
+                } else if(Stream.IsElement("tag") && Stream.GetAttribute("k", Key) && Stream.GetAttribute("v", Value)) {
+                    FOSMFile::DecodeRelationTag(*Key, *Value, *Relation);
+                }
+            }
+        }
+        if(Relation) {
+            for(const auto * Member : Relation->Members) {
+                delete Member;
+            }
+            delete Relation;
+        }
+        return !Stream.IsError();
+    }
+}
+
+bool FOSMDataAssetBuilder::BuildFromFile(const FString& Filename, UOSMDataAsset* Asset, const FOSMImportSettings& Settings, FFeedbackContext* Warn)
+{
+    if(Settings.bImportOutOfCore) {
+        return BuildOutOfCore(Filename, Asset, Settings);
+    }
+    FString File = Filename;
+    FOSMFile Parser;
+    if(!Parser.LoadOpenStreetMapFile(File, false, Warn)) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to parse osm file %s"), *File)
+        return false;
+    }
+    return BuildFromParser(Parser, Asset, Settings);
+}
+
+bool FOSMDataAssetBuilder::BuildFromBuffer(FString& Buffer, UOSMDataAsset* Asset, const FOSMImportSettings& Settings, FFeedbackContext* Warn)
+{
+    FOSMFile Parser;
+    if(!Parser.LoadOpenStreetMapFile(Buffer, true, Warn)) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to parse osm buffer"))
+        return false;
+    }
+    return BuildFromParser(Parser, Asset, Settings);
+}
+
+bool FOSMDataAssetBuilder::BuildPOIsFromFile(const FString& Filename, UOSMPOIDataAsset* Asset, FFeedbackContext* Warn)
+{
+    return BuildWithExtracts({Filename}, nullptr, FOSMImportSettings(), Asset, nullptr, Warn);
+}
+
+bool FOSMDataAssetBuilder::BuildAreasFromFile(const FString& Filename, UOSMAreaDataAsset* Asset, FFeedbackContext* Warn)
+{
+    return BuildWithExtracts({Filename}, nullptr, FOSMImportSettings(), nullptr, Asset, Warn);
+}
+
+bool FOSMDataAssetBuilder::BuildFromFiles(const TArray<FString>& Filenames, UOSMDataAsset* Asset, const FOSMImportSettings& Settings)
+{
+    return BuildWithExtracts(Filenames, Asset, Settings, nullptr, nullptr);
+}
+
+bool FOSMDataAssetBuilder::BuildWithExtracts(const TArray<FString>& Filenames, UOSMDataAsset* Asset, const FOSMImportSettings& Settings, UOSMPOIDataAsset* POIAsset, UOSMAreaDataAsset* AreaAsset, FFeedbackContext* Warn)
+{
+    // node tags are only kept in memory if points of interest are extracted
+    const bool bCollectNodeTags = POIAsset != nullptr;
+    TUniquePtr<FOSMFile> Parser;
+    if(Filenames.Num() == 1) {
+        FString File = Filenames[0];
+        Parser = MakeUnique<FOSMFile>();
+        Parser->bCollectNodeTags = bCollectNodeTags;
+        if(!Parser->LoadOpenStreetMapFile(File, false, Warn)) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to parse osm file %s"), *File)
+            return false;
+        }
+    } else {
+        Parser = LoadMerged(Filenames, bCollectNodeTags);
+        if(!Parser) {
+            return false;
+        }
+    }
+
+    if(Asset && !BuildFromParser(*Parser, Asset, Settings)) {
+        return false;
+    }
+    if(POIAsset) {
+        BuildPOIsFromParser(*Parser, POIAsset);
+    }
+    if(AreaAsset) {
+        BuildAreasFromParser(*Parser, AreaAsset);
+    }
+    return true;
+}
+
+bool FOSMDataAssetBuilder::BuildPOIsFromFiles(const TArray<FString>& Filenames, UOSMPOIDataAsset* Asset)
+{
+    return BuildWithExtracts(Filenames, nullptr, FOSMImportSettings(), Asset, nullptr);
+}
+
+bool FOSMDataAssetBuilder::BuildAreasFromFiles(const TArray<FString>& Filenames, UOSMAreaDataAsset* Asset)
+{
+    return BuildWithExtracts(Filenames, nullptr, FOSMImportSettings(), nullptr, Asset);
+}
+
+bool FOSMDataAssetBuilder::ReadFileList(const FString& ListFilename, TArray<FString>& OutFilenames)
+{
+    OutFilenames.Reset();
+    TArray<FString> Lines;
+    if(!FFileHelper::LoadFileToStringArray(Lines, *ListFilename)) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to read file list %s"), *ListFilename)
+        return false;
+    }
+    const FString BaseDirectory = FPaths::GetPath(ListFilename);
+    for(const FString& Line : Lines) {
+        const FString Entry = Line.TrimStartAndEnd();
+        if(Entry.IsEmpty() || Entry.StartsWith(TEXT("#"))) {
+            continue;
+        }
+        OutFilenames.Add(FPaths::IsRelative(Entry) ? FPaths::ConvertRelativePathToFull(BaseDirectory, Entry) : Entry);
+    }
+    return OutFilenames.Num() > 0;
+}
+
+void FOSMDataAssetBuilder::LoadFromFileAsync(const FString& Filename, const FOSMImportSettings& Settings, FOnOSMDataAssetLoaded OnLoaded)
+{
+    LoadAsync([Filename, Settings](UOSMDataAsset* Asset)
+    {
+        return BuildFromFile(Filename, Asset, Settings);
+    }, OnLoaded);
+}
+
+void FOSMDataAssetBuilder::LoadFromBufferAsync(TArray<uint8> Buffer, const FOSMImportSettings& Settings, FOnOSMDataAssetLoaded OnLoaded)
+{
+    LoadAsync([Buffer = MoveTemp(Buffer), Settings](UOSMDataAsset* Asset)
+    {
+        FString Text;
+        FFileHelper::BufferToString(Text, Buffer.GetData(), Buffer.Num());
+        return BuildFromBuffer(Text, Asset, Settings);
+    }, OnLoaded);
+}
+
+void FOSMDataAssetBuilder::LoadAsync(TFunction<bool(UOSMDataAsset*)> BuildFunction, FOnOSMDataAssetLoaded OnLoaded)
+{
+    check(IsInGameThread());
+
+    // objects can only be created safely on the game thread, the worker just fills the arrays.
+    // The strong pointer keeps the transient asset from being garbage collected while it is being built.
+    TSharedPtr<TStrongObjectPtr<UOSMDataAsset>, ESPMode::ThreadSafe> AssetPtr = MakeShared<TStrongObjectPtr<UOSMDataAsset>, ESPMode::ThreadSafe>(
+        NewObject<UOSMDataAsset>(GetTransientPackage(), NAME_None, RF_Transient));
+
+    Async(EAsyncExecution::ThreadPool, [AssetPtr, BuildFunction = MoveTemp(BuildFunction), OnLoaded]()
+    {
+        const bool bSuccess = BuildFunction(AssetPtr->Get());
+
+        AsyncTask(ENamedThreads::GameThread, [AssetPtr, OnLoaded, bSuccess]()
+        {
+            OnLoaded.ExecuteIfBound(bSuccess ? AssetPtr->Get() : nullptr);
+            AssetPtr->Reset();
+        });
+    });
+}
+
+void FOSMDataAssetBuilder::ReorderBuildings(UOSMDataAsset* Asset, const TArray<int32>& BuildingOrder, const TArray<int32>& MPBuildingOrder)
+{
+    // the graph is remapped before the arrays change, HasBuildingAdjacency compares it with their sizes
+    if(Asset->HasBuildingAdjacency()) {
+        Asset->BuildingAdjacency.Reorder(BuildingOrder, MPBuildingOrder);
+    } else {
+        Asset->BuildingAdjacency.Empty();
+    }
+    ReorderArray(Asset->Buildings, BuildingOrder);
+    if(Asset->BuildingAttributes.Num() > 0) {
+        Asset->BuildingAttributes.Reorder(BuildingOrder);
+    }
+    ReorderArray(Asset->MultiPolygonBuildings, MPBuildingOrder);
+    if(Asset->MultiPolygonBuildingAttributes.Num() > 0) {
+        Asset->MultiPolygonBuildingAttributes.Reorder(MPBuildingOrder);
+    }
+    Asset->UpdateBuildingLookups();
+}
+
+void FOSMDataAssetBuilder::BucketByBuildingType(UOSMDataAsset* Asset)
+{
+    ReorderBuildings(Asset, GetTypeOrder(Asset->Buildings), GetTypeOrder(Asset->MultiPolygonBuildings));
+}
+
+void FOSMDataAssetBuilder::SortByHilbertIndex(UOSMDataAsset* Asset)
+{
+    const int32 NumBuildings = Asset->Buildings.Num();
+    const int32 NumAll = NumBuildings + Asset->MultiPolygonBuildings.Num();
+
+    TArray<FCentroid> Centroids;
+    Centroids.SetNum(NumAll);
+    ParallelFor(NumAll, [&](int32 i)
+    {
+        TArray<FOSMGeoPoint> Points;
+        int64 SumX = 0;
+        int64 SumY = 0;
+        int32 Count = 0;
+        if(i < NumBuildings) {
+            Asset->ResolveCoordinates(Asset->Buildings[i], Points);
+            AccumulateVertices(Points, SumX, SumY, Count);
+        } else {
+            for(const FMPBuildingPart& Part : Asset->MultiPolygonBuildings[i - NumBuildings].Parts) {
+                if(!Part.bIsInner) {
+                    Asset->ResolveCoordinates(Part, Points);
+                    AccumulateVertices(Points, SumX, SumY, Count);
+                }
+            }
+        }
+        if(Count > 0) {
+            Centroids[i].X = SumX / (Count * FOSMGeoPoint::Scale);
+            Centroids[i].Y = SumY / (Count * FOSMGeoPoint::Scale);
+            Centroids[i].bIsValid = true;
+        }
+    });
+
+    // both arrays share one grid, buildings without vertices keep index 0 and move to the front
+    double MinX = TNumericLimits<double>::Max();
+    double MinY = TNumericLimits<double>::Max();
+    double MaxX = TNumericLimits<double>::Lowest();
+    double MaxY = TNumericLimits<double>::Lowest();
+    for(const FCentroid& Centroid : Centroids) {
+        if(Centroid.bIsValid) {
+            MinX = FMath::Min(MinX, Centroid.X);
+            MinY = FMath::Min(MinY, Centroid.Y);
+            MaxX = FMath::Max(MaxX, Centroid.X);
+            MaxY = FMath::Max(MaxY, Centroid.Y);
+        }
+    }
+    TArray<uint32> HilbertIndices;
+    HilbertIndices.SetNumZeroed(NumAll);
+    ParallelFor(NumAll, [&](int32 i)
+    {
+        if(Centroids[i].bIsValid) {
+            HilbertIndices[i] = FOSMHilbert::Encode(Centroids[i].X, Centroids[i].Y, MinX, MinY, MaxX - MinX, MaxY - MinY);
+        }
+    });
+
+    auto GetOrder = [&HilbertIndices](int32 First, int32 Num)
+    {
+        TArray<int32> Order;
+        Order.SetNumUninitialized(Num);
+        for(int32 i = 0; i < Num; i++) {
+            Order[i] = i;
+        }
+        // ties are broken by the old index, so the result does not depend on the sort algorithm
+        Algo::Sort(Order, [&HilbertIndices, First](int32 A, int32 B)
+        {
+            const uint32 IndexA = HilbertIndices[First + A];
+            const uint32 IndexB = HilbertIndices[First + B];
+            return IndexA != IndexB ? IndexA < IndexB : A < B;
+        });
+        return Order;
+    };
+    ReorderBuildings(Asset, GetOrder(0, NumBuildings), GetOrder(NumBuildings, NumAll - NumBuildings));
+}
+
+void FOSMDataAssetBuilder::OrderBuildings(UOSMDataAsset* Asset)
+{
+    const FOSMImportSettings& Settings = Asset->ImportSettings;
+    if(Settings.bSortByHilbertIndex) {
+        SortByHilbertIndex(Asset);
+    }
+    // bucketing is stable, so the Hilbert order is kept within each type
+    if(Settings.bBucketByBuildingType) {
+        BucketByBuildingType(Asset);
+    } else if(!Settings.bSortByHilbertIndex) {
+        // reordering updated the lookups already
+        Asset->UpdateBuildingLookups();
+    }
+    // imports of OSM files computed the graph from node IDs before and the orderings remapped it,
+    // other sources only have pool indices or coordinates to compare
+    if(!Settings.bComputeAdjacency) {
+        Asset->BuildingAdjacency.Empty();
+    } else if(!Asset->HasBuildingAdjacency()) {
+        Asset->UpdateBuildingAdjacency();
+    }
+}
+
+void FOSMDataAssetBuilder::ResolveBuildingHeights(UOSMDataAsset* Asset)
+{
+    for(FBuildingData& Building : Asset->Buildings) {
+        ResolveHeight(Building, Asset->ImportSettings);
+    }
+    for(FMPBuildingData& Building : Asset->MultiPolygonBuildings) {
+        ResolveHeight(Building, Asset->ImportSettings);
+    }
+}
+
+FOSMDataAssetChangeSet FOSMDataAssetBuilder::ApplyUpdate(UOSMDataAsset* Target, UOSMDataAsset* Source)
+{
+    FOSMDataAssetChangeSet Changes;
+    // compared in fixed point, so float rounding neither hides nor invents changes
+    TArray<FOSMGeoPoint> OldPoints;
+    TArray<FOSMGeoPoint> NewPoints;
+
+    TArray<int32> NewIndices;
+    TBitArray<> ModifiedSlots;
+    TArray<int32> AddedIndices;
+    DiffBuildings(Target->Buildings, Source->Buildings, [&](int32 OldIndex, int32 NewIndex)
+    {
+        const FBuildingData& Old = Target->Buildings[OldIndex];
+        const FBuildingData& New = Source->Buildings[NewIndex];
+        if(Old.BuildingType != New.BuildingType || Old.Height != New.Height || Old.Levels != New.Levels
+            || Old.HeightSource != New.HeightSource)
+        {
+            return false;
+        }
+        Target->GetBuildingCoordinates(OldIndex, OldPoints);
+        Source->GetBuildingCoordinates(NewIndex, NewPoints);
+        return OldPoints == NewPoints
+            && Target->GetBuildingAttributes(OldIndex) == Source->GetBuildingAttributes(NewIndex);
+    }, NewIndices, ModifiedSlots, AddedIndices, Changes.AddedBuildings, Changes.RemovedBuildings, Changes.ModifiedBuildings);
+
+    TArray<int32> MPNewIndices;
+    TBitArray<> MPModifiedSlots;
+    TArray<int32> MPAddedIndices;
+    DiffBuildings(Target->MultiPolygonBuildings, Source->MultiPolygonBuildings, [&](int32 OldIndex, int32 NewIndex)
+    {
+        const FMPBuildingData& Old = Target->MultiPolygonBuildings[OldIndex];
+        const FMPBuildingData& New = Source->MultiPolygonBuildings[NewIndex];
+        if(Old.BuildingType != New.BuildingType || Old.Height != New.Height || Old.Levels != New.Levels
+            || Old.HeightSource != New.HeightSource || Old.bHasHole != New.bHasHole || Old.Parts.Num() != New.Parts.Num())
+        {
+            return false;
+        }
+        for(int32 p = 0; p < Old.Parts.Num(); p++) {
+            if(Old.Parts[p].bIsInner != New.Parts[p].bIsInner) {
+                return false;
+            }
+            Target->GetMPBuildingPartCoordinates(OldIndex, p, OldPoints);
+            Source->GetMPBuildingPartCoordinates(NewIndex, p, NewPoints);
+            if(OldPoints != NewPoints) {
+                return false;
+            }
+        }
+        return Target->GetMPBuildingAttributes(OldIndex) == Source->GetMPBuildingAttributes(NewIndex);
+    }, MPNewIndices, MPModifiedSlots, MPAddedIndices, Changes.AddedMPBuildings, Changes.RemovedMPBuildings, Changes.ModifiedMPBuildings);
+
+    const TMap<int64, int32> OldSlots = GetSlots(Target->Buildings);
+    const TMap<int64, int32> OldMPSlots = GetSlots(Target->MultiPolygonBuildings);
+    const int32 OldNum = Target->Buildings.Num();
+    const int32 OldMPNum = Target->MultiPolygonBuildings.Num();
+
+    // vertices stored another way can't be mixed with those of Source, then every building is copied
+    const bool bSameStorage = Target->ImportSettings.bUseSharedVertexPool == Source->ImportSettings.bUseSharedVertexPool
+        && Target->ImportSettings.bUseFixedPointCoordinates == Source->ImportSettings.bUseFixedPointCoordinates;
+    if(!bSameStorage) {
+        Target->NodePositions.Empty();
+        Target->NodeCoordinates.Empty();
+    }
+    Target->ImportSettings = Source->ImportSettings;
+
+    // patch the changed slots only, pool vertices of copied buildings are appended to the pool of Target
+    TMap<int32, int32> CopiedIndices;
+    const TArray<int32> Slots = GetUpdatedSlots(NewIndices, AddedIndices);
+    const TBitArray<> ChangedSlots = GetChangedSlots(Slots, NewIndices, ModifiedSlots, !bSameStorage);
+    Target->Buildings.SetNum(Slots.Num());
+    for(int32 Slot = 0; Slot < Slots.Num(); Slot++) {
+        if(ChangedSlots[Slot]) {
+            FBuildingData& Building = Target->Buildings[Slot];
+            Building = Source->Buildings[Slots[Slot]];
+            CopyPoolVertices(Source, Target, Building, CopiedIndices);
+        }
+    }
+    PatchAttributes(Target->BuildingAttributes, OldNum, Source->BuildingAttributes, Slots, ChangedSlots,
+        [Source](int32 Index) { return Source->GetBuildingAttributes(Index); });
+
+    const TArray<int32> MPSlots = GetUpdatedSlots(MPNewIndices, MPAddedIndices);
+    const TBitArray<> MPChangedSlots = GetChangedSlots(MPSlots, MPNewIndices, MPModifiedSlots, !bSameStorage);
+    Target->MultiPolygonBuildings.SetNum(MPSlots.Num());
+    for(int32 Slot = 0; Slot < MPSlots.Num(); Slot++) {
+        if(MPChangedSlots[Slot]) {
+            FMPBuildingData& Building = Target->MultiPolygonBuildings[Slot];
+            Building = Source->MultiPolygonBuildings[MPSlots[Slot]];
+            for(FMPBuildingPart& Part : Building.Parts) {
+                CopyPoolVertices(Source, Target, Part, CopiedIndices);
+            }
+        }
+    }
+    PatchAttributes(Target->MultiPolygonBuildingAttributes, OldMPNum, Source->MultiPolygonBuildingAttributes, MPSlots, MPChangedSlots,
+        [Source](int32 Index) { return Source->GetMPBuildingAttributes(Index); });
+
+    // drops the vertices of removed and replaced footprints
+    CompactNodePool(Target);
+
+    // every slot holds a building of Source now, so its graph only needs to follow the slots
+    if(Source->HasBuildingAdjacency()) {
+        Target->BuildingAdjacency = Source->BuildingAdjacency;
+        Target->BuildingAdjacency.Reorder(Slots, MPSlots);
+    } else {
+        Target->BuildingAdjacency.Empty();
+    }
+
+    // slots are kept unless the asset is sorted or bucketed, then the orderings win
+    OrderBuildings(Target);
+    GetMovedBuildings(Target->Buildings, OldSlots, Changes.MovedBuildings);
+    GetMovedBuildings(Target->MultiPolygonBuildings, OldMPSlots, Changes.MovedMPBuildings);
+
+    Target->LastReimportChanges = Changes;
+    Target->OnBuildingsChanged.Broadcast(Target, Changes);
+    return Changes;
+}
+
+bool FOSMDataAssetBuilder::BuildFromParser(FOSMFile& Parser, UOSMDataAsset* Asset, const FOSMImportSettings& Settings)
+{
+    Asset->ImportSettings = Settings;
+
+    // node -> index into Asset->NodePositions or NodeCoordinates, only used with a shared vertex pool
+    TMap<const FOSMFile::FOSMNodeInfo*, int32> NodePoolIndices;
+
+    // node IDs of every ring for the adjacency, pool indices identify the nodes as well
+    const bool bCollectNodeIDs = Settings.bComputeAdjacency && !Settings.bUseSharedVertexPool;
+    TArray<TArray<int64>> RingNodeIDs;
+    TArray<TArray<int64>> MPRingNodeIDs;
+    auto AddRingNodeIDs = [](const TArray<FOSMFile::FOSMNodeInfo*>& Nodes, int32 NumNodes, TArray<TArray<int64>>& OutRings)
+    {
+        TArray<int64>& Ring = OutRings.AddDefaulted_GetRef();
+        Ring.Reserve(NumNodes);
+        for(int32 i = 0; i < NumNodes; i++) {
+            Ring.Add(FCString::Atoi64(*Nodes[i]->NodeID));
+        }
+    };
+
+    auto AddToPool = [&](const FOSMFile::FOSMNodeInfo* Node)
+    {
+        if(Settings.bUseFixedPointCoordinates) {
+            return Asset->NodeCoordinates.Add(FOSMGeoPoint::FromDegrees(Node->Longitude, Node->Latitude));
+        }
+        return Asset->NodePositions.Add(FVector(Node->Longitude, Node->Latitude, 0));
+    };
+
+    // Appends NumNodes nodes as positions, fixed point coordinates or indices into the shared pool
+    auto AddFootprint = [&](const TArray<FOSMFile::FOSMNodeInfo*>& Nodes, int32 NumNodes, FOSMFootprint& Footprint)
+    {
+        if(Settings.bUseSharedVertexPool) {
+            Footprint.PolygonIndices.Reserve(NumNodes);
+            for(int32 i = 0; i < NumNodes; i++) {
+                const FOSMFile::FOSMNodeInfo * Node = Nodes[i];
+                int32 * PoolIndex = NodePoolIndices.Find(Node);
+                if(!PoolIndex) {
+                    PoolIndex = &NodePoolIndices.Add(Node, AddToPool(Node));
+                }
+                Footprint.PolygonIndices.Add(*PoolIndex);
+            }
+        } else if(Settings.bUseFixedPointCoordinates) {
+            Footprint.PolygonCoordinates.Reserve(NumNodes);
+            for(int32 i = 0; i < NumNodes; i++) {
+                Footprint.PolygonCoordinates.Add(FOSMGeoPoint::FromDegrees(Nodes[i]->Longitude, Nodes[i]->Latitude));
+            }
+        } else {
+            Footprint.PolygonPoints.Reserve(NumNodes);
+            for(int32 i = 0; i < NumNodes; i++) {
+                Footprint.PolygonPoints.Add(FVector(Nodes[i]->Longitude, Nodes[i]->Latitude, 0));
+            }
+        }
+    };
+
+    // ways that are part of a relation are not imported a second time as simple buildings
+    TSet<FOSMFile::FOSMWayInfo*> RelationWays;
+
+    Asset->MultiPolygonBuildingAttributes.Reserve(Parser.Relations.Num());
+    Asset->BuildingAttributes.Reserve(Parser.Ways.Num());
+    if(Settings.bUseSharedVertexPool) {
+        NodePoolIndices.Reserve(Parser.NodeMap.Num());
+        if(Settings.bUseFixedPointCoordinates) {
+            Asset->NodeCoordinates.Reserve(Parser.NodeMap.Num());
+        } else {
+            Asset->NodePositions.Reserve(Parser.NodeMap.Num());
+        }
+    }
+
+    UE_LOG(LogTemp, Log, TEXT("FOSMDataAssetBuilder: %d Relations"), Parser.Relations.Num())
+    for(const auto Rel : Parser.Relations) {
+        // member ways carry no building tags of their own, so they are consumed even if the relation is broken
+        for(const auto m : Rel->Members) {
+            if(FOSMFile::FOSMWayInfo * Way = Parser.WayMap.FindRef(m->Ref)) {
+                RelationWays.Add(Way);
+            }
+        }
+        if(IsAreaOnly(*Rel)) {
+            continue;
+        }
+
+        TArray<FOSMRingAssembler::FRing> Rings;
+        if(!FOSMRingAssembler::Assemble(Parser, *Rel, Rings)) {
+            UE_LOG(LogTemp, Warning, TEXT("FOSMDataAssetBuilder: Skipping broken relation %s"), *Rel->RelationID)
+            continue;
+        }
+
+        FMPBuildingData Building;
+        Building.ID = FCString::Atoi64(*Rel->RelationID);
+        Building.BuildingType = Rel->BuildingType;
+        Building.Levels = Rel->BuildingLevels;
+        Building.Height = Rel->Height;
+        Building.HeightSource = Rel->Height > 0 ? EOSMHeightSource::HeightFromTag : EOSMHeightSource::HeightUnknown;
+        Building.bHasHole = 0;
+        for(const auto& Ring : Rings) {
+            FMPBuildingPart Part;
+            Part.bIsInner = Ring.bIsInner;
+            if(Part.bIsInner==1)
+                Building.bHasHole=1;
+            AddFootprint(Ring.Nodes, Ring.Nodes.Num(), Part);
+            if(bCollectNodeIDs) {
+                AddRingNodeIDs(Ring.Nodes, Ring.Nodes.Num(), MPRingNodeIDs);
+            }
+            Building.Parts.Add(Part);
+        }
+        Asset->MultiPolygonBuildings.Add(Building);
+        Asset->MultiPolygonBuildingAttributes.AddRow(ToAttributes(Rel->BuildingTags));
+    }
+
+    UE_LOG(LogTemp, Log, TEXT("FOSMDataAssetBuilder: %d Ways"), Parser.Ways.Num())
+    // clipped extracts cut thousands of ways at their border, they are only summed up
+    int32 NumIncompleteWays = 0;
+    for(const auto Way : Parser.Ways) {
+        if (Way) {
+            if(RelationWays.Contains(Way) || IsAreaOnly(*Way)) {
+                continue;
+            }
+            if(Way->bHasMissingNodes || Way->Nodes.Num() < 3) {
+                UE_LOG(LogTemp, Verbose, TEXT("FOSMDataAssetBuilder: Skipping incomplete way %s"), *Way->WayID)
+                NumIncompleteWays++;
+                continue;
+            }
+            FBuildingData Building;
+            Building.ID = FCString::Atoi64(*Way->WayID);
+            Building.BuildingType = Way->BuildingType;
+            Building.Height = Way->Height;
+            Building.HeightSource = Way->Height > 0 ? EOSMHeightSource::HeightFromTag : EOSMHeightSource::HeightUnknown;
+            // building:levels counts the storeys above ground, levels is its older and rarer spelling
+            Building.Levels = Way->BuildingLevels > 0 ? Way->BuildingLevels : Way->Levels;
+
+            // sometimes shapes are closed of with the first point, we dont need that
+            const FOSMFile::FOSMNodeInfo * First = Way->Nodes[0];
+            const FOSMFile::FOSMNodeInfo * Last = Way->Nodes.Last();
+            const bool bIsClosed = First == Last
+                || FVector(Last->Longitude, Last->Latitude, 0).Equals(FVector(First->Longitude, First->Latitude, 0));
+            AddFootprint(Way->Nodes, bIsClosed ? Way->Nodes.Num() - 1 : Way->Nodes.Num(), Building);
+            if(bCollectNodeIDs) {
+                AddRingNodeIDs(Way->Nodes, bIsClosed ? Way->Nodes.Num() - 1 : Way->Nodes.Num(), RingNodeIDs);
+            }
+
+            Asset->Buildings.Add(Building);
+            Asset->BuildingAttributes.AddRow(ToAttributes(Way->BuildingTags));
+        } else
+        {
+            UE_LOG(LogTemp, Warning, TEXT("FOSMDataAssetBuilder: Invalid Way"))
+        }
+    }
+    if(NumIncompleteWays > 0) {
+        UE_LOG(LogTemp, Warning, TEXT("FOSMDataAssetBuilder: Skipped %d incomplete ways"), NumIncompleteWays)
+    }
+
+    // computed before the orderings, which remap the graph
+    if(Settings.bComputeAdjacency) {
+        if(bCollectNodeIDs) {
+            RingNodeIDs.Append(MoveTemp(MPRingNodeIDs));
+            Asset->UpdateBuildingAdjacency(RingNodeIDs);
+        } else {
+            Asset->UpdateBuildingAdjacency();
+        }
+    }
+    ResolveBuildingHeights(Asset);
+    OrderBuildings(Asset);
+    return true;
+}
+
+bool FOSMDataAssetBuilder::BuildOutOfCore(const FString& Filename, UOSMDataAsset* Asset, const FOSMImportSettings& Settings)
+{
+    Asset->ImportSettings = Settings;
+    if(Settings.bUseSharedVertexPool) {
+        // a pool would need a map of all nodes in memory
+        UE_LOG(LogTemp, Warning, TEXT("FOSMDataAssetBuilder: Out of core imports store footprints per building, ignoring the shared vertex pool"))
+        Asset->ImportSettings.bUseSharedVertexPool = false;
+    }
+
+    // the budget is split between the sort buffers that are alive at the same time
+    const int64 Budget = FMath::Max(Settings.OutOfCoreMemoryMB, 64) * 1024ll * 1024ll;
+    const FString Directory = FPaths::Combine(FPlatformProcess::UserTempDir(), TEXT("OSMImport"), FGuid::NewGuid().ToString());
+    if(!IFileManager::Get().MakeDirectory(*Directory, true)) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to create temporary directory %s"), *Directory)
+        return false;
+    }
+    ON_SCOPE_EXIT
+    {
+        IFileManager::Get().DeleteDirectory(*Directory, false, true);
+    };
+
+    // member ways and relations that become multipolygon buildings, small enough to assemble in memory
+    FOSMFile Members;
+    TSet<int64> MemberWays;
+    TSet<int64> NeededWays;
+    if(!ReadRelations(Filename, Members, MemberWays, NeededWays)) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to read relations of %s"), *Filename)
+        return false;
+    }
+    UE_LOG(LogTemp, Log, TEXT("FOSMDataAssetBuilder: %d multipolygon relations with %d member ways"), Members.Relations.Num(), NeededWays.Num())
+
+    // second pass spills the nodes and the node references of all ways that are imported
+    TOSMExternalSorter<FSpilledNode, FSpilledNodeLess> Nodes(Directory, TEXT("Nodes"), Budget / 2);
+    TOSMExternalSorter<FSpilledNodeRef, FSpilledNodeRefLess> Refs(Directory, TEXT("Refs"), Budget / 2);
+    const FString WaysFilename = FPaths::Combine(Directory, TEXT("Ways.bin"));
+    int32 NumWays = 0;
+    {
+        TUniquePtr<FArchive> WayWriter(IFileManager::Get().CreateFileWriter(*WaysFilename));
+        FOSMXmlStream Stream;
+        if(!WayWriter || !Stream.Open(Filename)) {
+            return false;
+        }
+        FOSMFile::FOSMWayInfo Way;
+        int64 WayID = 0;
+        bool bIsInWay = false;
+        TArray<int64> WayRefs;
+        FString Key;
+        FString Value;
+        bool bSpilled = true;
+        while(bSpilled && Stream.Next()) {
+            if(Stream.IsElement("node")) {
+                FSpilledNode Node;
+                double Latitude;
+                double Longitude;
+                if(!Stream.IsEnd() && Stream.GetAttribute("id", Node.ID)
+                    && Stream.GetAttribute("lat", Latitude) && Stream.GetAttribute("lon", Longitude))
+                {
+                    const FOSMGeoPoint Point = FOSMGeoPoint::FromDegrees(Longitude, Latitude);
+                    Node.LongitudeE7 = Point.LongitudeE7;
+                    Node.LatitudeE7 = Point.LatitudeE7;
+                    bSpilled = Nodes.Add(Node);
+                }
+            } else if(Stream.IsElement("way")) {
+                if(!Stream.IsEnd()) {
+                    Way = FOSMFile::FOSMWayInfo();
+                    FOSMFile::InitWayInfo(Way);
+                    bIsInWay = Stream.GetAttribute("id", WayID);
+                    WayRefs.Reset();
+                    continue;
+                }
+                if(!bIsInWay) {
+                    continue;
+                }
+                bIsInWay = false;
+                // the same ways as BuildFromParser, ways with less nodes than a footprint or ring needs are dropped early
+                FSpilledWay Spilled;
+                Spilled.bIsMember = NeededWays.Contains(WayID);
+                const bool bIsBuilding = !MemberWays.Contains(WayID) && !IsAreaOnly(Way);
+                if((!Spilled.bIsMember && !bIsBuilding) || WayRefs.Num() < (Spilled.bIsMember ? 2 : 3)) {
+                    continue;
+                }
+                Spilled.ID = WayID;
+                Spilled.NumRefs = WayRefs.Num();
+                Spilled.BuildingType = Way.BuildingType;
+                Spilled.Height = Way.Height;
+                // building:levels counts the storeys above ground, levels is its older and rarer spelling
+                Spilled.Levels = Way.BuildingLevels > 0 ? Way.BuildingLevels : Way.Levels;
+                Spilled.Tags = MoveTemp(Way.BuildingTags);
+                *WayWriter << Spilled;
+                for(int32 i = 0; i < WayRefs.Num() && bSpilled; i++) {
+                    bSpilled = Refs.Add({WayRefs[i], NumWays, i});
+                }
+                NumWays++;
+            } else if(bIsInWay && !Stream.IsEnd()) {
+                int64 NodeRef;
+                if(Stream.IsElement("nd") && Stream.GetAttribute("ref", NodeRef)) {
+                    WayRefs.Add(NodeRef);
+                } else if(Stream.IsElement("tag") && Stream.GetAttribute("k", Key) && Stream.GetAttribute("v", Value)) {
+                    FOSMFile::DecodeWayTag(*Key, *Value, Way);
+                }
+            }
+        }
+        if(!bSpilled || Stream.IsError() || !WayWriter->Close()) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to spill %s to %s"), *Filename, *Directory)
+            return false;
+        }
+    }
+    UE_LOG(LogTemp, Log, TEXT("FOSMDataAssetBuilder: %lld nodes, %d ways with %lld node references"), Nodes.Num(), NumWays, Refs.Num())
+
+    // merge join, both sides are sorted by node ID. References to nodes missing from the file drop out here.
+    TOSMExternalSorter<FResolvedNodeRef, FResolvedNodeRefLess> Resolved(Directory, TEXT("Resolved"), Budget / 2);
+    {
+        if(!Nodes.Finish(Budget / 4) || !Refs.Finish(Budget / 4)) {
+            return false;
+        }
+        FSpilledNode Node;
+        bool bHasNode = Nodes.Next(Node);
+        FSpilledNodeRef Ref;
+        while(Refs.Next(Ref)) {
+            while(bHasNode && Node.ID < Ref.NodeID) {
+                bHasNode = Nodes.Next(Node);
+            }
+            if(bHasNode && Node.ID == Ref.NodeID
+                && !Resolved.Add({Ref.WayIndex, Ref.Sequence, Node.ID, Node.LongitudeE7, Node.LatitudeE7}))
+            {
+                return false;
+            }
+        }
+        if(Nodes.IsError() || Refs.IsError() || !Resolved.Finish(Budget / 2)) {
+            return false;
+        }
+    }
+
+    // ways come out in the order they were spilled, so the buildings keep the order of the file
+    TUniquePtr<FArchive> WayReader(IFileManager::Get().CreateFileReader(*WaysFilename));
+    if(!WayReader) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to read %s"), *WaysFilename)
+        return false;
+    }
+    auto AddFootprint = [&](const TArray<FOSMGeoPoint>& Points, int32 NumPoints, FOSMFootprint& Footprint)
+    {
+        if(Settings.bUseFixedPointCoordinates) {
+            Footprint.PolygonCoordinates.Append(Points.GetData(), NumPoints);
+        } else {
+            Footprint.PolygonPoints.Reserve(NumPoints);
+            for(int32 i = 0; i < NumPoints; i++) {
+                Footprint.PolygonPoints.Add(Points[i].ToVector());
+            }
+        }
+    };
+
+    // node IDs of every ring for the adjacency
+    TArray<TArray<int64>> RingNodeIDs;
+    TArray<TArray<int64>> MPRingNodeIDs;
+
+    FResolvedNodeRef Record;
+    bool bHasRecord = Resolved.Next(Record);
+    TArray<FOSMGeoPoint> Points;
+    TArray<int64> NodeIDs;
+    int32 NumIncompleteWays = 0;
+    for(int32 WayIndex = 0; WayIndex < NumWays; WayIndex++) {
+        FSpilledWay Way;
+        *WayReader << Way;
+        Points.Reset();
+        NodeIDs.Reset();
+        while(bHasRecord && Record.WayIndex == WayIndex) {
+            Points.Emplace(Record.LongitudeE7, Record.LatitudeE7);
+            NodeIDs.Add(Record.NodeID);
+            bHasRecord = Resolved.Next(Record);
+        }
+        const bool bHasMissingNodes = Points.Num() < Way.NumRefs;
+
+        if(Way.bIsMember) {
+            // rebuilt as parsed nodes and ways, the ring assembler matches shared nodes by pointer
+            auto * MemberWay = new FOSMFile::FOSMWayInfo();
+            FOSMFile::InitWayInfo(*MemberWay);
+            MemberWay->WayID = FString::Printf(TEXT("%lld"), Way.ID);
+            MemberWay->bHasMissingNodes = bHasMissingNodes;
+            for(int32 i = 0; i < Points.Num(); i++) {
+                const FString NodeID = FString::Printf(TEXT("%lld"), NodeIDs[i]);
+                FOSMFile::FOSMNodeInfo *& Node = Members.NodeMap.FindOrAdd(NodeID);
+                if(!Node) {
+                    Node = new FOSMFile::FOSMNodeInfo();
+                    Node->NodeID = NodeID;
+                    Node->Latitude = Points[i].GetLatitude();
+                    Node->Longitude = Points[i].GetLongitude();
+                }
+                MemberWay->Nodes.Add(Node);
+            }
+            Members.Ways.Add(MemberWay);
+            Members.WayMap.Add(MemberWay->WayID, MemberWay);
+            continue;
+        }
+
+        if(bHasMissingNodes || Points.Num() < 3) {
+            UE_LOG(LogTemp, Verbose, TEXT("FOSMDataAssetBuilder: Skipping incomplete way %lld"), Way.ID)
+            NumIncompleteWays++;
+            continue;
+        }
+        FBuildingData Building;
+        Building.ID = Way.ID;
+        Building.BuildingType = Way.BuildingType;
+        Building.Height = Way.Height;
+        Building.HeightSource = Way.Height > 0 ? EOSMHeightSource::HeightFromTag : EOSMHeightSource::HeightUnknown;
+        Building.Levels = Way.Levels;
+
+        // sometimes shapes are closed of with the first point, we dont need that
+        const bool bIsClosed = NodeIDs[0] == NodeIDs.Last()
+            || FVector(Points.Last().GetLongitude(), Points.Last().GetLatitude(), 0).Equals(FVector(Points[0].GetLongitude(), Points[0].GetLatitude(), 0));
+        AddFootprint(Points, bIsClosed ? Points.Num() - 1 : Points.Num(), Building);
+        if(Settings.bComputeAdjacency) {
+            RingNodeIDs.Emplace(NodeIDs.GetData(), bIsClosed ? NodeIDs.Num() - 1 : NodeIDs.Num());
+        }
+
+        Asset->Buildings.Add(Building);
+        Asset->BuildingAttributes.AddRow(ToAttributes(Way.Tags));
+    }
+    if(Resolved.IsError() || WayReader->IsError()) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMDataAssetBuilder: Failed to read back the ways of %s"), *Filename)
+        return false;
+    }
+    if(NumIncompleteWays > 0) {
+        UE_LOG(LogTemp, Warning, TEXT("FOSMDataAssetBuilder: Skipped %d incomplete ways"), NumIncompleteWays)
+    }
+    WayReader.Reset();
+
+    Asset->MultiPolygonBuildingAttributes.Reserve(Members.Relations.Num());
+    for(const auto Rel : Members.Relations) {
+        TArray<FOSMRingAssembler::FRing> Rings;
+        if(!FOSMRingAssembler::Assemble(Members, *Rel, Rings)) {
+            UE_LOG(LogTemp, Warning, TEXT("FOSMDataAssetBuilder: Skipping broken relation %s"), *Rel->RelationID)
+            continue;
+        }
+
+        FMPBuildingData Building;
+        Building.ID = FCString::Atoi64(*Rel->RelationID);
+        Building.BuildingType = Rel->BuildingType;
+        Building.Levels = Rel->BuildingLevels;
+        Building.Height = Rel->Height;
+        Building.HeightSource = Rel->Height > 0 ? EOSMHeightSource::HeightFromTag : EOSMHeightSource::HeightUnknown;
+        Building.bHasHole = 0;
+        for(const auto& Ring : Rings) {
+            FMPBuildingPart Part;
+            Part.bIsInner = Ring.bIsInner;
+            if(Part.bIsInner == 1) {
+                Building.bHasHole = 1;
+            }
+            Points.Reset(Ring.Nodes.Num());
+            NodeIDs.Reset(Ring.Nodes.Num());
+            for(const auto * Node : Ring.Nodes) {
+                Points.Add(FOSMGeoPoint::FromDegrees(Node->Longitude, Node->Latitude));
+                NodeIDs.Add(FCString::Atoi64(*Node->NodeID));
+            }
+            AddFootprint(Points, Points.Num(), Part);
+            if(Settings.bComputeAdjacency) {
+                MPRingNodeIDs.Add(NodeIDs);
+            }
+            Building.Parts.Add(Part);
+        }
+        Asset->MultiPolygonBuildings.Add(Building);
+        Asset->MultiPolygonBuildingAttributes.AddRow(ToAttributes(Rel->BuildingTags));
+    }
+    UE_LOG(LogTemp, Log, TEXT("FOSMDataAssetBuilder: %d buildings, %d multipolygon buildings"), Asset->Buildings.Num(), Asset->MultiPolygonBuildings.Num())
+
+    // computed before the orderings, which remap the graph
+    if(Settings.bComputeAdjacency) {
+        RingNodeIDs.Append(MoveTemp(MPRingNodeIDs));
+        Asset->UpdateBuildingAdjacency(RingNodeIDs);
+    }
+    ResolveBuildingHeights(Asset);
+    OrderBuildings(Asset);
+    return true;
+}
+
+void FOSMDataAssetBuilder::BuildPOIsFromParser(const FOSMFile& Parser, UOSMPOIDataAsset* Asset)
+{
+    Asset->Reset();
+    for(const auto& Entry : Parser.NodeMap) {
+        const FOSMFile::FOSMNodeInfo * Node = Entry.Value;
+        EOSMPOICategory Category;
+        if(!Node || !OSMTagParsing::ClassifyPOI(Node->Tags, Category)) {
+            continue;
+        }
+        Asset->AddPOI(FCString::Atoi64(*Node->NodeID), FOSMGeoPoint::FromDegrees(Node->Longitude, Node->Latitude), Category, Node->Tags);
+    }
+    Asset->BuildIndex();
+    UE_LOG(LogTemp, Log, TEXT("FOSMDataAssetBuilder: %d POIs, %d distinct strings"), Asset->NumPOIs(), Asset->Strings.Num())
+}
+
+void FOSMDataAssetBuilder::BuildAreasFromParser(const FOSMFile& Parser, UOSMAreaDataAsset* Asset)
+{
+    Asset->Areas.Reset();
+    auto AddRing = [](const TArray<FOSMFile::FOSMNodeInfo*>& Nodes, int32 NumNodes, bool bIsInner, FOSMAreaData& Area)
+    {
+        FMPBuildingPart& Ring = Area.Rings.AddDefaulted_GetRef();
+        Ring.bIsInner = bIsInner;
+        Ring.PolygonCoordinates.Reserve(NumNodes);
+        for(int32 i = 0; i < NumNodes; i++) {
+            Ring.PolygonCoordinates.Add(FOSMGeoPoint::FromDegrees(Nodes[i]->Longitude, Nodes[i]->Latitude));
+        }
+    };
+
+    // member ways of area relations are often untagged, but may carry their own area tags
+    TSet<FOSMFile::FOSMWayInfo*> RelationWays;
+    for(const auto Rel : Parser.Relations) {
+        if(!IsAreaOnly(*Rel)) {
+            continue;
+        }
+        TArray<FOSMRingAssembler::FRing> Rings;
+        if(!FOSMRingAssembler::Assemble(Parser, *Rel, Rings)) {
+            UE_LOG(LogTemp, Warning, TEXT("FOSMDataAssetBuilder: Skipping broken area relation %s"), *Rel->RelationID)
+            continue;
+        }
+        for(const auto m : Rel->Members) {
+            FOSMFile::FOSMWayInfo * Way = Parser.WayMap.FindRef(m->Ref);
+            if(Way && (!Way->bIsArea || Way->AreaType == Rel->AreaType)) {
+                RelationWays.Add(Way);
+            }
+        }
+
+        FOSMAreaData& Area = Asset->Areas.AddDefaulted_GetRef();
+        Area.ID = FCString::Atoi64(*Rel->RelationID);
+        Area.ElementType = EOSMElementType::RelationElement;
+        Area.AreaType = Rel->AreaType;
+        for(const auto& Ring : Rings) {
+            AddRing(Ring.Nodes, Ring.Nodes.Num(), Ring.bIsInner, Area);
+        }
+    }
+
+    for(const auto Way : Parser.Ways) {
+        if(!Way || !IsAreaOnly(*Way) || RelationWays.Contains(Way)) {
+            continue;
+        }
+        // areas have to be closed, open ways with area tags are usually lines like fences around them
+        if(Way->bHasMissingNodes || Way->Nodes.Num() < 4 || Way->Nodes[0] != Way->Nodes.Last()) {
+            continue;
+        }
+        FOSMAreaData& Area = Asset->Areas.AddDefaulted_GetRef();
+        Area.ID = FCString::Atoi64(*Way->WayID);
+        Area.ElementType = EOSMElementType::WayElement;
+        Area.AreaType = Way->AreaType;
+        AddRing(Way->Nodes, Way->Nodes.Num() - 1, false, Area);
+    }
+
+    Asset->BucketByAreaType();
+    UE_LOG(LogTemp, Log, TEXT("FOSMDataAssetBuilder: %d areas"), Asset->Areas.Num())
+}
@@ -0,0 +1,28 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMDataAssetLoadAction.h"
+
+#include "OSMDataAssetBuilder.h"
+
+UOSMDataAssetLoadAction* UOSMDataAssetLoadAction::LoadOSMDataAssetFromFile(UObject* WorldContextObject, const FString& Filename, const FOSMImportSettings& Settings)
+{
+    UOSMDataAssetLoadAction* Action = NewObject<UOSMDataAssetLoadAction>();
+    Action->Filename = Filename;
+    Action->Settings = Settings;
+    Action->RegisterWithGameInstance(WorldContextObject);
+    return Action;
+}
+
+void UOSMDataAssetLoadAction::Activate()
+{
+    FOSMDataAssetBuilder::LoadFromFileAsync(Filename, Settings, FOnOSMDataAssetLoaded::CreateUObject(this, &UOSMDataAssetLoadAction::HandleLoaded));
+}
+
+void UOSMDataAssetLoadAction::HandleLoaded(UOSMDataAsset* Asset)
+{
+    if(Asset) {
+        OnLoaded.Broadcast(Asset);
+    } else {
+        OnFailed.Broadcast(nullptr);
+    }
+    SetReadyToDestroy();
+}
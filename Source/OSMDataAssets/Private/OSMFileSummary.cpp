@@ -0,0 +1,160 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMFileSummary.h"
+
+#include "HAL/FileManager.h"
+
+namespace
+{
+    constexpr int64 ChunkSize = 4 * 1024 * 1024;
+    /** "<relation" and the character after it, a tag cut at the end of a chunk is carried over into the next one */
+    constexpr int64 MaxTagLength = 10;
+    /** <bounds> is part of the header, it is only looked for at the start of the file */
+    constexpr int64 HeaderLength = 64 * 1024;
+
+    // per element estimates of FOSMFile, including the map entries and heap allocated strings
+    constexpr int64 BytesPerNode = 160;
+    constexpr int64 BytesPerWay = 400;
+    constexpr int64 BytesPerRelation = 400;
+    constexpr double ParseBytesPerSecond = 50.0 * 1024 * 1024;
+
+    /** True if At, the character after '<', starts the element Name */
+    template<typename CharType>
+    FORCEINLINE bool MatchesElement(const CharType* At, const CharType* End, const ANSICHAR* Name)
+    {
+        for(; *Name; Name++, At++) {
+            if(At >= End || *At != *Name) {
+                return false;
+            }
+        }
+        return At < End && (*At == ' ' || *At == '\t' || *At == '\r' || *At == '\n' || *At == '>' || *At == '/');
+    }
+
+    /** Counts the elements opened before ScanEnd, Data has to extend MaxTagLength beyond unless it ends there */
+    template<typename CharType>
+    void CountElements(const CharType* Data, int64 ScanEnd, int64 Length, FOSMFileSummary& Summary)
+    {
+        const CharType* End = Data + Length;
+        for(int64 i = 0; i < ScanEnd; i++) {
+            if(Data[i] != '<') {
+                continue;
+            }
+            const CharType* Name = Data + i + 1;
+            if(MatchesElement(Name, End, "node")) {
+                Summary.NumNodes++;
+            } else if(MatchesElement(Name, End, "way")) {
+                Summary.NumWays++;
+            } else if(MatchesElement(Name, End, "relation")) {
+                Summary.NumRelations++;
+            }
+        }
+    }
+
+    /** Reads the double value of attribute Name between Begin and End */
+    template<typename CharType>
+    bool ParseAttribute(const CharType* Begin, const CharType* End, const ANSICHAR* Name, double& OutValue)
+    {
+        const int32 NameLength = FCStringAnsi::Strlen(Name);
+        for(const CharType* At = Begin; At + NameLength + 2 <= End; At++) {
+            int32 j = 0;
+            while(j < NameLength && At[j] == Name[j]) {
+                j++;
+            }
+            const CharType Quote = At[j + 1];
+            if(j < NameLength || At[j] != '=' || (Quote != '"' && Quote != '\'')) {
+                continue;
+            }
+            // Atod needs a terminated string
+            constexpr int32 MaxValueLength = 31;
+            ANSICHAR Value[MaxValueLength + 1];
+            int32 n = 0;
+            for(const CharType* V = At + j + 2; V < End && *V != Quote && n < MaxValueLength; V++) {
+                Value[n++] = static_cast<ANSICHAR>(*V);
+            }
+            Value[n] = 0;
+            OutValue = FCStringAnsi::Atod(Value);
+            return true;
+        }
+        return false;
+    }
+
+    template<typename CharType>
+    void ReadBounds(const CharType* Data, int64 Length, FOSMFileSummary& Summary)
+    {
+        const CharType* End = Data + Length;
+        for(int64 i = 0; i < Length; i++) {
+            if(Data[i] != '<' || !MatchesElement(Data + i + 1, End, "bounds")) {
+                continue;
+            }
+            const CharType* Begin = Data + i;
+            const CharType* Close = Begin;
+            while(Close < End && *Close != '>') {
+                Close++;
+            }
+            Summary.bHasBounds = ParseAttribute(Begin, Close, "minlat", Summary.MinLatitude)
+                && ParseAttribute(Begin, Close, "minlon", Summary.MinLongitude)
+                && ParseAttribute(Begin, Close, "maxlat", Summary.MaxLatitude)
+                && ParseAttribute(Begin, Close, "maxlon", Summary.MaxLongitude);
+            return;
+        }
+    }
+}
+
+bool FOSMFileSummary::ScanFile(const FString& Filename, FOSMFileSummary& OutSummary)
+{
+    OutSummary = FOSMFileSummary();
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+    if(!Reader) {
+        UE_LOG(LogTemp, Error, TEXT("FOSMFileSummary: Failed to open %s"), *Filename)
+        return false;
+    }
+    OutSummary.FileSize = Reader->TotalSize();
+
+    // the tags are plain ASCII, so the UTF-8 bytes can be scanned without decoding them
+    TArray<uint8> Buffer;
+    Buffer.SetNumUninitialized(FMath::Min(OutSummary.FileSize, ChunkSize) + MaxTagLength);
+    int64 Remaining = OutSummary.FileSize;
+    int64 Carry = 0;
+    bool bIsHeader = true;
+    while(Remaining > 0) {
+        const int64 Read = FMath::Min(Remaining, ChunkSize);
+        Reader->Serialize(Buffer.GetData() + Carry, Read);
+        if(Reader->IsError()) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMFileSummary: Failed to read %s"), *Filename)
+            return false;
+        }
+        Remaining -= Read;
+        const int64 Length = Carry + Read;
+        if(bIsHeader) {
+            ReadBounds(Buffer.GetData(), FMath::Min(Length, HeaderLength), OutSummary);
+            bIsHeader = false;
+        }
+        const int64 ScanEnd = Remaining > 0 ? FMath::Max<int64>(Length - MaxTagLength, 0) : Length;
+        CountElements(Buffer.GetData(), ScanEnd, Length, OutSummary);
+        Carry = Length - ScanEnd;
+        FMemory::Memmove(Buffer.GetData(), Buffer.GetData() + ScanEnd, Carry);
+    }
+    return true;
+}
+
+void FOSMFileSummary::ScanText(const TCHAR* Text, FOSMFileSummary& OutSummary)
+{
+    OutSummary = FOSMFileSummary();
+    const int64 Length = FCString::Strlen(Text);
+    OutSummary.FileSize = Length;
+    ReadBounds(Text, FMath::Min(Length, HeaderLength), OutSummary);
+    CountElements(Text, Length, Length, OutSummary);
+}
+
+int64 FOSMFileSummary::GetEstimatedMemory() const
+{
+    // the XML parser holds the whole file as TCHAR text
+    return FileSize * sizeof(TCHAR)
+        + NumNodes * BytesPerNode
+        + NumWays * BytesPerWay
+        + NumRelations * BytesPerRelation;
+}
+
+double FOSMFileSummary::GetEstimatedSeconds() const
+{
+    return FileSize / ParseBytesPerSecond;
+}
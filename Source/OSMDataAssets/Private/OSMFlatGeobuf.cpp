@@ -0,0 +1,1024 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMFlatGeobuf.h"
+
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "UObject/Class.h"
+#include "OSMDataAsset.h"
+#include "OSMDataAssetBuilder.h"
+#include "OSMFileParser.h"
+#include "OSMHilbert.h"
+#include "OSMPolygonValidity.h"
+#include "OSMTagParsing.h"
+
+namespace
+{
+    constexpr uint8 Magic[] = {'f', 'g', 'b', 3, 'f', 'g', 'b', 0};
+    constexpr int64 MagicSize = 8;
+    /** The header only holds the schema and a few scalars, anything larger is not a FlatGeobuf file */
+    constexpr uint32 MaxHeaderSize = 16 * 1024 * 1024;
+    constexpr uint32 MaxFeatureSize = 256 * 1024 * 1024;
+
+    // GeometryType values of the format schema
+    constexpr uint8 GeometryUnknown = 0;
+    constexpr uint8 GeometryPolygon = 3;
+    constexpr uint8 GeometryMultiPolygon = 6;
+
+    enum class EColumnType : uint8 { Byte, UByte, Bool, Short, UShort, Int, UInt, Long, ULong, Float, Double, String, Json, DateTime, Binary };
+
+    // field ids of the tables in header.fbs and feature.fbs
+    namespace HeaderField { enum : int32 { Name = 0, Envelope = 1, GeometryType = 2, Columns = 7, FeaturesCount = 8, IndexNodeSize = 9, Crs = 10 }; }
+    namespace ColumnField { enum : int32 { Name = 0, Type = 1 }; }
+    namespace FeatureField { enum : int32 { Geometry = 0, Properties = 1 }; }
+    namespace GeometryField { enum : int32 { Ends = 0, XY = 1, Type = 6, Parts = 7 }; }
+
+    /** Properties of a building feature */
+    enum EColumn : int32 { ColumnID, ColumnElementType, ColumnBuilding, ColumnHeight, ColumnLevels, NumColumns };
+    const TCHAR* const ColumnNames[NumColumns] = {TEXT("osm_id"), TEXT("osm_type"), TEXT("building"), TEXT("height"), TEXT("levels")};
+    const EColumnType ColumnTypes[NumColumns] = {EColumnType::Long, EColumnType::String, EColumnType::String, EColumnType::Double, EColumnType::Int};
+
+    /** Node of the packed R-tree in its on-disk layout */
+    struct FNodeItem
+    {
+        double MinX;
+        double MinY;
+        double MaxX;
+        double MaxY;
+        /** Byte offset of the feature relative to the feature section for leaves, index of the first child otherwise */
+        uint64 Offset;
+
+        static FNodeItem Empty()
+        {
+            return {TNumericLimits<double>::Max(), TNumericLimits<double>::Max(), TNumericLimits<double>::Lowest(), TNumericLimits<double>::Lowest(), 0};
+        }
+        void Expand(double X, double Y)
+        {
+            MinX = FMath::Min(MinX, X);
+            MinY = FMath::Min(MinY, Y);
+            MaxX = FMath::Max(MaxX, X);
+            MaxY = FMath::Max(MaxY, Y);
+        }
+        void Expand(const FNodeItem& Other)
+        {
+            Expand(Other.MinX, Other.MinY);
+            Expand(Other.MaxX, Other.MaxY);
+        }
+        bool Intersects(const FNodeItem& Other) const
+        {
+            return MinX <= Other.MaxX && MinY <= Other.MaxY && MaxX >= Other.MinX && MaxY >= Other.MinY;
+        }
+    };
+    static_assert(sizeof(FNodeItem) == 40, "FlatGeobuf index nodes are 40 bytes");
+
+    /** Node index ranges of the levels of a packed R-tree, leaves first. In the file the root comes first. */
+    TArray<TPair<uint64, uint64>> GetLevelBounds(uint64 NumItems, uint16 NodeSize)
+    {
+        TArray<uint64> LevelNumNodes;
+        uint64 N = NumItems;
+        uint64 NumNodes = N;
+        LevelNumNodes.Add(N);
+        do {
+            N = (N + NodeSize - 1) / NodeSize;
+            NumNodes += N;
+            LevelNumNodes.Add(N);
+        } while(N != 1);
+
+        TArray<TPair<uint64, uint64>> Levels;
+        for(const uint64 LevelSize : LevelNumNodes) {
+            NumNodes -= LevelSize;
+            Levels.Add(TPair<uint64, uint64>(NumNodes, NumNodes + LevelSize));
+        }
+        return Levels;
+    }
+
+    template<typename T>
+    void AppendBytes(TArray<uint8>& Bytes, const T& Value)
+    {
+        Bytes.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+    }
+
+    /**
+     * Minimal FlatBuffers writer for the few tables of the format. Tables are written front to back before the
+     * objects they reference, so references always point forward as FlatBuffers requires, and are linked once the
+     * referenced object exists. Like the reference builder, alignment is relative to the start of the size prefix.
+     */
+    class FFlatBufferWriter
+    {
+    public:
+        FFlatBufferWriter()
+        {
+            // size prefix and root reference
+            Buffer.AddZeroed(8);
+        }
+
+        template<typename T>
+        void Put(int32 Position, T Value)
+        {
+            FMemory::Memcpy(Buffer.GetData() + Position, &Value, sizeof(T));
+        }
+
+        /** Points the reference at Position to the object at Target */
+        void Link(int32 Position, int32 Target)
+        {
+            Put<uint32>(Position, Target - Position);
+        }
+
+        /**
+         * Writes a vtable followed by the zeroed inline part of a table and returns the table position.
+         * FieldOffsets holds the offset of each field inside the table, 0 for fields that are not set.
+         */
+        int32 BeginTable(std::initializer_list<uint16> FieldOffsets, uint16 InlineSize)
+        {
+            Pad(2);
+            const int32 VTable = Buffer.Num();
+            AppendBytes<uint16>(Buffer, 4 + 2 * FieldOffsets.size());
+            AppendBytes<uint16>(Buffer, InlineSize);
+            for(const uint16 FieldOffset : FieldOffsets) {
+                AppendBytes(Buffer, FieldOffset);
+            }
+            // 8 byte aligned so 64 bit fields can be placed at offsets that are multiples of 8
+            Pad(8);
+            const int32 Table = Buffer.Num();
+            Buffer.AddZeroed(InlineSize);
+            Put<int32>(Table, Table - VTable);
+            return Table;
+        }
+
+        int32 AddString(const FString& Value)
+        {
+            const FTCHARToUTF8 Utf8(*Value);
+            Pad(4);
+            const int32 Position = Buffer.Num();
+            AppendBytes<uint32>(Buffer, Utf8.Length());
+            Buffer.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+            Buffer.Add(0);
+            return Position;
+        }
+
+        template<typename T>
+        int32 AddVector(const T* Data, int32 Num)
+        {
+            // the elements follow the length and are aligned to their own size
+            Pad(FMath::Max<int32>(sizeof(T), 4), 4);
+            const int32 Position = Buffer.Num();
+            AppendBytes<uint32>(Buffer, Num);
+            Buffer.Append(reinterpret_cast<const uint8*>(Data), Num * sizeof(T));
+            return Position;
+        }
+
+        /** Reserves a vector of Num references, element i is linked at Position + 4 + 4 * i */
+        int32 AddReferenceVector(int32 Num)
+        {
+            Pad(4);
+            const int32 Position = Buffer.Num();
+            AppendBytes<uint32>(Buffer, Num);
+            Buffer.AddZeroed(4 * Num);
+            return Position;
+        }
+
+        /** Links the root and fills in the size prefix, the result is the size prefixed buffer */
+        TArray<uint8> Finish(int32 Root)
+        {
+            Pad(8);
+            Link(4, Root);
+            Put<uint32>(0, Buffer.Num() - 4);
+            return MoveTemp(Buffer);
+        }
+
+    private:
+        /** Pads so that Buffer.Num() + Offset is a multiple of Alignment */
+        void Pad(int32 Alignment, int32 Offset = 0)
+        {
+            while((Buffer.Num() + Offset) % Alignment != 0) {
+                Buffer.Add(0);
+            }
+        }
+
+        TArray<uint8> Buffer;
+    };
+
+    /** Bounds checked access to the tables of a FlatBuffers buffer, positions are relative to its root reference */
+    class FFlatBufferReader
+    {
+    public:
+        FFlatBufferReader(const uint8* InData, int64 InSize)
+            : Data(InData)
+            , Size(InSize)
+        {
+        }
+
+        template<typename T>
+        bool Read(int64 Position, T& OutValue) const
+        {
+            if(Position < 0 || Position + static_cast<int64>(sizeof(T)) > Size) {
+                return false;
+            }
+            FMemory::Memcpy(&OutValue, Data + Position, sizeof(T));
+            return true;
+        }
+
+        /** Follows the reference stored at Position */
+        bool Dereference(int64 Position, int64& OutTarget) const
+        {
+            uint32 Offset;
+            if(!Read(Position, Offset)) {
+                return false;
+            }
+            OutTarget = Position + Offset;
+            return OutTarget < Size;
+        }
+
+        /** Position of field Id of Table, INDEX_NONE if the field is not set */
+        int64 GetField(int64 Table, int32 Id) const
+        {
+            int32 VTableOffset;
+            uint16 VTableSize;
+            uint16 FieldOffset;
+            if(!Read(Table, VTableOffset)) {
+                return INDEX_NONE;
+            }
+            const int64 VTable = Table - VTableOffset;
+            const int64 Entry = 4 + 2 * Id;
+            if(!Read(VTable, VTableSize) || Entry + 2 > VTableSize || !Read(VTable + Entry, FieldOffset) || FieldOffset == 0) {
+                return INDEX_NONE;
+            }
+            return Table + FieldOffset;
+        }
+
+        template<typename T>
+        T GetScalar(int64 Table, int32 Id, T Default) const
+        {
+            const int64 Field = GetField(Table, Id);
+            T Value;
+            return Field != INDEX_NONE && Read(Field, Value) ? Value : Default;
+        }
+
+        /** Table, string or vector referenced by field Id */
+        bool GetReference(int64 Table, int32 Id, int64& OutTarget) const
+        {
+            const int64 Field = GetField(Table, Id);
+            return Field != INDEX_NONE && Dereference(Field, OutTarget);
+        }
+
+        /** Position of the first element and element count of the vector referenced by field Id */
+        bool GetVector(int64 Table, int32 Id, int64 ElementSize, int64& OutFirst, uint32& OutNum) const
+        {
+            int64 Vector;
+            if(!GetReference(Table, Id, Vector) || !Read(Vector, OutNum)) {
+                return false;
+            }
+            OutFirst = Vector + 4;
+            return OutFirst + OutNum * ElementSize <= Size;
+        }
+
+        FString ReadString(int64 Position, int64 Length) const
+        {
+            const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Data + Position), static_cast<int32>(Length));
+            return FString(Converted.Length(), Converted.Get());
+        }
+
+        bool GetString(int64 Table, int32 Id, FString& OutString) const
+        {
+            int64 First;
+            uint32 Num;
+            if(!GetVector(Table, Id, 1, First, Num)) {
+                return false;
+            }
+            OutString = ReadString(First, Num);
+            return true;
+        }
+
+    private:
+        const uint8* Data;
+        int64 Size;
+    };
+
+    TArray<uint8> EncodeHeader(const FNodeItem& Extent, uint64 NumFeatures)
+    {
+        const bool bHasFeatures = NumFeatures > 0;
+        FFlatBufferWriter Writer;
+        // name, envelope, geometry_type, has_z/m/t/tm, columns, features_count, index_node_size, crs
+        const int32 Header = Writer.BeginTable({4, static_cast<uint16>(bHasFeatures ? 16 : 0), 30, 0, 0, 0, 0, 20, 8, 28, 24}, 32);
+        Writer.Put<uint64>(Header + 8, NumFeatures);
+        // the index is omitted for empty files, which the format marks with a node size of 0
+        Writer.Put<uint16>(Header + 28, bHasFeatures ? FOSMFlatGeobuf::IndexNodeSize : 0);
+        Writer.Put<uint8>(Header + 30, GeometryMultiPolygon);
+        Writer.Link(Header + 4, Writer.AddString(TEXT("buildings")));
+        if(bHasFeatures) {
+            const double Envelope[] = {Extent.MinX, Extent.MinY, Extent.MaxX, Extent.MaxY};
+            Writer.Link(Header + 16, Writer.AddVector(Envelope, 4));
+        }
+
+        const int32 Columns = Writer.AddReferenceVector(NumColumns);
+        Writer.Link(Header + 20, Columns);
+        for(int32 i = 0; i < NumColumns; i++) {
+            const int32 Column = Writer.BeginTable({4, 8}, 12);
+            Writer.Link(Columns + 4 + 4 * i, Column);
+            Writer.Put<uint8>(Column + 8, static_cast<uint8>(ColumnTypes[i]));
+            Writer.Link(Column + 4, Writer.AddString(ColumnNames[i]));
+        }
+
+        const int32 Crs = Writer.BeginTable({4, 8}, 12);
+        Writer.Link(Header + 24, Crs);
+        Writer.Put<int32>(Crs + 8, 4326);
+        Writer.Link(Crs + 4, Writer.AddString(TEXT("EPSG")));
+        return Writer.Finish(Header);
+    }
+
+    template<typename T>
+    void AddProperty(TArray<uint8>& Properties, EColumn Column, T Value)
+    {
+        AppendBytes<uint16>(Properties, Column);
+        AppendBytes(Properties, Value);
+    }
+
+    void AddProperty(TArray<uint8>& Properties, EColumn Column, const FString& Value)
+    {
+        const FTCHARToUTF8 Utf8(*Value);
+        AppendBytes<uint16>(Properties, Column);
+        AppendBytes<uint32>(Properties, Utf8.Length());
+        Properties.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+    }
+
+    /**
+     * Encodes building Index of Asset, indices past Buildings address MultiPolygonBuildings. Holes go to the first
+     * outer ring containing them. Returns false for buildings without a valid outer ring.
+     */
+    bool EncodeBuilding(const UOSMDataAsset& Asset, int32 Index, const TArray<FString>& TypeNames, TArray<uint8>& OutFeature, FNodeItem& OutBox)
+    {
+        TArray<uint8> Properties;
+        // rings of all polygons, each outer ring followed by its holes
+        TArray<TArray<FOSMGeoPoint>> Rings;
+        TArray<int32> PolygonNumRings;
+        auto HasTooFewVertices = [](const TArray<FOSMGeoPoint>& Ring) { return Ring.Num() < 3; };
+
+        if(Index < Asset.Buildings.Num()) {
+            const FBuildingData& Building = Asset.Buildings[Index];
+            Asset.ResolveCoordinates(Building, Rings.AddDefaulted_GetRef());
+            if(HasTooFewVertices(Rings[0])) {
+                return false;
+            }
+            PolygonNumRings.Add(1);
+            AddProperty<int64>(Properties, ColumnID, Building.ID);
+            AddProperty(Properties, ColumnElementType, FString(TEXT("way")));
+            AddProperty(Properties, ColumnBuilding, TypeNames[Building.BuildingType]);
+            AddProperty<double>(Properties, ColumnHeight, Building.Height);
+            AddProperty<int32>(Properties, ColumnLevels, Building.Levels);
+        } else {
+            const FMPBuildingData& Building = Asset.MultiPolygonBuildings[Index - Asset.Buildings.Num()];
+            TArray<TArray<FOSMGeoPoint>> Outers;
+            TArray<TArray<FOSMGeoPoint>> Holes;
+            for(const FMPBuildingPart& Part : Building.Parts) {
+                Asset.ResolveCoordinates(Part, (Part.bIsInner ? Holes : Outers).AddDefaulted_GetRef());
+            }
+            Outers.RemoveAll(HasTooFewVertices);
+            Holes.RemoveAll(HasTooFewVertices);
+            if(Outers.Num() == 0) {
+                return false;
+            }
+            TArray<TArray<int32>> HolesOfOuter;
+            HolesOfOuter.SetNum(Outers.Num());
+            for(int32 h = 0; h < Holes.Num(); h++) {
+                const int32 Outer = Outers.IndexOfByPredicate([&](const TArray<FOSMGeoPoint>& Ring) { return FOSMPolygonValidity::IsInside(Holes[h][0], Ring); });
+                HolesOfOuter[FMath::Max(Outer, 0)].Add(h);
+            }
+            for(int32 o = 0; o < Outers.Num(); o++) {
+                Rings.Add(MoveTemp(Outers[o]));
+                for(const int32 h : HolesOfOuter[o]) {
+                    Rings.Add(MoveTemp(Holes[h]));
+                }
+                PolygonNumRings.Add(1 + HolesOfOuter[o].Num());
+            }
+            AddProperty<int64>(Properties, ColumnID, Building.ID);
+            AddProperty(Properties, ColumnElementType, FString(TEXT("relation")));
+            AddProperty(Properties, ColumnBuilding, TypeNames[Building.BuildingType]);
+            AddProperty<double>(Properties, ColumnHeight, Building.Height);
+            AddProperty<int32>(Properties, ColumnLevels, Building.Levels);
+        }
+
+        FFlatBufferWriter Writer;
+        const int32 Feature = Writer.BeginTable({4, 8}, 12);
+        // the header declares MultiPolygon, so only the parts are set on the feature geometry
+        const int32 Geometry = Writer.BeginTable({0, 0, 0, 0, 0, 0, 0, 4}, 8);
+        Writer.Link(Feature + 4, Geometry);
+        Writer.Link(Feature + 8, Writer.AddVector(Properties.GetData(), Properties.Num()));
+        const int32 Parts = Writer.AddReferenceVector(PolygonNumRings.Num());
+        Writer.Link(Geometry + 4, Parts);
+
+        OutBox = FNodeItem::Empty();
+        TArray<double> XY;
+        TArray<uint32> Ends;
+        int32 Ring = 0;
+        for(int32 p = 0; p < PolygonNumRings.Num(); p++) {
+            XY.Reset();
+            Ends.Reset();
+            for(int32 r = 0; r < PolygonNumRings[p]; r++, Ring++) {
+                // rings are closed explicitly in the format
+                for(int32 v = 0; v <= Rings[Ring].Num(); v++) {
+                    const FOSMGeoPoint& Point = Rings[Ring][v % Rings[Ring].Num()];
+                    XY.Add(Point.GetLongitude());
+                    XY.Add(Point.GetLatitude());
+                    OutBox.Expand(Point.GetLongitude(), Point.GetLatitude());
+                }
+                Ends.Add(XY.Num() / 2);
+            }
+            // ends can be left out for a single ring
+            const bool bHasEnds = Ends.Num() > 1;
+            const int32 Polygon = Writer.BeginTable({static_cast<uint16>(bHasEnds ? 4 : 0), 8}, 12);
+            Writer.Link(Parts + 4 + 4 * p, Polygon);
+            if(bHasEnds) {
+                Writer.Link(Polygon + 4, Writer.AddVector(Ends.GetData(), Ends.Num()));
+            }
+            Writer.Link(Polygon + 8, Writer.AddVector(XY.GetData(), XY.Num()));
+        }
+        OutFeature = Writer.Finish(Feature);
+        return true;
+    }
+
+    /** Column layout of a file, mapped to the building properties */
+    struct FFileLayout
+    {
+        uint8 GeometryType = GeometryUnknown;
+        uint64 NumFeatures = 0;
+        uint16 NodeSize = 0;
+        TArray<EColumnType> ColumnTypes;
+        /** EColumn of each file column, INDEX_NONE for columns that are ignored */
+        TArray<int32> Columns;
+    };
+
+    bool ParseHeader(const TArray<uint8>& Data, FFileLayout& OutLayout)
+    {
+        const FFlatBufferReader Reader(Data.GetData(), Data.Num());
+        int64 Header;
+        if(!Reader.Dereference(0, Header)) {
+            return false;
+        }
+        OutLayout.GeometryType = Reader.GetScalar<uint8>(Header, HeaderField::GeometryType, GeometryUnknown);
+        OutLayout.NumFeatures = Reader.GetScalar<uint64>(Header, HeaderField::FeaturesCount, 0);
+        OutLayout.NodeSize = Reader.GetScalar<uint16>(Header, HeaderField::IndexNodeSize, 16);
+
+        int64 First;
+        uint32 Num;
+        if(!Reader.GetVector(Header, HeaderField::Columns, 4, First, Num)) {
+            return true;
+        }
+        for(uint32 i = 0; i < Num; i++) {
+            int64 Column;
+            FString Name;
+            if(!Reader.Dereference(First + 4 * i, Column) || !Reader.GetString(Column, ColumnField::Name, Name)) {
+                return false;
+            }
+            OutLayout.ColumnTypes.Add(static_cast<EColumnType>(Reader.GetScalar<uint8>(Column, ColumnField::Type, 0)));
+            int32 Known = INDEX_NONE;
+            for(int32 c = 0; c < NumColumns; c++) {
+                if(Name.Equals(ColumnNames[c], ESearchCase::IgnoreCase)) {
+                    Known = c;
+                }
+            }
+            // the OSM key, as written by GDAL and osmium exports
+            if(Name.Equals(TEXT("building:levels"), ESearchCase::IgnoreCase)) {
+                Known = ColumnLevels;
+            }
+            OutLayout.Columns.Add(Known);
+        }
+        return true;
+    }
+
+    /** A feature read from a file, rings are not closed and each outer ring is followed by its holes */
+    struct FDecodedFeature
+    {
+        int64 ID = 0;
+        bool bHasElementType = false;
+        EOSMElementType ElementType = EOSMElementType::WayElement;
+        EOSMBuildingType BuildingType = EOSMBuildingType::OtherBuilding;
+        float Height = 0.f;
+        int32 Levels = 0;
+        TArray<TArray<FOSMGeoPoint>> Rings;
+        TArray<bool> IsInner;
+        FNodeItem Box = FNodeItem::Empty();
+    };
+
+    int64 GetValueSize(EColumnType Type)
+    {
+        switch(Type) {
+        case EColumnType::Byte:
+        case EColumnType::UByte:
+        case EColumnType::Bool:
+            return 1;
+        case EColumnType::Short:
+        case EColumnType::UShort:
+            return 2;
+        case EColumnType::Int:
+        case EColumnType::UInt:
+        case EColumnType::Float:
+            return 4;
+        case EColumnType::Long:
+        case EColumnType::ULong:
+        case EColumnType::Double:
+            return 8;
+        default:
+            // length prefixed
+            return INDEX_NONE;
+        }
+    }
+
+    template<typename T>
+    double ReadAs(const FFlatBufferReader& Reader, int64 Position)
+    {
+        T Value = 0;
+        Reader.Read(Position, Value);
+        return static_cast<double>(Value);
+    }
+
+    double ReadNumber(const FFlatBufferReader& Reader, int64 Position, EColumnType Type)
+    {
+        switch(Type) {
+        case EColumnType::Byte: return ReadAs<int8>(Reader, Position);
+        case EColumnType::UByte:
+        case EColumnType::Bool: return ReadAs<uint8>(Reader, Position);
+        case EColumnType::Short: return ReadAs<int16>(Reader, Position);
+        case EColumnType::UShort: return ReadAs<uint16>(Reader, Position);
+        case EColumnType::Int: return ReadAs<int32>(Reader, Position);
+        case EColumnType::UInt: return ReadAs<uint32>(Reader, Position);
+        case EColumnType::Long: return ReadAs<int64>(Reader, Position);
+        case EColumnType::ULong: return ReadAs<uint64>(Reader, Position);
+        case EColumnType::Float: return ReadAs<float>(Reader, Position);
+        case EColumnType::Double: return ReadAs<double>(Reader, Position);
+        default: return 0.0;
+        }
+    }
+
+    /** Our own files store the EOSMBuildingType name, other files usually the value of the OSM building tag */
+    EOSMBuildingType ParseBuildingType(const FString& Value)
+    {
+        const int64 Type = StaticEnum<EOSMBuildingType>()->GetValueByNameString(Value);
+        if(Type != INDEX_NONE) {
+            return static_cast<EOSMBuildingType>(Type);
+        }
+        EOSMBuildingType BuildingType;
+        FOSMFile::DecodeBuildingType(*Value, BuildingType);
+        return BuildingType;
+    }
+
+    void ApplyProperty(const FFlatBufferReader& Reader, int64 Position, int64 Length, EColumnType Type, int32 Column, FDecodedFeature& Out)
+    {
+        const bool bIsText = GetValueSize(Type) == INDEX_NONE;
+        const FString Text = bIsText ? Reader.ReadString(Position, Length) : FString();
+        switch(Column) {
+        case ColumnID:
+            if(Type == EColumnType::Long || Type == EColumnType::ULong) {
+                Reader.Read(Position, Out.ID);
+            } else {
+                Out.ID = bIsText ? FCString::Atoi64(*Text) : static_cast<int64>(ReadNumber(Reader, Position, Type));
+            }
+            break;
+        case ColumnElementType:
+            Out.bHasElementType = bIsText;
+            Out.ElementType = Text.Equals(TEXT("relation"), ESearchCase::IgnoreCase) ? EOSMElementType::RelationElement : EOSMElementType::WayElement;
+            break;
+        case ColumnBuilding:
+            if(bIsText) {
+                Out.BuildingType = ParseBuildingType(Text);
+            }
+            break;
+        case ColumnHeight:
+            if(bIsText) {
+                OSMTagParsing::ParseLength(*Text, Out.Height);
+            } else {
+                Out.Height = static_cast<float>(ReadNumber(Reader, Position, Type));
+            }
+            break;
+        case ColumnLevels:
+            Out.Levels = bIsText ? FCString::Atoi(*Text) : static_cast<int32>(ReadNumber(Reader, Position, Type));
+            break;
+        default:
+            break;
+        }
+    }
+
+    bool ReadProperties(const FFlatBufferReader& Reader, int64 First, uint32 Num, const FFileLayout& Layout, FDecodedFeature& Out)
+    {
+        const int64 End = First + Num;
+        int64 Position = First;
+        while(Position + 2 <= End) {
+            uint16 Column;
+            Reader.Read(Position, Column);
+            Position += 2;
+            if(Column >= Layout.ColumnTypes.Num()) {
+                return false;
+            }
+            const EColumnType Type = Layout.ColumnTypes[Column];
+            int64 ValueSize = GetValueSize(Type);
+            if(ValueSize == INDEX_NONE) {
+                uint32 Length;
+                if(!Reader.Read(Position, Length)) {
+                    return false;
+                }
+                Position += 4;
+                ValueSize = Length;
+            }
+            if(Position + ValueSize > End) {
+                return false;
+            }
+            if(Layout.Columns[Column] != INDEX_NONE) {
+                ApplyProperty(Reader, Position, ValueSize, Type, Layout.Columns[Column], Out);
+            }
+            Position += ValueSize;
+        }
+        return true;
+    }
+
+    /** Appends the rings of a polygon geometry, the first ring is the outer one */
+    bool ReadPolygon(const FFlatBufferReader& Reader, int64 Geometry, FDecodedFeature& Out)
+    {
+        int64 XYFirst;
+        uint32 NumCoordinates;
+        if(!Reader.GetVector(Geometry, GeometryField::XY, 8, XYFirst, NumCoordinates)) {
+            return false;
+        }
+        const uint32 NumVertices = NumCoordinates / 2;
+        TArray<uint32> Ends;
+        int64 EndsFirst;
+        uint32 NumEnds;
+        if(Reader.GetVector(Geometry, GeometryField::Ends, 4, EndsFirst, NumEnds) && NumEnds > 0) {
+            Ends.SetNumUninitialized(NumEnds);
+            for(uint32 i = 0; i < NumEnds; i++) {
+                Reader.Read(EndsFirst + 4 * i, Ends[i]);
+            }
+        } else {
+            Ends.Add(NumVertices);
+        }
+
+        uint32 Start = 0;
+        for(int32 r = 0; r < Ends.Num(); r++) {
+            const uint32 End = FMath::Min(Ends[r], NumVertices);
+            TArray<FOSMGeoPoint> Ring;
+            for(uint32 v = Start; v < End; v++) {
+                double X = 0.0;
+                double Y = 0.0;
+                Reader.Read(XYFirst + 16 * v, X);
+                Reader.Read(XYFirst + 16 * v + 8, Y);
+                Ring.Add(FOSMGeoPoint::FromDegrees(X, Y));
+                Out.Box.Expand(X, Y);
+            }
+            Start = FMath::Max(Start, End);
+            if(Ring.Num() > 1 && Ring[0] == Ring.Last()) {
+                Ring.Pop();
+            }
+            if(Ring.Num() >= 3) {
+                Out.Rings.Add(MoveTemp(Ring));
+                Out.IsInner.Add(r > 0);
+            }
+        }
+        return true;
+    }
+
+    bool DecodeFeature(const TArray<uint8>& Data, const FFileLayout& Layout, FDecodedFeature& Out)
+    {
+        const FFlatBufferReader Reader(Data.GetData(), Data.Num());
+        int64 Feature;
+        int64 Geometry;
+        if(!Reader.Dereference(0, Feature) || !Reader.GetReference(Feature, FeatureField::Geometry, Geometry)) {
+            return false;
+        }
+        // files with mixed geometries declare Unknown in the header and the type on every feature
+        uint8 GeometryType = Layout.GeometryType;
+        if(GeometryType == GeometryUnknown) {
+            GeometryType = Reader.GetScalar<uint8>(Geometry, GeometryField::Type, GeometryUnknown);
+        }
+        if(GeometryType == GeometryPolygon) {
+            if(!ReadPolygon(Reader, Geometry, Out)) {
+                return false;
+            }
+        } else if(GeometryType == GeometryMultiPolygon) {
+            int64 First;
+            uint32 Num;
+            if(!Reader.GetVector(Geometry, GeometryField::Parts, 4, First, Num)) {
+                return false;
+            }
+            for(uint32 i = 0; i < Num; i++) {
+                int64 Part;
+                if(!Reader.Dereference(First + 4 * i, Part) || !ReadPolygon(Reader, Part, Out)) {
+                    return false;
+                }
+            }
+        } else {
+            return false;
+        }
+
+        int64 PropertiesFirst;
+        uint32 NumProperties;
+        if(Reader.GetVector(Feature, FeatureField::Properties, 1, PropertiesFirst, NumProperties)
+            && !ReadProperties(Reader, PropertiesFirst, NumProperties, Layout, Out)) {
+            return false;
+        }
+        return Out.Rings.Num() > 0;
+    }
+
+    void SetVertices(TArray<FOSMGeoPoint>&& Ring, bool bFixedPoint, FOSMFootprint& OutFootprint)
+    {
+        if(bFixedPoint) {
+            OutFootprint.PolygonCoordinates = MoveTemp(Ring);
+        } else {
+            OutFootprint.PolygonPoints.Reserve(Ring.Num());
+            for(const FOSMGeoPoint& Point : Ring) {
+                OutFootprint.PolygonPoints.Add(Point.ToVector());
+            }
+        }
+    }
+
+    template<typename TBuilding>
+    void SetProperties(const FDecodedFeature& Feature, TBuilding& OutBuilding)
+    {
+        OutBuilding.ID = Feature.ID;
+        OutBuilding.BuildingType = Feature.BuildingType;
+        OutBuilding.Height = Feature.Height;
+        OutBuilding.Levels = Feature.Levels;
+        // estimated heights are resolved again after reading
+        OutBuilding.HeightSource = Feature.Height > 0.f ? EOSMHeightSource::HeightFromTag : EOSMHeightSource::HeightUnknown;
+    }
+
+    /** Single polygons without holes become buildings, everything else multipolygon buildings */
+    void AddToAsset(FDecodedFeature&& Feature, bool bFixedPoint, UOSMDataAsset* Asset)
+    {
+        const bool bIsRelation = Feature.bHasElementType && Feature.ElementType == EOSMElementType::RelationElement;
+        if(Feature.Rings.Num() == 1 && !bIsRelation) {
+            FBuildingData& Building = Asset->Buildings.AddDefaulted_GetRef();
+            SetProperties(Feature, Building);
+            SetVertices(MoveTemp(Feature.Rings[0]), bFixedPoint, Building);
+            return;
+        }
+        FMPBuildingData& Building = Asset->MultiPolygonBuildings.AddDefaulted_GetRef();
+        SetProperties(Feature, Building);
+        Building.Parts.SetNum(Feature.Rings.Num());
+        for(int32 i = 0; i < Feature.Rings.Num(); i++) {
+            Building.Parts[i].bIsInner = Feature.IsInner[i];
+            Building.bHasHole |= Feature.IsInner[i];
+            SetVertices(MoveTemp(Feature.Rings[i]), bFixedPoint, Building.Parts[i]);
+        }
+    }
+
+    /** Walks the packed R-tree from the root, reading only the children of nodes that intersect Filter */
+    bool SearchIndex(FArchive& Reader, int64 IndexStart, const TArray<TPair<uint64, uint64>>& Levels, uint16 NodeSize, const FNodeItem& Filter, TArray<uint64>& OutOffsets)
+    {
+        TArray<uint64> Visit = {0};
+        TArray<uint64> Next;
+        TArray<FNodeItem> Nodes;
+        for(int32 Level = Levels.Num() - 1; Level >= 0; Level--) {
+            Next.Reset();
+            for(const uint64 First : Visit) {
+                const uint64 End = FMath::Min<uint64>(First + NodeSize, Levels[Level].Value);
+                if(First < Levels[Level].Key || First >= End) {
+                    return false;
+                }
+                Nodes.SetNumUninitialized(static_cast<int32>(End - First));
+                Reader.Seek(IndexStart + First * sizeof(FNodeItem));
+                Reader.Serialize(Nodes.GetData(), Nodes.Num() * sizeof(FNodeItem));
+                if(Reader.IsError()) {
+                    return false;
+                }
+                for(const FNodeItem& Node : Nodes) {
+                    if(Node.Intersects(Filter)) {
+                        (Level == 0 ? OutOffsets : Next).Add(Node.Offset);
+                    }
+                }
+            }
+            Swap(Visit, Next);
+        }
+        // read the features front to back
+        Algo::Sort(OutOffsets);
+        return true;
+    }
+
+    /** Reads all features of Filename or, with Filter, the ones whose bounding box intersects it */
+    bool ReadFeatures(const FString& Filename, const FNodeItem* Filter, UOSMDataAsset* Asset)
+    {
+        if(!Asset) {
+            return false;
+        }
+        TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+        if(!Reader) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMFlatGeobuf: Could not open %s"), *Filename)
+            return false;
+        }
+        const int64 FileSize = Reader->TotalSize();
+
+        uint8 FileMagic[MagicSize] = {};
+        uint32 HeaderSize = 0;
+        if(FileSize >= MagicSize + 4) {
+            Reader->Serialize(FileMagic, MagicSize);
+            Reader->Serialize(&HeaderSize, 4);
+        }
+        // the fourth byte is the major version, the patch version in the last byte is not checked
+        if(FMemory::Memcmp(FileMagic, Magic, 7) != 0 || HeaderSize > MaxHeaderSize || MagicSize + 4 + HeaderSize > FileSize) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMFlatGeobuf: %s is not a FlatGeobuf version 3 file"), *Filename)
+            return false;
+        }
+        TArray<uint8> HeaderData;
+        HeaderData.SetNumUninitialized(HeaderSize);
+        Reader->Serialize(HeaderData.GetData(), HeaderSize);
+        FFileLayout Layout;
+        if(Reader->IsError() || !ParseHeader(HeaderData, Layout)) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMFlatGeobuf: Invalid header in %s"), *Filename)
+            return false;
+        }
+
+        // the index sits between header and features
+        const int64 IndexStart = MagicSize + 4 + HeaderSize;
+        TArray<TPair<uint64, uint64>> Levels;
+        int64 IndexSize = 0;
+        if(Layout.NodeSize > 0 && Layout.NumFeatures > 0) {
+            if(Layout.NodeSize < 2 || Layout.NumFeatures > static_cast<uint64>(FileSize)) {
+                UE_LOG(LogTemp, Error, TEXT("FOSMFlatGeobuf: Invalid spatial index in %s"), *Filename)
+                return false;
+            }
+            Levels = GetLevelBounds(Layout.NumFeatures, Layout.NodeSize);
+            IndexSize = Levels[0].Value * sizeof(FNodeItem);
+        }
+        const int64 FeatureStart = IndexStart + IndexSize;
+        if(FeatureStart > FileSize) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMFlatGeobuf: %s is truncated"), *Filename)
+            return false;
+        }
+
+        const bool bUseIndex = Filter && IndexSize > 0;
+        TArray<uint64> Offsets;
+        if(bUseIndex && !SearchIndex(*Reader, IndexStart, Levels, Layout.NodeSize, *Filter, Offsets)) {
+            UE_LOG(LogTemp, Error, TEXT("FOSMFlatGeobuf: Invalid spatial index in %s"), *Filename)
+            return false;
+        }
+
+        Asset->Buildings.Reset();
+        Asset->MultiPolygonBuildings.Reset();
+        const bool bFixedPoint = Asset->ImportSettings.bUseFixedPointCoordinates;
+        int32 NumSkipped = 0;
+        int32 NextOffset = 0;
+        int64 Position = FeatureStart;
+        TArray<uint8> FeatureData;
+        while(bUseIndex ? NextOffset < Offsets.Num() : Position + 4 <= FileSize) {
+            if(bUseIndex) {
+                Position = FeatureStart + Offsets[NextOffset++];
+            }
+            uint32 FeatureSize = 0;
+            if(Position + 4 > FileSize) {
+                UE_LOG(LogTemp, Error, TEXT("FOSMFlatGeobuf: %s is truncated"), *Filename)
+                return false;
+            }
+            Reader->Seek(Position);
+            Reader->Serialize(&FeatureSize, 4);
+            if(Reader->IsError() || FeatureSize > MaxFeatureSize || Position + 4 + FeatureSize > FileSize) {
+                UE_LOG(LogTemp, Error, TEXT("FOSMFlatGeobuf: %s is truncated"), *Filename)
+                return false;
+            }
+            FeatureData.SetNumUninitialized(FeatureSize);
+            Reader->Serialize(FeatureData.GetData(), FeatureSize);
+            Position += 4 + FeatureSize;
+
+            FDecodedFeature Feature;
+            if(!DecodeFeature(FeatureData, Layout, Feature)) {
+                NumSkipped++;
+                continue;
+            }
+            if(Filter && !bUseIndex && !Filter->Intersects(Feature.Box)) {
+                continue;
+            }
+            AddToAsset(MoveTemp(Feature), bFixedPoint, Asset);
+        }
+        if(NumSkipped > 0) {
+            UE_LOG(LogTemp, Warning, TEXT("FOSMFlatGeobuf: Skipped %d features of %s that are no polygons"), NumSkipped, *Filename)
+        }
+
+        // vertices are read resolved, attributes beyond the columns above are not part of the file
+        Asset->ImportSettings.bUseSharedVertexPool = false;
+        Asset->NodePositions.Empty();
+        Asset->NodeCoordinates.Empty();
+        Asset->BuildingAttributes.Empty();
+        Asset->MultiPolygonBuildingAttributes.Empty();
+        // there are no node IDs either, OrderBuildings compares coordinates if the graph is enabled
+        Asset->BuildingAdjacency.Empty();
+        FOSMDataAssetBuilder::ResolveBuildingHeights(Asset);
+        FOSMDataAssetBuilder::OrderBuildings(Asset);
+        return true;
+    }
+}
+
+bool FOSMFlatGeobuf::Write(const UOSMDataAsset* Asset, TArray64<uint8>& OutData)
+{
+    if(!Asset) {
+        return false;
+    }
+
+    const UEnum* BuildingTypeEnum = StaticEnum<EOSMBuildingType>();
+    TArray<FString> TypeNames;
+    for(int32 i = 0; i <= EOSMBuildingType::OtherBuilding; i++) {
+        TypeNames.Add(BuildingTypeEnum->GetNameStringByValue(i));
+    }
+
+    // features do not depend on their position in the file, so they are encoded before the order is known
+    const int32 NumBuildings = Asset->Buildings.Num() + Asset->MultiPolygonBuildings.Num();
+    TArray<TArray<uint8>> Features;
+    TArray<FNodeItem> Boxes;
+    Features.SetNum(NumBuildings);
+    Boxes.SetNum(NumBuildings);
+    ParallelFor(NumBuildings, [&](int32 i)
+    {
+        if(!EncodeBuilding(*Asset, i, TypeNames, Features[i], Boxes[i])) {
+            Features[i].Empty();
+        }
+    });
+
+    TArray<int32> Order;
+    Order.Reserve(NumBuildings);
+    FNodeItem Extent = FNodeItem::Empty();
+    for(int32 i = 0; i < NumBuildings; i++) {
+        if(Features[i].Num() > 0) {
+            Order.Add(i);
+            Extent.Expand(Boxes[i]);
+        }
+    }
+    if(Order.Num() < NumBuildings) {
+        UE_LOG(LogTemp, Warning, TEXT("FOSMFlatGeobuf: Skipped %d buildings without a valid outer ring"), NumBuildings - Order.Num())
+    }
+
+    // the packed R-tree expects the features sorted by the Hilbert index of their box centers, descending like
+    // the reference writer
+    TArray<uint32> HilbertIndices;
+    HilbertIndices.SetNumZeroed(NumBuildings);
+    ParallelFor(Order.Num(), [&](int32 j)
+    {
+        const FNodeItem& Box = Boxes[Order[j]];
+        HilbertIndices[Order[j]] = FOSMHilbert::Encode((Box.MinX + Box.MaxX) / 2, (Box.MinY + Box.MaxY) / 2,
+            Extent.MinX, Extent.MinY, Extent.MaxX - Extent.MinX, Extent.MaxY - Extent.MinY);
+    });
+    Algo::Sort(Order, [&HilbertIndices](int32 A, int32 B)
+    {
+        return HilbertIndices[A] != HilbertIndices[B] ? HilbertIndices[A] > HilbertIndices[B] : A < B;
+    });
+
+    const int32 NumFeatures = Order.Num();
+    TArray<uint64> FeatureOffsets;
+    FeatureOffsets.SetNumUninitialized(NumFeatures + 1);
+    FeatureOffsets[0] = 0;
+    for(int32 j = 0; j < NumFeatures; j++) {
+        FeatureOffsets[j + 1] = FeatureOffsets[j] + Features[Order[j]].Num();
+    }
+
+    TArray64<FNodeItem> Nodes;
+    if(NumFeatures > 0) {
+        const TArray<TPair<uint64, uint64>> Levels = GetLevelBounds(NumFeatures, IndexNodeSize);
+        Nodes.SetNumUninitialized(Levels[0].Value);
+        for(int32 j = 0; j < NumFeatures; j++) {
+            FNodeItem& Leaf = Nodes[Levels[0].Key + j];
+            Leaf = Boxes[Order[j]];
+            Leaf.Offset = FeatureOffsets[j];
+        }
+        // each parent covers up to IndexNodeSize consecutive nodes of the level below
+        for(int32 Level = 0; Level < Levels.Num() - 1; Level++) {
+            uint64 Child = Levels[Level].Key;
+            uint64 Parent = Levels[Level + 1].Key;
+            while(Child < Levels[Level].Value) {
+                FNodeItem Node = FNodeItem::Empty();
+                Node.Offset = Child;
+                for(int32 k = 0; k < IndexNodeSize && Child < Levels[Level].Value; k++) {
+                    Node.Expand(Nodes[Child++]);
+                }
+                Nodes[Parent++] = Node;
+            }
+        }
+    }
+
+    const TArray<uint8> Header = EncodeHeader(Extent, NumFeatures);
+    const int64 IndexStart = MagicSize + Header.Num();
+    const int64 FeatureStart = IndexStart + Nodes.Num() * static_cast<int64>(sizeof(FNodeItem));
+    OutData.SetNumUninitialized(FeatureStart + FeatureOffsets[NumFeatures]);
+    FMemory::Memcpy(OutData.GetData(), Magic, MagicSize);
+    FMemory::Memcpy(OutData.GetData() + MagicSize, Header.GetData(), Header.Num());
+    FMemory::Memcpy(OutData.GetData() + IndexStart, Nodes.GetData(), Nodes.Num() * sizeof(FNodeItem));
+    ParallelFor(NumFeatures, [&](int32 j)
+    {
+        const TArray<uint8>& Feature = Features[Order[j]];
+        FMemory::Memcpy(OutData.GetData() + FeatureStart + FeatureOffsets[j], Feature.GetData(), Feature.Num());
+    });
+    return true;
+}
+
+bool FOSMFlatGeobuf::WriteToFile(const UOSMDataAsset* Asset, const FString& Filename)
+{
+    TArray64<uint8> Data;
+    return Write(Asset, Data) && FFileHelper::SaveArrayToFile(Data, *Filename);
+}
+
+bool FOSMFlatGeobuf::ReadFromFile(const FString& Filename, UOSMDataAsset* Asset)
+{
+    return ReadFeatures(Filename, nullptr, Asset);
+}
+
+bool FOSMFlatGeobuf::ReadFromFileInBounds(const FString& Filename, const FOSMGeoPoint& Min, const FOSMGeoPoint& Max, UOSMDataAsset* Asset)
+{
+    FNodeItem Filter = FNodeItem::Empty();
+    Filter.Expand(Min.GetLongitude(), Min.GetLatitude());
+    Filter.Expand(Max.GetLongitude(), Max.GetLatitude());
+    return ReadFeatures(Filename, &Filter, Asset);
+}
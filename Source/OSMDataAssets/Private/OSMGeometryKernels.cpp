@@ -0,0 +1,257 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMGeometryKernels.h"
+
+#include "OSMDataAsset.h"
+#include "Async/ParallelFor.h"
+#include "Runtime/Launch/Resources/Version.h"
+
+namespace
+{
+#if ENGINE_MAJOR_VERSION >= 5
+    using FOSMVector4 = VectorRegister4Float;
+#else
+    using FOSMVector4 = VectorRegister;
+#endif
+
+    /** Rings per ParallelFor task, small rings are cheap so tasks need plenty of them */
+    constexpr int32 RingsPerTask = 1024;
+
+    /** Rings with less area than this fraction of their bounding box are considered degenerate */
+    constexpr float DegenerateAreaRatio = 1e-6f;
+
+    FORCEINLINE float SumLanes(const FOSMVector4& Vector)
+    {
+        alignas(16) float Lanes[4];
+        VectorStoreAligned(Vector, Lanes);
+        return (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+    }
+
+    FORCEINLINE float MinLanes(const FOSMVector4& Vector)
+    {
+        alignas(16) float Lanes[4];
+        VectorStoreAligned(Vector, Lanes);
+        return FMath::Min(FMath::Min(Lanes[0], Lanes[1]), FMath::Min(Lanes[2], Lanes[3]));
+    }
+
+    FORCEINLINE float MaxLanes(const FOSMVector4& Vector)
+    {
+        alignas(16) float Lanes[4];
+        VectorStoreAligned(Vector, Lanes);
+        return FMath::Max(FMath::Max(Lanes[0], Lanes[1]), FMath::Max(Lanes[2], Lanes[3]));
+    }
+
+    /** 1.0 in all lanes where Mask is set, 0.0 elsewhere */
+    FORCEINLINE FOSMVector4 MaskToOne(const FOSMVector4& Mask)
+    {
+        return VectorBitwiseAnd(Mask, VectorOne());
+    }
+
+    /** Analyzes one ring, four edges per iteration */
+    FOSMRingAnalysis AnalyzeRing(const float* X, const float* Y, int32 Count, const FVector2D& Origin)
+    {
+        FOSMRingAnalysis Result;
+        Result.Flags = EOSMRingFlags::None;
+        if(Count < 3) {
+            Result.SignedArea = 0.f;
+            Result.Bounds = FBox2D(Origin, Origin);
+            Result.Flags = EOSMRingFlags::Degenerate;
+            return Result;
+        }
+
+        const FOSMVector4 Zero = VectorZero();
+        const FOSMVector4 Four = MakeVectorRegister(4.f, 4.f, 4.f, 4.f);
+        const FOSMVector4 LaneCount = MakeVectorRegister((float)Count, (float)Count, (float)Count, (float)Count);
+        FOSMVector4 LaneIndex = MakeVectorRegister(0.f, 1.f, 2.f, 3.f);
+
+        FOSMVector4 Area = Zero;
+        FOSMVector4 MinX = Zero, MinY = Zero, MaxX = Zero, MaxY = Zero;
+        FOSMVector4 LeftTurns = Zero, RightTurns = Zero;
+        FOSMVector4 XSignChanges = Zero, YSignChanges = Zero;
+
+        for(int32 i = 0; i < Count; i += 4) {
+            const FOSMVector4 X0 = VectorLoadAligned(X + i);
+            const FOSMVector4 Y0 = VectorLoadAligned(Y + i);
+            const FOSMVector4 X1 = VectorLoad(X + i + 1);
+            const FOSMVector4 Y1 = VectorLoad(Y + i + 1);
+            const FOSMVector4 X2 = VectorLoad(X + i + 2);
+            const FOSMVector4 Y2 = VectorLoad(Y + i + 2);
+
+            // padding is zero and the ring is relative to vertex 0, so lanes past the end add no area and
+            // leave the bounds untouched as they always contain the origin
+            Area = VectorAdd(Area, VectorSubtract(VectorMultiply(X0, Y1), VectorMultiply(X1, Y0)));
+            MinX = VectorMin(MinX, X0);
+            MinY = VectorMin(MinY, Y0);
+            MaxX = VectorMax(MaxX, X0);
+            MaxY = VectorMax(MaxY, Y0);
+
+            // turn direction at vertex i+1 and sign changes of the edge directions, masked to valid lanes
+            const FOSMVector4 Valid = VectorCompareGT(LaneCount, LaneIndex);
+            const FOSMVector4 DX0 = VectorSubtract(X1, X0);
+            const FOSMVector4 DY0 = VectorSubtract(Y1, Y0);
+            const FOSMVector4 DX1 = VectorSubtract(X2, X1);
+            const FOSMVector4 DY1 = VectorSubtract(Y2, Y1);
+            const FOSMVector4 Turn = VectorSubtract(VectorMultiply(DX0, DY1), VectorMultiply(DY0, DX1));
+            LeftTurns = VectorAdd(LeftTurns, MaskToOne(VectorBitwiseAnd(Valid, VectorCompareGT(Turn, Zero))));
+            RightTurns = VectorAdd(RightTurns, MaskToOne(VectorBitwiseAnd(Valid, VectorCompareGT(Zero, Turn))));
+            XSignChanges = VectorAdd(XSignChanges, MaskToOne(VectorBitwiseAnd(Valid, VectorCompareGT(Zero, VectorMultiply(DX0, DX1)))));
+            YSignChanges = VectorAdd(YSignChanges, MaskToOne(VectorBitwiseAnd(Valid, VectorCompareGT(Zero, VectorMultiply(DY0, DY1)))));
+
+            LaneIndex = VectorAdd(LaneIndex, Four);
+        }
+
+        Result.SignedArea = 0.5f * SumLanes(Area);
+        Result.Bounds = FBox2D(Origin + FVector2D(MinLanes(MinX), MinLanes(MinY)),
+                               Origin + FVector2D(MaxLanes(MaxX), MaxLanes(MaxY)));
+
+        const FVector2D Size = Result.Bounds.GetSize();
+        if(FMath::Abs(Result.SignedArea) <= DegenerateAreaRatio * Size.X * Size.Y) {
+            Result.Flags |= EOSMRingFlags::Degenerate;
+        }
+        if(Result.SignedArea < 0.f) {
+            Result.Flags |= EOSMRingFlags::Clockwise;
+        }
+        // a ring turning in one direction only whose edges reverse direction at most twice per axis is convex
+        // and therefore simple, everything else may self intersect
+        const bool bConvex = SumLanes(LeftTurns) == 0.f || SumLanes(RightTurns) == 0.f;
+        if(!bConvex || SumLanes(XSignChanges) > 2.f || SumLanes(YSignChanges) > 2.f) {
+            Result.Flags |= EOSMRingFlags::SelfIntersectionCandidate;
+        }
+        return Result;
+    }
+}
+
+void FOSMPackedRings::Reset()
+{
+    X.Reset();
+    Y.Reset();
+    Start.Reset();
+    Count.Reset();
+    Origin.Reset();
+}
+
+int32 FOSMPackedRings::AddRingSlot(int32 NumVertices)
+{
+    const int32 Offset = X.Num();
+    X.AddZeroed(PaddedSize(NumVertices));
+    Y.AddZeroed(PaddedSize(NumVertices));
+    Count.Add(NumVertices);
+    Origin.Add(FVector2D::ZeroVector);
+    return Start.Add(Offset);
+}
+
+void FOSMPackedRings::SetRing(int32 Ring, TFunctionRef<FVector(int32)> GetVertex)
+{
+    const int32 NumVertices = Count[Ring];
+    if(NumVertices == 0) {
+        return;
+    }
+    const FVector First = GetVertex(0);
+    Origin[Ring] = FVector2D(First.X, First.Y);
+
+    float * RingX = X.GetData() + Start[Ring];
+    float * RingY = Y.GetData() + Start[Ring];
+    for(int32 i = 1; i < NumVertices; i++) {
+        const FVector Vertex = GetVertex(i);
+        RingX[i] = Vertex.X - First.X;
+        RingY[i] = Vertex.Y - First.Y;
+    }
+    // vertex 0 is the origin and stays zero, repeat vertex 1 after the closing vertex
+    RingX[NumVertices + 1] = RingX[FMath::Min(1, NumVertices - 1)];
+    RingY[NumVertices + 1] = RingY[FMath::Min(1, NumVertices - 1)];
+}
+
+void FOSMPackedRings::SetRing(int32 Ring, TArrayView<const FOSMGeoPoint> Coordinates)
+{
+    const int32 NumVertices = Count[Ring];
+    check(Coordinates.Num() == NumVertices);
+    if(NumVertices == 0) {
+        return;
+    }
+    const FOSMGeoPoint& First = Coordinates[0];
+    Origin[Ring] = FVector2D(First.GetLongitude(), First.GetLatitude());
+
+    float * RingX = X.GetData() + Start[Ring];
+    float * RingY = Y.GetData() + Start[Ring];
+    for(int32 i = 1; i < NumVertices; i++) {
+        const FVector2D Delta = First.DeltaTo(Coordinates[i]);
+        RingX[i] = Delta.X;
+        RingY[i] = Delta.Y;
+    }
+    RingX[NumVertices + 1] = RingX[FMath::Min(1, NumVertices - 1)];
+    RingY[NumVertices + 1] = RingY[FMath::Min(1, NumVertices - 1)];
+}
+
+int32 FOSMPackedRings::AddRing(const TArray<FVector>& Points)
+{
+    const int32 Ring = AddRingSlot(Points.Num());
+    SetRing(Ring, [&Points](int32 i) { return Points[i]; });
+    return Ring;
+}
+
+void FOSMGeometryKernels::PackAsset(const UOSMDataAsset* Asset, FOSMPackedRings& OutRings, TArray<FOSMRingSource>& OutSources)
+{
+    OutRings.Reset();
+    OutSources.Reset();
+    if(!Asset) {
+        return;
+    }
+
+    TArray<const FOSMFootprint*> Inputs;
+    for(int32 i = 0; i < Asset->Buildings.Num(); i++) {
+        Inputs.Add(&Asset->Buildings[i]);
+        OutSources.Add({i, INDEX_NONE, false});
+    }
+    for(int32 i = 0; i < Asset->MultiPolygonBuildings.Num(); i++) {
+        const TArray<FMPBuildingPart>& Parts = Asset->MultiPolygonBuildings[i].Parts;
+        for(int32 p = 0; p < Parts.Num(); p++) {
+            Inputs.Add(&Parts[p]);
+            OutSources.Add({i, p, Parts[p].bIsInner});
+        }
+    }
+
+    // allocate sequentially, then fill the slots in parallel
+    int32 TotalSize = 0;
+    for(const FOSMFootprint * Input : Inputs) {
+        TotalSize += FOSMPackedRings::PaddedSize(Input->NumVertices());
+    }
+    OutRings.X.Reserve(TotalSize);
+    OutRings.Y.Reserve(TotalSize);
+    OutRings.Start.Reserve(Inputs.Num());
+    OutRings.Count.Reserve(Inputs.Num());
+    OutRings.Origin.Reserve(Inputs.Num());
+    for(const FOSMFootprint * Input : Inputs) {
+        OutRings.AddRingSlot(Input->NumVertices());
+    }
+
+    ParallelFor(FMath::DivideAndRoundUp(Inputs.Num(), RingsPerTask), [&](int32 Task)
+    {
+        TArray<FOSMGeoPoint> Coordinates;
+        const int32 End = FMath::Min((Task + 1) * RingsPerTask, Inputs.Num());
+        for(int32 Ring = Task * RingsPerTask; Ring < End; Ring++) {
+            Asset->ResolveCoordinates(*Inputs[Ring], Coordinates);
+            OutRings.SetRing(Ring, Coordinates);
+        }
+    });
+}
+
+void FOSMGeometryKernels::AnalyzeRings(const FOSMPackedRings& Rings, int32 FirstRing, TArrayView<FOSMRingAnalysis> OutResults)
+{
+    check(FirstRing >= 0 && FirstRing + OutResults.Num() <= Rings.Num());
+    const float * X = Rings.X.GetData();
+    const float * Y = Rings.Y.GetData();
+    for(int32 i = 0; i < OutResults.Num(); i++) {
+        const int32 Ring = FirstRing + i;
+        OutResults[i] = AnalyzeRing(X + Rings.Start[Ring], Y + Rings.Start[Ring], Rings.Count[Ring], Rings.Origin[Ring]);
+    }
+}
+
+void FOSMGeometryKernels::AnalyzeRingsParallel(const FOSMPackedRings& Rings, TArray<FOSMRingAnalysis>& OutResults)
+{
+    OutResults.SetNumUninitialized(Rings.Num());
+    ParallelFor(FMath::DivideAndRoundUp(Rings.Num(), RingsPerTask), [&](int32 Task)
+    {
+        const int32 First = Task * RingsPerTask;
+        const int32 Num = FMath::Min(RingsPerTask, Rings.Num() - First);
+        AnalyzeRings(Rings, First, TArrayView<FOSMRingAnalysis>(OutResults.GetData() + First, Num));
+    });
+}
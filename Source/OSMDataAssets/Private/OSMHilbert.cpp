@@ -0,0 +1,64 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMHilbert.h"
+
+uint32 FOSMHilbert::Encode(uint32 X, uint32 Y)
+{
+    // branch free conversion from "Fast Hilbert curve generation, sorting, and range queries" by rawrunprotected,
+    // bit identical to the reference implementation of FlatGeobuf
+    uint32 A = X ^ Y;
+    uint32 B = 0xFFFF ^ A;
+    uint32 C = 0xFFFF ^ (X | Y);
+    uint32 D = X & (Y ^ 0xFFFF);
+
+    uint32 NA = A | (B >> 1);
+    uint32 NB = (A >> 1) ^ A;
+    uint32 NC = ((C >> 1) ^ (B & (D >> 1))) ^ C;
+    uint32 ND = ((A & (C >> 1)) ^ (D >> 1)) ^ D;
+
+    A = NA; B = NB; C = NC; D = ND;
+    NA = (A & (A >> 2)) ^ (B & (B >> 2));
+    NB = (A & (B >> 2)) ^ (B & ((A ^ B) >> 2));
+    NC ^= (A & (C >> 2)) ^ (B & (D >> 2));
+    ND ^= (B & (C >> 2)) ^ ((A ^ B) & (D >> 2));
+
+    A = NA; B = NB; C = NC; D = ND;
+    NA = (A & (A >> 4)) ^ (B & (B >> 4));
+    NB = (A & (B >> 4)) ^ (B & ((A ^ B) >> 4));
+    NC ^= (A & (C >> 4)) ^ (B & (D >> 4));
+    ND ^= (B & (C >> 4)) ^ ((A ^ B) & (D >> 4));
+
+    A = NA; B = NB; C = NC; D = ND;
+    NC ^= (A & (C >> 8)) ^ (B & (D >> 8));
+    ND ^= (B & (C >> 8)) ^ ((A ^ B) & (D >> 8));
+
+    A = NC ^ (NC >> 1);
+    B = ND ^ (ND >> 1);
+
+    uint32 I0 = X ^ Y;
+    uint32 I1 = B | (0xFFFF ^ (I0 | A));
+
+    I0 = (I0 | (I0 << 8)) & 0x00FF00FF;
+    I0 = (I0 | (I0 << 4)) & 0x0F0F0F0F;
+    I0 = (I0 | (I0 << 2)) & 0x33333333;
+    I0 = (I0 | (I0 << 1)) & 0x55555555;
+
+    I1 = (I1 | (I1 << 8)) & 0x00FF00FF;
+    I1 = (I1 | (I1 << 4)) & 0x0F0F0F0F;
+    I1 = (I1 | (I1 << 2)) & 0x33333333;
+    I1 = (I1 | (I1 << 1)) & 0x55555555;
+
+    return (I1 << 1) | I0;
+}
+
+uint32 FOSMHilbert::Encode(double X, double Y, double MinX, double MinY, double Width, double Height)
+{
+    uint32 GridX = 0;
+    uint32 GridY = 0;
+    if(Width > 0.0) {
+        GridX = static_cast<uint32>(FMath::Clamp(FMath::FloorToDouble(GridMax * (X - MinX) / Width), 0.0, static_cast<double>(GridMax)));
+    }
+    if(Height > 0.0) {
+        GridY = static_cast<uint32>(FMath::Clamp(FMath::FloorToDouble(GridMax * (Y - MinY) / Height), 0.0, static_cast<double>(GridMax)));
+    }
+    return Encode(GridX, GridY);
+}
@@ -0,0 +1,325 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMPOIDataAsset.h"
+
+#include "Algo/Sort.h"
+
+namespace
+{
+    /** Length of a degree of latitude, and of longitude at the equator */
+    constexpr double MetersPerDegree = 111319.49;
+
+    /** New element i is old element Order[i] */
+    template<typename T>
+    void ReorderColumn(TArray<T>& Array, const TArray<int32>& Order)
+    {
+        TArray<T> Reordered;
+        Reordered.Reserve(Order.Num());
+        for(const int32 OldIndex : Order) {
+            Reordered.Add(MoveTemp(Array[OldIndex]));
+        }
+        Array = MoveTemp(Reordered);
+    }
+
+    FORCEINLINE int32 GetAxis(const FOSMGeoPoint& Point, int32 Axis)
+    {
+        return Axis == 0 ? Point.LongitudeE7 : Point.LatitudeE7;
+    }
+
+    /** Sorts every range by its split axis, so its median is the split and the halves are the subtrees */
+    void BuildTreeOrder(const TArray<FOSMGeoPoint>& Positions, TArray<int32>& Order, int32 Lo, int32 Hi, int32 Depth)
+    {
+        if(Hi - Lo <= 1) {
+            return;
+        }
+        const int32 Axis = Depth % 2;
+        Algo::Sort(TArrayView<int32>(Order.GetData() + Lo, Hi - Lo), [&Positions, Axis](int32 A, int32 B)
+        {
+            const int32 KeyA = GetAxis(Positions[A], Axis);
+            const int32 KeyB = GetAxis(Positions[B], Axis);
+            if(KeyA != KeyB) {
+                return KeyA < KeyB;
+            }
+            // deterministic order for duplicates
+            const int32 OtherA = GetAxis(Positions[A], 1 - Axis);
+            const int32 OtherB = GetAxis(Positions[B], 1 - Axis);
+            return OtherA != OtherB ? OtherA < OtherB : A < B;
+        });
+        const int32 Mid = Lo + (Hi - Lo) / 2;
+        BuildTreeOrder(Positions, Order, Lo, Mid, Depth + 1);
+        BuildTreeOrder(Positions, Order, Mid + 1, Hi, Depth + 1);
+    }
+
+    /** Query location with the local meters per fixed point unit of both axes */
+    struct FTreeQuery
+    {
+        const TArray<FOSMGeoPoint>& Positions;
+        FOSMGeoPoint Location;
+        double MetersPerUnit[2];
+        TFunctionRef<bool(int32)> Filter;
+
+        FTreeQuery(const TArray<FOSMGeoPoint>& InPositions, const FOSMGeoPoint& InLocation, TFunctionRef<bool(int32)> InFilter)
+            : Positions(InPositions)
+            , Location(InLocation)
+            , Filter(InFilter)
+        {
+            MetersPerUnit[1] = MetersPerDegree / FOSMGeoPoint::Scale;
+            MetersPerUnit[0] = MetersPerUnit[1] * FMath::Cos(FMath::DegreesToRadians(Location.GetLatitude()));
+        }
+
+        FORCEINLINE double AxisDelta(int32 Index, int32 Axis) const
+        {
+            return (static_cast<int64>(GetAxis(Location, Axis)) - GetAxis(Positions[Index], Axis)) * MetersPerUnit[Axis];
+        }
+
+        FORCEINLINE double DistanceSquared(int32 Index) const
+        {
+            return FMath::Square(AxisDelta(Index, 0)) + FMath::Square(AxisDelta(Index, 1));
+        }
+    };
+
+    /**
+     * Visits every POI in [Lo, Hi) that passes the filter and is not further away than the current bound.
+     * Nearer subtrees are searched first, so a shrinking bound prunes as much as possible.
+     */
+    template<typename TVisit, typename TBound>
+    void SearchTree(const FTreeQuery& Query, int32 Lo, int32 Hi, int32 Depth, TVisit& Visit, TBound& BoundSquared)
+    {
+        while(Lo < Hi) {
+            const int32 Mid = Lo + (Hi - Lo) / 2;
+            const double DistanceSquared = Query.DistanceSquared(Mid);
+            if(DistanceSquared <= BoundSquared() && Query.Filter(Mid)) {
+                Visit(Mid, DistanceSquared);
+            }
+
+            const double Delta = Query.AxisDelta(Mid, Depth % 2);
+            if(Delta < 0) {
+                SearchTree(Query, Lo, Mid, Depth + 1, Visit, BoundSquared);
+                Lo = Mid + 1;
+            } else {
+                SearchTree(Query, Mid + 1, Hi, Depth + 1, Visit, BoundSquared);
+                Hi = Mid;
+            }
+            // the far side is at least as far away as the split plane
+            if(Delta * Delta > BoundSquared()) {
+                return;
+            }
+            Depth++;
+        }
+    }
+}
+
+void UOSMPOIDataAsset::Reset()
+{
+    IDs.Reset();
+    Positions.Reset();
+    Categories.Reset();
+    Names.Reset();
+    TagOffsets.Reset();
+    TagKeys.Reset();
+    TagValues.Reset();
+    Strings.Reset();
+    StringIndices.Reset();
+}
+
+int32 UOSMPOIDataAsset::AddPOI(int64 ID, const FOSMGeoPoint& Location, EOSMPOICategory Category, const TArray<TPair<FString, FString>>& Tags)
+{
+    if(TagOffsets.Num() == 0) {
+        TagOffsets.Add(0);
+    }
+    int32 Name = INDEX_NONE;
+    for(const TPair<FString, FString>& Tag : Tags) {
+        if(Tag.Key == TEXT("name")) {
+            Name = InternString(Tag.Value);
+        }
+        TagKeys.Add(InternString(Tag.Key));
+        TagValues.Add(InternString(Tag.Value));
+    }
+    IDs.Add(ID);
+    Positions.Add(Location);
+    Categories.Add(Category);
+    Names.Add(Name);
+    TagOffsets.Add(TagKeys.Num());
+    return IDs.Num() - 1;
+}
+
+int32 UOSMPOIDataAsset::InternString(const FString& String)
+{
+    if(StringIndices.Num() != Strings.Num()) {
+        StringIndices.Reset();
+        StringIndices.Reserve(Strings.Num());
+        for(int32 i = 0; i < Strings.Num(); i++) {
+            StringIndices.Add(Strings[i], i);
+        }
+    }
+    if(const int32 * Index = StringIndices.Find(String)) {
+        return *Index;
+    }
+    return StringIndices.Add(String, Strings.Add(String));
+}
+
+void UOSMPOIDataAsset::BuildIndex()
+{
+    TArray<int32> Order;
+    Order.SetNumUninitialized(Positions.Num());
+    for(int32 i = 0; i < Order.Num(); i++) {
+        Order[i] = i;
+    }
+    BuildTreeOrder(Positions, Order, 0, Order.Num(), 0);
+
+    // the tag ranges move with their POIs
+    TArray<int32> NewTagOffsets;
+    TArray<int32> NewTagKeys;
+    TArray<int32> NewTagValues;
+    NewTagOffsets.Reserve(TagOffsets.Num());
+    NewTagKeys.Reserve(TagKeys.Num());
+    NewTagValues.Reserve(TagValues.Num());
+    NewTagOffsets.Add(0);
+    for(const int32 OldIndex : Order) {
+        for(int32 t = TagOffsets[OldIndex]; t < TagOffsets[OldIndex + 1]; t++) {
+            NewTagKeys.Add(TagKeys[t]);
+            NewTagValues.Add(TagValues[t]);
+        }
+        NewTagOffsets.Add(NewTagKeys.Num());
+    }
+    TagOffsets = MoveTemp(NewTagOffsets);
+    TagKeys = MoveTemp(NewTagKeys);
+    TagValues = MoveTemp(NewTagValues);
+
+    ReorderColumn(IDs, Order);
+    ReorderColumn(Positions, Order);
+    ReorderColumn(Categories, Order);
+    ReorderColumn(Names, Order);
+}
+
+void UOSMPOIDataAsset::FindNearest(const FOSMGeoPoint& Location, int32 K, double MaxDistance, TArray<int32>& OutIndices, TFunctionRef<bool(int32)> Filter) const
+{
+    OutIndices.Reset();
+    if(K <= 0) {
+        return;
+    }
+
+    struct FCandidate
+    {
+        int32 Index;
+        double DistanceSquared;
+    };
+    // max heap, the top is the furthest of the K best so far
+    auto IsFurther = [](const FCandidate& A, const FCandidate& B) { return A.DistanceSquared > B.DistanceSquared; };
+    TArray<FCandidate> Heap;
+    Heap.Reserve(K + 1);
+
+    const double MaxDistanceSquared = MaxDistance > 0.0 ? MaxDistance * MaxDistance : TNumericLimits<double>::Max();
+    auto BoundSquared = [&]()
+    {
+        return Heap.Num() < K ? MaxDistanceSquared : Heap.HeapTop().DistanceSquared;
+    };
+    auto Visit = [&](int32 Index, double DistanceSquared)
+    {
+        if(Heap.Num() == K) {
+            Heap.HeapPopDiscard(IsFurther, false);
+        }
+        Heap.HeapPush(FCandidate{Index, DistanceSquared}, IsFurther);
+    };
+    SearchTree(FTreeQuery(Positions, Location, Filter), 0, Positions.Num(), 0, Visit, BoundSquared);
+
+    Heap.Sort([](const FCandidate& A, const FCandidate& B) { return A.DistanceSquared < B.DistanceSquared; });
+    OutIndices.Reserve(Heap.Num());
+    for(const FCandidate& Candidate : Heap) {
+        OutIndices.Add(Candidate.Index);
+    }
+}
+
+void UOSMPOIDataAsset::FindNearest(const FOSMGeoPoint& Location, int32 K, double MaxDistance, TArray<int32>& OutIndices) const
+{
+    FindNearest(Location, K, MaxDistance, OutIndices, [](int32) { return true; });
+}
+
+void UOSMPOIDataAsset::FindInRadius(const FOSMGeoPoint& Location, double Radius, TArray<int32>& OutIndices, TFunctionRef<bool(int32)> Filter) const
+{
+    OutIndices.Reset();
+    const double RadiusSquared = Radius * Radius;
+    auto BoundSquared = [RadiusSquared]() { return RadiusSquared; };
+    auto Visit = [&OutIndices](int32 Index, double) { OutIndices.Add(Index); };
+    SearchTree(FTreeQuery(Positions, Location, Filter), 0, Positions.Num(), 0, Visit, BoundSquared);
+}
+
+void UOSMPOIDataAsset::FindInRadius(const FOSMGeoPoint& Location, double Radius, TArray<int32>& OutIndices) const
+{
+    FindInRadius(Location, Radius, OutIndices, [](int32) { return true; });
+}
+
+double UOSMPOIDataAsset::GetDistance(const FOSMGeoPoint& A, const FOSMGeoPoint& B)
+{
+    const double MetersPerUnit = MetersPerDegree / FOSMGeoPoint::Scale;
+    const double DX = (static_cast<int64>(B.LongitudeE7) - A.LongitudeE7) * MetersPerUnit * FMath::Cos(FMath::DegreesToRadians(A.GetLatitude()));
+    const double DY = (static_cast<int64>(B.LatitudeE7) - A.LatitudeE7) * MetersPerUnit;
+    return FMath::Sqrt(DX * DX + DY * DY);
+}
+
+FString UOSMPOIDataAsset::GetTag(int32 Index, const FString& Key) const
+{
+    if(!IDs.IsValidIndex(Index)) {
+        return FString();
+    }
+    for(int32 t = TagOffsets[Index]; t < TagOffsets[Index + 1]; t++) {
+        if(Strings[TagKeys[t]] == Key) {
+            return Strings[TagValues[t]];
+        }
+    }
+    return FString();
+}
+
+int32 UOSMPOIDataAsset::NumPOIs() const
+{
+    return IDs.Num();
+}
+
+FOSMPOI UOSMPOIDataAsset::GetPOI(int32 Index) const
+{
+    FOSMPOI POI;
+    if(!IDs.IsValidIndex(Index)) {
+        return POI;
+    }
+    POI.ID = IDs[Index];
+    POI.Name = Names[Index] != INDEX_NONE ? Strings[Names[Index]] : FString();
+    POI.Category = Categories[Index];
+    POI.Location = Positions[Index];
+    for(int32 t = TagOffsets[Index]; t < TagOffsets[Index + 1]; t++) {
+        POI.Tags.Add(Strings[TagKeys[t]], Strings[TagValues[t]]);
+    }
+    return POI;
+}
+
+bool UOSMPOIDataAsset::FindNearestPOI(const FOSMGeoPoint& Location, float MaxDistance, int32& OutIndex, float& OutDistance) const
+{
+    TArray<int32> Indices;
+    FindNearest(Location, 1, MaxDistance, Indices);
+    if(Indices.Num() == 0) {
+        OutIndex = INDEX_NONE;
+        OutDistance = 0.0f;
+        return false;
+    }
+    OutIndex = Indices[0];
+    OutDistance = GetDistance(Location, Positions[OutIndex]);
+    return true;
+}
+
+void UOSMPOIDataAsset::FindNearestPOIs(const FOSMGeoPoint& Location, int32 K, float MaxDistance, TArray<int32>& OutIndices) const
+{
+    FindNearest(Location, K, MaxDistance, OutIndices);
+}
+
+void UOSMPOIDataAsset::FindNearestPOIsOfCategory(const FOSMGeoPoint& Location, TEnumAsByte<EOSMPOICategory> Category, int32 K, float MaxDistance, TArray<int32>& OutIndices) const
+{
+    FindNearest(Location, K, MaxDistance, OutIndices, [this, Category](int32 Index) { return Categories[Index] == Category; });
+}
+
+void UOSMPOIDataAsset::FindPOIsInRadius(const FOSMGeoPoint& Location, float Radius, TArray<int32>& OutIndices) const
+{
+    FindInRadius(Location, Radius, OutIndices);
+}
+
+void UOSMPOIDataAsset::FindPOIsOfCategoryInRadius(const FOSMGeoPoint& Location, TEnumAsByte<EOSMPOICategory> Category, float Radius, TArray<int32>& OutIndices) const
+{
+    FindInRadius(Location, Radius, OutIndices, [this, Category](int32 Index) { return Categories[Index] == Category; });
+}
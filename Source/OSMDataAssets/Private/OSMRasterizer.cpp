@@ -0,0 +1,128 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMRasterizer.h"
+
+#include "Async/ParallelFor.h"
+
+namespace
+{
+    /** First pixel index whose center is at or after Position, clamped to [0, Limit] */
+    FORCEINLINE int32 FirstPixelAt(double Position, int32 Limit)
+    {
+        return FMath::CeilToInt(FMath::Clamp(Position - 0.5, 0.0, static_cast<double>(Limit)));
+    }
+}
+
+FOSMScanlineRasterizer::FOSMScanlineRasterizer(const FOSMGeoPoint& InMin, const FOSMGeoPoint& InMax, int32 InWidth, int32 InHeight)
+    : Min(InMin)
+    , Max(InMax)
+    , Width(FMath::Max(InWidth, 0))
+    , Height(FMath::Max(InHeight, 0))
+{
+    const int64 SpanX = FMath::Max<int64>(static_cast<int64>(Max.LongitudeE7) - Min.LongitudeE7, 1);
+    const int64 SpanY = FMath::Max<int64>(static_cast<int64>(Max.LatitudeE7) - Min.LatitudeE7, 1);
+    ScaleX = Width / static_cast<double>(SpanX);
+    ScaleY = Height / static_cast<double>(SpanY);
+}
+
+int32 FOSMScanlineRasterizer::BeginPolygon()
+{
+    return NumPolygonsAdded++;
+}
+
+FVector2D FOSMScanlineRasterizer::ToGrid(const FOSMGeoPoint& Point) const
+{
+    return FVector2D((static_cast<int64>(Point.LongitudeE7) - Min.LongitudeE7) * ScaleX,
+                     (static_cast<int64>(Max.LatitudeE7) - Point.LatitudeE7) * ScaleY);
+}
+
+void FOSMScanlineRasterizer::AddRing(TArrayView<const FOSMGeoPoint> Ring)
+{
+    AddGridRing(Ring.Num(), [this, &Ring](int32 i) { return ToGrid(Ring[i]); });
+}
+
+void FOSMScanlineRasterizer::AddRing(TArrayView<const FVector> Ring)
+{
+    AddGridRing(Ring.Num(), [this, &Ring](int32 i) { return ToGrid(FOSMGeoPoint::FromVector(Ring[i])); });
+}
+
+void FOSMScanlineRasterizer::AddGridRing(int32 Num, TFunctionRef<FVector2D(int32)> GetPoint)
+{
+    check(NumPolygonsAdded > 0);
+    if(Num < 3) {
+        return;
+    }
+    const FVector2D First = GetPoint(0);
+    FVector2D Previous = First;
+    for(int32 i = 1; i < Num; i++) {
+        const FVector2D Current = GetPoint(i);
+        AddEdge(Previous, Current);
+        Previous = Current;
+    }
+    AddEdge(Previous, First);
+}
+
+void FOSMScanlineRasterizer::AddEdge(const FVector2D& A, const FVector2D& B)
+{
+    // horizontal edges never cross a pixel center row
+    if(A.Y == B.Y) {
+        return;
+    }
+    const FVector2D& Low = A.Y < B.Y ? A : B;
+    const FVector2D& High = A.Y < B.Y ? B : A;
+    Edges.Add(FEdge{Low.Y, High.Y, Low.X, (High.X - Low.X) / (High.Y - Low.Y), NumPolygonsAdded - 1});
+}
+
+void FOSMScanlineRasterizer::Rasterize(FFillSpan Fill, int32 RowsPerBand) const
+{
+    if(Width == 0 || Height == 0 || Edges.Num() == 0) {
+        return;
+    }
+    RowsPerBand = FMath::Max(RowsPerBand, 1);
+    const int32 NumBands = FMath::DivideAndRoundUp(Height, RowsPerBand);
+
+    // bucket the edges by the bands of the rows they cross, edges stay in polygon order within a band
+    TArray<TArray<int32>> BandEdges;
+    BandEdges.SetNum(NumBands);
+    for(int32 e = 0; e < Edges.Num(); e++) {
+        const FEdge& Edge = Edges[e];
+        // rows whose center Y + 0.5 is in [YMin, YMax)
+        const int32 FirstRow = FirstPixelAt(Edge.YMin, Height);
+        const int32 EndRow = FirstPixelAt(Edge.YMax, Height);
+        if(FirstRow >= EndRow) {
+            continue;
+        }
+        for(int32 Band = FirstRow / RowsPerBand; Band <= (EndRow - 1) / RowsPerBand; Band++) {
+            BandEdges[Band].Add(e);
+        }
+    }
+
+    ParallelFor(NumBands, [&](int32 Band)
+    {
+        const TArray<int32>& Indices = BandEdges[Band];
+        TArray<double> Crossings;
+        const int32 EndRow = FMath::Min((Band + 1) * RowsPerBand, Height);
+        for(int32 Row = Band * RowsPerBand; Row < EndRow; Row++) {
+            const double Y = Row + 0.5;
+            int32 i = 0;
+            while(i < Indices.Num()) {
+                const int32 Polygon = Edges[Indices[i]].Polygon;
+                Crossings.Reset();
+                for(; i < Indices.Num() && Edges[Indices[i]].Polygon == Polygon; i++) {
+                    const FEdge& Edge = Edges[Indices[i]];
+                    if(Y >= Edge.YMin && Y < Edge.YMax) {
+                        Crossings.Add(Edge.XAtYMin + (Y - Edge.YMin) * Edge.DXDY);
+                    }
+                }
+                Crossings.Sort();
+                // pixels whose center X + 0.5 is between a pair of crossings
+                for(int32 c = 0; c + 1 < Crossings.Num(); c += 2) {
+                    const int32 FirstColumn = FirstPixelAt(Crossings[c], Width);
+                    const int32 EndColumn = FirstPixelAt(Crossings[c + 1], Width);
+                    if(FirstColumn < EndColumn) {
+                        Fill(Polygon, Row, FirstColumn, EndColumn);
+                    }
+                }
+            }
+        }
+    });
+}
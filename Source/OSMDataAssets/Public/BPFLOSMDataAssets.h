@@ -9,6 +9,89 @@
 
 #include "BPFLOSMDataAssets.generated.h"
 
+class UTexture2D;
+
+/**
+ * Result of validating all footprints of an asset
+ */
+USTRUCT(BlueprintType)
+struct FOSMValidationReport
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    int32 NumRings = 0;
+
+    /** Rings with less than three vertices or without area */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    int32 NumDegenerate = 0;
+
+    /** Outer rings that are clockwise or inner rings that are counter clockwise */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    int32 NumWrongWinding = 0;
+
+    /** Non convex rings that need an exact self intersection test */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    int32 NumSelfIntersectionCandidates = 0;
+
+    /** Rings whose edges cross or touch each other */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    int32 NumSelfIntersecting = 0;
+
+    /** Inner rings of multipolygon buildings that are not inside any outer ring */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    int32 NumHolesOutsideOuter = 0;
+
+    /** Rings changed or removed by a repair */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    int32 NumRepairedRings = 0;
+
+    /** Indices of buildings with degenerate or self intersecting footprints */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    TArray<int32> InvalidBuildings;
+
+    /** Indices of multipolygon buildings with degenerate or self intersecting rings or misplaced holes */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Validation")
+    TArray<int32> InvalidMPBuildings;
+};
+
+/**
+ * Footprints of an asset rasterized onto a grid over a geographic box. Row 0 is the northern edge.
+ * All arrays hold Width * Height values, row by row.
+ */
+USTRUCT(BlueprintType)
+struct FOSMFootprintRaster
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Raster")
+    int32 Width = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Raster")
+    int32 Height = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Raster")
+    FOSMGeoPoint Min;
+
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Raster")
+    FOSMGeoPoint Max;
+
+    /** 255 where a pixel center is covered by a footprint, 0 elsewhere */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Raster")
+    TArray<uint8> Coverage;
+
+    /**
+     * Building covering the pixel, the tallest where footprints overlap. Index into Buildings, or
+     * Buildings.Num() + index into MultiPolygonBuildings, INDEX_NONE for uncovered pixels.
+     */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Raster")
+    TArray<int32> BuildingIndices;
+
+    /** Height in meters of the building covering the pixel, 0 for uncovered pixels */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Raster")
+    TArray<float> Heights;
+};
+
 /**
  *
  */
@@ -31,7 +114,87 @@ public:
     UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Building")
     static bool CheckAndRepairMPBuildingData(UPARAM(ref) AGeoReferenceActor* GeoReference, UPARAM(ref) FMPBuildingData &Building, float MinVertexDistance);
 
+    /**
+     * Writes the buildings of Asset into a flat blob file that can be memory mapped with FOSMBuildingBlob.
+     * Returns false if the file could not be written.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Blob")
+    static bool ExportBuildingBlob(UOSMDataAsset* Asset, const FString& Filename);
+
+    /**
+     * Writes the buildings of Asset as FlatGeobuf file with spatial index, for GIS tools and ImportFlatGeobuf.
+     * Returns false if the file could not be written.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|FlatGeobuf")
+    static bool ExportFlatGeobuf(UOSMDataAsset* Asset, const FString& Filename);
+
+    /** Replaces the buildings of Asset with the footprints of a FlatGeobuf file */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|FlatGeobuf")
+    static bool ImportFlatGeobuf(UOSMDataAsset* Asset, const FString& Filename);
+
+    /**
+     * Like ImportFlatGeobuf for the footprints whose bounds intersect Min/Max. Only the spatial index and the
+     * matching features are read from the file.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|FlatGeobuf")
+    static bool ImportFlatGeobufInBounds(UOSMDataAsset* Asset, const FString& Filename, const FOSMGeoPoint& Min, const FOSMGeoPoint& Max);
+
+    /**
+     * Checks winding order, area and simplicity of all footprints in Asset at once.
+     * Uses the vectorized kernels of FOSMGeometryKernels as a precheck, only non convex rings go through the
+     * exact sweep line test. Runs on all cores.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Validation")
+    static FOSMValidationReport ValidateAsset(UOSMDataAsset* Asset);
+
+    /**
+     * Removes duplicate vertices and spikes from all footprints of Asset, drops degenerate rings and holes
+     * outside of their outer rings from multipolygon buildings. Returns the validation report after repair.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Validation")
+    static FOSMValidationReport RepairAsset(UOSMDataAsset* Asset);
+
+    /**
+     * Checks a building footprint for self intersections and zero area, repairs duplicate vertices and spikes
+     * first if bRepair is set. Returns false if the footprint is invalid.
+     * Footprints stored in a shared vertex pool are checked with ValidateAsset.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Validation")
+    static bool CheckBuildingPolygon(UPARAM(ref) FBuildingData &Building, bool bRepair);
+
+    /**
+     * Like CheckBuildingPolygon for all rings of a multipolygon building, additionally checks that all holes
+     * are inside an outer ring. Repair drops degenerate rings and misplaced holes.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Validation")
+    static bool CheckMPBuildingPolygons(UPARAM(ref) FMPBuildingData &Building, bool bRepair);
+
+    /**
+     * Rasterizes all footprints of Asset into coverage, building index and height grids of Width x Height over
+     * the box Min/Max. Bands of rows are filled on all cores. Returns false for an empty grid or box.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Raster")
+    static bool RasterizeFootprints(UOSMDataAsset* Asset, const FOSMGeoPoint& Min, const FOSMGeoPoint& Max, int32 Width, int32 Height, FOSMFootprintRaster& OutRaster);
+
+    /** Creates a transient single channel float texture from the heights of Raster, e.g. for minimaps */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Raster")
+    static UTexture2D* CreateFootprintHeightTexture(const FOSMFootprintRaster& Raster);
+
+    /**
+     * Converts longitude/latitude positions to game coordinates in one call, through FOSMBatchProjection for
+     * large arrays. Returns false without GeoReference.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Projection")
+    static bool ProjectToGameCoordinates(AGeoReferenceActor* GeoReference, const TArray<FVector>& GeoPoints, TArray<FVector>& OutGamePoints);
+
 private:
     static bool CheckFloorPlanVertexDistance(AGeoReferenceActor* GeoReference, TArray<FVector> &FloorPlan, float MinVertexDistance);
     static bool CheckFloorPlanWindingOrder(TArray<FVector> &FloorPlan, bool Inner);
+
+    /** Removes duplicate vertices and spikes, returns true if the ring was changed */
+    static bool RepairRing(FOSMFootprint &Footprint, const TArray<FOSMGeoPoint> &Resolved);
+    /** Repairs all rings of Building, returns the number of changed or removed rings */
+    static int32 RepairMPBuilding(FMPBuildingData &Building, TFunctionRef<void(const FMPBuildingPart&, TArray<FOSMGeoPoint>&)> Resolve);
+    /** Counts holes of Building that are not inside any of its outer rings */
+    static int32 CountHolesOutsideOuter(const FMPBuildingData &Building, TFunctionRef<void(const FMPBuildingPart&, TArray<FOSMGeoPoint>&)> Resolve);
 };
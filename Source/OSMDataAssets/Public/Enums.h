@@ -293,3 +293,121 @@ enum EOSMBuildingType {
     /** Use this value (building=yes) where it is not possible to determine a more specific value.   */
     OtherBuilding
 };
+
+/** Coarse categories of points of interest, derived from the main tag of a node */
+UENUM(BlueprintType)
+enum EOSMPOICategory {
+    /** Restaurants, cafes, bars, pubs and fast food (amenity=restaurant, cafe, ...) */
+    FoodPOI,
+    /** Any shop=* */
+    ShopPOI,
+    /** Schools, kindergartens, universities and libraries */
+    EducationPOI,
+    /** Hospitals, clinics, doctors and pharmacies */
+    HealthPOI,
+    /** Banks and ATMs */
+    FinancePOI,
+    /** Public transport stops and stations */
+    TransportPOI,
+    /** Parking, fuel and charging stations */
+    VehiclePOI,
+    /** Any tourism=*, e.g. hotels, museums and viewpoints */
+    TourismPOI,
+    /** Any leisure=*, e.g. playgrounds and sports centres */
+    LeisurePOI,
+    /** Places of worship */
+    WorshipPOI,
+    /** Police, fire stations, town halls and post offices */
+    PublicServicePOI,
+    /** Any historic=* */
+    HistoricPOI,
+    /** Any office=* or craft=* */
+    OfficePOI,
+    /** Any other amenity=* or emergency=* */
+    AmenityPOI,
+    /** Tagged node of unknown category */
+    OtherPOI
+};
+
+/** Types of area polygons, closed ways and multipolygons tagged with landuse, natural, leisure or water */
+UENUM(BlueprintType)
+enum EOSMAreaType {
+    /// LANDUSE
+
+    /** landuse=residential */
+    ResidentialArea,
+    /** landuse=commercial */
+    CommercialArea,
+    /** landuse=industrial */
+    IndustrialArea,
+    /** landuse=retail */
+    RetailArea,
+    /** landuse=farmland or farmyard */
+    FarmlandArea,
+    /** landuse=orchard or vineyard */
+    OrchardArea,
+    /** landuse=cemetery or amenity=grave_yard */
+    CemeteryArea,
+    /** landuse=construction, brownfield or greenfield */
+    ConstructionArea,
+
+    /// NATURE
+
+    /** landuse=forest or natural=wood */
+    ForestArea,
+    /** landuse=grass, village_green, recreation_ground or natural=grassland */
+    GrassArea,
+    /** landuse=meadow */
+    MeadowArea,
+    /** natural=scrub */
+    ScrubArea,
+    /** natural=heath */
+    HeathArea,
+    /** natural=wetland */
+    WetlandArea,
+    /** natural=beach or sand */
+    BeachArea,
+    /** natural=bare_rock or scree */
+    BareRockArea,
+    /** natural=water, waterway=riverbank, landuse=reservoir or basin */
+    WaterArea,
+
+    /// LEISURE
+
+    /** leisure=park */
+    ParkArea,
+    /** leisure=garden */
+    GardenArea,
+    /** leisure=pitch or sports_centre */
+    PitchArea,
+    /** leisure=playground */
+    PlaygroundArea,
+    /** leisure=golf_course */
+    GolfArea,
+
+    /// UNSUPPORTED
+
+    /** Any other landuse=* */
+    OtherArea
+};
+
+/** Where the height of a building comes from */
+UENUM(BlueprintType)
+enum EOSMHeightSource {
+    /** Neither height nor levels are known, the height is 0 */
+    HeightUnknown,
+    /** The height tag, converted to meters */
+    HeightFromTag,
+    /** building:levels times the storey height of the building type */
+    HeightFromLevels,
+    /** The default number of levels times the storey height of the building type */
+    HeightFromTypeDefault
+};
+
+/** Types of OSM elements, IDs are only unique within one type */
+UENUM(BlueprintType)
+enum EOSMElementType {
+    NodeElement,
+    WayElement,
+    RelationElement
+};
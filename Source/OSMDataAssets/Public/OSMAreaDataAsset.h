@@ -0,0 +1,74 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Enums.h"
+#include "OSMDataAsset.h"
+
+#include "OSMAreaDataAsset.generated.h"
+
+/** A land use, nature or leisure area, a closed way or a multipolygon relation */
+USTRUCT(BlueprintType)
+struct OSMDATAASSETS_API FOSMAreaData {
+    GENERATED_BODY()
+    /** OSM ID of the way or relation */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    int64 ID;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TEnumAsByte<EOSMElementType> ElementType;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TEnumAsByte<EOSMAreaType> AreaType;
+    /** Rings in fixed point coordinates, inner rings are holes */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TArray<FMPBuildingPart> Rings;
+
+    FOSMAreaData() {
+        ID = 0;
+        ElementType = EOSMElementType::WayElement;
+        AreaType = EOSMAreaType::OtherArea;
+    }
+};
+
+/**
+ * Area polygons of an OSM file, sorted by EOSMAreaType like the buildings of a bucketed UOSMDataAsset.
+ * Rings are always stored as FOSMGeoPoint, areas are large and their vertices rarely shared.
+ */
+UCLASS(BlueprintType, hidecategories=(Object))
+class OSMDATAASSETS_API UOSMAreaDataAsset : public UDataAsset
+{
+    GENERATED_BODY()
+public:
+    UPROPERTY(BlueprintReadOnly, EditAnywhere)
+    TArray<FOSMAreaData> Areas;
+
+    /** Areas of type T are Areas[AreaTypeOffsets[T], AreaTypeOffsets[T + 1]) */
+    UPROPERTY(VisibleAnywhere)
+    TArray<int32> AreaTypeOffsets;
+
+    /** Stable sorts Areas by type and updates AreaTypeOffsets */
+    void BucketByAreaType();
+
+    /** Contiguous view of all areas of Type */
+    TArrayView<const FOSMAreaData> GetAreasOfType(EOSMAreaType Type) const;
+
+    /** Index range of the areas of Type. Returns false if the areas are not bucketed. */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Area")
+    bool GetAreaTypeRange(TEnumAsByte<EOSMAreaType> Type, int32& OutFirst, int32& OutNum) const;
+
+    /** Bounding box of all areas, returns false if there are none */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Area")
+    bool GetBounds(FOSMGeoPoint& OutMin, FOSMGeoPoint& OutMax) const;
+
+    /**
+     * Rasterizes all areas of the given types into an 8 bit mask of Width x Height over the box Min/Max, 255 where
+     * a pixel center is covered and 0 elsewhere. Rows run from north to south, the layout of landscape layer
+     * weightmaps. Runs in parallel.
+     */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Area")
+    bool RasterizeLayerMask(const TArray<TEnumAsByte<EOSMAreaType>>& Types, const FOSMGeoPoint& Min, const FOSMGeoPoint& Max, int32 Width, int32 Height, TArray<uint8>& OutMask) const;
+
+    /** Rasterizes a layer mask like RasterizeLayerMask and saves it as 8 bit raw file for landscape layer import */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Area")
+    bool ExportLayerMask(const FString& Filename, const TArray<TEnumAsByte<EOSMAreaType>>& Types, const FOSMGeoPoint& Min, const FOSMGeoPoint& Max, int32 Width, int32 Height) const;
+};
@@ -0,0 +1,79 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AGeoReferenceActor;
+class UOSMDataAsset;
+struct FOSMGeoPoint;
+
+/**
+ * Projects many longitude/latitude positions to game coordinates of an AGeoReferenceActor per call.
+ * The projection of the actor is sampled on a grid over a bounding box and approximated by a quadratic
+ * polynomial per game axis, which is evaluated four vertices at a time. The polynomial is checked against the
+ * actor between the samples, if it deviates by more than the tolerance every vertex is projected by the actor
+ * instead. Positions outside the box or with an altitude are always projected by the actor.
+ *
+ * Fitting and the fallback call the actor, which is not thread safe: create the projection on the game thread
+ * and hand it to workers for Evaluate only. The actor is not kept alive, it has to outlive the projection.
+ */
+class OSMDATAASSETS_API FOSMBatchProjection
+{
+public:
+    /** Fits the projection of InGeoReference for positions within the box Min/Max in degrees */
+    FOSMBatchProjection(AGeoReferenceActor* InGeoReference, const FVector2D& Min, const FVector2D& Max, float Tolerance = 1.f);
+
+    /** Fits the projection for the bounds of all footprints of Asset */
+    static FOSMBatchProjection ForAsset(AGeoReferenceActor* GeoReference, const UOSMDataAsset* Asset, float Tolerance = 1.f);
+
+    /** True if the polynomial is within tolerance, otherwise every vertex is projected by the actor */
+    bool IsFitted() const { return bIsFitted; }
+
+    /** Largest deviation from the actor found while fitting, in game units */
+    double GetFitError() const { return FitError; }
+
+    /**
+     * Projects GeoPoints into OutGamePoints, both views need the same size. Positions the polynomial does not
+     * cover are projected by the actor on the calling thread, which has to be the game thread then.
+     */
+    void Project(TArrayView<const FVector> GeoPoints, TArrayView<FVector> OutGamePoints) const;
+
+    /** Like Project for fixed point coordinates, offsets to the center of the box are computed exactly */
+    void Project(TArrayView<const FOSMGeoPoint> Coordinates, TArrayView<FVector> OutGamePoints) const;
+
+    /** Like Project, the polynomial is evaluated on all cores for large arrays */
+    void ProjectParallel(TArrayView<const FVector> GeoPoints, TArrayView<FVector> OutGamePoints) const;
+
+    /**
+     * Evaluates the polynomial only and never calls the actor, so it is safe on any thread. The indices of the
+     * positions it does not cover are appended to OutActorIndices, their output is undefined until
+     * ProjectWithActor wrote them. Without a fit every index is listed.
+     */
+    void Evaluate(TArrayView<const FVector> GeoPoints, TArrayView<FVector> OutGamePoints, TArray<int32>& OutActorIndices) const;
+    void Evaluate(TArrayView<const FOSMGeoPoint> Coordinates, TArrayView<FVector> OutGamePoints, TArray<int32>& OutActorIndices) const;
+
+    /** Projects the positions at Indices by the actor, on the game thread */
+    void ProjectWithActor(TArrayView<const FVector> GeoPoints, const TArray<int32>& Indices, TArrayView<FVector> OutGamePoints) const;
+    void ProjectWithActor(TArrayView<const FOSMGeoPoint> Coordinates, const TArray<int32>& Indices, TArrayView<FVector> OutGamePoints) const;
+
+    /**
+     * Projects GeoPoints in one call on the game thread. The polynomial is only fitted if there are enough points
+     * to pay for the samples, few points are projected by the actor directly.
+     */
+    static void ProjectPoints(AGeoReferenceActor* GeoReference, const TArray<FVector>& GeoPoints, TArray<FVector>& OutGamePoints);
+
+private:
+    /** Writes four vertices from their normalized offsets, lanes past Count are ignored */
+    void EvaluateBlock(const float* U, const float* V, int32 Count, FVector* OutGamePoints) const;
+
+    AGeoReferenceActor* GeoReference;
+    double CenterLongitude = 0;
+    double CenterLatitude = 0;
+    /** Scale from degrees to the normalized offsets in [-1, 1] the polynomial is fitted for */
+    double InvHalfWidth = 0;
+    double InvHalfHeight = 0;
+    /** Per game axis the coefficients of 1, u, v, u², uv and v² */
+    double Coefficients[3][6];
+    double FitError = 0;
+    bool bIsFitted = false;
+};
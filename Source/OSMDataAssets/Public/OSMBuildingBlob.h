@@ -0,0 +1,158 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Enums.h"
+
+class UOSMDataAsset;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * Flat, versioned binary layout of a building set. All sections are 8 byte aligned and little endian so
+ * the file can be memory mapped and read in place:
+ *
+ *   FOSMBlobHeader
+ *   FOSMBlobBuildingRecord[BuildingCount]
+ *   FOSMBlobMPBuildingRecord[MPBuildingCount]
+ *   FOSMBlobPartRecord[PartCount]
+ *   FOSMBlobVertex[VertexCount]
+ */
+namespace OSMBuildingBlob
+{
+    static constexpr uint32 Magic = 0x424D534F; // "OSMB"
+    static constexpr uint32 Version = 1;
+}
+
+struct FOSMBlobHeader
+{
+    uint32 Magic;
+    uint32 Version;
+    uint32 BuildingCount;
+    uint32 MPBuildingCount;
+    uint32 PartCount;
+    uint32 Reserved;
+    uint64 VertexCount;
+    uint64 BuildingTableOffset;
+    uint64 MPBuildingTableOffset;
+    uint64 PartTableOffset;
+    uint64 VertexOffset;
+    uint64 TotalSize;
+};
+
+/** Longitude/latitude pair, stored in double precision */
+struct FOSMBlobVertex
+{
+    double Longitude;
+    double Latitude;
+};
+
+struct FOSMBlobBuildingRecord
+{
+    int64 ID;
+    uint32 FirstVertex;
+    uint32 VertexCount;
+    float Height;
+    int32 Levels;
+    uint8 BuildingType;
+    /** EOSMHeightSource, 0 in blobs written before it was stored */
+    uint8 HeightSource;
+    uint8 Padding[6];
+};
+
+struct FOSMBlobMPBuildingRecord
+{
+    int64 ID;
+    uint32 FirstPart;
+    uint32 PartCount;
+    float Height;
+    int32 Levels;
+    uint8 BuildingType;
+    uint8 bHasHole;
+    /** EOSMHeightSource, 0 in blobs written before it was stored */
+    uint8 HeightSource;
+    uint8 Padding[5];
+};
+
+struct FOSMBlobPartRecord
+{
+    uint32 FirstVertex;
+    uint32 VertexCount;
+    uint8 bIsInner;
+    uint8 Padding[7];
+};
+
+static_assert(sizeof(FOSMBlobHeader) == 72, "Blob header layout changed, bump OSMBuildingBlob::Version");
+static_assert(sizeof(FOSMBlobBuildingRecord) == 32, "Blob record layout changed, bump OSMBuildingBlob::Version");
+static_assert(sizeof(FOSMBlobMPBuildingRecord) == 32, "Blob record layout changed, bump OSMBuildingBlob::Version");
+static_assert(sizeof(FOSMBlobPartRecord) == 16, "Blob record layout changed, bump OSMBuildingBlob::Version");
+
+/** Read-only view of a simple building inside a blob. Only valid as long as the owning FOSMBuildingBlob is. */
+struct FOSMBuildingView
+{
+    const FOSMBlobBuildingRecord* Record;
+    TArrayView<const FOSMBlobVertex> Vertices;
+
+    int64 GetID() const { return Record->ID; }
+    EOSMBuildingType GetBuildingType() const { return static_cast<EOSMBuildingType>(Record->BuildingType); }
+    float GetHeight() const { return Record->Height; }
+    int32 GetLevels() const { return Record->Levels; }
+    EOSMHeightSource GetHeightSource() const { return static_cast<EOSMHeightSource>(Record->HeightSource); }
+};
+
+/** Read-only view of one ring of a multipolygon building inside a blob */
+struct FOSMBuildingPartView
+{
+    const FOSMBlobPartRecord* Record;
+    TArrayView<const FOSMBlobVertex> Vertices;
+
+    bool IsInner() const { return Record->bIsInner != 0; }
+};
+
+/**
+ * Building set backed by a memory mapped (or single allocation) blob file.
+ * Buildings are accessed through views, no per building memory is allocated.
+ */
+class OSMDATAASSETS_API FOSMBuildingBlob
+{
+public:
+    FOSMBuildingBlob();
+    ~FOSMBuildingBlob();
+
+    /** Serializes the building arrays of Asset into the blob layout */
+    static bool Write(const UOSMDataAsset* Asset, TArray64<uint8>& OutData);
+    static bool WriteToFile(const UOSMDataAsset* Asset, const FString& Filename);
+
+    /** Memory maps Filename. Falls back to loading the file into a single buffer where mapping is not supported. */
+    bool Open(const FString& Filename);
+
+    /** Uses an in-memory blob. The memory must outlive this object. */
+    bool OpenFromMemory(TArrayView<const uint8> Data);
+
+    void Close();
+    bool IsOpen() const { return Header != nullptr; }
+
+    int32 NumBuildings() const { return Header ? Header->BuildingCount : 0; }
+    int32 NumMPBuildings() const { return Header ? Header->MPBuildingCount : 0; }
+
+    FOSMBuildingView GetBuilding(int32 Index) const;
+
+    const FOSMBlobMPBuildingRecord& GetMPBuilding(int32 Index) const;
+    FOSMBuildingPartView GetMPBuildingPart(int32 BuildingIndex, int32 PartIndex) const;
+
+    /** Copies the blob contents into the UPROPERTY arrays of Asset, e.g. when Blueprint access is needed */
+    void CopyToAsset(UOSMDataAsset* Asset) const;
+
+private:
+    bool ValidateAndBind(const uint8* InData, int64 InSize);
+
+    TUniquePtr<IMappedFileHandle> MappedHandle;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+    TArray64<uint8> FallbackData;
+
+    const FOSMBlobHeader* Header;
+    const FOSMBlobBuildingRecord* BuildingRecords;
+    const FOSMBlobMPBuildingRecord* MPBuildingRecords;
+    const FOSMBlobPartRecord* PartRecords;
+    const FOSMBlobVertex* Vertices;
+};
@@ -0,0 +1,206 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "GeoReferenceActor.h"
+#include "OSMDataAsset.h"
+
+#include "OSMBuildingSpawnSubsystem.generated.h"
+
+/** One ring of a prepared building in game coordinates, the closing vertex is not repeated */
+USTRUCT(BlueprintType)
+struct OSMDATAASSETS_API FOSMPreparedRing {
+    GENERATED_BODY()
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    TArray<FVector> Vertices;
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    bool bIsInner;
+
+    FOSMPreparedRing() {
+        bIsInner = false;
+    }
+};
+
+/** A building of a UOSMDataAsset with its rings projected to game coordinates, handed to the spawn callback */
+USTRUCT(BlueprintType)
+struct OSMDATAASSETS_API FOSMPreparedBuilding {
+    GENERATED_BODY()
+    /** Index into Buildings, or MultiPolygonBuildings with bIsMultiPolygon */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    int32 BuildingIndex;
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    bool bIsMultiPolygon;
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    int64 ID;
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    TEnumAsByte<EOSMBuildingType> BuildingType;
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    float Height;
+    /** Average of the outer ring vertices, the distance to the viewer is measured from here */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    FVector Center;
+    /** A single ring for simple buildings, all parts for multipolygon buildings */
+    UPROPERTY(BlueprintReadOnly, Category="OSMDataAssets|Spawning")
+    TArray<FOSMPreparedRing> Rings;
+
+    FOSMPreparedBuilding() {
+        BuildingIndex = INDEX_NONE;
+        bIsMultiPolygon = false;
+        ID = 0;
+        BuildingType = EOSMBuildingType::OtherBuilding;
+        Height = 0;
+        Center = FVector::ZeroVector;
+    }
+};
+
+/** Identifies a spawn request of UOSMBuildingSpawnSubsystem */
+USTRUCT(BlueprintType)
+struct OSMDATAASSETS_API FOSMSpawnHandle {
+    GENERATED_BODY()
+    UPROPERTY()
+    int32 ID;
+
+    FOSMSpawnHandle() {
+        ID = 0;
+    }
+    bool IsValid() const {
+        return ID != 0;
+    }
+};
+
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOSMSpawnBuildingDelegate, const FOSMPreparedBuilding&, Building);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOSMSpawnFinishedDelegate, FOSMSpawnHandle, Handle);
+
+/** Worker side state of a request, shared with its preparation task */
+struct FOSMSpawnWork;
+
+USTRUCT()
+struct FOSMSpawnRequest {
+    GENERATED_BODY()
+    UPROPERTY()
+    UOSMDataAsset* Asset;
+    UPROPERTY()
+    AGeoReferenceActor* GeoReference;
+    UPROPERTY()
+    FOSMSpawnBuildingDelegate OnSpawn;
+    UPROPERTY()
+    FOSMSpawnFinishedDelegate OnFinished;
+    TSharedPtr<FOSMSpawnWork, ESPMode::ThreadSafe> Work;
+
+    FOSMSpawnRequest() {
+        Asset = nullptr;
+        GeoReference = nullptr;
+    }
+};
+
+/**
+ * Spreads spawning the buildings of a UOSMDataAsset over many frames. Footprints are resolved and projected to
+ * game coordinates on worker threads, with an FOSMBatchProjection fitted on the game thread. Vertices it does
+ * not cover are projected by the geo reference on the game thread within FrameBudgetMs. The spawn callback then
+ * runs on the game thread for as many buildings as fit into the budget, nearest to the viewer first. What is
+ * spawned is up to the callback, e.g. an actor or a procedural mesh section per building.
+ *
+ * Asset and GeoReference are kept alive while a request runs. A request is canceled when either of them is
+ * destroyed, e.g. when the level of a tile unloads.
+ */
+UCLASS()
+class OSMDATAASSETS_API UOSMBuildingSpawnSubsystem
+    : public UWorldSubsystem
+    , public FTickableGameObject
+{
+    GENERATED_BODY()
+public:
+    /** Game thread time per frame for spawn callbacks in milliseconds, at least one building is spawned per frame */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="OSMDataAssets|Spawning")
+    float FrameBudgetMs = 2.f;
+
+    /** Pending buildings are reordered when the viewer moved further than this since the last ordering */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="OSMDataAssets|Spawning")
+    float ReprioritizeDistance = 5000.f;
+
+    /** Spawns all buildings of Asset. OnFinished is called after the last one unless the request is canceled. */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Spawning")
+    FOSMSpawnHandle SpawnBuildings(UOSMDataAsset* Asset, AGeoReferenceActor* GeoReference, FOSMSpawnBuildingDelegate OnSpawn, FOSMSpawnFinishedDelegate OnFinished);
+
+    /** Spawns the listed buildings and multipolygon buildings of Asset, e.g. the ones of a tile */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Spawning")
+    FOSMSpawnHandle SpawnBuildingSubset(UOSMDataAsset* Asset, AGeoReferenceActor* GeoReference, const TArray<int32>& BuildingIndices, const TArray<int32>& MPBuildingIndices, FOSMSpawnBuildingDelegate OnSpawn, FOSMSpawnFinishedDelegate OnFinished);
+
+    /** Native variant of SpawnBuildingSubset, with bAllBuildings the index arrays are ignored and the whole asset is spawned */
+    FOSMSpawnHandle RequestSpawn(UOSMDataAsset* Asset, AGeoReferenceActor* GeoReference, TArray<int32> BuildingIndices, TArray<int32> MPBuildingIndices, bool bAllBuildings, TFunction<void(const FOSMPreparedBuilding&)> OnSpawn);
+
+    /** Stops a request, no spawn callbacks are called for it afterwards. Waits for its current worker batch. */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Spawning")
+    void CancelSpawn(FOSMSpawnHandle Handle);
+
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Spawning")
+    void CancelAll();
+
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Spawning")
+    bool IsSpawning(FOSMSpawnHandle Handle) const;
+
+    /**
+     * Number of prepared buildings waiting for their spawn callback, or for the game thread to finish
+     * projecting them
+     */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Spawning")
+    int32 GetNumPending() const;
+
+    /** Prioritize around Location instead of the camera of the first player */
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Spawning")
+    void SetViewerLocation(const FVector& Location);
+
+    UFUNCTION(BlueprintCallable, Category="OSMDataAssets|Spawning")
+    void ClearViewerLocation();
+
+    // UWorldSubsystem
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual bool IsTickable() const override;
+    virtual TStatId GetStatId() const override;
+    virtual UWorld* GetTickableGameObjectWorld() const override;
+
+private:
+    struct FReadyBuilding
+    {
+        int32 RequestID;
+        int32 Index;
+        double DistanceSquared;
+    };
+
+    FOSMSpawnHandle StartRequest(FOSMSpawnRequest&& Request, TArray<int32>&& BuildingIndices, TArray<int32>&& MPBuildingIndices);
+
+    /** Signals the worker to stop, waits for it and drops all pending buildings of the request */
+    void StopRequest(int32 RequestID);
+
+    /** Cancels requests whose asset or geo reference is about to be collected */
+    void HandlePreGarbageCollect();
+
+    /** Moves finished worker batches into the ready heap, or aside if the actor has to project some vertices */
+    void CollectPrepared();
+
+    /** Projects the vertices the polynomial did not cover until EndTime, finished buildings become ready */
+    void ProjectUnprojected(double EndTime);
+
+    void AddReady(int32 RequestID, FOSMSpawnWork& Work, FOSMPreparedBuilding&& Prepared);
+
+    bool GetViewerLocation(FVector& OutLocation) const;
+    void Reprioritize(const FVector& ViewerLocation);
+
+    UPROPERTY()
+    TMap<int32, FOSMSpawnRequest> Requests;
+
+    /** Min heap by distance to the viewer */
+    TArray<FReadyBuilding> ReadyHeap;
+
+    FVector PriorityLocation = FVector::ZeroVector;
+    FVector ViewerOverride = FVector::ZeroVector;
+    bool bHasViewerOverride = false;
+    int32 NextRequestID = 1;
+    FDelegateHandle PreGarbageCollectHandle;
+};
@@ -1,37 +1,130 @@
 ﻿// Copyright (c) Iwer Petersen. All rights reserved.
 #pragma once
 #include "Enums.h"
+#include "OSMImportSettings.h"
 #include "OSMDataAsset.generated.h"
 
 
+/**
+ * Geographic coordinate stored like OSM itself as degrees scaled by 1e7 in fixed point.
+ * Exact for OSM data, independent of the float precision of FVector and half the size of two doubles.
+ */
 USTRUCT(BlueprintType)
-struct FBuildingData {
+struct OSMDATAASSETS_API FOSMGeoPoint {
     GENERATED_BODY()
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
-    FString ID;
+    int32 LongitudeE7;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    int32 LatitudeE7;
+
+    static constexpr double Scale = 1e7;
+
+    FOSMGeoPoint() {
+        LongitudeE7 = 0;
+        LatitudeE7 = 0;
+    }
+    FOSMGeoPoint(int32 InLongitudeE7, int32 InLatitudeE7) {
+        LongitudeE7 = InLongitudeE7;
+        LatitudeE7 = InLatitudeE7;
+    }
+
+    static FOSMGeoPoint FromDegrees(double Longitude, double Latitude) {
+        return FOSMGeoPoint(static_cast<int32>(FMath::RoundToDouble(Longitude * Scale)), static_cast<int32>(FMath::RoundToDouble(Latitude * Scale)));
+    }
+    /** Converts a PolygonPoints entry, X is longitude and Y latitude */
+    static FOSMGeoPoint FromVector(const FVector& Point) {
+        return FromDegrees(Point.X, Point.Y);
+    }
+
+    double GetLongitude() const { return LongitudeE7 / Scale; }
+    double GetLatitude() const { return LatitudeE7 / Scale; }
+
+    /** Converts to the PolygonPoints layout, loses precision where FVector is float */
+    FVector ToVector() const {
+        return FVector(GetLongitude(), GetLatitude(), 0);
+    }
+
+    /** Exact offset from this point to Other in degrees, precise as float for the extent of a building */
+    FVector2D DeltaTo(const FOSMGeoPoint& Other) const {
+        return FVector2D((static_cast<int64>(Other.LongitudeE7) - LongitudeE7) / Scale,
+                         (static_cast<int64>(Other.LatitudeE7) - LatitudeE7) / Scale);
+    }
+
+    bool operator==(const FOSMGeoPoint& Other) const {
+        return LongitudeE7 == Other.LongitudeE7 && LatitudeE7 == Other.LatitudeE7;
+    }
+    bool operator!=(const FOSMGeoPoint& Other) const {
+        return !(*this == Other);
+    }
+};
+
+/**
+ * Vertices of a footprint ring, the closing vertex is not repeated. Only one of the arrays is used, depending on
+ * the FOSMImportSettings of the owning asset. Use UOSMDataAsset::ResolvePoints or ResolveCoordinates to read them.
+ */
+USTRUCT(BlueprintType)
+struct OSMDATAASSETS_API FOSMFootprint {
+    GENERATED_BODY()
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     TArray<FVector> PolygonPoints;
+    /** Fixed point vertices, used instead of PolygonPoints with fixed point coordinates */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TArray<FOSMGeoPoint> PolygonCoordinates;
+    /**
+     * Vertices as indices into UOSMDataAsset::NodeCoordinates or NodePositions, used instead of the other arrays
+     * with a shared vertex pool
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TArray<int32> PolygonIndices;
+
+    int32 NumVertices() const {
+        return FMath::Max3(PolygonPoints.Num(), PolygonCoordinates.Num(), PolygonIndices.Num());
+    }
+
+    /** Keeps only the vertices listed in Keep, in that order, in whichever array is used */
+    void KeepVertices(const TArray<int32>& Keep);
+};
+
+USTRUCT(BlueprintType)
+struct FBuildingData : public FOSMFootprint {
+    GENERATED_BODY()
+    /** OSM ID of the way */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    int64 ID;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TEnumAsByte<EOSMElementType> ElementType;
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     TEnumAsByte<EOSMBuildingType> BuildingType;
+    /** Height in meters, estimated at import if not tagged, see HeightSource */
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     float Height;
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     int32 Levels;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TEnumAsByte<EOSMHeightSource> HeightSource;
     FBuildingData() {
         ID = 0;
+        ElementType = EOSMElementType::WayElement;
         BuildingType = EOSMBuildingType::OtherBuilding;
         Height = 0;
         Levels = 0;
+        HeightSource = EOSMHeightSource::HeightUnknown;
     }
+    /** Reads the string IDs of packages from before numeric IDs, everything else is tagged properties */
+    bool Serialize(FArchive& Ar);
+};
+
+template<>
+struct TStructOpsTypeTraits<FBuildingData> : public TStructOpsTypeTraitsBase2<FBuildingData>
+{
+    enum { WithSerializer = true };
 };
 
 USTRUCT(BlueprintType)
-struct FMPBuildingPart {
+struct FMPBuildingPart : public FOSMFootprint {
     GENERATED_BODY()
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     uint8 bIsInner : 1;
-    UPROPERTY(EditAnywhere, BlueprintReadWrite)
-    TArray<FVector> PolygonPoints;
     FMPBuildingPart() {
         bIsInner = 0;
     }
@@ -40,20 +133,81 @@ struct FMPBuildingPart {
 USTRUCT(BlueprintType)
 struct FMPBuildingData {
     GENERATED_BODY()
+    /** OSM ID of the relation */
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
-    FString ID;
+    int64 ID;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TEnumAsByte<EOSMElementType> ElementType;
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     TArray<FMPBuildingPart> Parts;
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     uint8 bHasHole : 1;
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     TEnumAsByte<EOSMBuildingType> BuildingType;
+    /** Height in meters, estimated at import if not tagged, see HeightSource */
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     float Height;
     UPROPERTY(EditAnywhere, BlueprintReadWrite)
     int32 Levels;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TEnumAsByte<EOSMHeightSource> HeightSource;
     FMPBuildingData() {
         ID = 0;
+        ElementType = EOSMElementType::RelationElement;
+        bHasHole = 0;
+        BuildingType = EOSMBuildingType::OtherBuilding;
+        Height = 0;
+        Levels = 0;
+        HeightSource = EOSMHeightSource::HeightUnknown;
+    }
+    /** Reads the string IDs of packages from before numeric IDs, everything else is tagged properties */
+    bool Serialize(FArchive& Ar);
+};
+
+template<>
+struct TStructOpsTypeTraits<FMPBuildingData> : public TStructOpsTypeTraitsBase2<FMPBuildingData>
+{
+    enum { WithSerializer = true };
+};
+
+/** FBuildingData as saved before OSM IDs were numeric, only read from old packages */
+USTRUCT()
+struct FOSMLegacyBuildingData {
+    GENERATED_BODY()
+    UPROPERTY()
+    FString ID;
+    UPROPERTY()
+    TArray<FVector> PolygonPoints;
+    UPROPERTY()
+    TEnumAsByte<EOSMBuildingType> BuildingType;
+    UPROPERTY()
+    float Height;
+    UPROPERTY()
+    int32 Levels;
+    FOSMLegacyBuildingData() {
+        BuildingType = EOSMBuildingType::OtherBuilding;
+        Height = 0;
+        Levels = 0;
+    }
+};
+
+/** FMPBuildingData as saved before OSM IDs were numeric, only read from old packages */
+USTRUCT()
+struct FOSMLegacyMPBuildingData {
+    GENERATED_BODY()
+    UPROPERTY()
+    FString ID;
+    UPROPERTY()
+    TArray<FMPBuildingPart> Parts;
+    UPROPERTY()
+    uint8 bHasHole : 1;
+    UPROPERTY()
+    TEnumAsByte<EOSMBuildingType> BuildingType;
+    UPROPERTY()
+    float Height;
+    UPROPERTY()
+    int32 Levels;
+    FOSMLegacyMPBuildingData() {
         bHasHole = 0;
         BuildingType = EOSMBuildingType::OtherBuilding;
         Height = 0;
@@ -61,6 +215,171 @@ struct FMPBuildingData {
     }
 };
 
+/** Additional building attributes of a single building, resolved from FOSMBuildingAttributeTable */
+USTRUCT(BlueprintType)
+struct FOSMBuildingAttributes {
+    GENERATED_BODY()
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    float MinHeight;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    int32 MinLevel;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    float RoofHeight;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    FString RoofShape;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    FString BuildingPart;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    FString BuildingColour;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    FString BuildingMaterial;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    FString RoofColour;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    FString RoofMaterial;
+    FOSMBuildingAttributes() {
+        MinHeight = 0;
+        MinLevel = 0;
+        RoofHeight = 0;
+    }
+    bool operator==(const FOSMBuildingAttributes& Other) const {
+        return MinHeight == Other.MinHeight && MinLevel == Other.MinLevel && RoofHeight == Other.RoofHeight
+            && RoofShape == Other.RoofShape && BuildingPart == Other.BuildingPart
+            && BuildingColour == Other.BuildingColour && BuildingMaterial == Other.BuildingMaterial
+            && RoofColour == Other.RoofColour && RoofMaterial == Other.RoofMaterial;
+    }
+};
+
+/**
+ * Columnar storage of additional building attributes. Row i belongs to building i of the owning array.
+ * String values are interned, string columns store indices into Strings or INDEX_NONE if the tag was not set.
+ */
+USTRUCT()
+struct OSMDATAASSETS_API FOSMBuildingAttributeTable {
+    GENERATED_BODY()
+    UPROPERTY(VisibleAnywhere)
+    TArray<FString> Strings;
+    UPROPERTY()
+    TArray<float> MinHeight;
+    UPROPERTY()
+    TArray<int16> MinLevel;
+    UPROPERTY()
+    TArray<float> RoofHeight;
+    UPROPERTY()
+    TArray<int32> RoofShape;
+    UPROPERTY()
+    TArray<int32> BuildingPart;
+    UPROPERTY()
+    TArray<int32> BuildingColour;
+    UPROPERTY()
+    TArray<int32> BuildingMaterial;
+    UPROPERTY()
+    TArray<int32> RoofColour;
+    UPROPERTY()
+    TArray<int32> RoofMaterial;
+
+    int32 Num() const { return MinHeight.Num(); }
+    void Reserve(int32 Rows);
+    void Empty();
+
+    /** Appends a row and returns its index */
+    int32 AddRow(const FOSMBuildingAttributes& Attributes);
+    FOSMBuildingAttributes GetRow(int32 Row) const;
+    void SetRow(int32 Row, const FOSMBuildingAttributes& Attributes);
+
+    /** Truncates the table or appends empty rows */
+    void SetNum(int32 Rows);
+
+    /** Rearranges the rows so that new row i is old row Order[i]. Rows not in Order are dropped. */
+    void Reorder(const TArray<int32>& Order);
+
+    /** Returns the index of Value in Strings, adding it if necessary. Empty values are stored as INDEX_NONE. */
+    int32 Intern(const FString& Value);
+    const FString& GetString(int32 StringIndex) const;
+
+private:
+    /** Lookup for interning while building the table, not serialized */
+    TMap<FString, int32> StringLookup;
+};
+
+/**
+ * Graph of the buildings that touch each other, in compressed sparse row form. Node i is Buildings[i] for
+ * i < NumBuildings and MultiPolygonBuildings[i - NumBuildings] above. The neighbours of node i are
+ * Neighbours[Offsets[i], Offsets[i + 1]) in ascending order, every edge is stored for both of its nodes.
+ */
+USTRUCT()
+struct OSMDATAASSETS_API FOSMBuildingAdjacency {
+    GENERATED_BODY()
+    /** Number of Buildings the graph was built for, the first node of the multipolygon buildings */
+    UPROPERTY(VisibleAnywhere)
+    int32 NumBuildings;
+    /** One entry per node plus one, empty if the graph was not computed */
+    UPROPERTY()
+    TArray<int32> Offsets;
+    UPROPERTY()
+    TArray<int32> Neighbours;
+    /** Wall segments shared with the neighbour at the same position, 0 if the buildings only share nodes */
+    UPROPERTY()
+    TArray<int32> SharedWalls;
+
+    /** An undirected edge, listed once with A < B */
+    struct FEdge {
+        int32 A;
+        int32 B;
+        int32 SharedWalls;
+    };
+
+    FOSMBuildingAdjacency() {
+        NumBuildings = 0;
+    }
+
+    int32 NumNodes() const { return FMath::Max(Offsets.Num() - 1, 0); }
+    bool IsEmpty() const { return Offsets.Num() == 0; }
+    void Empty();
+
+    /** Replaces the graph by InNumNodes nodes connected by Edges */
+    void SetEdges(int32 InNumBuildings, int32 InNumNodes, const TArray<FEdge>& Edges);
+
+    /** Appends the edges of the graph to OutEdges, each once */
+    void GetEdges(TArray<FEdge>& OutEdges) const;
+
+    TArrayView<const int32> GetNeighbours(int32 Node) const;
+    TArrayView<const int32> GetSharedWalls(int32 Node) const;
+
+    /** Follows FOSMDataAssetBuilder::ReorderBuildings, edges of removed buildings are dropped */
+    void Reorder(const TArray<int32>& BuildingOrder, const TArray<int32>& MPBuildingOrder);
+};
+
+/** OSM IDs of the buildings that were added, removed, modified or moved to another slot by a reimport */
+USTRUCT(BlueprintType)
+struct OSMDATAASSETS_API FOSMDataAssetChangeSet {
+    GENERATED_BODY()
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    TArray<int64> AddedBuildings;
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    TArray<int64> RemovedBuildings;
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    TArray<int64> ModifiedBuildings;
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    TArray<int64> AddedMPBuildings;
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    TArray<int64> RemovedMPBuildings;
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    TArray<int64> ModifiedMPBuildings;
+    /** Buildings that kept their data but not their index in Buildings */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    TArray<int64> MovedBuildings;
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    TArray<int64> MovedMPBuildings;
+
+    bool IsEmpty() const {
+        return AddedBuildings.Num() == 0 && RemovedBuildings.Num() == 0 && ModifiedBuildings.Num() == 0
+            && AddedMPBuildings.Num() == 0 && RemovedMPBuildings.Num() == 0 && ModifiedMPBuildings.Num() == 0
+            && MovedBuildings.Num() == 0 && MovedMPBuildings.Num() == 0;
+    }
+};
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnOSMDataAssetChanged, class UOSMDataAsset* /*Asset*/, const FOSMDataAssetChangeSet& /*Changes*/);
 
 UCLASS(BlueprintType, hidecategories=(Object))
 class OSMDATAASSETS_API UOSMDataAsset : public UDataAsset
@@ -71,4 +390,166 @@ public:
     TArray<FMPBuildingData> MultiPolygonBuildings;
     UPROPERTY(BlueprintReadOnly,EditAnywhere)
     TArray<FBuildingData> Buildings;
+
+    /** Additional attributes of MultiPolygonBuildings, indexed like the array */
+    UPROPERTY(EditAnywhere)
+    FOSMBuildingAttributeTable MultiPolygonBuildingAttributes;
+    /** Additional attributes of Buildings, indexed like the array */
+    UPROPERTY(EditAnywhere)
+    FOSMBuildingAttributeTable BuildingAttributes;
+
+    /** Deduplicated node positions referenced by PolygonIndices, empty unless imported with a shared vertex pool */
+    UPROPERTY(EditAnywhere)
+    TArray<FVector> NodePositions;
+
+    /** Replaces NodePositions when imported with a shared vertex pool and fixed point coordinates */
+    UPROPERTY(EditAnywhere)
+    TArray<FOSMGeoPoint> NodeCoordinates;
+
+    /**
+     * Buildings of type T are Buildings[BuildingTypeOffsets[T], BuildingTypeOffsets[T + 1]).
+     * Empty unless the buildings are sorted by type, see FOSMImportSettings::bBucketByBuildingType.
+     */
+    UPROPERTY(VisibleAnywhere)
+    TArray<int32> BuildingTypeOffsets;
+    /** Like BuildingTypeOffsets for MultiPolygonBuildings */
+    UPROPERTY(VisibleAnywhere)
+    TArray<int32> MPBuildingTypeOffsets;
+
+    /** Way ID -> index into Buildings */
+    UPROPERTY()
+    TMap<int64, int32> BuildingIDIndex;
+    /** Relation ID -> index into MultiPolygonBuildings */
+    UPROPERTY()
+    TMap<int64, int32> MPBuildingIDIndex;
+
+    /** Buildings sharing nodes or walls, empty unless imported with FOSMImportSettings::bComputeAdjacency */
+    UPROPERTY(VisibleAnywhere)
+    FOSMBuildingAdjacency BuildingAdjacency;
+
+    /** Settings the asset was imported with */
+    UPROPERTY(VisibleAnywhere)
+    FOSMImportSettings ImportSettings;
+
+    /** Buildings touched by the last reimport, lets downstream caches regenerate only what changed */
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+    FOSMDataAssetChangeSet LastReimportChanges;
+
+    /** Broadcast after a reimport updated the building set */
+    FOnOSMDataAssetChanged OnBuildingsChanged;
+
+#if WITH_EDITORONLY_DATA
+    UPROPERTY(VisibleAnywhere, Instanced, Category=ImportSettings)
+    class UAssetImportData* AssetImportData;
+#endif
+
+    virtual void PostInitProperties() override;
+    /** Packages store the building arrays and node pools as compressed chunks, see OSMPayloadChunks */
+    virtual void Serialize(FArchive& Ar) override;
+    virtual void PostLoad() override;
+#if WITH_EDITORONLY_DATA
+    virtual void GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const override;
+#endif
+
+    /**
+     * Serializes all imported data of the asset as tagged properties into a standalone archive.
+     * Used to cache import results outside of packages.
+     */
+    void SerializeBuildingSet(FArchive& Ar);
+
+    /** Returns the footprint of Buildings[BuildingIndex], independent of the storage mode */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    void GetBuildingFootprint(int32 BuildingIndex, TArray<FVector>& OutPoints) const;
+
+    /** Returns one ring of MultiPolygonBuildings[BuildingIndex], independent of the storage mode */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    void GetMPBuildingPartFootprint(int32 BuildingIndex, int32 PartIndex, TArray<FVector>& OutPoints) const;
+
+    /** Returns the footprint of Buildings[BuildingIndex] without loss of precision */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    void GetBuildingCoordinates(int32 BuildingIndex, TArray<FOSMGeoPoint>& OutCoordinates) const;
+
+    /** Returns one ring of MultiPolygonBuildings[BuildingIndex] without loss of precision */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    void GetMPBuildingPartCoordinates(int32 BuildingIndex, int32 PartIndex, TArray<FOSMGeoPoint>& OutCoordinates) const;
+
+    /** Resolves a footprint of this asset into positions, independent of the storage mode */
+    void ResolvePoints(const FOSMFootprint& Footprint, TArray<FVector>& OutPoints) const;
+
+    /** Resolves a footprint of this asset into fixed point coordinates, independent of the storage mode */
+    void ResolveCoordinates(const FOSMFootprint& Footprint, TArray<FOSMGeoPoint>& OutCoordinates) const;
+
+    /**
+     * Recomputes the type offsets and the ID index after the building arrays changed.
+     * The type offsets are cleared if the buildings are not sorted by type.
+     */
+    void UpdateBuildingLookups();
+
+    /**
+     * Recomputes BuildingAdjacency on all cores. Buildings are adjacent if their rings share a vertex, and
+     * share a wall for every ring segment both of them contain. Vertices are identified by their index into the
+     * shared vertex pool, without a pool by their fixed point coordinates, which also joins distinct nodes
+     * at the same position.
+     */
+    void UpdateBuildingAdjacency();
+
+    /**
+     * Like UpdateBuildingAdjacency, with the vertices identified by OSM node ID. RingNodeIDs holds the node IDs
+     * of every ring in the order of Buildings, followed by the parts of each of MultiPolygonBuildings.
+     */
+    void UpdateBuildingAdjacency(const TArray<TArray<int64>>& RingNodeIDs);
+
+    /** Index into Buildings of the way with ID, INDEX_NONE if it is not part of the asset */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    int32 FindBuildingIndex(int64 ID) const;
+
+    /** Index into MultiPolygonBuildings of the relation with ID, INDEX_NONE if it is not part of the asset */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    int32 FindMPBuildingIndex(int64 ID) const;
+
+    /**
+     * Finds the building of an OSM element, a way in Buildings or a relation in MultiPolygonBuildings.
+     * Returns false if there is none.
+     */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    bool FindBuildingByID(int64 ID, TEnumAsByte<EOSMElementType> ElementType, int32& OutIndex, bool& bOutIsMultiPolygon) const;
+
+    const FBuildingData* FindBuilding(int64 ID) const;
+    const FMPBuildingData* FindMPBuilding(int64 ID) const;
+
+    /** Index range of the buildings of Type. Returns false if the buildings are not bucketed by type. */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    bool GetBuildingTypeRange(TEnumAsByte<EOSMBuildingType> Type, int32& OutFirst, int32& OutNum) const;
+
+    /** Index range of the multipolygon buildings of Type. Returns false if they are not bucketed by type. */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    bool GetMPBuildingTypeRange(TEnumAsByte<EOSMBuildingType> Type, int32& OutFirst, int32& OutNum) const;
+
+    /** Contiguous view of all buildings of Type, empty if the buildings are not bucketed by type */
+    TArrayView<const FBuildingData> GetBuildingsOfType(EOSMBuildingType Type) const;
+    TArrayView<const FMPBuildingData> GetMPBuildingsOfType(EOSMBuildingType Type) const;
+
+    /** True if BuildingAdjacency was computed and matches the building arrays */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Adjacency")
+    bool HasBuildingAdjacency() const;
+
+    /**
+     * Buildings and multipolygon buildings touching a building, from BuildingAdjacency.
+     * With bSharedWallsOnly neighbours that only share nodes are skipped.
+     */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Adjacency")
+    void GetBuildingNeighbours(int32 BuildingIndex, bool bIsMultiPolygon, bool bSharedWallsOnly, TArray<int32>& OutBuildingIndices, TArray<int32>& OutMPBuildingIndices) const;
+
+    /**
+     * Flags the walls of one ring that a neighbour shares, OutIsShared[i] belongs to the segment from vertex i
+     * to the next one. Such walls are hidden and need no geometry. PartIndex is ignored for Buildings.
+     */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Adjacency")
+    void GetSharedWallSegments(int32 BuildingIndex, bool bIsMultiPolygon, int32 PartIndex, TArray<bool>& OutIsShared) const;
+
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    FOSMBuildingAttributes GetBuildingAttributes(int32 BuildingIndex) const;
+
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|Building")
+    FOSMBuildingAttributes GetMPBuildingAttributes(int32 BuildingIndex) const;
 };
@@ -0,0 +1,130 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OSMDataAsset.h"
+#include "OSMAreaDataAsset.h"
+#include "OSMImportSettings.h"
+#include "OSMPOIDataAsset.h"
+
+class FFeedbackContext;
+
+/** Called on the game thread when an asynchronous load finished. Asset is nullptr if parsing failed. */
+DECLARE_DELEGATE_OneParam(FOnOSMDataAssetLoaded, UOSMDataAsset* /*Asset*/);
+
+/**
+ * Runtime entry point for turning OpenStreetMap XML into UOSMDataAsset contents.
+ * Used by the editor factory as well as by packaged games that load OSM data at runtime.
+ */
+class OSMDATAASSETS_API FOSMDataAssetBuilder
+{
+public:
+    /** Bump whenever the builder produces different asset contents for the same input, invalidates import caches */
+    static constexpr int32 BuilderVersion = 4;
+
+    /**
+     * Parses an .osm file and fills the building arrays of Asset. Safe to call from worker threads.
+     * With Settings.bImportOutOfCore the file is streamed through temporary files instead of parsed in memory.
+     */
+    static bool BuildFromFile(const FString& Filename, UOSMDataAsset* Asset, const FOSMImportSettings& Settings, FFeedbackContext* Warn = nullptr);
+
+    /** Parses OSM XML text and fills the building arrays of Asset. The buffer is modified in place while parsing. */
+    static bool BuildFromBuffer(FString& Buffer, UOSMDataAsset* Asset, const FOSMImportSettings& Settings, FFeedbackContext* Warn = nullptr);
+
+    /**
+     * Parses an .osm file and fills Asset with its points of interest, nodes tagged as shop, amenity, stop and
+     * the like. Asset is reset first and indexed for queries afterwards. Safe to call from worker threads.
+     */
+    static bool BuildPOIsFromFile(const FString& Filename, UOSMPOIDataAsset* Asset, FFeedbackContext* Warn = nullptr);
+
+    /**
+     * Parses an .osm file and fills Asset with its area polygons, closed ways and multipolygons tagged with
+     * landuse, natural, leisure and the like that are not buildings. Safe to call from worker threads.
+     */
+    static bool BuildAreasFromFile(const FString& Filename, UOSMAreaDataAsset* Asset, FFeedbackContext* Warn = nullptr);
+
+    /**
+     * Parses several neighbouring .osm files in parallel and fills Asset with their merged contents. Nodes, ways and
+     * relations are merged by OSM ID, so buildings on the borders are imported once and ways and multipolygons
+     * cut by one extract are completed from the others.
+     */
+    static bool BuildFromFiles(const TArray<FString>& Filenames, UOSMDataAsset* Asset, const FOSMImportSettings& Settings);
+
+    /**
+     * Parses Filenames once, merged like BuildFromFiles if there are several, and fills Asset, POIAsset and
+     * AreaAsset from the same parse. Any of the assets may be nullptr to skip it. Use this instead of the single
+     * Build functions when more than one of them is needed. Safe to call from worker threads.
+     */
+    static bool BuildWithExtracts(const TArray<FString>& Filenames, UOSMDataAsset* Asset, const FOSMImportSettings& Settings, UOSMPOIDataAsset* POIAsset, UOSMAreaDataAsset* AreaAsset, FFeedbackContext* Warn = nullptr);
+
+    /** Points of interest of several merged .osm files, see BuildFromFiles and BuildPOIsFromFile */
+    static bool BuildPOIsFromFiles(const TArray<FString>& Filenames, UOSMPOIDataAsset* Asset);
+
+    /** Areas of several merged .osm files, see BuildFromFiles and BuildAreasFromFile */
+    static bool BuildAreasFromFiles(const TArray<FString>& Filenames, UOSMAreaDataAsset* Asset);
+
+    /**
+     * Reads an .osmlist file, one .osm path per line relative to the list. Empty lines and lines starting with #
+     * are skipped. Returns false if the list can not be read or is empty.
+     */
+    static bool ReadFileList(const FString& ListFilename, TArray<FString>& OutFilenames);
+
+    /**
+     * Creates a transient UOSMDataAsset and fills it from an .osm file on a worker thread.
+     * Must be called from the game thread, OnLoaded is executed on the game thread.
+     */
+    static void LoadFromFileAsync(const FString& Filename, const FOSMImportSettings& Settings, FOnOSMDataAssetLoaded OnLoaded);
+
+    /** Same as LoadFromFileAsync, but parses an UTF-8 encoded memory buffer, e.g. a downloaded or cached file */
+    static void LoadFromBufferAsync(TArray<uint8> Buffer, const FOSMImportSettings& Settings, FOnOSMDataAssetLoaded OnLoaded);
+
+    /**
+     * Rearranges the building arrays and all per building tables of Asset.
+     * New building i is old building BuildingOrder[i], buildings missing from an order are removed.
+     * The building adjacency is remapped to the new order.
+     */
+    static void ReorderBuildings(UOSMDataAsset* Asset, const TArray<int32>& BuildingOrder, const TArray<int32>& MPBuildingOrder);
+
+    /**
+     * Stable sorts the buildings of Asset by EOSMBuildingType and stores the offsets of each type,
+     * see UOSMDataAsset::GetBuildingsOfType.
+     */
+    static void BucketByBuildingType(UOSMDataAsset* Asset);
+
+    /**
+     * Sorts the buildings and the multipolygon buildings of Asset by the Hilbert index of their centroids on a
+     * grid over the bounds of the whole asset. Centroids are computed on all cores.
+     */
+    static void SortByHilbertIndex(UOSMDataAsset* Asset);
+
+    /**
+     * Applies the orderings enabled in Asset->ImportSettings and updates the lookups of Asset. An existing
+     * building adjacency is remapped, it is only computed from coordinates or pool indices if enabled and missing.
+     * Runs at the end of every import.
+     */
+    static void OrderBuildings(UOSMDataAsset* Asset);
+
+    /**
+     * Estimates the height of all buildings without height tag from their levels and the storey heights in
+     * Asset->ImportSettings, and records the source of every height. Runs at the end of every import.
+     */
+    static void ResolveBuildingHeights(UOSMDataAsset* Asset);
+
+    /**
+     * Updates Target with Source, a fresh import of the same file. Buildings are matched by OSM ID and Target is
+     * patched in place: surviving buildings keep their slot, changed ones are overwritten there, new ones fill the
+     * slots of removed ones before they are appended. Removed slots left over are filled with the last buildings.
+     * The slots are kept over any order, unless Target is sorted by Hilbert index or bucketed by type: then
+     * those orderings are applied again after patching, which moves buildings as well.
+     * Buildings that changed slots are listed as moved. The changes are stored in Target->LastReimportChanges and
+     * broadcast through Target->OnBuildingsChanged.
+     */
+    static FOSMDataAssetChangeSet ApplyUpdate(UOSMDataAsset* Target, UOSMDataAsset* Source);
+
+private:
+    static bool BuildFromParser(class FOSMFile& Parser, UOSMDataAsset* Asset, const FOSMImportSettings& Settings);
+    static bool BuildOutOfCore(const FString& Filename, UOSMDataAsset* Asset, const FOSMImportSettings& Settings);
+    static void BuildPOIsFromParser(const class FOSMFile& Parser, UOSMPOIDataAsset* Asset);
+    static void BuildAreasFromParser(const class FOSMFile& Parser, UOSMAreaDataAsset* Asset);
+    static void LoadAsync(TFunction<bool(UOSMDataAsset*)> BuildFunction, FOnOSMDataAssetLoaded OnLoaded);
+};
@@ -0,0 +1,40 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "OSMDataAsset.h"
+#include "OSMImportSettings.h"
+
+#include "OSMDataAssetLoadAction.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOSMDataAssetLoadActionPin, UOSMDataAsset*, Asset);
+
+/**
+ * Blueprint node that loads an .osm file into a transient UOSMDataAsset without blocking the game thread.
+ */
+UCLASS()
+class OSMDATAASSETS_API UOSMDataAssetLoadAction : public UBlueprintAsyncActionBase
+{
+    GENERATED_BODY()
+public:
+    /** Called when the file was parsed successfully */
+    UPROPERTY(BlueprintAssignable)
+    FOSMDataAssetLoadActionPin OnLoaded;
+
+    /** Called when the file could not be parsed */
+    UPROPERTY(BlueprintAssignable)
+    FOSMDataAssetLoadActionPin OnFailed;
+
+    /** Loads an OpenStreetMap XML file from disk on a worker thread */
+    UFUNCTION(BlueprintCallable, meta=(BlueprintInternalUseOnly="true", WorldContext="WorldContextObject"), Category="OSMDataAssets|Loading")
+    static UOSMDataAssetLoadAction* LoadOSMDataAssetFromFile(UObject* WorldContextObject, const FString& Filename, const FOSMImportSettings& Settings);
+
+    virtual void Activate() override;
+
+private:
+    void HandleLoaded(UOSMDataAsset* Asset);
+
+    FString Filename;
+    FOSMImportSettings Settings;
+};
@@ -0,0 +1,35 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Element counts and bounds of an OSM XML file, gathered by a byte level scan without parsing the XML.
+ * Used to size the parser containers up front and to warn about huge imports before they start.
+ */
+struct OSMDATAASSETS_API FOSMFileSummary
+{
+    int64 FileSize = 0;
+    int32 NumNodes = 0;
+    int32 NumWays = 0;
+    int32 NumRelations = 0;
+
+    /** Bounds from the <bounds> element, only valid with bHasBounds */
+    bool bHasBounds = false;
+    double MinLatitude = 0.0;
+    double MinLongitude = 0.0;
+    double MaxLatitude = 0.0;
+    double MaxLongitude = 0.0;
+
+    /** Counts the elements of an .osm file and reads its bounds. Returns false if the file can not be read. */
+    static bool ScanFile(const FString& Filename, FOSMFileSummary& OutSummary);
+
+    /** Same as ScanFile for OSM XML text that is already in memory */
+    static void ScanText(const TCHAR* Text, FOSMFileSummary& OutSummary);
+
+    /** Rough peak memory of parsing the file, the text buffer plus the parsed elements */
+    int64 GetEstimatedMemory() const;
+
+    /** Rough parse time in seconds, assumes a typical XML parser throughput */
+    double GetEstimatedSeconds() const;
+};
@@ -0,0 +1,39 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UOSMDataAsset;
+struct FOSMGeoPoint;
+
+/**
+ * Reads and writes building footprints as FlatGeobuf (https://flatgeobuf.org), a binary vector format that GIS
+ * tools like QGIS and GDAL open directly.
+ *
+ * Every building becomes a MultiPolygon feature in EPSG:4326 with the properties osm_id, osm_type, building,
+ * height and levels. Features are ordered along a Hilbert curve and the file always contains the packed Hilbert
+ * R-tree of the format, so the features in a box can be read without reading the rest of the file.
+ */
+class OSMDATAASSETS_API FOSMFlatGeobuf
+{
+public:
+    /** Children per node of the spatial index, the default of the format */
+    static constexpr uint16 IndexNodeSize = 16;
+
+    /** Encodes all buildings of Asset, features are encoded on all cores */
+    static bool Write(const UOSMDataAsset* Asset, TArray64<uint8>& OutData);
+    static bool WriteToFile(const UOSMDataAsset* Asset, const FString& Filename);
+
+    /**
+     * Replaces the buildings of Asset with the features of Filename, stored as configured in Asset->ImportSettings
+     * except for the shared vertex pool. Polygons become buildings, multipolygons and features with an osm_type of
+     * relation become multipolygon buildings.
+     */
+    static bool ReadFromFile(const FString& Filename, UOSMDataAsset* Asset);
+
+    /**
+     * Like ReadFromFile for the features whose bounding box intersects Min/Max. Only the spatial index and the
+     * matching features are read, files without index are scanned completely.
+     */
+    static bool ReadFromFileInBounds(const FString& Filename, const FOSMGeoPoint& Min, const FOSMGeoPoint& Max, UOSMDataAsset* Asset);
+};
@@ -0,0 +1,84 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UOSMDataAsset;
+struct FOSMGeoPoint;
+
+/**
+ * Many rings packed into one structure of arrays for SIMD processing.
+ * Each ring starts at a 16 byte aligned offset and is stored relative to its first vertex, which keeps float
+ * precision at degree scale. Rings are followed by their first two vertices again and zero padding, so
+ * kernels can read four lanes starting at vertex i+1 and i+2 without wrapping or bounds checks.
+ */
+struct OSMDATAASSETS_API FOSMPackedRings
+{
+    TArray<float, TAlignedHeapAllocator<16>> X;
+    TArray<float, TAlignedHeapAllocator<16>> Y;
+    /** Offset of each ring into X and Y */
+    TArray<int32> Start;
+    /** Number of vertices of each ring, without closing vertex */
+    TArray<int32> Count;
+    /** Absolute position of the first vertex of each ring */
+    TArray<FVector2D> Origin;
+
+    int32 Num() const { return Start.Num(); }
+    void Reset();
+
+    /** Number of floats a ring with NumVertices occupies in X and Y */
+    static int32 PaddedSize(int32 NumVertices) { return Align(NumVertices + 5, 4); }
+
+    /** Reserves a slot for a ring, returns the ring index. The slot has to be filled with SetRing. */
+    int32 AddRingSlot(int32 NumVertices);
+    void SetRing(int32 Ring, TFunctionRef<FVector(int32)> GetVertex);
+    /** Fills a slot from fixed point coordinates, offsets to the first vertex are computed exactly */
+    void SetRing(int32 Ring, TArrayView<const FOSMGeoPoint> Coordinates);
+    int32 AddRing(const TArray<FVector>& Points);
+};
+
+enum class EOSMRingFlags : uint8
+{
+    None = 0,
+    /** Less than three vertices or no area */
+    Degenerate = 1 << 0,
+    /** Clockwise in longitude/latitude space */
+    Clockwise = 1 << 1,
+    /** Not provably simple by the convexity precheck, needs an exact intersection test */
+    SelfIntersectionCandidate = 1 << 2,
+};
+ENUM_CLASS_FLAGS(EOSMRingFlags);
+
+struct FOSMRingAnalysis
+{
+    /** Shoelace area in squared degrees, positive for counter clockwise rings */
+    float SignedArea;
+    FBox2D Bounds;
+    EOSMRingFlags Flags;
+};
+
+/** Identifies the building ring a packed ring was created from */
+struct FOSMRingSource
+{
+    int32 BuildingIndex;
+    /** INDEX_NONE for simple buildings, part index for multipolygon buildings */
+    int32 PartIndex;
+    bool bIsInner;
+};
+
+/** Vectorized kernels that process many rings per call */
+class OSMDATAASSETS_API FOSMGeometryKernels
+{
+public:
+    /**
+     * Packs all building footprints and multipolygon rings of Asset, simple buildings first.
+     * OutSources receives the origin of each packed ring.
+     */
+    static void PackAsset(const UOSMDataAsset* Asset, FOSMPackedRings& OutRings, TArray<FOSMRingSource>& OutSources);
+
+    /** Computes signed area, bounds and validity flags of rings [FirstRing, FirstRing + OutResults.Num()) */
+    static void AnalyzeRings(const FOSMPackedRings& Rings, int32 FirstRing, TArrayView<FOSMRingAnalysis> OutResults);
+
+    /** Analyzes all rings, spread over all cores */
+    static void AnalyzeRingsParallel(const FOSMPackedRings& Rings, TArray<FOSMRingAnalysis>& OutResults);
+};
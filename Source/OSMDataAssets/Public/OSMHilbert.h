@@ -0,0 +1,21 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Hilbert curve index on a 2^16 x 2^16 grid. Items sorted by the index of their center are close in memory when
+ * they are close in space. This is the ordering of the FlatGeobuf packed R-tree, so the same sort order can be
+ * used for files and for in-memory arrays.
+ */
+struct OSMDATAASSETS_API FOSMHilbert
+{
+    /** Largest grid coordinate */
+    static constexpr uint32 GridMax = 0xFFFF;
+
+    /** Index of the grid cell X/Y, both in [0, GridMax] */
+    static uint32 Encode(uint32 X, uint32 Y);
+
+    /** Index of the point X/Y on a grid spanning the box MinX/MinY with extent Width x Height */
+    static uint32 Encode(double X, double Y, double MinX, double MinY, double Width, double Height);
+};
@@ -0,0 +1,112 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Enums.h"
+
+#include "OSMImportSettings.generated.h"
+
+/** Options controlling how an OSM file is turned into a UOSMDataAsset */
+USTRUCT(BlueprintType)
+struct OSMDATAASSETS_API FOSMImportSettings {
+    GENERATED_BODY()
+
+    /**
+     * Store footprints as indices into UOSMDataAsset::NodePositions instead of copying every node position into
+     * each building. Saves memory in dense areas where buildings share walls.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Storage")
+    bool bUseSharedVertexPool;
+
+    /**
+     * Store footprints as FOSMGeoPoint, degrees scaled by 1e7 in fixed point like OSM itself, instead of FVector.
+     * Keeps the full precision of the source data where FVector is float, read them with
+     * UOSMDataAsset::ResolveCoordinates.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Storage")
+    bool bUseFixedPointCoordinates;
+
+    /**
+     * Sort buildings by EOSMBuildingType and store the offsets of each type in the asset, so generating all
+     * buildings of one type only touches a contiguous range.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Storage")
+    bool bBucketByBuildingType;
+
+    /**
+     * Sort buildings along a Hilbert curve through their centroids, so buildings that are close on the map are
+     * close in memory and in serialized data. With bBucketByBuildingType this is the order within each type.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Storage")
+    bool bSortByHilbertIndex;
+
+    /**
+     * Compute which buildings share nodes or walls and store the graph in the asset, see
+     * UOSMDataAsset::GetBuildingNeighbours and UOSMDataAsset::GetSharedWallSegments.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Adjacency")
+    bool bComputeAdjacency;
+
+    /**
+     * Import through sorted temporary files on local disk instead of parsing the whole file in memory, for
+     * extracts larger than RAM. Reads the file twice and always stores footprints per building, the shared
+     * vertex pool is not available. Only used for single .osm files.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Out of Core")
+    bool bImportOutOfCore;
+
+    /** Memory for the sort buffers of an out of core import in megabytes, the imported buildings come on top */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Out of Core", meta=(ClampMin="64"))
+    int32 OutOfCoreMemoryMB;
+
+    /**
+     * Additionally extract tagged nodes like shops, amenities and stops into a UOSMPOIDataAsset next to the
+     * imported asset
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="POI")
+    bool bExtractPOIs;
+
+    /**
+     * Additionally import land use, water, nature and leisure polygons into a UOSMAreaDataAsset next to the
+     * imported asset. Such areas are never imported as buildings.
+     */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Areas")
+    bool bExtractAreas;
+
+    /** Storey height in meters for estimating the height of buildings without height tag */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Height")
+    float DefaultStoreyHeight;
+
+    /** Storey heights of building types that differ from DefaultStoreyHeight */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Height")
+    TMap<TEnumAsByte<EOSMBuildingType>, float> StoreyHeights;
+
+    /** Levels assumed for buildings with neither height nor levels tag, 0 leaves their height at 0 */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Height")
+    int32 DefaultLevels;
+
+    float GetStoreyHeight(EOSMBuildingType Type) const {
+        const float * StoreyHeight = StoreyHeights.Find(Type);
+        return StoreyHeight ? *StoreyHeight : DefaultStoreyHeight;
+    }
+
+    FOSMImportSettings() {
+        bUseSharedVertexPool = false;
+        bUseFixedPointCoordinates = false;
+        bBucketByBuildingType = false;
+        bSortByHilbertIndex = false;
+        bComputeAdjacency = false;
+        bImportOutOfCore = false;
+        OutOfCoreMemoryMB = 1024;
+        bExtractPOIs = false;
+        bExtractAreas = false;
+        DefaultStoreyHeight = 3.0f;
+        StoreyHeights.Add(EOSMBuildingType::CommercialBuilding, 4.0f);
+        StoreyHeights.Add(EOSMBuildingType::Office, 3.5f);
+        StoreyHeights.Add(EOSMBuildingType::Retail, 4.0f);
+        StoreyHeights.Add(EOSMBuildingType::Supermarket, 5.0f);
+        StoreyHeights.Add(EOSMBuildingType::IndustrialBuilding, 5.0f);
+        StoreyHeights.Add(EOSMBuildingType::Warehouse, 6.0f);
+        DefaultLevels = 1;
+    }
+};
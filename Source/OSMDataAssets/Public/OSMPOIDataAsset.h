@@ -0,0 +1,131 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Enums.h"
+#include "OSMDataAsset.h"
+
+#include "OSMPOIDataAsset.generated.h"
+
+/** A single point of interest, unpacked from the columns of UOSMPOIDataAsset */
+USTRUCT(BlueprintType)
+struct OSMDATAASSETS_API FOSMPOI {
+    GENERATED_BODY()
+    /** OSM ID of the node */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    int64 ID;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    FString Name;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TEnumAsByte<EOSMPOICategory> Category;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    FOSMGeoPoint Location;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite)
+    TMap<FString, FString> Tags;
+
+    FOSMPOI() {
+        ID = 0;
+        Category = EOSMPOICategory::OtherPOI;
+    }
+};
+
+/**
+ * Tagged nodes of an OSM file, stored column wise: all arrays are indexed alike and strings are interned into
+ * Strings. After BuildIndex the POIs are ordered as an implicit k-d tree over Positions, which answers nearest
+ * neighbour and radius queries without storing any tree nodes.
+ * Distances are in meters, using an equirectangular approximation around the query location. That is accurate
+ * for the ranges POI queries are about, but not across hundreds of kilometers.
+ */
+UCLASS(BlueprintType, hidecategories=(Object))
+class OSMDATAASSETS_API UOSMPOIDataAsset : public UDataAsset
+{
+    GENERATED_BODY()
+public:
+    /** OSM node IDs */
+    UPROPERTY(VisibleAnywhere)
+    TArray<int64> IDs;
+
+    UPROPERTY(VisibleAnywhere)
+    TArray<FOSMGeoPoint> Positions;
+
+    UPROPERTY(VisibleAnywhere)
+    TArray<TEnumAsByte<EOSMPOICategory>> Categories;
+
+    /** Index into Strings, INDEX_NONE for POIs without a name tag */
+    UPROPERTY(VisibleAnywhere)
+    TArray<int32> Names;
+
+    /** Tags of POI i are TagKeys and TagValues [TagOffsets[i], TagOffsets[i + 1]), one more entry than POIs */
+    UPROPERTY(VisibleAnywhere)
+    TArray<int32> TagOffsets;
+    /** Indices into Strings */
+    UPROPERTY(VisibleAnywhere)
+    TArray<int32> TagKeys;
+    /** Indices into Strings */
+    UPROPERTY(VisibleAnywhere)
+    TArray<int32> TagValues;
+
+    /** Every distinct name, tag key and tag value, stored once */
+    UPROPERTY(VisibleAnywhere)
+    TArray<FString> Strings;
+
+    /** Removes all POIs */
+    void Reset();
+
+    /** Appends a POI and returns its index. Queries need BuildIndex to be called after adding. */
+    int32 AddPOI(int64 ID, const FOSMGeoPoint& Location, EOSMPOICategory Category, const TArray<TPair<FString, FString>>& Tags);
+
+    /** Returns the index of String in Strings, adds it if it is new */
+    int32 InternString(const FString& String);
+
+    /** Orders all columns as an implicit k-d tree, the median of every range splits alternately by longitude and latitude */
+    void BuildIndex();
+
+    /**
+     * Indices of the up to K POIs closest to Location and not further away than MaxDistance, nearest first.
+     * MaxDistance <= 0 means unlimited. Only POIs for which Filter returns true are considered.
+     */
+    void FindNearest(const FOSMGeoPoint& Location, int32 K, double MaxDistance, TArray<int32>& OutIndices, TFunctionRef<bool(int32)> Filter) const;
+    void FindNearest(const FOSMGeoPoint& Location, int32 K, double MaxDistance, TArray<int32>& OutIndices) const;
+
+    /** Indices of all POIs within Radius of Location, in no particular order */
+    void FindInRadius(const FOSMGeoPoint& Location, double Radius, TArray<int32>& OutIndices, TFunctionRef<bool(int32)> Filter) const;
+    void FindInRadius(const FOSMGeoPoint& Location, double Radius, TArray<int32>& OutIndices) const;
+
+    /** Approximate distance in meters, see the class comment */
+    static double GetDistance(const FOSMGeoPoint& A, const FOSMGeoPoint& B);
+
+    /** Tag Key of POI Index, empty if it is not set */
+    FString GetTag(int32 Index, const FString& Key) const;
+
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|POI")
+    int32 NumPOIs() const;
+
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|POI")
+    FOSMPOI GetPOI(int32 Index) const;
+
+    /** Returns false if no POI is within MaxDistance meters, MaxDistance <= 0 means unlimited */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|POI")
+    bool FindNearestPOI(const FOSMGeoPoint& Location, float MaxDistance, int32& OutIndex, float& OutDistance) const;
+
+    /** The K nearest POIs within MaxDistance meters, nearest first. MaxDistance <= 0 means unlimited. */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|POI")
+    void FindNearestPOIs(const FOSMGeoPoint& Location, int32 K, float MaxDistance, TArray<int32>& OutIndices) const;
+
+    /** Like FindNearestPOIs, restricted to one category */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|POI")
+    void FindNearestPOIsOfCategory(const FOSMGeoPoint& Location, TEnumAsByte<EOSMPOICategory> Category, int32 K, float MaxDistance, TArray<int32>& OutIndices) const;
+
+    /** All POIs within Radius meters */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|POI")
+    void FindPOIsInRadius(const FOSMGeoPoint& Location, float Radius, TArray<int32>& OutIndices) const;
+
+    /** All POIs of one category within Radius meters */
+    UFUNCTION(BlueprintPure, Category="OSMDataAssets|POI")
+    void FindPOIsOfCategoryInRadius(const FOSMGeoPoint& Location, TEnumAsByte<EOSMPOICategory> Category, float Radius, TArray<int32>& OutIndices) const;
+
+private:
+    /** Lookup for InternString, rebuilt from Strings on first use after loading */
+    TMap<FString, int32> StringIndices;
+};
@@ -0,0 +1,67 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OSMDataAsset.h"
+
+/**
+ * Scanline rasterizer for polygons in longitude/latitude space onto a regular grid over a geographic box.
+ * Row 0 is the northern edge and column 0 the western edge. A pixel is covered if its center is inside a polygon,
+ * rings are filled with the even-odd rule so inner rings of a polygon become holes.
+ *
+ * The grid is split into bands of rows that are rasterized in parallel. Fill callbacks of different rows may run
+ * concurrently, but every row is owned by a single task, so writing to a row indexed buffer needs no locking.
+ */
+class OSMDATAASSETS_API FOSMScanlineRasterizer
+{
+public:
+    /** Called for every covered span [FirstColumn, EndColumn) of Row */
+    using FFillSpan = TFunctionRef<void(int32 Polygon, int32 Row, int32 FirstColumn, int32 EndColumn)>;
+
+    FOSMScanlineRasterizer(const FOSMGeoPoint& InMin, const FOSMGeoPoint& InMax, int32 InWidth, int32 InHeight);
+
+    /** Starts a new polygon, following AddRing calls add to it. Returns the index passed to the fill callback. */
+    int32 BeginPolygon();
+
+    /** Adds a ring to the current polygon, the closing vertex is not repeated */
+    void AddRing(TArrayView<const FOSMGeoPoint> Ring);
+    void AddRing(TArrayView<const FVector> Ring);
+
+    /**
+     * Calls Fill for all covered spans. Within a row, spans arrive in polygon order, so later polygons
+     * paint over earlier ones.
+     */
+    void Rasterize(FFillSpan Fill, int32 RowsPerBand = 16) const;
+
+    int32 GetWidth() const { return Width; }
+    int32 GetHeight() const { return Height; }
+    int32 NumPolygons() const { return NumPolygonsAdded; }
+
+    /** Grid position of a coordinate, in pixels with pixel centers at .5 */
+    FVector2D ToGrid(const FOSMGeoPoint& Point) const;
+
+private:
+    /** Non horizontal edge, X is stored at YMin and advanced by DXDY per unit of Y */
+    struct FEdge
+    {
+        double YMin;
+        double YMax;
+        double XAtYMin;
+        double DXDY;
+        int32 Polygon;
+    };
+
+    void AddEdge(const FVector2D& A, const FVector2D& B);
+    void AddGridRing(int32 Num, TFunctionRef<FVector2D(int32)> GetPoint);
+
+    FOSMGeoPoint Min;
+    FOSMGeoPoint Max;
+    int32 Width;
+    int32 Height;
+    /** Pixels per fixed point unit */
+    double ScaleX;
+    double ScaleY;
+
+    int32 NumPolygonsAdded = 0;
+    TArray<FEdge> Edges;
+};
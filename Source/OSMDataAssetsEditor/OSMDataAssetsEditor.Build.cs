@@ -27,9 +27,11 @@ public class OSMDataAssetsEditor : ModuleRules
         PrivateDependencyModuleNames.AddRange(
             new string[]
             {
+                "AssetRegistry",
                 "ContentBrowser",
 				"Core",
 				"CoreUObject",
+				"DerivedDataCache",
 				"DesktopWidgets",
 				"EditorStyle",
 				"Engine",
@@ -39,7 +41,6 @@ public class OSMDataAssetsEditor : ModuleRules
 				"Slate",
 				"SlateCore",
 				"UnrealEd",
-                "XmlParser",
                 // ... add private dependencies that you statically link with here ...
                 "GDAL",
 				"UnrealGDAL",
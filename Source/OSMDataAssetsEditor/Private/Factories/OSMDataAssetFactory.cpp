@@ -1,9 +1,70 @@
 // Copyright (c) Iwer Petersen. All rights reserved.
 #include "OSMDataAssetFactory.h"
 
+#include "EditorFramework/AssetImportData.h"
 #include "GeoCoordinate.h"
+#include "Misc/App.h"
+#include "Misc/MessageDialog.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "UObject/Package.h"
+#include "OSMAreaDataAsset.h"
 #include "OSMDataAsset.h"
-#include "OSMFileParser.h"
+#include "OSMDataAssetBuilder.h"
+#include "OSMFileSummary.h"
+#include "OSMFlatGeobuf.h"
+#include "OSMImportCache.h"
+#include "OSMPOIDataAsset.h"
+
+#if ENGINE_MAJOR_VERSION >= 5
+#include "AssetRegistry/AssetRegistryModule.h"
+#else
+#include "AssetRegistryModule.h"
+#endif
+
+#define LOCTEXT_NAMESPACE "OSMDataAssetFactory"
+
+namespace
+{
+    /** Creates or replaces the asset <Name><Suffix> in the package folder of the imported asset */
+    template<typename TAsset>
+    TAsset* CreateSiblingAsset(UObject* InParent, FName InName, const TCHAR* Suffix, EObjectFlags Flags)
+    {
+        const FString PackagePath = FPackageName::GetLongPackagePath(InParent->GetOutermost()->GetName());
+        const FString AssetName = InName.ToString() + Suffix;
+        UPackage* Package = CreatePackage(*(PackagePath / AssetName));
+        return NewObject<TAsset>(Package, FName(*AssetName), Flags | RF_Public | RF_Standalone);
+    }
+
+    void FinishSiblingAsset(UObject* Asset)
+    {
+        FAssetRegistryModule::AssetCreated(Asset);
+        Asset->MarkPackageDirty();
+    }
+
+    /** Loads the sibling <Name><Suffix> of an imported asset, or creates it if it does not exist yet */
+    template<typename TAsset>
+    TAsset* FindOrCreateSiblingAsset(UObject* Asset, const TCHAR* Suffix, bool& bOutCreated)
+    {
+        const FString PackagePath = FPackageName::GetLongPackagePath(Asset->GetOutermost()->GetName());
+        const FString AssetName = Asset->GetName() + Suffix;
+        const FString ObjectPath = PackagePath / AssetName + TEXT(".") + AssetName;
+        bOutCreated = false;
+        if(TAsset* Existing = LoadObject<TAsset>(nullptr, *ObjectPath, nullptr, LOAD_NoWarn | LOAD_Quiet)) {
+            return Existing;
+        }
+        bOutCreated = true;
+        return CreateSiblingAsset<TAsset>(Asset, Asset->GetFName(), Suffix, RF_Transactional);
+    }
+
+    /** FlatGeobuf files only hold building footprints, there is nothing to parse, merge or extract */
+    bool IsFlatGeobuf(const TArray<FString>& SourceFiles)
+    {
+        return SourceFiles.Num() == 1 && FPaths::GetExtension(SourceFiles[0]).Equals(TEXT("fgb"), ESearchCase::IgnoreCase);
+    }
+}
+
 UOSMDataAssetFactory::UOSMDataAssetFactory( const FObjectInitializer& ObjectInitializer )
     : Super(ObjectInitializer)
 {
@@ -11,6 +72,8 @@ UOSMDataAssetFactory::UOSMDataAssetFactory( const FObjectInitializer& ObjectInit
     bCreateNew = false;
     bEditorImport = true;
     Formats.Add(TEXT("osm;OSM File"));
+    Formats.Add(TEXT("osmlist;List of neighbouring OSM files to merge"));
+    Formats.Add(TEXT("fgb;FlatGeobuf building footprints"));
 }
 
 UObject * UOSMDataAssetFactory::FactoryCreateFile(UClass* InClass,
@@ -22,84 +85,41 @@ UObject * UOSMDataAssetFactory::FactoryCreateFile(UClass* InClass,
                                                       FFeedbackContext* Warn,
                                                       bool& bOutOperationCanceled)
 {
-    UOSMDataAsset* Asset = NewObject<UOSMDataAsset>(InParent, InClass, InName, Flags);
+    TArray<FString> SourceFiles;
+    if(!GetSourceFiles(Filename, SourceFiles)) {
+        return nullptr;
+    }
+    const bool bIsFlatGeobuf = IsFlatGeobuf(SourceFiles);
+    // out of core imports do not hold the file in memory, the estimate does not apply to them
+    const bool bIsOutOfCore = ImportSettings.bImportOutOfCore && SourceFiles.Num() == 1 && !bIsFlatGeobuf;
+    if(!bIsFlatGeobuf && !bIsOutOfCore && !ConfirmLargeImport(SourceFiles)) {
+        bOutOperationCanceled = true;
+        return nullptr;
+    }
 
-    FString File = Filename;
-    FOSMFile Parser;
-    if(Parser.LoadOpenStreetMapFile(File, false, Warn))
+    auto CreateAsset = [&]()
     {
-        UE_LOG(LogTemp, Warning, TEXT("UOSMDataAssetFactory: %d Relations"), Parser.Relations.Num())
-        for(const auto Rel : Parser.Relations) {
-            FMPBuildingData Building;
-            Building.ID = Rel->RelationID;
-            Building.BuildingType = Rel->BuildingType;
-            Building.Levels = Rel->BuildingLevels;
-            Building.Height = Rel->Height;
-            Building.bHasHole = 0;
-            UE_LOG(LogTemp,Warning,TEXT("UOSMDataAssetFactory: %d MPolygons"), Rel->Members.Num())
-            for (auto m : Rel->Members){
-                FMPBuildingPart Part;
-                Part.bIsInner = m->bIsInner;
-                if(Part.bIsInner==1)
-                    Building.bHasHole=1;
-                auto WayID = m->Ref;
-                FOSMFile::FOSMWayInfo * Way = Parser.WayMap.FindRef(WayID);
-                UE_LOG(LogTemp, Warning, TEXT("UOSMDataAssetFactory: %d Nodes"), Way->Nodes.Num())
-                for(int i = 0; i < Way->Nodes.Num(); i++) {
-                    const double Lat = Way->Nodes[i]->Latitude;
-                    const double Lon = Way->Nodes[i]->Longitude;
-
-                    FVector Location = FVector(Lon, Lat, 0);
-
-                    // sometimes shapes are closed of with the first point, we dont need that
-                    if(i == Way->Nodes.Num() - 1
-                        && Location.Equals(Part.PolygonPoints[0]))
-                    {
-                        break;
-                    }
-                    Part.PolygonPoints.Add(Location);
-                }
-                Building.Parts.Add(Part);
-                Parser.WayMap.Remove(WayID);
-                Parser.Ways.Remove(Way);
-            }
-            Asset->MultiPolygonBuildings.Add(Building);
-        }
+        return NewObject<UOSMDataAsset>(InParent, InClass, InName, Flags);
+    };
+    UOSMDataAsset* Asset = CreateAsset();
 
-        UE_LOG(LogTemp, Warning, TEXT("UOSMDataAssetFactory: %d Ways"), Parser.Ways.Num())
-        for(const auto Way : Parser.Ways) {
-            if (Way) {
-                FBuildingData Building;
-                Building.ID = Way->WayID;
-                Building.BuildingType = Way->BuildingType;
-                Building.Height = Way->Height;
-                Building.Levels = Way->Levels;
-                UE_LOG(LogTemp, Warning, TEXT("UOSMDataAssetFactory: %d Nodes"), Way->Nodes.Num())
-
-                //for(FOSMFile::FOSMNodeInfo* node : way->Nodes){
-                for(int i = 0; i < Way->Nodes.Num(); i++) {
-                    const double Lat = Way->Nodes[i]->Latitude;
-                    const double Lon = Way->Nodes[i]->Longitude;
-
-                    FVector Location = FVector(Lon, Lat, 0);
-
-                    // sometimes shapes are closed of with the first point, we dont need that
-                    if(i == Way->Nodes.Num() - 1
-                        && Location.Equals(Building.PolygonPoints[0]))
-                    {
-                        break;
-                    }
-                    Building.PolygonPoints.Add(Location);
-                }
-                Asset->Buildings.Add(Building);
-            } else
-            {
-                UE_LOG(LogTemp, Warning, TEXT("UOSMDataAssetFactory: Invalid Way"))
-            }
-        }
-    } else
-    {
-        UE_LOG(LogTemp, Error, TEXT("UOSMDataAssetFactory: Failed to parse osm file %s"), *File)
+    // extracts come from the parse of the buildings, which out of core imports and FlatGeobuf files do not have
+    if(bIsOutOfCore && (ImportSettings.bExtractPOIs || ImportSettings.bExtractAreas)) {
+        UE_LOG(LogTemp, Warning, TEXT("UOSMDataAssetFactory: Points of interest and areas are not extracted by out of core imports"))
+    }
+    const bool bCanExtract = !bIsOutOfCore && !bIsFlatGeobuf;
+    UOSMPOIDataAsset* POIAsset = bCanExtract && ImportSettings.bExtractPOIs
+        ? CreateSiblingAsset<UOSMPOIDataAsset>(InParent, InName, TEXT("_POI"), Flags) : nullptr;
+    UOSMAreaDataAsset* AreaAsset = bCanExtract && ImportSettings.bExtractAreas
+        ? CreateSiblingAsset<UOSMAreaDataAsset>(InParent, InName, TEXT("_Areas"), Flags) : nullptr;
+
+    const bool bBuilt = ImportBuildingSet(SourceFiles, ImportSettings, Asset, CreateAsset, Warn, POIAsset, AreaAsset);
+    Asset->AssetImportData->Update(Filename);
+    if(bBuilt && POIAsset) {
+        FinishSiblingAsset(POIAsset);
+    }
+    if(bBuilt && AreaAsset) {
+        FinishSiblingAsset(AreaAsset);
     }
 
     return Asset;
@@ -110,3 +130,178 @@ bool UOSMDataAssetFactory::FactoryCanImport(const FString & Filename)
 
     return true;
 }
+
+bool UOSMDataAssetFactory::CanReimport(UObject* Obj, TArray<FString>& OutFilenames)
+{
+    UOSMDataAsset* Asset = Cast<UOSMDataAsset>(Obj);
+    if(Asset && Asset->AssetImportData) {
+        Asset->AssetImportData->ExtractFilenames(OutFilenames);
+        return true;
+    }
+    return false;
+}
+
+void UOSMDataAssetFactory::SetReimportPaths(UObject* Obj, const TArray<FString>& NewReimportPaths)
+{
+    UOSMDataAsset* Asset = Cast<UOSMDataAsset>(Obj);
+    if(Asset && Asset->AssetImportData && ensure(NewReimportPaths.Num() == 1)) {
+        Asset->AssetImportData->UpdateFilenameOnly(NewReimportPaths[0]);
+    }
+}
+
+EReimportResult::Type UOSMDataAssetFactory::Reimport(UObject* Obj)
+{
+    UOSMDataAsset* Asset = Cast<UOSMDataAsset>(Obj);
+    if(!Asset || !Asset->AssetImportData) {
+        return EReimportResult::Failed;
+    }
+
+    const FString Filename = Asset->AssetImportData->GetFirstFilename();
+    if(Filename.IsEmpty() || !FPaths::FileExists(Filename)) {
+        UE_LOG(LogTemp, Error, TEXT("UOSMDataAssetFactory: Source file %s for reimport not found"), *Filename)
+        return EReimportResult::Failed;
+    }
+    TArray<FString> SourceFiles;
+    if(!GetSourceFiles(Filename, SourceFiles)) {
+        return EReimportResult::Failed;
+    }
+
+    // build the new state aside, the existing asset is only updated where buildings differ
+    auto CreateFresh = []()
+    {
+        return NewObject<UOSMDataAsset>(GetTransientPackage(), NAME_None, RF_Transient);
+    };
+    UOSMDataAsset* Fresh = CreateFresh();
+
+    // the extracts are refreshed from the same parse, they are small enough to be rebuilt as a whole
+    const FOSMImportSettings& Settings = Asset->ImportSettings;
+    const bool bCanExtract = !IsFlatGeobuf(SourceFiles) && !(Settings.bImportOutOfCore && SourceFiles.Num() == 1);
+    bool bPOIAssetCreated = false;
+    bool bAreaAssetCreated = false;
+    UOSMPOIDataAsset* POIAsset = bCanExtract && Settings.bExtractPOIs
+        ? FindOrCreateSiblingAsset<UOSMPOIDataAsset>(Asset, TEXT("_POI"), bPOIAssetCreated) : nullptr;
+    UOSMAreaDataAsset* AreaAsset = bCanExtract && Settings.bExtractAreas
+        ? FindOrCreateSiblingAsset<UOSMAreaDataAsset>(Asset, TEXT("_Areas"), bAreaAssetCreated) : nullptr;
+    // existing extracts are overwritten in place, like the asset itself
+    if(POIAsset && !bPOIAssetCreated) {
+        POIAsset->Modify();
+    }
+    if(AreaAsset && !bAreaAssetCreated) {
+        AreaAsset->Modify();
+    }
+
+    if(!ImportBuildingSet(SourceFiles, Settings, Fresh, CreateFresh, GWarn, POIAsset, AreaAsset)) {
+        return EReimportResult::Failed;
+    }
+    if(bPOIAssetCreated) {
+        FinishSiblingAsset(POIAsset);
+    } else if(POIAsset) {
+        POIAsset->MarkPackageDirty();
+    }
+    if(bAreaAssetCreated) {
+        FinishSiblingAsset(AreaAsset);
+    } else if(AreaAsset) {
+        AreaAsset->MarkPackageDirty();
+    }
+
+    // patched in place, record it for undo
+    Asset->Modify();
+    const FOSMDataAssetChangeSet Changes = FOSMDataAssetBuilder::ApplyUpdate(Asset, Fresh);
+    UE_LOG(LogTemp, Log, TEXT("UOSMDataAssetFactory: Reimported %s, buildings %d added / %d removed / %d modified / %d moved, multipolygon buildings %d added / %d removed / %d modified / %d moved"),
+        *Asset->GetName(),
+        Changes.AddedBuildings.Num(), Changes.RemovedBuildings.Num(), Changes.ModifiedBuildings.Num(), Changes.MovedBuildings.Num(),
+        Changes.AddedMPBuildings.Num(), Changes.RemovedMPBuildings.Num(), Changes.ModifiedMPBuildings.Num(), Changes.MovedMPBuildings.Num())
+
+    Asset->AssetImportData->Update(Filename);
+    if(!Changes.IsEmpty()) {
+        Asset->MarkPackageDirty();
+    }
+    return EReimportResult::Succeeded;
+}
+
+int32 UOSMDataAssetFactory::GetPriority() const
+{
+    return ImportPriority;
+}
+
+bool UOSMDataAssetFactory::GetSourceFiles(const FString& Filename, TArray<FString>& OutSourceFiles)
+{
+    if(FPaths::GetExtension(Filename).Equals(TEXT("osmlist"), ESearchCase::IgnoreCase)) {
+        return FOSMDataAssetBuilder::ReadFileList(Filename, OutSourceFiles);
+    }
+    OutSourceFiles = {Filename};
+    return true;
+}
+
+bool UOSMDataAssetFactory::ConfirmLargeImport(const TArray<FString>& SourceFiles) const
+{
+    // merged files are parsed at the same time, so their estimates add up
+    FOSMFileSummary Summary;
+    for(const FString& SourceFile : SourceFiles) {
+        FOSMFileSummary FileSummary;
+        if(!FOSMFileSummary::ScanFile(SourceFile, FileSummary)) {
+            // the parser reports unreadable files
+            return true;
+        }
+        Summary.FileSize += FileSummary.FileSize;
+        Summary.NumNodes += FileSummary.NumNodes;
+        Summary.NumWays += FileSummary.NumWays;
+        Summary.NumRelations += FileSummary.NumRelations;
+    }
+    const FString Filename = FString::Join(SourceFiles, TEXT(", "));
+    const int64 EstimatedMemory = Summary.GetEstimatedMemory();
+    UE_LOG(LogTemp, Log, TEXT("UOSMDataAssetFactory: %s has %d nodes, %d ways and %d relations, estimated %lld MB and %.0f s to parse"),
+        *Filename, Summary.NumNodes, Summary.NumWays, Summary.NumRelations,
+        EstimatedMemory / (1024 * 1024), Summary.GetEstimatedSeconds())
+
+    if(LargeImportWarningMB <= 0 || EstimatedMemory < static_cast<int64>(LargeImportWarningMB) * 1024 * 1024
+        || FApp::IsUnattended() || GIsRunningUnattendedScript) {
+        return true;
+    }
+    FFormatNamedArguments Args;
+    Args.Add(TEXT("File"), FText::FromString(SourceFiles.Num() == 1 ? FPaths::GetCleanFilename(SourceFiles[0]) : FString::Printf(TEXT("%d files"), SourceFiles.Num())));
+    Args.Add(TEXT("Nodes"), FText::AsNumber(Summary.NumNodes));
+    Args.Add(TEXT("Ways"), FText::AsNumber(Summary.NumWays));
+    Args.Add(TEXT("Relations"), FText::AsNumber(Summary.NumRelations));
+    Args.Add(TEXT("Memory"), FText::AsMemory(EstimatedMemory));
+    Args.Add(TEXT("Seconds"), FText::AsNumber(FMath::CeilToInt(Summary.GetEstimatedSeconds())));
+    const FText Message = FText::Format(LOCTEXT("LargeImport",
+        "{File} contains {Nodes} nodes, {Ways} ways and {Relations} relations.\n\n"
+        "Importing it needs about {Memory} of memory and {Seconds} seconds of parsing. Continue?"), Args);
+    return FMessageDialog::Open(EAppMsgType::YesNo, Message) == EAppReturnType::Yes;
+}
+
+bool UOSMDataAssetFactory::ImportBuildingSet(const TArray<FString>& SourceFiles, const FOSMImportSettings& Settings, UOSMDataAsset*& Asset, TFunctionRef<UOSMDataAsset*()> CreateAsset, FFeedbackContext* Warn, UOSMPOIDataAsset* POIAsset, UOSMAreaDataAsset* AreaAsset)
+{
+    const bool bHasExtracts = POIAsset || AreaAsset;
+    const FString CacheKey = bUseImportCache ? FOSMImportCache::BuildCacheKey(SourceFiles, Settings) : FString();
+    if(FOSMImportCache::Load(CacheKey, Asset)) {
+        // the cache only holds the buildings, the extracts need one parse without building assembly
+        return !bHasExtracts || FOSMDataAssetBuilder::BuildWithExtracts(SourceFiles, nullptr, Settings, POIAsset, AreaAsset, Warn);
+    }
+    if(!CacheKey.IsEmpty() && (Asset->Buildings.Num() > 0 || Asset->MultiPolygonBuildings.Num() > 0)) {
+        // an unusable cache entry may have left partial data behind, start over with a fresh object
+        Asset = CreateAsset();
+    }
+
+    // parsing and assembly live in the runtime module, failures are logged there
+    bool bBuilt;
+    if(IsFlatGeobuf(SourceFiles)) {
+        // the reader stores the footprints as configured on the asset
+        Asset->ImportSettings = Settings;
+        bBuilt = FOSMFlatGeobuf::ReadFromFile(SourceFiles[0], Asset);
+    } else if(bHasExtracts) {
+        bBuilt = FOSMDataAssetBuilder::BuildWithExtracts(SourceFiles, Asset, Settings, POIAsset, AreaAsset, Warn);
+    } else {
+        bBuilt = SourceFiles.Num() == 1
+            ? FOSMDataAssetBuilder::BuildFromFile(SourceFiles[0], Asset, Settings, Warn)
+            : FOSMDataAssetBuilder::BuildFromFiles(SourceFiles, Asset, Settings);
+    }
+    if(!bBuilt) {
+        return false;
+    }
+    FOSMImportCache::Store(CacheKey, Asset);
+    return true;
+}
+
+#undef LOCTEXT_NAMESPACE
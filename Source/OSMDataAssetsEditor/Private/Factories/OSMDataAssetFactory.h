@@ -1,18 +1,60 @@
 // Copyright (c) Iwer Petersen. All rights reserved.
 #pragma once
 
+#include "EditorReimportHandler.h"
 #include "Factories/Factory.h"
 #include "UObject/ObjectMacros.h"
+#include "OSMImportSettings.h"
 
 #include "OSMDataAssetFactory.generated.h"
 
+class UOSMDataAsset;
+class UOSMAreaDataAsset;
+class UOSMPOIDataAsset;
+
 UCLASS(BlueprintType, hidecategories=Object)
 class UOSMDataAssetFactory
     : public UFactory
+    , public FReimportHandler
 {
     GENERATED_BODY()
 public:
     UOSMDataAssetFactory(const FObjectInitializer& ObjectInitializer);
 	virtual UObject* FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms, FFeedbackContext* Warn, bool& bOutOperationCanceled) override;
     virtual bool FactoryCanImport(const FString & Filename) override;
+
+    // FReimportHandler interface
+    virtual bool CanReimport(UObject* Obj, TArray<FString>& OutFilenames) override;
+    virtual void SetReimportPaths(UObject* Obj, const TArray<FString>& NewReimportPaths) override;
+    virtual EReimportResult::Type Reimport(UObject* Obj) override;
+    virtual int32 GetPriority() const override;
+
+    UPROPERTY(EditAnywhere, Category="Import")
+    FOSMImportSettings ImportSettings;
+
+    /** Reuse assembled building sets from the derived data cache when the file and settings did not change */
+    UPROPERTY(EditAnywhere, Category="Import")
+    bool bUseImportCache = true;
+
+    /**
+     * Ask for confirmation before importing files whose estimated parse memory exceeds this many megabytes.
+     * 0 never asks.
+     */
+    UPROPERTY(EditAnywhere, Category="Import", meta=(ClampMin="0"))
+    int32 LargeImportWarningMB = 2048;
+
+private:
+    /** The .osm files of an import, Filename itself or the entries of an .osmlist. Returns false if there are none. */
+    static bool GetSourceFiles(const FString& Filename, TArray<FString>& OutSourceFiles);
+
+    /** Scans the source files and asks whether to continue if it is a large import. Returns false if the user declined. */
+    bool ConfirmLargeImport(const TArray<FString>& SourceFiles) const;
+
+    /**
+     * Fills Asset from the import cache or by parsing SourceFiles, merging them if there are several. If an
+     * unusable cache entry left partial data behind, Asset is replaced with a fresh object from CreateAsset.
+     * POIAsset and AreaAsset are filled from the same parse if set, a cache hit still parses the files once
+     * for them.
+     */
+    bool ImportBuildingSet(const TArray<FString>& SourceFiles, const FOSMImportSettings& Settings, UOSMDataAsset*& Asset, TFunctionRef<UOSMDataAsset*()> CreateAsset, FFeedbackContext* Warn, UOSMPOIDataAsset* POIAsset = nullptr, UOSMAreaDataAsset* AreaAsset = nullptr);
 };
@@ -0,0 +1,83 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#include "OSMImportCache.h"
+
+#include "DerivedDataCacheInterface.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "OSMDataAsset.h"
+#include "OSMDataAssetBuilder.h"
+
+FString FOSMImportCache::BuildCacheKey(const FString& Filename, const FOSMImportSettings& Settings)
+{
+    return BuildCacheKey(TArray<FString>{Filename}, Settings);
+}
+
+FString FOSMImportCache::BuildCacheKey(const TArray<FString>& Filenames, const FOSMImportSettings& Settings)
+{
+    // a single file keeps the plain content hash, merged imports hash the list of all content hashes
+    FString FileHash;
+    for(const FString& Filename : Filenames) {
+        const FMD5Hash Hash = FMD5Hash::HashFile(*Filename);
+        if(!Hash.IsValid()) {
+            return FString();
+        }
+        FileHash += LexToString(Hash);
+    }
+    if(Filenames.Num() != 1) {
+        FileHash = FMD5::HashAnsiString(*FileHash);
+    }
+
+    // any settings change has to produce a different key, so hash the binary representation of all fields
+    TArray<uint8> SettingsData;
+    FMemoryWriter SettingsWriter(SettingsData);
+    FOSMImportSettings SettingsCopy = Settings;
+    FOSMImportSettings::StaticStruct()->SerializeBin(SettingsWriter, &SettingsCopy);
+    const FString SettingsHash = FSHA1::HashBuffer(SettingsData.GetData(), SettingsData.Num()).ToString();
+
+    return FDerivedDataCacheInterface::BuildCacheKey(
+        TEXT("OSMDATAASSET"),
+        *FString::Printf(TEXT("%d"), FOSMDataAssetBuilder::BuilderVersion),
+        *FString::Printf(TEXT("%s_%s"), *FileHash, *SettingsHash));
+}
+
+bool FOSMImportCache::Load(const FString& CacheKey, UOSMDataAsset* Asset)
+{
+    if(CacheKey.IsEmpty()) {
+        return false;
+    }
+
+    TArray<uint8> Payload;
+    if(!GetDerivedDataCacheRef().GetSynchronous(*CacheKey, Payload, Asset->GetPathName())) {
+        return false;
+    }
+
+    FMemoryReader Reader(Payload);
+    uint32 Magic = 0;
+    Reader << Magic;
+    if(Magic != PayloadMagic) {
+        UE_LOG(LogTemp, Warning, TEXT("FOSMImportCache: Ignoring invalid cache entry %s"), *CacheKey)
+        return false;
+    }
+    Asset->SerializeBuildingSet(Reader);
+    if(Reader.IsError()) {
+        UE_LOG(LogTemp, Warning, TEXT("FOSMImportCache: Failed to read cache entry %s"), *CacheKey)
+        return false;
+    }
+    UE_LOG(LogTemp, Log, TEXT("FOSMImportCache: Restored %s from cache"), *Asset->GetName())
+    return true;
+}
+
+void FOSMImportCache::Store(const FString& CacheKey, UOSMDataAsset* Asset)
+{
+    if(CacheKey.IsEmpty()) {
+        return;
+    }
+
+    TArray<uint8> Payload;
+    FMemoryWriter Writer(Payload);
+    uint32 Magic = PayloadMagic;
+    Writer << Magic;
+    Asset->SerializeBuildingSet(Writer);
+    GetDerivedDataCacheRef().Put(*CacheKey, Payload, Asset->GetPathName());
+}
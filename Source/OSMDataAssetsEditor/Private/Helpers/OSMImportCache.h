@@ -0,0 +1,31 @@
+// Copyright (c) Iwer Petersen. All rights reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OSMImportSettings.h"
+
+class UOSMDataAsset;
+
+/**
+ * Caches fully assembled building sets in the derived data cache, keyed by the content hash of the
+ * source file, the import settings and the builder version. Shared caches make repeated imports on
+ * fresh checkouts and build agents as cheap as a cache read.
+ */
+class FOSMImportCache
+{
+public:
+    /** Computes the cache key for Filename, returns an empty string if the file can not be read */
+    static FString BuildCacheKey(const FString& Filename, const FOSMImportSettings& Settings);
+
+    /** Computes the cache key for a merged import of Filenames, returns an empty string if a file can not be read */
+    static FString BuildCacheKey(const TArray<FString>& Filenames, const FOSMImportSettings& Settings);
+
+    /** Fills Asset from the cache. Returns false on a cache miss or if the cached data was unusable. */
+    static bool Load(const FString& CacheKey, UOSMDataAsset* Asset);
+
+    /** Stores the building set of Asset under CacheKey */
+    static void Store(const FString& CacheKey, UOSMDataAsset* Asset);
+
+private:
+    static constexpr uint32 PayloadMagic = 0x434D534F; // "OSMC"
+};